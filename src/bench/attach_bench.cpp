@@ -0,0 +1,112 @@
+#include <map>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "../common/Utility.h"
+#include "../common/os/pstree.hpp"
+#include "../daemon/ProcessSnapshot.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Startup attach: <apps> applications on a host with <processes> processes,
+// compare command line map built from os::pstree(1) (rebuilt for every app
+// configured with pid) with one snapshot indexed by pid and command line hash
+//////////////////////////////////////////////////////////////////////////
+
+static void buildProcessMap(std::map<std::string, int>& processList, const os::ProcessTree& tree)
+{
+	processList[Utility::stdStringTrim(tree.process.command)] = tree.process.pid;
+	for (const auto& child : tree.children)
+	{
+		buildProcessMap(processList, child);
+	}
+}
+
+static double elapsedMs(const std::chrono::steady_clock::time_point& begin)
+{
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000;
+}
+
+int main(int argc, char* argv[])
+{
+	const int appCount = (argc > 1) ? std::stoi(argv[1]) : 2000;
+	const int processCount = (argc > 2) ? std::stoi(argv[2]) : 20000;
+	std::cout << "applications: " << appCount << ", host processes: " << processCount << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	// every 5th application shares command line with the previous one,
+	// every 10th application is configured with pid, every 50th of them with a reused pid
+	std::mt19937 rng(42);
+	std::vector<std::string> commands(appCount);
+	std::vector<pid_t> pids(appCount);
+	std::vector<uint64_t> startTimes(appCount);
+	std::list<os::Process> processes;
+	auto snapshot = std::make_shared<ProcessSnapshot>();
+	pid_t next = 2;
+	for (int i = 0; i < processCount; i++, next++)
+	{
+		std::string command;
+		uint64_t startTime = 1000 + next;
+		if (i < appCount)
+		{
+			commands[i] = (i % 5 == 4) ? commands[i - 1] : "/opt/app/bin/worker --id " + std::to_string(i);
+			command = commands[i];
+			pids[i] = next;
+			startTimes[i] = (i % 500 == 0) ? startTime + 1 : startTime;
+		}
+		else
+		{
+			command = "/usr/bin/host-process " + std::to_string(i);
+		}
+		pid_t parent = (i < 16) ? 1 : 2 + (pid_t)(rng() % 16);
+		processes.emplace_back(next, parent, next, next, 4096, std::chrono::seconds(0), std::chrono::seconds(0), 0, 1, command, false);
+		snapshot->add(next, startTime, command);
+	}
+	processes.emplace_back(1, 0, 1, 1, 4096, std::chrono::seconds(0), std::chrono::seconds(0), 0, 1, "/sbin/init", false);
+
+	// previous: one map for all apps plus one for every app configured with pid
+	auto begin = std::chrono::steady_clock::now();
+	std::map<std::string, int> processMap;
+	buildProcessMap(processMap, *os::pstree(1, processes));
+	auto mapMs = elapsedMs(begin);
+	size_t mapAttached = 0;
+	for (int i = 0; i < appCount; i++)
+	{
+		if (processMap.erase(commands[i])) mapAttached++;
+	}
+	const int pinned = (appCount + 9) / 10;
+	std::cout << "pstree map:     " << mapMs << " ms, attached " << mapAttached << ", estimated total with "
+		<< pinned << " pid attach " << mapMs * (pinned + 1) / 1000 << " s" << std::endl;
+
+	// current: pinned apps claim by pid + start time, the rest by command line
+	begin = std::chrono::steady_clock::now();
+	size_t attached = 0;
+	size_t rejected = 0;
+	for (int i = 0; i < appCount; i += 10)
+	{
+		if (snapshot->claim(pids[i], commands[i], startTimes[i])) attached++;
+		else rejected++;
+	}
+	for (int i = 0; i < appCount; i++)
+	{
+		if (i % 10 == 0 && i % 500 != 0) continue;
+		uint64_t startTime = 0;
+		if (snapshot->claim(commands[i], startTime) > 0) attached++;
+	}
+	auto claimMs = elapsedMs(begin);
+	std::cout << "snapshot claim: " << claimMs << " ms, attached " << attached << ", reused pid rejected " << rejected << std::endl;
+
+	// cost to read this host
+	begin = std::chrono::steady_clock::now();
+	auto host = ProcessSnapshot::capture();
+	auto captureMs = elapsedMs(begin);
+	std::cout << "capture /proc:  " << captureMs << " ms for " << host->size() << " processes, "
+		<< (host->size() ? captureMs * 1000 / host->size() : 0) << " us/process" << std::endl;
+
+	if (attached != (size_t)appCount)
+	{
+		std::cerr << "attached " << attached << " of " << appCount << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include <queue>
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include "../common/Utility.h"
+#include "../common/CronExpression.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Cron schedule: parse <count> generated expressions, compute next fire
+// time of each in system time zone and in a posix time zone, then fire
+// them from one min-heap for one simulated day against scanning next
+// times for the earliest (sample only, it is quadratic).
+//////////////////////////////////////////////////////////////////////////
+
+static double elapsedSeconds(const std::chrono::steady_clock::time_point& begin)
+{
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000000;
+}
+
+static void printRate(const std::string& name, size_t count, double seconds)
+{
+	std::cout << name << count / seconds << " ops/s (" << seconds * 1000 << " ms)" << std::endl;
+}
+
+static std::string generate(std::mt19937& rng)
+{
+	static const char* const PATTERNS[] = {
+		"*/%d * * * *", "%d * * * *", "%d %d * * *", "%d %d * * MON-FRI", "%d %d 1 * *",
+		"%d %d 1,15 * *", "0 %d-%d * * *", "*/%d 9-17 * * 1-5", "%d %d * JAN,JUL *", "%d %d 13 * FRI"
+	};
+	std::uniform_int_distribution<int> pattern(0, 9);
+	std::uniform_int_distribution<int> minute(1, 59);
+	std::uniform_int_distribution<int> hour(0, 11);
+	char buffer[64];
+	auto index = pattern(rng);
+	if (index == 6)
+	{
+		auto low = hour(rng);
+		snprintf(buffer, sizeof(buffer), PATTERNS[index], low, low + hour(rng));
+	}
+	else if (index == 0 || index == 1 || index == 7)
+	{
+		snprintf(buffer, sizeof(buffer), PATTERNS[index], minute(rng));
+	}
+	else
+	{
+		snprintf(buffer, sizeof(buffer), PATTERNS[index], minute(rng), hour(rng) * 2);
+	}
+	return buffer;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t count = (argc > 1) ? std::stoul(argv[1]) : 100000;
+	std::cout << "expressions: " << count << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	std::mt19937 rng(42);
+	std::vector<std::string> expressions;
+	for (size_t i = 0; i < count; i++) expressions.push_back(generate(rng));
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<std::unique_ptr<CronExpression>> crons;
+	for (const auto& expression : expressions) crons.push_back(std::make_unique<CronExpression>(expression));
+	printRate("parse:                  ", count, elapsedSeconds(begin));
+
+	const auto now = std::chrono::system_clock::now();
+	const time_t nowTime = std::chrono::system_clock::to_time_t(now);
+	std::tm local;
+	localtime_r(&nowTime, &local);
+	std::tm result;
+	size_t fired = 0;
+	begin = std::chrono::steady_clock::now();
+	for (const auto& cron : crons) fired += cron->next(local, result);
+	printRate("next wall clock:        ", count, elapsedSeconds(begin));
+
+	std::vector<std::chrono::system_clock::time_point> nextTimes(count);
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++) nextTimes[i] = crons[i]->next(now, "");
+	printRate("next system zone:       ", count, elapsedSeconds(begin));
+
+	begin = std::chrono::steady_clock::now();
+	for (const auto& cron : crons) cron->next(now, "EST-5EDT,M3.2.0/2,M11.1.0/2");
+	printRate("next posix_timezone:    ", count, elapsedSeconds(begin));
+
+	// fire one day: heap pops the earliest, scan looks for it in all next times
+	typedef std::pair<std::chrono::system_clock::time_point, size_t> Entry;
+	const auto end = now + std::chrono::hours(24);
+	begin = std::chrono::steady_clock::now();
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+	for (size_t i = 0; i < count; i++) heap.push(Entry(nextTimes[i], i));
+	size_t heapFired = 0;
+	while (heap.size() && heap.top().first < end)
+	{
+		auto entry = heap.top();
+		heap.pop();
+		heap.push(Entry(crons[entry.second]->next(entry.first, ""), entry.second));
+		heapFired++;
+	}
+	printRate("one day fire heap:      ", heapFired, elapsedSeconds(begin));
+
+	const size_t scanCount = std::min(count, (size_t)2000);
+	auto scanTimes = std::vector<std::chrono::system_clock::time_point>(nextTimes.begin(), nextTimes.begin() + scanCount);
+	size_t scanFired = 0;
+	begin = std::chrono::steady_clock::now();
+	while (true)
+	{
+		size_t earliest = 0;
+		for (size_t i = 1; i < scanCount; i++)
+		{
+			if (scanTimes[i] < scanTimes[earliest]) earliest = i;
+		}
+		if (scanTimes[earliest] >= end) break;
+		scanTimes[earliest] = crons[earliest]->next(scanTimes[earliest], "");
+		scanFired++;
+	}
+	printRate("one day fire scan " + std::to_string(scanCount) + ": ", scanFired, elapsedSeconds(begin));
+	std::cout << "fired in one day: " << heapFired << std::endl;
+	return fired == count ? 0 : 1;
+}
@@ -0,0 +1,333 @@
+#include <pwd.h>
+#include <unistd.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <ace/Init_ACE.h>
+#include <pplx/threadpool.h>
+#include <cpprest/http_client.h>
+#include "../daemon/AppProcess.h"
+#include "../daemon/MonitoredProcess.h"
+#include "../daemon/ProcessSnapshot.h"
+#include "../daemon/Configuration.h"
+#include "../daemon/StartupPlan.h"
+#include "../daemon/RestHandler.h"
+#include "../daemon/PrometheusRest.h"
+#include "../daemon/ResourceCollection.h"
+#include "../common/JsonWriter.h"
+#include "../common/Utility.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Daemon hot paths in process, without network or docker: process spawn,
+// /proc snapshot against process count, configuration persistence against
+// application count, output capture throughput, scheduler tick against
+// application count and REST dispatch per route with and without JWT
+// (requests go through the loopback listener, routing is private to
+// RestHandler). Results are written to <result.json> to diff versions.
+//////////////////////////////////////////////////////////////////////////
+
+// sample configuration, all applications are replaced
+static const char* SAMPLE_CONFIG = "../daemon/appsvc.json";
+static const char* SLEEP_COMMAND = "sleep 600";
+static const int HTTP_THREAD_POOL_SIZE = 6;
+
+class Samples
+{
+public:
+	void add(const std::chrono::steady_clock::time_point& begin)
+	{
+		m_micros.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count() / 1000);
+	}
+	double percentile(int percent) const
+	{
+		if (m_micros.empty()) return 0;
+		auto sorted = m_micros;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+	}
+	web::json::value AsJson() const
+	{
+		double total = 0;
+		for (auto micros : m_micros) total += micros;
+		web::json::value result = web::json::value::object();
+		result["count"] = web::json::value::number((uint64_t)m_micros.size());
+		result["avg_us"] = web::json::value::number(m_micros.size() ? total / m_micros.size() : 0);
+		result["p50_us"] = web::json::value::number(percentile(50));
+		result["p99_us"] = web::json::value::number(percentile(99));
+		result["max_us"] = web::json::value::number(percentile(100));
+		return result;
+	}
+	void print(const std::string& name) const
+	{
+		std::cout << name << "p50 " << percentile(50) << " us, p99 " << percentile(99) << " us, max " << percentile(100) << " us" << std::endl;
+	}
+
+private:
+	std::vector<double> m_micros;
+};
+
+static std::string currentUser()
+{
+	auto pw = getpwuid(getuid());
+	return pw ? pw->pw_name : "root";
+}
+
+// sample configuration with <count> generated applications
+static std::shared_ptr<Configuration> buildConfig(int count, const std::string& command, bool enabled, bool jwt, int port)
+{
+	std::ifstream file(SAMPLE_CONFIG);
+	if (!file.is_open()) throw std::invalid_argument(std::string("can not open ") + SAMPLE_CONFIG);
+	std::string str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	auto json = web::json::value::parse(GET_STRING_T(str));
+	json[JSON_KEY_SSLEnabled] = web::json::value::boolean(false);
+	json[JSON_KEY_JWTEnabled] = web::json::value::boolean(jwt);
+	json[JSON_KEY_RestListenAddress] = web::json::value::string("127.0.0.1");
+	json[JSON_KEY_RestListenPort] = web::json::value::number(port);
+	json[JSON_KEY_PrometheusExporterListenPort] = web::json::value::number(0);
+	json[JSON_KEY_LogLevel] = web::json::value::string("ERROR");
+	json[JSON_KEY_ProcessTrackerEnabled] = web::json::value::boolean(false);
+	json[JSON_KEY_OutputStoreEnabled] = web::json::value::boolean(false);
+	// rate 0 is no limit, the client is always the same
+	for (auto& routeClass : json[JSON_KEY_RateLimit].as_object())
+	{
+		routeClass.second[JSON_KEY_RATE_user_rate] = web::json::value::number(0);
+		routeClass.second[JSON_KEY_RATE_client_rate] = web::json::value::number(0);
+	}
+	auto apps = web::json::value::array(count);
+	for (int i = 0; i < count; i++)
+	{
+		auto app = web::json::value::object();
+		app[JSON_KEY_APP_name] = web::json::value::string(GET_STRING_T("bench" + std::to_string(i)));
+		app[JSON_KEY_APP_command] = web::json::value::string(GET_STRING_T(command));
+		app[JSON_KEY_APP_user] = web::json::value::string(GET_STRING_T(currentUser()));
+		app[JSON_KEY_APP_working_dir] = web::json::value::string("/tmp");
+		app[JSON_KEY_APP_status] = web::json::value::number(enabled ? 1 : 0);
+		apps[i] = app;
+	}
+	json[JSON_KEY_Applications] = apps;
+	return Configuration::FromJson(GET_STD_STRING(json.serialize()));
+}
+
+static web::json::value benchSpawn(int iterations)
+{
+	Samples spawn, spawnExit;
+	for (int i = 0; i < iterations; i++)
+	{
+		AppProcess process(0);
+		auto begin = std::chrono::steady_clock::now();
+		if (process.spawnProcess("/bin/true", "", "/tmp", {}, nullptr) <= 0) throw std::runtime_error("spawn /bin/true failed");
+		spawn.add(begin);
+		process.wait();
+		spawnExit.add(begin);
+	}
+	spawn.print("spawn:                   ");
+	spawnExit.print("spawn and exit:          ");
+	web::json::value result = web::json::value::object();
+	result["spawn"] = spawn.AsJson();
+	result["spawn_exit"] = spawnExit.AsJson();
+	return result;
+}
+
+static web::json::value benchSnapshot(const std::vector<int>& counts, int iterations)
+{
+	auto result = web::json::value::array(counts.size());
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		std::vector<std::unique_ptr<AppProcess>> children;
+		for (int i = 0; i < counts[c]; i++)
+		{
+			children.push_back(std::make_unique<AppProcess>(0));
+			children.back()->spawnProcess(SLEEP_COMMAND, "", "/tmp", {}, nullptr);
+		}
+		Samples capture;
+		size_t processes = 0;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			processes = ProcessSnapshot::capture()->size();
+			capture.add(begin);
+		}
+		capture.print("proc snapshot " + std::to_string(processes) + " processes: ");
+		for (auto& child : children)
+		{
+			child->killgroup();
+			child->wait();
+		}
+		result[c] = capture.AsJson();
+		result[c]["children"] = web::json::value::number(counts[c]);
+		result[c]["processes"] = web::json::value::number((uint64_t)processes);
+	}
+	return result;
+}
+
+static web::json::value benchSaveConfig(const std::vector<int>& counts, int iterations, int port)
+{
+	auto result = web::json::value::array(counts.size());
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		Configuration::instance(buildConfig(counts[c], SLEEP_COMMAND, false, true, port));
+		Samples save;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			Configuration::instance()->saveConfigToDisk();
+			save.add(begin);
+		}
+		save.print("saveConfigToDisk " + std::to_string(counts[c]) + " apps: ");
+		result[c] = save.AsJson();
+		result[c]["apps"] = web::json::value::number(counts[c]);
+	}
+	return result;
+}
+
+static web::json::value benchOutputCapture(uint64_t lines)
+{
+	// bytes written by seq
+	uint64_t bytes = 0;
+	for (uint64_t low = 1, digits = 1; low <= lines; low *= 10, digits++)
+	{
+		bytes += (std::min(lines, low * 10 - 1) - low + 1) * (digits + 1);
+	}
+	MonitoredProcess process(256, true);
+	auto begin = std::chrono::steady_clock::now();
+	if (process.spawnProcess("seq 1 " + std::to_string(lines), "", "/tmp", {}, nullptr) <= 0) throw std::runtime_error("spawn seq failed");
+	// wait joins the pipe reader thread
+	process.wait();
+	const double seconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000000;
+	std::cout << "output capture:          " << bytes / seconds / 1024 / 1024 << " MB/s, " << lines / seconds << " lines/s" << std::endl;
+	web::json::value result = web::json::value::object();
+	result["lines"] = web::json::value::number(lines);
+	result["bytes"] = web::json::value::number(bytes);
+	result["seconds"] = web::json::value::number(seconds);
+	result["mb_per_second"] = web::json::value::number(bytes / seconds / 1024 / 1024);
+	return result;
+}
+
+static web::json::value benchSchedulerTick(const std::vector<int>& counts, int iterations, int port)
+{
+	auto result = web::json::value::array(counts.size());
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		Configuration::instance(buildConfig(counts[c], SLEEP_COMMAND, true, true, port));
+		// first tick starts all applications, the others only check them
+		Samples first, steady;
+		auto begin = std::chrono::steady_clock::now();
+		Configuration::instance()->getStartupPlan()->invoke(Configuration::instance()->getStartupConcurrency());
+		first.add(begin);
+		for (int i = 0; i < iterations; i++)
+		{
+			begin = std::chrono::steady_clock::now();
+			Configuration::instance()->getStartupPlan()->invoke(Configuration::instance()->getStartupConcurrency());
+			steady.add(begin);
+		}
+		steady.print("scheduler tick " + std::to_string(counts[c]) + " apps: ");
+		for (auto& app : Configuration::instance()->getApps()) app->disable();
+		result[c] = steady.AsJson();
+		result[c]["apps"] = web::json::value::number(counts[c]);
+		result[c]["first_tick"] = first.AsJson();
+	}
+	return result;
+}
+
+static Samples requestRoute(web::http::client::http_client& client, const std::string& path, const std::string& token, int iterations)
+{
+	Samples samples;
+	for (int i = 0; i < iterations; i++)
+	{
+		web::http::http_request request(web::http::methods::GET);
+		request.set_request_uri(path);
+		if (token.length()) request.headers().add(HTTP_HEADER_JWT_Authorization, std::string(HTTP_HEADER_JWT_BearerSpace) + token);
+		auto begin = std::chrono::steady_clock::now();
+		auto response = client.request(request).get();
+		response.extract_utf8string(true).get();
+		samples.add(begin);
+		if (response.status_code() != web::http::status_codes::OK)
+		{
+			throw std::runtime_error("GET " + path + " failed with status " + std::to_string(response.status_code()));
+		}
+	}
+	return samples;
+}
+
+static web::json::value benchRest(int apps, int iterations, int port)
+{
+	static const char* const ROUTES[] = { "/app-manager/applications", "/app/bench0", "/app-manager/resources", "/labels", "/app-manager/config" };
+
+	auto jwtConfig = buildConfig(apps, SLEEP_COMMAND, false, true, port);
+	auto openConfig = buildConfig(apps, SLEEP_COMMAND, false, false, port);
+	Configuration::instance(jwtConfig);
+	auto handler = std::make_shared<RestHandler>("127.0.0.1", port);
+	web::http::client::http_client client("http://127.0.0.1:" + std::to_string(port));
+
+	web::http::http_request login(web::http::methods::POST);
+	login.set_request_uri("/login");
+	login.headers().add(HTTP_HEADER_JWT_username, Utility::encode64("admin"));
+	login.headers().add(HTTP_HEADER_JWT_password, Utility::encode64("Admin123"));
+	auto loginResponse = client.request(login).get();
+	if (loginResponse.status_code() != web::http::status_codes::OK) throw std::runtime_error("login failed");
+	const auto token = GET_STD_STRING(loginResponse.extract_json(true).get().at(HTTP_HEADER_JWT_access_token).as_string());
+
+	auto result = web::json::value::array(sizeof(ROUTES) / sizeof(ROUTES[0]));
+	for (size_t r = 0; r < sizeof(ROUTES) / sizeof(ROUTES[0]); r++)
+	{
+		// configuration is read for each request, JWTEnabled is switched by instance
+		Configuration::instance(jwtConfig);
+		auto jwt = requestRoute(client, ROUTES[r], token, iterations);
+		Configuration::instance(openConfig);
+		auto open = requestRoute(client, ROUTES[r], "", iterations);
+		jwt.print(std::string("GET ") + ROUTES[r] + " jwt: ");
+		open.print(std::string("GET ") + ROUTES[r] + " no jwt: ");
+		result[r] = web::json::value::object();
+		result[r]["route"] = web::json::value::string(ROUTES[r]);
+		result[r]["jwt"] = jwt.AsJson();
+		result[r]["no_jwt"] = open.AsJson();
+		result[r]["auth_p50_us"] = web::json::value::number(jwt.percentile(50) - open.percentile(50));
+	}
+	handler = nullptr;
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string resultFile = (argc > 1) ? argv[1] : "daemon_bench_result.json";
+	const int port = (argc > 2) ? std::stoi(argv[2]) : 16060;
+	const int iterations = (argc > 3) ? std::stoi(argv[3]) : 200;
+	std::cout << "result: " << resultFile << ", rest port: " << port << ", iterations: " << iterations << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	try
+	{
+		ACE::init();
+		Utility::initLogging();
+		Utility::setLogLevel("ERROR");
+		crossplat::threadpool::initialize_with_threads(HTTP_THREAD_POOL_SIZE);
+		PrometheusRest::instance(std::make_shared<PrometheusRest>("127.0.0.1", 0));
+		ResourceCollection::instance()->getHostResource();
+		// no timer thread: timers registered by processes (exit wait, kill) are not fired, the bench waits itself
+
+		web::json::value result = web::json::value::object();
+		result["iterations"] = web::json::value::number(iterations);
+		result["spawn"] = benchSpawn(iterations);
+		result["proc_snapshot"] = benchSnapshot({ 0, 100, 500 }, std::max(iterations / 10, 5));
+		result["save_config"] = benchSaveConfig({ 10, 100, 1000 }, std::max(iterations / 10, 5), port);
+		result["output_capture"] = benchOutputCapture(2000000);
+		result["scheduler_tick"] = benchSchedulerTick({ 10, 100, 500 }, std::max(iterations / 10, 5), port);
+		result["rest"] = benchRest(100, iterations, port);
+
+		std::ofstream ofs(resultFile, std::ios::trunc);
+		ofs << JsonWriter::toString(result, true) << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "failed: " << e.what() << std::endl;
+		return 1;
+	}
+	ACE::fini();
+	return 0;
+}
@@ -0,0 +1,307 @@
+#include <set>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../common/Utility.h"
+#include "../daemon/DockerApiClient.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Docker Engine API client against a local stand-in server on a unix
+// socket: the server answers the endpoints DockerApiClient uses (container
+// create/start/inspect/remove/logs, image inspect/pull) with Content-Length,
+// chunked and read-to-close responses. Every client call is checked first,
+// then <count> create/start/inspect/remove cycles are timed. Exit code is
+// the number of failed checks.
+//////////////////////////////////////////////////////////////////////////
+
+class FakeDockerServer
+{
+public:
+	explicit FakeDockerServer(const std::string& socketFile)
+		:m_socketFile(socketFile), m_stop(false), m_nextId(1)
+	{
+		::unlink(m_socketFile.c_str());
+		m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		struct sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, m_socketFile.c_str(), sizeof(addr.sun_path) - 1);
+		if (m_fd < 0 || ::bind(m_fd, (struct sockaddr*) & addr, sizeof(addr)) != 0 || ::listen(m_fd, 16) != 0)
+		{
+			throw std::runtime_error(std::string("listen on ") + m_socketFile + " failed: " + std::strerror(errno));
+		}
+		m_thread = std::thread(&FakeDockerServer::run, this);
+	}
+	virtual ~FakeDockerServer()
+	{
+		m_stop = true;
+		::shutdown(m_fd, SHUT_RDWR);
+		::close(m_fd);
+		m_thread.join();
+		::unlink(m_socketFile.c_str());
+	}
+
+private:
+	struct Container
+	{
+		std::string id;
+		std::string name;
+		bool started;
+	};
+
+	void run()
+	{
+		while (!m_stop)
+		{
+			int client = ::accept(m_fd, nullptr, nullptr);
+			if (client < 0)
+			{
+				if (errno == EINTR) continue;
+				break;
+			}
+			try
+			{
+				serve(client);
+			}
+			catch (...)
+			{
+			}
+			::close(client);
+		}
+	}
+
+	void serve(int client)
+	{
+		// request line, headers and Content-Length body
+		std::string buffer;
+		size_t headerEnd;
+		char data[4096];
+		while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+		{
+			auto rt = ::recv(client, data, sizeof(data), 0);
+			if (rt <= 0) return;
+			buffer.append(data, rt);
+		}
+		auto headers = Utility::splitString(buffer.substr(0, headerEnd), "\r\n");
+		size_t contentLength = 0;
+		for (const auto& header : headers)
+		{
+			if (header.find("Content-Length:") == 0) contentLength = std::stoul(header.substr(15));
+		}
+		while (buffer.length() < headerEnd + 4 + contentLength)
+		{
+			auto rt = ::recv(client, data, sizeof(data), 0);
+			if (rt <= 0) return;
+			buffer.append(data, rt);
+		}
+		std::istringstream requestLine(headers.at(0));
+		std::string method, target;
+		requestLine >> method >> target;
+		auto query = target.find('?');
+		const std::string path = target.substr(0, query);
+		const std::string params = (query == std::string::npos) ? "" : target.substr(query + 1);
+		auto segments = Utility::splitString(path, "/");
+
+		if (method == "POST" && path == "/containers/create")
+		{
+			const auto name = queryValue(params, "name");
+			if (findContainer(name) != m_containers.end()) return reply(client, 409, "{\"message\": \"Conflict. The container name is already in use\"}");
+			Container container{ "c" + std::to_string(m_nextId++), name, false };
+			m_containers.push_back(container);
+			return reply(client, 201, "{\"Id\": \"" + container.id + "\", \"Warnings\": []}");
+		}
+		if (segments.size() >= 2 && segments[0] == "containers")
+		{
+			auto container = findContainer(segments[1]);
+			if (container == m_containers.end()) return reply(client, 404, "{\"message\": \"No such container: " + segments[1] + "\"}");
+			if (method == "POST" && segments.size() == 3 && segments[2] == "start")
+			{
+				if (container->started) return reply(client, 304, "");
+				container->started = true;
+				return reply(client, 204, "");
+			}
+			if (method == "GET" && segments.size() == 3 && segments[2] == "json")
+			{
+				return reply(client, 200, "{\"Id\": \"" + container->id + "\", \"Name\": \"/" + container->name +
+					"\", \"State\": {\"Running\": " + (container->started ? "true" : "false") + ", \"Pid\": " + std::to_string(::getpid()) + "}}");
+			}
+			if (method == "GET" && segments.size() == 3 && segments[2] == "logs")
+			{
+				// stdout and stderr frames, chunk boundaries in the middle of frames
+				auto stream = frame(1, "hello stdout\n") + frame(2, "hello stderr\n") + frame(1, "bye\n");
+				return replyChunked(client, 200, { stream.substr(0, 5), stream.substr(5, 20), stream.substr(25) });
+			}
+			if (method == "DELETE" && segments.size() == 2)
+			{
+				m_containers.erase(container);
+				return reply(client, 204, "");
+			}
+		}
+		if (method == "GET" && segments.size() >= 3 && segments[0] == "images" && segments.back() == "json")
+		{
+			auto image = path.substr(strlen("/images/"), path.length() - strlen("/images/") - strlen("/json"));
+			if (m_images.count(image) == 0) return reply(client, 404, "{\"message\": \"No such image: " + image + "\"}");
+			// no Content-Length, body ends with connection close
+			return replyUntilClose(client, 200, "{\"Id\": \"sha256:" + image + "\"}");
+		}
+		if (method == "POST" && path == "/images/create")
+		{
+			auto image = queryValue(params, "fromImage");
+			if (image == "missing") return replyChunked(client, 200, { "{\"status\": \"Pulling\"}\n", "{\"error\": \"repository missing not found\"}\n" });
+			m_images.insert(image + ":" + queryValue(params, "tag"));
+			return replyChunked(client, 200, { "{\"status\": \"Pulling\"}\n{\"status\": \"Downlo", "ading\", \"progress\": \"50%\"}\n", "{\"status\": \"Downloaded\"}\n" });
+		}
+		reply(client, 404, "{\"message\": \"page not found\"}");
+	}
+
+	std::vector<Container>::iterator findContainer(const std::string& idOrName)
+	{
+		return std::find_if(m_containers.begin(), m_containers.end(), [&idOrName](const Container& c) { return c.id == idOrName || c.name == idOrName; });
+	}
+
+	static std::string queryValue(const std::string& params, const std::string& key)
+	{
+		for (const auto& param : Utility::splitString(params, "&"))
+		{
+			if (param.find(key + "=") == 0) return param.substr(key.length() + 1);
+		}
+		return std::string();
+	}
+
+	static std::string frame(char type, const std::string& payload)
+	{
+		std::string header(8, '\0');
+		header[0] = type;
+		header[7] = (char)payload.length();
+		return header + payload;
+	}
+
+	static void send(int client, const std::string& data)
+	{
+		size_t sent = 0;
+		while (sent < data.length())
+		{
+			auto rt = ::send(client, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+			if (rt <= 0) return;
+			sent += rt;
+		}
+	}
+
+	static void reply(int client, int status, const std::string& body)
+	{
+		send(client, "HTTP/1.1 " + std::to_string(status) + " X\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.length()) + "\r\n\r\n" + body);
+	}
+
+	static void replyUntilClose(int client, int status, const std::string& body)
+	{
+		send(client, "HTTP/1.1 " + std::to_string(status) + " X\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n" + body);
+	}
+
+	static void replyChunked(int client, int status, const std::vector<std::string>& chunks)
+	{
+		std::stringstream ss;
+		ss << "HTTP/1.1 " << status << " X\r\nTransfer-Encoding: chunked\r\n\r\n";
+		for (const auto& chunk : chunks) ss << std::hex << chunk.length() << "\r\n" << chunk << "\r\n";
+		ss << "0\r\n\r\n";
+		send(client, ss.str());
+	}
+
+private:
+	const std::string m_socketFile;
+	int m_fd;
+	std::atomic<bool> m_stop;
+	std::thread m_thread;
+	int m_nextId;
+	std::vector<Container> m_containers;
+	std::set<std::string> m_images;
+};
+
+static int failures = 0;
+
+static void check(const std::string& name, bool result)
+{
+	std::cout << (result ? "ok     " : "FAILED ") << name << std::endl;
+	if (!result) failures++;
+}
+
+template<class Func>
+static bool throws(Func func)
+{
+	try
+	{
+		func();
+	}
+	catch (const std::exception&)
+	{
+		return true;
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	const int count = (argc > 1) ? std::stoi(argv[1]) : 2000;
+	const std::string socketFile = (argc > 2) ? argv[2] : "/tmp/docker_bench.sock";
+	std::cout << "socket: " << socketFile << ", cycles: " << count << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	FakeDockerServer server(socketFile);
+	DockerApiClient client(socketFile);
+
+	// container
+	auto id = client.createContainer("app1", web::json::value::object());
+	check("create container", id == "c1");
+	check("create duplicated name is refused", throws([&]() { client.createContainer("app1", web::json::value::object()); }));
+	client.startContainer(id);
+	check("start started container (304)", !throws([&]() { client.startContainer(id); }));
+	auto inspect = client.inspectContainer("app1");
+	check("inspect container pid", !inspect.is_null() && GET_JSON_INT_VALUE(inspect.at("State"), "Pid") == ::getpid());
+	check("inspect missing container is null", client.inspectContainer("nope").is_null());
+	check("chunked multiplexed logs", client.containerLogs(id, 10) == "hello stdout\nhello stderr\nbye\n");
+	check("remove container", client.removeContainer(id, true));
+	check("remove missing container", !client.removeContainer(id, true));
+
+	// image
+	check("inspect missing image is null", client.inspectImage("busybox:latest").is_null());
+	int progress = 0;
+	client.pullImage("busybox", 10, [&progress](const web::json::value&) { progress++; });
+	check("pull image progress split over chunks", progress == 3);
+	check("inspect image read until close", !client.inspectImage("busybox:latest").is_null());
+	check("pull error in progress stream", throws([&]() { client.pullImage("missing", 10); }));
+
+	// stale socket: every call throws, callers log it and go on
+	DockerApiClient stale(socketFile + ".stale");
+	check("stale socket throws", throws([&]() { stale.removeContainer("app1", true); }));
+
+	// create/start/inspect/remove cycle as DockerProcess does for one spawn
+	std::vector<double> latencies;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		auto cycleBegin = std::chrono::steady_clock::now();
+		client.removeContainer("cycle", true);
+		auto cycleId = client.createContainer("cycle", web::json::value::object());
+		client.startContainer(cycleId);
+		client.inspectContainer(cycleId);
+		latencies.push_back((double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cycleBegin).count());
+	}
+	const double seconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000000;
+	std::sort(latencies.begin(), latencies.end());
+	if (latencies.size())
+	{
+		std::cout << "spawn cycle: " << count / seconds << " cycles/s, p50 " << latencies[latencies.size() / 2] << " us, p99 "
+			<< latencies[latencies.size() * 99 / 100] << " us" << std::endl;
+	}
+	std::cout << "failed checks: " << failures << std::endl;
+	return failures;
+}
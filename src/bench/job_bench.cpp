@@ -0,0 +1,138 @@
+#include <map>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "../common/Utility.h"
+#include "../daemon/JobTable.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Remote run bookkeeping: <jobs> /app/run calls with <apps> configured
+// applications. Temporary application path is the registry of shared
+// objects scanned by name (replaceApp, getApp, removeApp) plus one cleanup
+// timer id mapped to each app name; job table path is slab record, queue
+// admission, lookup by name and expiry by wheel tick. Process spawn is left
+// out of both.
+//////////////////////////////////////////////////////////////////////////
+
+struct TempApp
+{
+	std::string name;
+	std::string command;
+};
+
+static double elapsedSeconds(const std::chrono::steady_clock::time_point& begin)
+{
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000000;
+}
+
+static void printRate(const std::string& name, size_t count, double seconds)
+{
+	std::cout << name << count / seconds << " ops/s (" << seconds * 1000 << " ms)" << std::endl;
+}
+
+static std::shared_ptr<TempApp> findApp(std::vector<std::shared_ptr<TempApp>>& apps, const std::string& name)
+{
+	for (auto& app : apps)
+	{
+		if (app->name == name) return app;
+	}
+	return nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t jobCount = (argc > 1) ? std::stoul(argv[1]) : 20000;
+	const size_t appCount = (argc > 2) ? std::stoul(argv[2]) : 200;
+	std::cout << "jobs: " << jobCount << ", configured applications: " << appCount << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	std::mt19937 rng(42);
+	std::vector<size_t> order(jobCount);
+	for (size_t i = 0; i < jobCount; i++) order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	// temporary application in registry
+	{
+		std::vector<std::shared_ptr<TempApp>> registry;
+		for (size_t i = 0; i < appCount; i++) registry.push_back(std::make_shared<TempApp>(TempApp{ "app" + std::to_string(i), "sleep 1" }));
+		std::map<int, std::string> cleanTimers;
+		std::vector<std::string> names(jobCount);
+
+		auto begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < jobCount; i++)
+		{
+			names[i] = Utility::createUUID();
+			auto app = std::make_shared<TempApp>(TempApp{ names[i], "sleep 1" });
+			bool update = false;
+			for (auto& mapApp : registry)
+			{
+				if (mapApp->name == app->name)
+				{
+					mapApp = app;
+					update = true;
+				}
+			}
+			if (!update) registry.push_back(app);
+			cleanTimers[(int)i + 1] = names[i];
+		}
+		printRate("temp app add:     ", jobCount, elapsedSeconds(begin));
+
+		begin = std::chrono::steady_clock::now();
+		size_t found = 0;
+		for (auto i : order) found += (findApp(registry, names[i]) != nullptr);
+		printRate("temp app lookup:  ", found, elapsedSeconds(begin));
+
+		begin = std::chrono::steady_clock::now();
+		for (auto& timer : cleanTimers)
+		{
+			registry.erase(std::remove_if(registry.begin(), registry.end(),
+				[&timer](const std::shared_ptr<TempApp>& app) { return app->name == timer.second; }), registry.end());
+		}
+		cleanTimers.clear();
+		printRate("temp app remove:  ", jobCount, elapsedSeconds(begin));
+	}
+
+	// job table, configured applications are not in it
+	{
+		JobTable table;
+		// no running or queued limit, every job starts at submit
+		auto policyJson = web::json::value::object();
+		policyJson[JSON_KEY_JOB_max_running] = web::json::value::number(0);
+		policyJson[JSON_KEY_JOB_max_queued] = web::json::value::number(0);
+		table.setPolicy(JobQueuePolicy::FromJson(policyJson));
+		JobTable::JobRequest request{ "admin", "", JobTable::parsePriority(""), DEFAULT_RUN_APP_TIMEOUT_SECONDS, DEFAULT_RUN_APP_RETENTION_DURATION, nullptr, nullptr };
+		std::vector<std::string> names(jobCount);
+		size_t queuePosition = 0;
+
+		auto begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < jobCount; i++)
+		{
+			names[i] = table.submit(nullptr, request, queuePosition);
+		}
+		printRate("job table add:    ", jobCount, elapsedSeconds(begin));
+
+		// process is not spawned, lookup result is the null process of the record
+		begin = std::chrono::steady_clock::now();
+		for (auto i : order) table.find(names[i]);
+		printRate("job table lookup: ", jobCount, elapsedSeconds(begin));
+
+		begin = std::chrono::steady_clock::now();
+		table.tick(JobTable::now() + DEFAULT_RUN_APP_TIMEOUT_SECONDS + DEFAULT_RUN_APP_RETENTION_DURATION);
+		printRate("job table expire: ", jobCount, elapsedSeconds(begin));
+		std::cout << "jobs left: " << table.size() << std::endl;
+
+		// records are reused after expiry, no slab is allocated again
+		begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < jobCount; i++)
+		{
+			table.release(table.submit(nullptr, request, queuePosition));
+		}
+		table.tick(JobTable::now() + DEFAULT_RUN_APP_TIMEOUT_SECONDS + DEFAULT_RUN_APP_RETENTION_DURATION + 1);
+		printRate("job table reuse:  ", jobCount, elapsedSeconds(begin));
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <cpprest/json.h>
+#include "../common/Utility.h"
+#include "../common/JsonWriter.h"
+#include "../common/CborCodec.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Compare application list serialization:
+//  legacy: cpprest tree -> serialize() -> jsoncpp parse -> toStyledString()
+//  JsonWriter: cpprest tree -> formatted text in one pass
+// and binary encoding (Accept: application/cbor) against json:
+//  encode: JsonWriter compact / CborCodec::encode
+//  decode: web::json::value::parse / CborCodec::decode
+//////////////////////////////////////////////////////////////////////////
+
+// same shape as Application::AsJson(true)
+static web::json::value buildApp(int index)
+{
+	web::json::value app = web::json::value::object();
+	app[JSON_KEY_APP_name] = web::json::value::string("app-" + std::to_string(index));
+	app[JSON_KEY_APP_user] = web::json::value::string("root");
+	app[JSON_KEY_APP_command] = web::json::value::string("/usr/bin/python3 /opt/service/worker.py --port " + std::to_string(8000 + index));
+	app[JSON_KEY_APP_working_dir] = web::json::value::string("/opt/service");
+	app[JSON_KEY_APP_status] = web::json::value::number(1);
+	app[JSON_KEY_APP_comments] = web::json::value::string("benchmark \"application\"\twith escapes");
+	app[JSON_KEY_APP_pid] = web::json::value::number(10000 + index);
+	app[JSON_KEY_APP_return] = web::json::value::number(0);
+	app[JSON_KEY_APP_memory] = web::json::value::number(uint64_t(1024 * 1024 * 32 + index));
+	app[JSON_KEY_APP_last_start] = web::json::value::number(1571000000 + index);
+	app[JSON_KEY_APP_health] = web::json::value::number(0);
+	web::json::value daily = web::json::value::object();
+	daily[JSON_KEY_DAILY_LIMITATION_daily_start] = web::json::value::string("09:00:00");
+	daily[JSON_KEY_DAILY_LIMITATION_daily_end] = web::json::value::string("20:00:00");
+	app[JSON_KEY_APP_daily_limitation] = daily;
+	web::json::value limit = web::json::value::object();
+	limit[JSON_KEY_RESOURCE_LIMITATION_memory_mb] = web::json::value::number(512);
+	limit[JSON_KEY_RESOURCE_LIMITATION_cpu_shares] = web::json::value::number(100);
+	app[JSON_KEY_APP_resource_limit] = limit;
+	web::json::value envs = web::json::value::object();
+	envs["LANG"] = web::json::value::string("en_US.UTF-8");
+	envs["SERVICE_INDEX"] = web::json::value::string(std::to_string(index));
+	app[JSON_KEY_APP_env] = envs;
+	app[JSON_KEY_APP_cache_lines] = web::json::value::number(100);
+	return app;
+}
+
+static void bench(const std::string& name, int iterations, std::function<size_t()> func)
+{
+	size_t bytes = func(); // warm up
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) bytes = func();
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << std::left << std::setw(36) << name
+		<< std::right << std::setw(10) << std::fixed << std::setprecision(1) << (double)us / iterations / 1000 << " ms/op"
+		<< std::setw(12) << bytes << " bytes" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	int appCount = (argc > 1) ? std::stoi(argv[1]) : 1000;
+	int iterations = (argc > 2) ? std::stoi(argv[2]) : 50;
+
+	auto apps = web::json::value::array(appCount);
+	for (int i = 0; i < appCount; i++) apps[i] = buildApp(i);
+	std::cout << "applications: " << appCount << ", iterations: " << iterations << std::endl;
+
+	bench("cpprest serialize (compact)", iterations, [&apps]() { return GET_STD_STRING(apps.serialize()).length(); });
+	bench("serialize + prettyJson (legacy)", iterations, [&apps]() { return Utility::prettyJson(GET_STD_STRING(apps.serialize())).length(); });
+	bench("JsonWriter compact", iterations, [&apps]() { return JsonWriter::toString(apps, false).length(); });
+	bench("JsonWriter pretty", iterations, [&apps]() { return JsonWriter::toString(apps, true).length(); });
+	bench("build tree + JsonWriter pretty", iterations, [appCount]()
+		{
+			auto list = web::json::value::array(appCount);
+			for (int i = 0; i < appCount; i++) list[i] = buildApp(i);
+			return JsonWriter::toString(list, true).length();
+		});
+
+	auto jsonText = JsonWriter::toString(apps, false);
+	auto cborData = CborCodec::encode(apps);
+	if (CborCodec::decode(cborData) != apps)
+	{
+		std::cerr << "CBOR round trip mismatch" << std::endl;
+		return 1;
+	}
+	bench("CborCodec encode", iterations, [&apps]() { return CborCodec::encode(apps).length(); });
+	bench("json parse", iterations, [&jsonText]() { web::json::value::parse(GET_STRING_T(jsonText)); return jsonText.length(); });
+	bench("CborCodec decode", iterations, [&cborData]() { CborCodec::decode(cborData); return cborData.length(); });
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <unistd.h>
+#include "../common/Utility.h"
+#include "../daemon/OutputStore.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Output store: a chatty application writing 100 MB/s for <megabytes> MB,
+// report append throughput against that rate, daemon RSS, sequential read
+// by mmap and time seek latency; size retention keeps MAX_OUTPUT_STORE_APP_BYTES
+//////////////////////////////////////////////////////////////////////////
+
+static const uint64_t APP_RATE = 100ULL * 1024 * 1024;
+
+static uint64_t rssBytes()
+{
+	uint64_t size = 0, resident = 0;
+	std::ifstream statm("/proc/self/statm");
+	statm >> size >> resident;
+	return resident * ::sysconf(_SC_PAGESIZE);
+}
+
+static double elapsedSeconds(const std::chrono::steady_clock::time_point& begin)
+{
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000000;
+}
+
+int main(int argc, char* argv[])
+{
+	const uint64_t megabytes = (argc > 1) ? std::stoull(argv[1]) : 2000;
+	const std::string dir = (argc > 2) ? argv[2] : "/tmp/output_bench";
+	const uint64_t total = megabytes * 1024 * 1024;
+	std::cout << "output: " << megabytes << " MB at 100 MB/s, dir: " << dir << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	// pipe reader gets at most 4096 bytes per read, content is lines of log text
+	std::mt19937 rng(42);
+	std::string chunk;
+	while (chunk.length() < 4096)
+	{
+		chunk.append("2019-10-14 10:00:00.000 INFO worker ").append(std::to_string(rng())).append(" processed request with status 200 in 12 ms\n");
+	}
+	chunk.resize(4096);
+
+	const int64_t start = 1571000000;
+	const auto rssBefore = rssBytes();
+	std::vector<double> latencies;
+	{
+		OutputLog log(dir, DEFAULT_OUTPUT_SEGMENT_BYTES, DEFAULT_OUTPUT_RETENTION_SECONDS, MAX_OUTPUT_STORE_APP_BYTES);
+		log.destroy();
+	}
+	OutputLog log(dir, DEFAULT_OUTPUT_SEGMENT_BYTES, DEFAULT_OUTPUT_RETENTION_SECONDS, MAX_OUTPUT_STORE_APP_BYTES);
+
+	auto begin = std::chrono::steady_clock::now();
+	uint64_t written = 0;
+	uint64_t rssMax = 0;
+	while (written < total)
+	{
+		auto now = start + (int64_t)(written / APP_RATE);
+		auto t = std::chrono::steady_clock::now();
+		log.append(chunk.data(), chunk.length(), now);
+		if (written % (64 * 4096) == 0) latencies.push_back(elapsedSeconds(t) * 1000000);
+		written += chunk.length();
+		// daemon main loop flush every 2 seconds
+		if (written % (2 * APP_RATE) == 0)
+		{
+			log.flush(now);
+			rssMax = std::max(rssMax, rssBytes());
+		}
+	}
+	log.flush(start + (int64_t)(total / APP_RATE));
+	auto seconds = elapsedSeconds(begin);
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << "append:  " << total / seconds / 1024 / 1024 << " MB/s (" << total / seconds / APP_RATE << "x of app rate), p50 "
+		<< latencies[latencies.size() / 2] << " us, p99 " << latencies[latencies.size() * 99 / 100] << " us per 4KB" << std::endl;
+	std::cout << "rss:     " << (double)(std::max(rssMax, rssBytes()) - rssBefore) / 1024 / 1024 << " MB growth while writing" << std::endl;
+	const uint64_t kept = log.endOffset() - log.beginOffset();
+	std::cout << "kept:    " << (double)kept / 1024 / 1024 << " MB from offset " << log.beginOffset() << std::endl;
+
+	// sequential read of all kept history in REST page size
+	begin = std::chrono::steady_clock::now();
+	uint64_t offset = log.beginOffset();
+	uint64_t read = 0;
+	std::string output;
+	while (true)
+	{
+		output.clear();
+		offset = log.read(offset, log.endOffset(), MAX_OUTPUT_READ_BYTES, output);
+		if (output.empty()) break;
+		read += output.length();
+	}
+	seconds = elapsedSeconds(begin);
+	std::cout << "read:    " << read / seconds / 1024 / 1024 << " MB/s, " << read / 1024 / 1024 << " MB" << std::endl;
+
+	// time range start lookup
+	const int seeks = 10000;
+	const int64_t first = start + (int64_t)(log.beginOffset() / APP_RATE);
+	const int64_t last = start + (int64_t)(total / APP_RATE);
+	begin = std::chrono::steady_clock::now();
+	uint64_t checksum = 0;
+	for (int i = 0; i < seeks; i++)
+	{
+		checksum += log.seek(first + (int64_t)(rng() % (last - first + 1)));
+	}
+	std::cout << "seek:    " << elapsedSeconds(begin) * 1000000 / seeks << " us/seek (" << checksum % 10 << ")" << std::endl;
+
+	log.destroy();
+	if (read != kept)
+	{
+		std::cerr << "read " << read << " of " << kept << " bytes" << std::endl;
+		return 1;
+	}
+	return 0;
+}
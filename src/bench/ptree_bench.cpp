@@ -0,0 +1,111 @@
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "../common/Utility.h"
+#include "../common/os/pstree.hpp"
+#include "../daemon/ProcessTracker.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Process tree lookup: resolve members of one application (<app> processes)
+// on a host with growing process count, compare /proc list walk (os::pstree)
+// with incremental tracker fed by fork/exit events
+//////////////////////////////////////////////////////////////////////////
+
+static double elapsedUs(const std::chrono::steady_clock::time_point& begin, int loops)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count() / loops / 1000;
+}
+
+int main(int argc, char* argv[])
+{
+	const int appProcesses = (argc > 1) ? std::stoi(argv[1]) : 20;
+	const int loops = (argc > 2) ? std::stoi(argv[2]) : 100;
+	std::cout << "application processes: " << appProcesses << ", lookups: " << loops << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	for (int hostProcesses : { 1000, 10000, 50000 })
+	{
+		std::mt19937 rng(42);
+		const pid_t appmgr = 2;
+		const pid_t root = 1000;
+		ProcessTracker tracker;
+		std::list<os::Process> processes;
+		auto fork = [&](pid_t parent, pid_t pid)
+		{
+			tracker.onFork(parent, pid);
+			processes.emplace_back(pid, parent, pid, pid, 4096, std::chrono::seconds(0), std::chrono::seconds(0), 0, 1, "bench", false);
+		};
+
+		// app manager with one application, the application forks a sub tree
+		fork(1, appmgr);
+		fork(appmgr, root);
+		for (int i = 1; i < appProcesses; i++)
+		{
+			fork(root + (pid_t)(rng() % i), root + i);
+		}
+		// other host processes spread under init
+		pid_t next = root + appProcesses;
+		for (int i = (int)processes.size(); i < hostProcesses; i++, next++)
+		{
+			fork((i % 4 == 0 || next <= root + appProcesses + 1) ? 1 : next - 1 - (pid_t)(rng() % 2), next);
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		size_t scanned = 0;
+		for (int i = 0; i < loops; i++)
+		{
+			auto tree = os::pstree(root, processes);
+			scanned += tree->getProcesses().size();
+		}
+		auto pstreeUs = elapsedUs(begin, loops);
+
+		// first lookup builds membership, not counted
+		tracker.getMembers(root);
+		begin = std::chrono::steady_clock::now();
+		size_t tracked = 0;
+		for (int i = 0; i < loops; i++)
+		{
+			tracked += tracker.getMembers(root).size();
+		}
+		auto membersUs = elapsedUs(begin, loops);
+
+		begin = std::chrono::steady_clock::now();
+		pid_t owner = 0;
+		for (int i = 0; i < loops; i++)
+		{
+			owner += tracker.getOwner(root + i % appProcesses);
+		}
+		auto ownerUs = elapsedUs(begin, loops);
+
+		// fork and exit churn inside the application
+		begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < loops; i++)
+		{
+			tracker.onFork(root, next + i);
+			tracker.onExit(next + i);
+		}
+		auto eventUs = elapsedUs(begin, loops * 2);
+
+		if (scanned != tracked || owner != root * loops)
+		{
+			std::cerr << "member mismatch: pstree " << scanned / loops << " tracker " << tracked / loops << std::endl;
+			return 1;
+		}
+
+		// app manager is tracked as an outer root: application forks and exits update both
+		tracker.getMembers(appmgr);
+		tracker.onFork(root + 1, next + loops);
+		auto appmgrMembers = tracker.getMembers(appmgr).size();
+		tracker.onExit(root);
+		if (appmgrMembers != (size_t)appProcesses + 2 || tracker.getOwner(next + loops) != appmgr ||
+			tracker.getMembers(appmgr).size() != (size_t)appProcesses + 1 || tracker.getMembers(root).size())
+		{
+			std::cerr << "nested root mismatch: app manager members " << appmgrMembers << " after exit " << tracker.getMembers(appmgr).size() << std::endl;
+			return 1;
+		}
+		std::cout << "host " << std::setw(5) << hostProcesses << ": pstree " << std::setw(10) << pstreeUs << " us, members "
+			<< std::setw(6) << membersUs << " us, owner " << std::setw(6) << ownerUs << " us, event " << std::setw(6) << eventUs << " us" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cpprest/http_client.h>
+#include <cpprest/producerconsumerstream.h>
+#include "../common/Utility.h"
+
+//////////////////////////////////////////////////////////////////////////
+// REST load against a running appsvc: <probes> clients keep requesting
+// /app-manager/resources, report throughput and latency, first alone and
+// then with <slow> clients that each trickle a request body one byte every
+// 100 ms for the whole phase (the body is an empty /apps/batch array, so the
+// daemon state is not changed). Before continuation based handlers every slow
+// body held one of the HttpThreadPoolSize threads.
+//////////////////////////////////////////////////////////////////////////
+
+static const int PROBE_CLIENTS = 8;
+static const int TRICKLE_MILLISECONDS = 100;
+
+struct PhaseResult
+{
+	std::vector<double> latencies;
+	int errors = 0;
+};
+
+static double elapsedMs(const std::chrono::steady_clock::time_point& begin)
+{
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000;
+}
+
+static web::http::client::http_client_config clientConfig()
+{
+	web::http::client::http_client_config config;
+	config.set_timeout(std::chrono::seconds(120));
+	config.set_validate_certificates(false);
+	return config;
+}
+
+static web::http::http_request buildRequest(const web::http::method& mtd, const std::string& path, const std::string& token)
+{
+	web::http::http_request request(mtd);
+	request.set_request_uri(path);
+	if (token.length()) request.headers().add(HTTP_HEADER_JWT_Authorization, std::string(HTTP_HEADER_JWT_BearerSpace) + token);
+	return request;
+}
+
+static PhaseResult runProbes(const std::string& url, const std::string& token, int seconds)
+{
+	std::vector<PhaseResult> results(PROBE_CLIENTS);
+	std::vector<std::thread> threads;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+	for (int i = 0; i < PROBE_CLIENTS; i++)
+	{
+		threads.emplace_back([&, i]()
+			{
+				web::http::client::http_client client(url, clientConfig());
+				while (std::chrono::steady_clock::now() < deadline)
+				{
+					auto begin = std::chrono::steady_clock::now();
+					try
+					{
+						auto resp = client.request(buildRequest(web::http::methods::GET, "/app-manager/resources", token)).get();
+						resp.extract_utf8string(true).get();
+						if (resp.status_code() != web::http::status_codes::OK) results[i].errors++;
+					}
+					catch (...)
+					{
+						results[i].errors++;
+					}
+					results[i].latencies.push_back(elapsedMs(begin));
+				}
+			});
+	}
+	PhaseResult total;
+	for (int i = 0; i < PROBE_CLIENTS; i++)
+	{
+		threads[i].join();
+		total.latencies.insert(total.latencies.end(), results[i].latencies.begin(), results[i].latencies.end());
+		total.errors += results[i].errors;
+	}
+	std::sort(total.latencies.begin(), total.latencies.end());
+	return total;
+}
+
+static void printPhase(const std::string& name, const PhaseResult& result, int seconds)
+{
+	if (result.latencies.empty())
+	{
+		std::cout << name << "no request finished" << std::endl;
+		return;
+	}
+	std::cout << name << result.latencies.size() / (double)seconds << " req/s, p50 "
+		<< result.latencies[result.latencies.size() / 2] << " ms, p99 "
+		<< result.latencies[result.latencies.size() * 99 / 100] << " ms, max "
+		<< result.latencies.back() << " ms, errors " << result.errors << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string url = (argc > 1) ? argv[1] : "https://127.0.0.1:6060";
+	const int slowCount = (argc > 2) ? std::stoi(argv[2]) : 500;
+	const int seconds = (argc > 3) ? std::stoi(argv[3]) : 20;
+	const std::string token = (argc > 4) ? argv[4] : "";
+	std::cout << "url: " << url << ", probe clients: " << PROBE_CLIENTS << ", slow clients: " << slowCount << ", " << seconds << "s each phase" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	printPhase("alone:     ", runProbes(url, token, seconds), seconds);
+
+	// slow clients send headers at once, body is written one byte each trickle interval
+	const size_t bodyBytes = seconds * 1000 / TRICKLE_MILLISECONDS + 2;
+	std::vector<concurrency::streams::producer_consumer_buffer<uint8_t>> bodies(slowCount);
+	std::vector<std::unique_ptr<web::http::client::http_client>> clients;
+	std::vector<pplx::task<void>> slowRequests;
+	std::atomic<int> slowReplied(0);
+	for (int i = 0; i < slowCount; i++)
+	{
+		clients.push_back(std::make_unique<web::http::client::http_client>(url, clientConfig()));
+		auto request = buildRequest(web::http::methods::POST, "/apps/batch", token);
+		request.set_body(bodies[i].create_istream(), bodyBytes, "application/json");
+		slowRequests.push_back(clients.back()->request(request).then([&slowReplied](pplx::task<web::http::http_response> t)
+			{
+				try
+				{
+					t.get();
+					slowReplied++;
+				}
+				catch (...)
+				{
+				}
+			}));
+	}
+	std::atomic<bool> stop(false);
+	std::thread trickle([&]()
+		{
+			size_t written = 0;
+			while (written < bodyBytes)
+			{
+				uint8_t byte = (written == 0) ? '[' : ((written == bodyBytes - 1) ? ']' : ' ');
+				for (auto& body : bodies) body.putc(byte);
+				written++;
+				// rest of the body is sent at once after probing
+				if (!stop) std::this_thread::sleep_for(std::chrono::milliseconds(TRICKLE_MILLISECONDS));
+			}
+			for (auto& body : bodies) body.close(std::ios_base::out);
+		});
+
+	// let all slow requests reach the daemon before probing
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	const int probeSeconds = std::max(seconds - 2, 1);
+	printPhase("slow load: ", runProbes(url, token, probeSeconds), probeSeconds);
+	stop = true;
+	trickle.join();
+	auto begin = std::chrono::steady_clock::now();
+	pplx::when_all(slowRequests.begin(), slowRequests.end()).wait();
+	std::cout << "slow:      " << slowReplied << " of " << slowCount << " replied, drained in " << elapsedMs(begin) << " ms" << std::endl;
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "../common/Utility.h"
+#include "../daemon/TimeSeries.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Application metrics store: ingest <series> series at <resolution> seconds
+// for <hours> hours, report memory per point and query latency
+//////////////////////////////////////////////////////////////////////////
+
+static const char* METRICS[] = { TIMESERIES_METRIC_memory, TIMESERIES_METRIC_cpu, TIMESERIES_METRIC_threads, TIMESERIES_METRIC_fds, TIMESERIES_METRIC_restarts };
+
+int main(int argc, char* argv[])
+{
+	int seriesCount = (argc > 1) ? std::stoi(argv[1]) : 10000;
+	int hours = (argc > 2) ? std::stoi(argv[2]) : 24;
+	int resolution = (argc > 3) ? std::stoi(argv[3]) : 10;
+	const int metricCount = sizeof(METRICS) / sizeof(METRICS[0]);
+	const int appCount = (seriesCount + metricCount - 1) / metricCount;
+	const int64_t points = (int64_t)hours * 3600 / resolution;
+	std::cout << "series: " << seriesCount << ", points per series: " << points << ", resolution: " << resolution << "s" << std::endl;
+
+	// no memory limit, measure the real usage
+	TimeSeriesStore store(hours * 3600, (size_t)-1);
+	std::mt19937 rng(42);
+	std::vector<double> memory(appCount, 64.0 * 1024 * 1024);
+	const int64_t start = 1571000000;
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int64_t i = 0; i < points; i++)
+	{
+		// sampler thread jitter of one second
+		int64_t timestamp = start + i * resolution + (rng() % 16 == 0 ? 1 : 0);
+		int series = 0;
+		for (int app = 0; app < appCount && series < seriesCount; app++)
+		{
+			auto name = "app-" + std::to_string(app);
+			memory[app] += (rng() % 8 == 0) ? 4096 * (int)(rng() % 64) : 0;
+			double values[] = { memory[app], (rng() % 1000) / 10.0, 8.0, 32.0 + rng() % 2, 0.0 };
+			for (int m = 0; m < metricCount && series < seriesCount; m++, series++)
+			{
+				store.append(name, METRICS[m], timestamp, values[m]);
+			}
+		}
+	}
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+	auto total = points * seriesCount;
+	auto stats = store.AsJson();
+	auto bytes = store.getMemoryBytes();
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "append:        " << (double)us * 1000 / total << " ns/point, " << total << " points in " << us / 1000 << " ms" << std::endl;
+	std::cout << "memory:        " << bytes / 1024 / 1024 << " MB, " << (double)bytes / total << " bytes/point (raw 16)" << std::endl;
+	std::cout << "chunks:        " << stats.at(JSON_KEY_TIMESERIES_chunks).as_number().to_uint64() << std::endl;
+
+	const int64_t end = start + points * resolution;
+	for (int64_t step : { 60, 300, 3600 })
+	{
+		const int queries = 100;
+		begin = std::chrono::steady_clock::now();
+		size_t buckets = 0;
+		for (int q = 0; q < queries; q++)
+		{
+			auto result = store.query("app-" + std::to_string(q % appCount), TIMESERIES_METRIC_memory, start, end, step);
+			buckets += result.at(JSON_KEY_TIMESERIES_time).size();
+		}
+		us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << "query step " << std::setw(4) << step << "s: " << (double)us / queries / 1000 << " ms/series, " << buckets / queries << " buckets" << std::endl;
+	}
+	return 0;
+}
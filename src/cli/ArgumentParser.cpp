@@ -6,6 +6,7 @@
 #endif
 #include <iostream>
 #include <thread>
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <boost/program_options.hpp>
@@ -13,10 +14,13 @@
 #include <cpprest/json.h>
 #include "ArgumentParser.h"
 #include "../common/Utility.h"
+#include "../common/CborCodec.h"
+#include "../common/JsonWriter.h"
 #include "../common/os/linux.hpp"
 #include "../common/os/chown.hpp"
 
 #define OPTION_HOST_NAME ("host,b", po::value<std::string>()->default_value("localhost"), "host name or ip address")
+#define OPTION_CBOR ("cbor", "request binary CBOR encoding of the response, printed the same as JSON")
 #define HELP_ARG_CHECK_WITH_RETURN if (m_commandLineVariables.count("help") > 0) { std::cout << desc << std::endl; return; } m_hostname = m_commandLineVariables["host"].as<std::string>();
 
 // Each user should have its own token path
@@ -128,6 +132,10 @@ void ArgumentParser::parse()
 	{
 		processConfigView();
 	}
+	else if (cmd == "reexec")
+	{
+		processReexec();
+	}
 	else if (cmd == "passwd")
 	{
 		processChangePwd();
@@ -163,6 +171,7 @@ void ArgumentParser::printMainHelp()
 	std::cout << "  passwd      Change user password" << std::endl;
 	std::cout << "  lock        Lock unlock a user" << std::endl;
 	std::cout << "  log         Set log level" << std::endl;
+	std::cout << "  reexec      Upgrade daemon in place, keep running applications" << std::endl;
 
 	std::cout << std::endl;
 	std::cout << "Run 'appc COMMAND --help' for more information on a command." << std::endl;
@@ -281,22 +290,30 @@ void ArgumentParser::processReg()
 		("start_time,t", po::value<std::string>(), "start date time for short running app (e.g., '2018-01-01 09:00:00')")
 		("daily_start,s", po::value<std::string>(), "daily start time (e.g., '09:00:00')")
 		("daily_end,y", po::value<std::string>(), "daily end time (e.g., '20:00:00')")
+		("weekdays", po::value<std::string>(), "weekdays of daily start and end time (e.g., 'MON-FRI')")
 		("memory,m", po::value<int>(), "memory limit in MByte")
 		("pid,p", po::value<int>(), "process id used to attach")
 		("virtual_memory,v", po::value<int>(), "virtual memory limit in MByte")
 		("cpu_shares,r", po::value<int>(), "CPU shares (relative weight)")
 		("env,e", po::value<std::vector<std::string>>(), "environment variables (e.g., -e env1=value1 -e env2=value2, APP_DOCKER_OPTS is used to input docker parameters)")
 		("interval,i", po::value<int>(), "start interval seconds for short running app")
+		("cron", po::value<std::string>(), "cron expression for short running app instead of interval (e.g., '0 9 * * MON-FRI')")
 		("extra_time,x", po::value<int>(), "extra timeout for short running app,the value must less than interval  (default 0)")
 		("timezone,z", po::value<std::string>(), "posix timezone for the application, reflect [start_time|daily_start|daily_end] (e.g., 'WST+08:00' is Australia Standard Time)")
 		("keep_running,k", po::value<bool>()->default_value(false), "monitor and keep running for short running app in start interval")
 		("cache_lines,o", po::value<int>()->default_value(0), "number of output lines will be cached in server side (used for none-container app)")
+		("batch,j", po::value<std::string>(), "json file of application definitions (or batch operations) to register in one request")
 		("force,f", "force without confirm")
 		("debug,g", "print debug information")
 		("help,h", "Prints command usage to stdout and exits");
 
 	shiftCommandLineArgs(desc);
 	HELP_ARG_CHECK_WITH_RETURN;
+	if (m_commandLineVariables.count("batch"))
+	{
+		processRegBatch(m_commandLineVariables["batch"].as<std::string>());
+		return;
+	}
 	if (m_commandLineVariables.count("name") == 0 ||
 	   (m_commandLineVariables.count("docker_image")== 0 && m_commandLineVariables.count("cmd") == 0))
 	{
@@ -335,6 +352,7 @@ void ArgumentParser::processReg()
 	if (m_commandLineVariables.count("timezone")) jsobObj[JSON_KEY_APP_posix_timezone] = web::json::value::string(m_commandLineVariables["timezone"].as<std::string>());
 	if (m_commandLineVariables.count("start_time")) jsobObj[JSON_KEY_SHORT_APP_start_time] = web::json::value::string(m_commandLineVariables["start_time"].as<std::string>());
 	if (m_commandLineVariables.count("interval")) jsobObj[JSON_KEY_SHORT_APP_start_interval_seconds] = web::json::value::number(m_commandLineVariables["interval"].as<int>());
+	if (m_commandLineVariables.count("cron")) jsobObj[JSON_KEY_SHORT_APP_cron] = web::json::value::string(m_commandLineVariables["cron"].as<std::string>());
 	if (m_commandLineVariables.count("extra_time")) jsobObj[JSON_KEY_SHORT_APP_start_interval_timeout] = web::json::value::number(m_commandLineVariables["extra_time"].as<int>());
 	if (m_commandLineVariables.count("keep_running")) jsobObj[JSON_KEY_PERIOD_APP_keep_running] = web::json::value::boolean(m_commandLineVariables["keep_running"].as<bool>());
 	if (m_commandLineVariables.count("daily_start") && m_commandLineVariables.count("daily_end"))
@@ -342,6 +360,7 @@ void ArgumentParser::processReg()
 		web::json::value objDailyLimitation = web::json::value::object();
 		objDailyLimitation[JSON_KEY_DAILY_LIMITATION_daily_start] = web::json::value::string(m_commandLineVariables["daily_start"].as<std::string>());
 		objDailyLimitation[JSON_KEY_DAILY_LIMITATION_daily_end] = web::json::value::string(m_commandLineVariables["daily_end"].as<std::string>());
+		if (m_commandLineVariables.count("weekdays")) objDailyLimitation[JSON_KEY_DAILY_LIMITATION_weekdays] = web::json::value::string(m_commandLineVariables["weekdays"].as<std::string>());
 		jsobObj[JSON_KEY_APP_daily_limitation] = objDailyLimitation;
 	}
 
@@ -383,6 +402,67 @@ void ArgumentParser::processReg()
 	std::cout << GET_STD_STRING(appJsonStr) << std::endl;
 }
 
+void ArgumentParser::processRegBatch(const std::string& batchFile)
+{
+	if (!Utility::isFileExist(batchFile))
+	{
+		throw std::invalid_argument(std::string("file not exist: ") + batchFile);
+	}
+	auto content = web::json::value::parse(GET_STRING_T(Utility::readFileCpp(batchFile)));
+	if (content.is_object())
+	{
+		auto array = web::json::value::array(1);
+		array[0] = content;
+		content = array;
+	}
+	if (!content.is_array())
+	{
+		throw std::invalid_argument("batch file should be a json array of application definitions");
+	}
+
+	// plain application definition is a register operation
+	auto operations = web::json::value::array(content.size());
+	for (size_t i = 0; i < content.size(); i++)
+	{
+		auto item = content[i];
+		if (HAS_JSON_FIELD(item, JSON_KEY_BATCH_operation))
+		{
+			operations[i] = item;
+		}
+		else
+		{
+			web::json::value op = web::json::value::object();
+			op[JSON_KEY_BATCH_operation] = web::json::value::string(BATCH_OPERATION_register);
+			op[JSON_KEY_BATCH_app] = item;
+			operations[i] = op;
+		}
+	}
+	if (m_commandLineVariables.count("force") == 0)
+	{
+		auto msg = std::string("Are you sure you want to apply ") + std::to_string(operations.size()) + " operations? [y/n]";
+		if (!confirmInput(msg.c_str()))
+		{
+			return;
+		}
+	}
+
+	// rejected batch is replied 400 with the same result list, other errors are plain text
+	std::map<std::string, std::string> query;
+	auto response = sendRequest(methods::POST, "/apps/batch", query, &operations);
+	bool rejected = (response.status_code() == status_codes::BadRequest && response.headers().content_type().find(HTTP_CONTENT_TYPE_json) != std::string::npos);
+	if (response.status_code() != status_codes::OK && !rejected)
+	{
+		throw std::invalid_argument(response.extract_utf8string(true).get());
+	}
+	auto result = response.extract_json(true).get();
+	for (const auto& item : result.at(JSON_KEY_BATCH_results).as_array())
+	{
+		std::cout << GET_JSON_STR_VALUE(item, JSON_KEY_BATCH_operation) << " <" << GET_JSON_STR_VALUE(item, JSON_KEY_BATCH_name) << ">: "
+			<< GET_JSON_STR_VALUE(item, JSON_KEY_BATCH_result) << " " << GET_JSON_STR_VALUE(item, JSON_KEY_BATCH_message) << std::endl;
+	}
+	if (rejected) throw std::invalid_argument("batch is rejected, no operation is applied");
+}
+
 void ArgumentParser::processUnReg()
 {
 	po::options_description desc("Unregister and remove an application");
@@ -431,9 +511,12 @@ void ArgumentParser::processView()
 	desc.add_options()
 		("help,h", "Prints command usage to stdout and exits")
 		OPTION_HOST_NAME
+		OPTION_CBOR
 		("name,n", po::value<std::string>(), "view application by name.")
 		("long,l", "display the complete information without reduce")
 		("output,o", "view the application output")
+		("since,s", po::value<std::string>(), "used with --output, view output history of the last duration (e.g. 30m, 2h), require OutputStoreEnabled in server side")
+		("grep,g", po::value<std::string>(), "used with --output, print output lines contain the text, searched in server side")
 		;
 
 	shiftCommandLineArgs(desc);
@@ -449,6 +532,44 @@ void ArgumentParser::processView()
 			auto response = requestHttp(methods::GET, restPath);
 			std::cout << response.extract_utf8string(true).get() << std::endl;
 		}
+		else if (m_commandLineVariables.count("grep"))
+		{
+			// search page by page until all output scanned
+			std::string restPath = std::string("/app/") + m_commandLineVariables["name"].as<std::string>() + "/output/search";
+			std::map<std::string, std::string> query;
+			query[HTTP_QUERY_KEY_pattern] = m_commandLineVariables["grep"].as<std::string>();
+			if (m_commandLineVariables.count("since")) query[HTTP_QUERY_KEY_since] = m_commandLineVariables["since"].as<std::string>();
+			while (true)
+			{
+				auto response = requestHttp(methods::GET, restPath, query);
+				auto result = response.extract_json(true).get();
+				for (const auto& match : result.at(JSON_KEY_SEARCH_matches).as_array())
+				{
+					std::cout << GET_STD_STRING(match.at(JSON_KEY_SEARCH_line).as_string()) << std::endl;
+				}
+				auto next = std::to_string(GET_JSON_NUMBER_VALUE(result, JSON_KEY_SEARCH_next_offset));
+				if (GET_JSON_BOOL_VALUE(result, JSON_KEY_SEARCH_complete) || next == query[HTTP_QUERY_KEY_offset]) break;
+				query[HTTP_QUERY_KEY_offset] = next;
+			}
+		}
+		else if (m_commandLineVariables.count("since"))
+		{
+			// view app output history page by page, stop at the time of this request
+			std::string restPath = std::string("/app/") + m_commandLineVariables["name"].as<std::string>() + "/output";
+			auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			std::map<std::string, std::string> query;
+			query[HTTP_QUERY_KEY_from] = std::to_string(now - Utility::parseDurationSeconds(m_commandLineVariables["since"].as<std::string>()));
+			query[HTTP_QUERY_KEY_to] = std::to_string(now);
+			while (true)
+			{
+				auto response = requestHttp(methods::GET, restPath, query);
+				auto bodyStr = response.extract_utf8string(true).get();
+				if (bodyStr.empty() || !response.headers().has(HTTP_HEADER_KEY_output_offset)) break;
+				std::cout << bodyStr;
+				query.erase(HTTP_QUERY_KEY_from);
+				query[HTTP_QUERY_KEY_offset] = GET_STD_STRING(response.headers().find(HTTP_HEADER_KEY_output_offset)->second);
+			}
+		}
 		else
 		{
 			// view app output
@@ -461,8 +582,7 @@ void ArgumentParser::processView()
 	else
 	{
 		std::string restPath = "/app-manager/applications";
-		auto response = requestHttp(methods::GET, restPath);
-		printApps(response.extract_json(true).get(), reduce);
+		printApps(requestJson(restPath), reduce);
 	}
 }
 
@@ -471,14 +591,14 @@ void ArgumentParser::processResource()
 	po::options_description desc("View host resource usage:");
 	desc.add_options()
 		OPTION_HOST_NAME
+		OPTION_CBOR
 		("help,h", "Prints command usage to stdout and exits")
 		;
 	shiftCommandLineArgs(desc);
 	HELP_ARG_CHECK_WITH_RETURN;
 
 	std::string restPath = "/app-manager/resources";
-	auto bodyStr = requestHttp(methods::GET, restPath).extract_utf8string(true).get();
-	std::cout << GET_STD_STRING(bodyStr) << std::endl;
+	std::cout << JsonWriter::toString(requestJson(restPath), true) << std::endl;
 }
 
 void ArgumentParser::processEnableDisable(bool start)
@@ -661,6 +781,10 @@ void ArgumentParser::processUpload()
 		OPTION_HOST_NAME
 		("remote,r", po::value<std::string>(), "save to remote file path")
 		("local,l", po::value<std::string>(), "local file path")
+		("parallel,p", po::value<int>()->default_value(4), "number of chunks upload concurrently")
+		("chunk,c", po::value<int>()->default_value(DEFAULT_UPLOAD_CHUNK_SIZE / 1024 / 1024), "chunk size in MB")
+		("session,s", po::value<std::string>(), "resume an unfinished upload session")
+		("force,f", "overwrite remote file if exist")
 		("help,h", "Prints command usage to stdout and exits")
 		;
 	shiftCommandLineArgs(desc);
@@ -674,40 +798,121 @@ void ArgumentParser::processUpload()
 
 	auto file = m_commandLineVariables["remote"].as<std::string>();
 	auto local = m_commandLineVariables["local"].as<std::string>();
+	auto parallel = std::max(1, std::min(m_commandLineVariables["parallel"].as<int>(), 64));
 
 	if (!Utility::isFileExist(local))
 	{
 		std::cout << "local file not exist" << std::endl;
 		return;
 	}
-	// https://msdn.microsoft.com/en-us/magazine/dn342869.aspx
-
-	auto fileStream = concurrency::streams::file_stream<uint8_t>::open_istream(local, std::ios_base::binary).get();
-	// Get the content length, which is used to set the
-	// Content-Length property
-	fileStream.seek(0, std::ios::end);
-	auto length = static_cast<size_t>(fileStream.tell());
-	fileStream.seek(0, std::ios::beg);
-
+	uint64_t fileSize = std::ifstream(local, std::ios::in | std::ios::binary | std::ios::ate).tellg();
+	auto sha256 = Utility::hashFile(local);
 
+	// 1. create a new upload session or query the existing one for resume
 	std::map<std::string, std::string> query, header;
-	header[HTTP_HEADER_KEY_file_path] = file;
+	web::json::value sessionJson;
+	if (m_commandLineVariables.count("session"))
+	{
+		auto restPath = std::string("/upload/session/") + m_commandLineVariables["session"].as<std::string>();
+		sessionJson = requestHttp(methods::GET, restPath).extract_json(true).get();
+		if ((uint64_t)GET_JSON_NUMBER_VALUE(sessionJson, JSON_KEY_UPLOAD_file_size) != fileSize)
+		{
+			std::cout << "local file size does not match upload session" << std::endl;
+			return;
+		}
+	}
+	else
+	{
+		header[HTTP_HEADER_KEY_file_path] = file;
+		header[HTTP_HEADER_KEY_file_size] = std::to_string(fileSize);
+		header[HTTP_HEADER_KEY_file_chunk_size] = std::to_string((uint64_t)m_commandLineVariables["chunk"].as<int>() * 1024 * 1024);
+		if (m_commandLineVariables.count("force")) query[HTTP_QUERY_KEY_overwrite] = "1";
+		sessionJson = requestHttp(methods::POST, "/upload/session", query, nullptr, &header).extract_json(true).get();
+	}
+	auto sessionId = GET_JSON_STR_VALUE(sessionJson, JSON_KEY_UPLOAD_session_id);
+	uint64_t chunkSize = GET_JSON_NUMBER_VALUE(sessionJson, JSON_KEY_UPLOAD_chunk_size);
+	std::vector<uint64_t> chunks;
+	for (const auto& chunk : sessionJson.at(GET_STRING_T(JSON_KEY_UPLOAD_missing_chunks)).as_array())
+	{
+		chunks.push_back(chunk.as_number().to_uint64());
+	}
 
+	// 2. upload missing chunks concurrently, each worker use its own connection and file handle
+	auto jwtToken = getAuthenToken();
 	auto protocol = m_sslEnabled ? U("https://") : U("http://");
-	auto restPath = (protocol + GET_STRING_T(m_hostname) + ":" + GET_STRING_T(std::to_string(m_listenPort)));
-	// Create http_client to send the request.
-	http_client_config config;
-	config.set_timeout(std::chrono::seconds(200));
-	config.set_validate_certificates(false);
-	http_client client(restPath, config);
-	http_request request = createRequest(methods::POST, "/upload", query, &header);
-
-	request.set_body(fileStream, length);
-	request.headers().add(HTTP_HEADER_KEY_file_mode, os::fileStat(local));
-	request.headers().add(HTTP_HEADER_KEY_file_user, os::fileUser(local));
-	http_response response = client.request(request).get();
-	fileStream.close();
-	std::cout << GET_STD_STRING(response.extract_utf8string(true).get()) << std::endl;
+	auto restURL = (protocol + GET_STRING_T(m_hostname) + ":" + GET_STRING_T(std::to_string(m_listenPort)));
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<uint64_t> uploadedBytes(0);
+	std::atomic<int> runningWorkers(parallel);
+	std::atomic<size_t> failedChunks(0);
+	auto worker = [&]()
+	{
+		http_client_config config;
+		config.set_timeout(std::chrono::seconds(200));
+		config.set_validate_certificates(false);
+		http_client client(restURL, config);
+		std::ifstream ifs(local, std::ios::in | std::ios::binary);
+		std::vector<unsigned char> buffer;
+		for (auto index = nextChunk++; index < chunks.size(); index = nextChunk++)
+		{
+			uint64_t offset = chunks[index] * chunkSize;
+			buffer.resize(std::min(chunkSize, fileSize - offset));
+			ifs.seekg(offset);
+			ifs.read((char*)buffer.data(), buffer.size());
+
+			bool success = false;
+			for (int retry = 0; retry < 3 && !success; retry++)
+			{
+				uri_builder builder(GET_STRING_T(std::string("/upload/session/") + sessionId));
+				builder.append_query(GET_STRING_T(HTTP_QUERY_KEY_offset), GET_STRING_T(std::to_string(offset)));
+				http_request request(methods::PUT);
+				request.set_request_uri(builder.to_uri());
+				request.headers().add(HTTP_HEADER_JWT_Authorization, std::string(HTTP_HEADER_JWT_BearerSpace) + jwtToken);
+				request.set_body(buffer);
+				try
+				{
+					success = (client.request(request).get().status_code() == status_codes::OK);
+				}
+				catch (...)
+				{
+				}
+			}
+			if (success)
+				uploadedBytes += buffer.size();
+			else
+				failedChunks++;
+		}
+		runningWorkers--;
+	};
+	auto startTime = std::chrono::system_clock::now();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < parallel; i++) workers.push_back(std::thread(worker));
+	while (runningWorkers > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		auto seconds = std::chrono::duration<double>(std::chrono::system_clock::now() - startTime).count();
+		std::cout << "\rUploaded " << Utility::humanReadableSize(uploadedBytes) << " / " << Utility::humanReadableSize(fileSize)
+			<< " (" << Utility::humanReadableSize(uploadedBytes / std::max(seconds, 0.001)) << "/s)      " << std::flush;
+	}
+	for (auto& t : workers) t.join();
+	auto seconds = std::chrono::duration<double>(std::chrono::system_clock::now() - startTime).count();
+	std::cout << std::endl;
+
+	if (failedChunks > 0)
+	{
+		std::cout << failedChunks << " chunks failed, resume with: appc put -l " << local << " -r " << file << " -s " << sessionId << std::endl;
+		return;
+	}
+
+	// 3. commit with whole file checksum
+	query.clear();
+	header.clear();
+	header[HTTP_HEADER_KEY_file_sha256] = sha256;
+	header[HTTP_HEADER_KEY_file_mode] = std::to_string(os::fileStat(local));
+	header[HTTP_HEADER_KEY_file_user] = os::fileUser(local);
+	auto response = requestHttp(methods::POST, std::string("/upload/session/") + sessionId + "/commit", query, nullptr, &header);
+	std::cout << GET_STD_STRING(response.extract_utf8string(true).get()) << " : " << Utility::humanReadableSize(uploadedBytes)
+		<< " in " << std::setprecision(3) << seconds << "s, " << Utility::humanReadableSize(uploadedBytes / std::max(seconds, 0.001)) << "/s" << std::endl;
 }
 
 void ArgumentParser::processTags()
@@ -715,6 +920,7 @@ void ArgumentParser::processTags()
 	po::options_description desc("Manage labels:");
 	desc.add_options()
 		OPTION_HOST_NAME
+		OPTION_CBOR
 		("view,v", "list labels")
 		("add,a", "add labels")
 		("remove,r", "remove labels")
@@ -776,10 +982,9 @@ void ArgumentParser::processTags()
 	}
 
 	std::string restPath = "/labels";
-	http_response response = requestHttp(methods::GET, restPath);
 
 	// Finally print current
-	auto tags = response.extract_json().get().as_object();
+	auto tags = requestJson(restPath).as_object();
 	for (auto tag : tags)
 	{
 		std::cout << tag.first << "=" << tag.second.as_string() << std::endl;
@@ -829,6 +1034,21 @@ void ArgumentParser::processConfigView()
 	std::cout << GET_STD_STRING(response.extract_utf8string(true).get()) << std::endl;
 }
 
+void ArgumentParser::processReexec()
+{
+	po::options_description desc("Re-exec daemon binary:");
+	desc.add_options()
+		OPTION_HOST_NAME
+		("help,h", "Prints command usage to stdout and exits")
+		;
+	shiftCommandLineArgs(desc);
+	HELP_ARG_CHECK_WITH_RETURN;
+
+	std::string restPath = "/app-manager/reexec";
+	http_response response = requestHttp(methods::POST, restPath);
+	std::cout << GET_STD_STRING(response.extract_utf8string(true).get()) << std::endl;
+}
+
 void ArgumentParser::processChangePwd()
 {
 	po::options_description desc("Manage labels:");
@@ -904,6 +1124,16 @@ http_response ArgumentParser::requestHttp(const method& mtd, const std::string&
 }
 
 http_response ArgumentParser::requestHttp(const method& mtd, const std::string& path, std::map<std::string, std::string>& query, web::json::value* body, std::map<std::string, std::string>* header)
+{
+	http_response response = sendRequest(mtd, path, query, body, header);
+	if (response.status_code() != status_codes::OK)
+	{
+		throw std::invalid_argument(response.extract_utf8string(true).get());
+	}
+	return std::move(response);
+}
+
+http_response ArgumentParser::sendRequest(const method& mtd, const std::string& path, std::map<std::string, std::string>& query, web::json::value* body, std::map<std::string, std::string>* header)
 {
 	auto protocol = m_sslEnabled ? U("https://") : U("http://");
 	auto restURL = (protocol + GET_STRING_T(m_hostname) + ":" + GET_STRING_T(std::to_string(m_listenPort)));
@@ -917,12 +1147,7 @@ http_response ArgumentParser::requestHttp(const method& mtd, const std::string&
 	{
 		request.set_body(*body);
 	}
-	http_response response = client.request(request).get();
-	if (response.status_code() != status_codes::OK)
-	{
-		throw std::invalid_argument(response.extract_utf8string(true).get());
-	}
-	return std::move(response);
+	return client.request(request).get();
 }
 
 http_request ArgumentParser::createRequest(const method& mtd, const std::string& path, std::map<std::string, std::string>& query, std::map<std::string, std::string>* header)
@@ -948,6 +1173,21 @@ http_request ArgumentParser::createRequest(const method& mtd, const std::string&
 	return std::move(request);
 }
 
+web::json::value ArgumentParser::requestJson(const std::string& path)
+{
+	std::map<std::string, std::string> query;
+	std::map<std::string, std::string> header;
+	if (m_commandLineVariables.count("cbor")) header[HTTP_HEADER_KEY_Accept] = HTTP_CONTENT_TYPE_cbor;
+	auto response = requestHttp(methods::GET, path, query, nullptr, &header);
+	// server without CBOR support still reply json
+	if (response.headers().content_type().find(HTTP_CONTENT_TYPE_cbor) != std::string::npos)
+	{
+		auto body = response.extract_vector().get();
+		return CborCodec::decode(std::string(body.begin(), body.end()));
+	}
+	return response.extract_json(true).get();
+}
+
 bool ArgumentParser::isAppExist(const std::string& appName)
 {
 	static auto apps = getAppList();
@@ -957,12 +1197,7 @@ bool ArgumentParser::isAppExist(const std::string& appName)
 std::map<std::string, bool> ArgumentParser::getAppList()
 {
 	std::map<std::string, bool> apps;
-	auto response = requestHttp(methods::GET, "/app-manager/applications");
-	if (response.status_code() != status_codes::OK)
-	{
-		throw std::invalid_argument(response.extract_utf8string(true).get());
-	}
-	auto jsonValue = response.extract_json(true).get();
+	auto jsonValue = requestJson("/app-manager/applications");
 	auto arr = jsonValue.as_array();
 	for (auto iter = arr.begin(); iter != arr.end(); iter++)
 	{
@@ -1033,6 +1268,7 @@ void ArgumentParser::printApps(web::json::value json, bool reduce)
 		<< std::setw(7) << (JSON_KEY_APP_health)
 		<< std::setw(7) << (JSON_KEY_APP_pid)
 		<< std::setw(8) << (JSON_KEY_APP_memory)
+		<< std::setw(7) << ("cpu%")
 		<< std::setw(7) << (JSON_KEY_APP_return)
 		<< std::setw(20) << (JSON_KEY_APP_last_start)
 		<< (JSON_KEY_APP_command)
@@ -1066,6 +1302,17 @@ void ArgumentParser::printApps(web::json::value json, bool reduce)
 				std::cout << slash;
 		}
 		std::cout << std::setw(7);
+		{
+			if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_cpu_percent))
+			{
+				char cpu[32] = { 0 };
+				snprintf(cpu, sizeof(cpu), "%.1f", GET_JSON_DOUBLE_VALUE(jobj, JSON_KEY_APP_cpu_percent));
+				std::cout << cpu;
+			}
+			else
+				std::cout << slash;
+		}
+		std::cout << std::setw(7);
 		{
 			if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_return))
 				std::cout << GET_JSON_INT_VALUE(jobj, JSON_KEY_APP_return);
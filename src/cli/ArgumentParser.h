@@ -29,6 +29,7 @@ private:
 	void processLogon();
 	void processLogoff();
 	void processReg();
+	void processRegBatch(const std::string& batchFile);
 	void processUnReg();
 	void processView();
 	void processResource();
@@ -39,6 +40,7 @@ private:
 	void processTags();
 	void processLoglevel();
 	void processConfigView();
+	void processReexec();
 	void processChangePwd();
 	void processLockUser();
 
@@ -46,7 +48,11 @@ private:
 	http_response requestHttp(const method& mtd, const std::string& path);
 	http_response requestHttp(const method& mtd, const std::string& path, web::json::value& body);
 	http_response requestHttp(const method& mtd, const std::string& path, std::map<std::string, std::string>& query, web::json::value* body = nullptr, std::map<std::string, std::string>* header = nullptr);
+	// same as requestHttp, but return reply of any status
+	http_response sendRequest(const method& mtd, const std::string& path, std::map<std::string, std::string>& query, web::json::value* body = nullptr, std::map<std::string, std::string>* header = nullptr);
 	http_request createRequest(const method& mtd, const std::string& path, std::map<std::string, std::string>& query, std::map<std::string, std::string>* header);
+	// GET json document, request CBOR encoding with --cbor, throw when not replied OK
+	web::json::value requestJson(const std::string& path);
 
 	std::string getAuthenToken();
 	std::string readAuthenToken();
@@ -0,0 +1,295 @@
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "CborCodec.h"
+
+// major types
+#define CBOR_UNSIGNED 0
+#define CBOR_NEGATIVE 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+// simple values and floats
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_UNDEFINED 0xf7
+#define CBOR_FLOAT16 0xf9
+#define CBOR_FLOAT32 0xfa
+#define CBOR_FLOAT64 0xfb
+// avoid stack overflow by malicious input
+#define CBOR_MAX_DEPTH 128
+
+std::string CborCodec::encode(const web::json::value& json)
+{
+	std::string out;
+	encodeValue(out, json);
+	return out;
+}
+
+web::json::value CborCodec::decode(const std::string& data)
+{
+	size_t pos = 0;
+	auto result = decodeValue(data, pos, 0);
+	if (pos != data.size())
+	{
+		throw std::invalid_argument("cbor: extra data after value");
+	}
+	return result;
+}
+
+void CborCodec::encodeValue(std::string& out, const web::json::value& json)
+{
+	switch (json.type())
+	{
+	case web::json::value::Object:
+	{
+		const auto& object = json.as_object();
+		encodeHead(out, CBOR_MAP, object.size());
+		for (const auto& field : object)
+		{
+			encodeHead(out, CBOR_TEXT, field.first.size());
+			out.append(field.first);
+			encodeValue(out, field.second);
+		}
+		break;
+	}
+	case web::json::value::Array:
+	{
+		const auto& array = json.as_array();
+		encodeHead(out, CBOR_ARRAY, array.size());
+		for (const auto& element : array)
+		{
+			encodeValue(out, element);
+		}
+		break;
+	}
+	case web::json::value::String:
+	{
+		const auto& str = json.as_string();
+		encodeHead(out, CBOR_TEXT, str.size());
+		out.append(str);
+		break;
+	}
+	case web::json::value::Number:
+	{
+		const auto& number = json.as_number();
+		if (number.is_uint64())
+		{
+			encodeHead(out, CBOR_UNSIGNED, number.to_uint64());
+		}
+		else if (number.is_int64())
+		{
+			auto value = number.to_int64();
+			// negative integer is encoded as -1 - n
+			if (value >= 0) encodeHead(out, CBOR_UNSIGNED, value);
+			else encodeHead(out, CBOR_NEGATIVE, static_cast<uint64_t>(-1 - value));
+		}
+		else
+		{
+			auto value = number.to_double();
+			auto single = static_cast<float>(value);
+			if (static_cast<double>(single) == value || std::isnan(value))
+			{
+				// lossless in 4 bytes
+				uint32_t bits;
+				std::memcpy(&bits, &single, sizeof(bits));
+				out.push_back(static_cast<char>(CBOR_FLOAT32));
+				for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<char>((bits >> shift) & 0xFF));
+			}
+			else
+			{
+				uint64_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				out.push_back(static_cast<char>(CBOR_FLOAT64));
+				for (int shift = 56; shift >= 0; shift -= 8) out.push_back(static_cast<char>((bits >> shift) & 0xFF));
+			}
+		}
+		break;
+	}
+	case web::json::value::Boolean:
+		out.push_back(static_cast<char>(json.as_bool() ? CBOR_TRUE : CBOR_FALSE));
+		break;
+	default:
+		out.push_back(static_cast<char>(CBOR_NULL));
+		break;
+	}
+}
+
+void CborCodec::encodeHead(std::string& out, uint8_t majorType, uint64_t argument)
+{
+	// shortest form of argument
+	uint8_t major = majorType << 5;
+	if (argument < 24)
+	{
+		out.push_back(static_cast<char>(major | argument));
+	}
+	else if (argument <= 0xFF)
+	{
+		out.push_back(static_cast<char>(major | 24));
+		out.push_back(static_cast<char>(argument));
+	}
+	else if (argument <= 0xFFFF)
+	{
+		out.push_back(static_cast<char>(major | 25));
+		for (int shift = 8; shift >= 0; shift -= 8) out.push_back(static_cast<char>((argument >> shift) & 0xFF));
+	}
+	else if (argument <= 0xFFFFFFFF)
+	{
+		out.push_back(static_cast<char>(major | 26));
+		for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<char>((argument >> shift) & 0xFF));
+	}
+	else
+	{
+		out.push_back(static_cast<char>(major | 27));
+		for (int shift = 56; shift >= 0; shift -= 8) out.push_back(static_cast<char>((argument >> shift) & 0xFF));
+	}
+}
+
+uint64_t CborCodec::decodeArgument(const std::string& data, size_t& pos, uint8_t info)
+{
+	if (info < 24) return info;
+	size_t len = 0;
+	switch (info)
+	{
+	case 24: len = 1; break;
+	case 25: len = 2; break;
+	case 26: len = 4; break;
+	case 27: len = 8; break;
+	default:
+		// 28-30 reserved, 31 is indefinite length
+		throw std::invalid_argument("cbor: indefinite length or reserved argument is not supported");
+	}
+	if (data.size() - pos < len)
+	{
+		throw std::invalid_argument("cbor: unexpected end of data");
+	}
+	uint64_t argument = 0;
+	for (size_t i = 0; i < len; i++) argument = (argument << 8) | static_cast<uint8_t>(data[pos++]);
+	return argument;
+}
+
+web::json::value CborCodec::decodeValue(const std::string& data, size_t& pos, int depth)
+{
+	if (depth > CBOR_MAX_DEPTH)
+	{
+		throw std::invalid_argument("cbor: nesting too deep");
+	}
+	if (pos >= data.size())
+	{
+		throw std::invalid_argument("cbor: unexpected end of data");
+	}
+	auto initial = static_cast<uint8_t>(data[pos++]);
+	uint8_t major = initial >> 5;
+	uint8_t info = initial & 0x1F;
+
+	switch (major)
+	{
+	case CBOR_UNSIGNED:
+		return web::json::value::number(decodeArgument(data, pos, info));
+	case CBOR_NEGATIVE:
+	{
+		auto argument = decodeArgument(data, pos, info);
+		if (argument > static_cast<uint64_t>(INT64_MAX))
+		{
+			throw std::invalid_argument("cbor: negative integer out of range");
+		}
+		return web::json::value::number(-1 - static_cast<int64_t>(argument));
+	}
+	case CBOR_TEXT:
+	{
+		auto len = decodeArgument(data, pos, info);
+		if (data.size() - pos < len)
+		{
+			throw std::invalid_argument("cbor: unexpected end of data");
+		}
+		auto str = data.substr(pos, len);
+		pos += len;
+		return web::json::value::string(str);
+	}
+	case CBOR_ARRAY:
+	{
+		auto count = decodeArgument(data, pos, info);
+		// each element takes at least one byte
+		if (count > data.size() - pos)
+		{
+			throw std::invalid_argument("cbor: array size exceeds data");
+		}
+		auto array = web::json::value::array(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			array[i] = decodeValue(data, pos, depth + 1);
+		}
+		return array;
+	}
+	case CBOR_MAP:
+	{
+		auto count = decodeArgument(data, pos, info);
+		if (count > (data.size() - pos) / 2)
+		{
+			throw std::invalid_argument("cbor: map size exceeds data");
+		}
+		auto object = web::json::value::object();
+		for (size_t i = 0; i < count; i++)
+		{
+			auto key = decodeValue(data, pos, depth + 1);
+			if (!key.is_string())
+			{
+				throw std::invalid_argument("cbor: only text map key is supported");
+			}
+			object[key.as_string()] = decodeValue(data, pos, depth + 1);
+		}
+		return object;
+	}
+	case CBOR_TAG:
+		// semantic tag is ignored, decode the tagged item
+		decodeArgument(data, pos, info);
+		return decodeValue(data, pos, depth + 1);
+	case CBOR_SIMPLE:
+		switch (initial)
+		{
+		case CBOR_FALSE:
+			return web::json::value::boolean(false);
+		case CBOR_TRUE:
+			return web::json::value::boolean(true);
+		case CBOR_NULL:
+		case CBOR_UNDEFINED:
+			return web::json::value::null();
+		case CBOR_FLOAT16:
+		{
+			auto half = static_cast<uint16_t>(decodeArgument(data, pos, 25));
+			int exponent = (half >> 10) & 0x1F;
+			int mantissa = half & 0x3FF;
+			double value;
+			if (exponent == 0) value = std::ldexp(mantissa, -24);
+			else if (exponent != 31) value = std::ldexp(mantissa + 1024, exponent - 25);
+			else value = mantissa == 0 ? INFINITY : NAN;
+			return web::json::value::number((half & 0x8000) ? -value : value);
+		}
+		case CBOR_FLOAT32:
+		{
+			auto bits = static_cast<uint32_t>(decodeArgument(data, pos, 26));
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return web::json::value::number(static_cast<double>(value));
+		}
+		case CBOR_FLOAT64:
+		{
+			auto bits = decodeArgument(data, pos, 27);
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return web::json::value::number(value);
+		}
+		default:
+			break;
+		}
+		break;
+	default:
+		// byte string has no JSON equivalent
+		break;
+	}
+	throw std::invalid_argument(std::string("cbor: unsupported initial byte ") + std::to_string(initial));
+}
@@ -0,0 +1,25 @@
+#ifndef CBOR_CODEC_H
+#define CBOR_CODEC_H
+#include <string>
+#include <cstdint>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// CBOR (RFC 8949) binary encoding of the JSON data model, object keys and
+// value semantics are the same as the JSON API
+//////////////////////////////////////////////////////////////////////////
+class CborCodec
+{
+public:
+	static std::string encode(const web::json::value& json);
+	// throw std::invalid_argument for malformed or unsupported input
+	static web::json::value decode(const std::string& data);
+
+private:
+	static void encodeValue(std::string& out, const web::json::value& json);
+	static void encodeHead(std::string& out, uint8_t majorType, uint64_t argument);
+	static web::json::value decodeValue(const std::string& data, size_t& pos, int depth);
+	static uint64_t decodeArgument(const std::string& data, size_t& pos, uint8_t info);
+};
+
+#endif
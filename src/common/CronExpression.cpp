@@ -0,0 +1,275 @@
+#include <map>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include "CronExpression.h"
+#include "TimeZoneHelper.h"
+#include "Utility.h"
+
+namespace
+{
+	const char* const MONTH_NAMES[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+	const char* const WEEKDAY_NAMES[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+	const std::map<std::string, std::string> MACROS = {
+		{ "@yearly", "0 0 0 1 1 *" },
+		{ "@annually", "0 0 0 1 1 *" },
+		{ "@monthly", "0 0 0 1 * *" },
+		{ "@weekly", "0 0 0 * * 0" },
+		{ "@daily", "0 0 0 * * *" },
+		{ "@midnight", "0 0 0 * * *" },
+		{ "@hourly", "0 0 * * * *" }
+	};
+}
+
+CronExpression::CronExpression(const std::string& expression)
+	:m_expression(Utility::stdStringTrim(expression)), m_seconds(0), m_minutes(0), m_hours(0), m_days(0), m_months(0), m_weekdays(0), m_anyDay(true), m_anyWeekday(true)
+{
+	auto macro = MACROS.find(m_expression);
+	std::istringstream stream(macro != MACROS.end() ? macro->second : m_expression);
+	std::vector<std::string> fields;
+	std::string field;
+	while (stream >> field) fields.push_back(field);
+	// 5 fields fire at second 0
+	if (fields.size() == 5) fields.insert(fields.begin(), "0");
+	if (fields.size() != 6)
+	{
+		throw std::invalid_argument("cron expression should have 5 or 6 fields: " + m_expression);
+	}
+
+	m_seconds = parseField(fields[0], 0, 59, nullptr, 0, 0);
+	m_minutes = parseField(fields[1], 0, 59, nullptr, 0, 0);
+	m_hours = parseField(fields[2], 0, 23, nullptr, 0, 0);
+	m_days = parseField(fields[3], 1, 31, nullptr, 0, 0);
+	m_months = parseField(fields[4], 1, 12, MONTH_NAMES, 12, 1);
+	m_weekdays = parseField(fields[5], 0, 7, WEEKDAY_NAMES, 7, 0);
+	// 7 is Sunday too
+	if (m_weekdays & (1ULL << 7)) m_weekdays = (m_weekdays | 1ULL) & ~(1ULL << 7);
+	m_anyDay = (fields[3] == "*" || fields[3] == "?");
+	m_anyWeekday = (fields[5] == "*" || fields[5] == "?");
+
+	// such as 31st of February
+	std::tm start = {};
+	start.tm_year = 100;
+	start.tm_mday = 1;
+	std::tm result;
+	if (!next(start, result))
+	{
+		throw std::invalid_argument("cron expression never fires: " + m_expression);
+	}
+}
+
+CronExpression::~CronExpression()
+{
+}
+
+uint64_t CronExpression::parseField(const std::string& field, int min, int max, const char* const* names, int nameCount, int nameBase)
+{
+	uint64_t mask = 0;
+	auto items = Utility::splitString(field, ",");
+	if (items.empty())
+	{
+		throw std::invalid_argument("empty cron field");
+	}
+	for (const auto& item : items)
+	{
+		int step = 1;
+		auto slash = item.find('/');
+		auto range = item.substr(0, slash);
+		if (slash != std::string::npos)
+		{
+			step = parseValue(item.substr(slash + 1), 1, max - min + 1, nullptr, 0, 0);
+		}
+		int low = min;
+		int high = max;
+		if (range != "*" && range != "?")
+		{
+			auto dash = range.find('-');
+			low = parseValue(range.substr(0, dash), min, max, names, nameCount, nameBase);
+			if (dash != std::string::npos)
+			{
+				high = parseValue(range.substr(dash + 1), min, max, names, nameCount, nameBase);
+			}
+			else if (slash == std::string::npos)
+			{
+				// single value, "5/15" means from 5 to max
+				high = low;
+			}
+		}
+		if (low > high)
+		{
+			throw std::invalid_argument("cron range start is greater than end: " + item);
+		}
+		for (int value = low; value <= high; value += step) mask |= (1ULL << value);
+	}
+	return mask;
+}
+
+int CronExpression::parseValue(const std::string& token, int min, int max, const char* const* names, int nameCount, int nameBase)
+{
+	if (token.length() && std::all_of(token.begin(), token.end(), ::isdigit))
+	{
+		auto value = std::stoi(token);
+		if (value < min || value > max)
+		{
+			throw std::invalid_argument("cron value <" + token + "> should be between " + std::to_string(min) + " and " + std::to_string(max));
+		}
+		return value;
+	}
+	auto upper = token;
+	std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+	for (int i = 0; i < nameCount; i++)
+	{
+		if (upper == names[i]) return nameBase + i;
+	}
+	throw std::invalid_argument("invalid cron value: " + token);
+}
+
+int CronExpression::nextBit(uint64_t mask, int from)
+{
+	if (from > 63) return -1;
+	mask = (mask >> from) << from;
+	return mask ? __builtin_ctzll(mask) : -1;
+}
+
+int CronExpression::daysInMonth(int year, int month)
+{
+	static const int DAYS[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) return 29;
+	return DAYS[month - 1];
+}
+
+int CronExpression::weekday(int year, int month, int day)
+{
+	// Sakamoto's method
+	static const int OFFSETS[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+	if (month < 3) year -= 1;
+	return (year + year / 4 - year / 100 + year / 400 + OFFSETS[month - 1] + day) % 7;
+}
+
+bool CronExpression::dayMatches(int year, int month, int day) const
+{
+	const bool dayMatch = (m_days >> day) & 1;
+	const bool weekdayMatch = (m_weekdays >> weekday(year, month, day)) & 1;
+	// both restricted: either one fires (same as vixie cron)
+	return (m_anyDay || m_anyWeekday) ? (dayMatch && weekdayMatch) : (dayMatch || weekdayMatch);
+}
+
+bool CronExpression::next(const std::tm& after, std::tm& result) const
+{
+	int year = after.tm_year + 1900;
+	int month = after.tm_mon + 1;
+	int day = after.tm_mday;
+	int hour = after.tm_hour;
+	int minute = after.tm_min;
+	int second = after.tm_sec + 1;
+	const int lastYear = year + CRON_MAX_SEARCH_YEARS;
+
+	// each step either accepts a field or moves it to the next candidate and resets lower fields,
+	// a field moved past its maximum is carried to the upper field at the beginning of next step
+	while (year <= lastYear)
+	{
+		if (second > 59)
+		{
+			second = 0;
+			minute++;
+		}
+		if (minute > 59)
+		{
+			minute = 0;
+			hour++;
+		}
+		if (hour > 23)
+		{
+			hour = 0;
+			day++;
+		}
+		if (month <= 12 && day > daysInMonth(year, month))
+		{
+			day = 1;
+			month++;
+		}
+		if (month > 12)
+		{
+			month = 1;
+			year++;
+			continue;
+		}
+
+		auto value = nextBit(m_months, month);
+		if (value != month)
+		{
+			month = (value < 0) ? 13 : value;
+			day = 1;
+			hour = minute = second = 0;
+			continue;
+		}
+		if (!dayMatches(year, month, day))
+		{
+			// weekday not restricted: jump to next day in mask
+			value = m_anyWeekday ? nextBit(m_days, day + 1) : day + 1;
+			day = (value < 0) ? 32 : value;
+			hour = minute = second = 0;
+			continue;
+		}
+		value = nextBit(m_hours, hour);
+		if (value != hour)
+		{
+			hour = (value < 0) ? 24 : value;
+			minute = second = 0;
+			continue;
+		}
+		value = nextBit(m_minutes, minute);
+		if (value != minute)
+		{
+			minute = (value < 0) ? 60 : value;
+			second = 0;
+			continue;
+		}
+		value = nextBit(m_seconds, second);
+		if (value != second)
+		{
+			second = (value < 0) ? 60 : value;
+			continue;
+		}
+
+		result = std::tm();
+		result.tm_year = year - 1900;
+		result.tm_mon = month - 1;
+		result.tm_mday = day;
+		result.tm_hour = hour;
+		result.tm_min = minute;
+		result.tm_sec = second;
+		result.tm_wday = weekday(year, month, day);
+		result.tm_isdst = -1;
+		return true;
+	}
+	return false;
+}
+
+std::chrono::system_clock::time_point CronExpression::next(const std::chrono::system_clock::time_point& after, const std::string& posixTimezone) const
+{
+	auto local = TimeZoneHelper::toLocalTime(after, posixTimezone);
+	const int lastYear = local.tm_year + CRON_MAX_SEARCH_YEARS;
+	std::tm candidate;
+	while (next(local, candidate) && candidate.tm_year <= lastYear)
+	{
+		for (const auto& time : TimeZoneHelper::fromLocalTime(candidate, posixTimezone))
+		{
+			if (time > after) return time;
+		}
+		// skipped by daylight saving: search again from the first wall clock after the gap
+		auto gapEnd = TimeZoneHelper::gapEnd(candidate, posixTimezone);
+		if (gapEnd > after)
+		{
+			local = TimeZoneHelper::toLocalTime(gapEnd, posixTimezone);
+			// next() starts from the second after <local>
+			local.tm_sec--;
+		}
+		else
+		{
+			local = candidate;
+		}
+	}
+	return std::chrono::system_clock::time_point::max();
+}
@@ -0,0 +1,56 @@
+#ifndef CRON_EXPRESSION_H
+#define CRON_EXPRESSION_H
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+//////////////////////////////////////////////////////////////////////////
+// Cron schedule: "min hour day month weekday" or with a leading second
+// field, each field is a list of values, ranges and steps (1,5 1-5 */10
+// 10-40/5), month and weekday accept names (JAN, MON), weekday 7 is Sunday,
+// @yearly @monthly @weekly @daily @hourly are accepted.
+// Every field is a bit mask, next fire time is found by jumping field by
+// field to the next set bit instead of testing each second.
+//////////////////////////////////////////////////////////////////////////
+class CronExpression
+{
+public:
+	// throw std::invalid_argument for bad syntax or expression never fires
+	explicit CronExpression(const std::string& expression);
+	virtual ~CronExpression();
+
+	const std::string& getExpression() const { return m_expression; }
+
+	// first wall clock later than <after> matching expression, false when none in CRON_MAX_SEARCH_YEARS
+	bool next(const std::tm& after, std::tm& result) const;
+	// first time later than <after> in <posixTimezone> (system time zone when empty), time_point::max() when none;
+	// wall clock skipped by daylight saving is not fired, search continues after the gap,
+	// repeated wall clock fires at its first occurrence later than <after>
+	std::chrono::system_clock::time_point next(const std::chrono::system_clock::time_point& after, const std::string& posixTimezone) const;
+
+private:
+	// values of one field as bit mask, names[i] is value <nameBase> + i
+	static uint64_t parseField(const std::string& field, int min, int max, const char* const* names, int nameCount, int nameBase);
+	static int parseValue(const std::string& token, int min, int max, const char* const* names, int nameCount, int nameBase);
+	// smallest set bit not less than <from>, -1 when none
+	static int nextBit(uint64_t mask, int from);
+	static int daysInMonth(int year, int month);
+	// 0 is Sunday
+	static int weekday(int year, int month, int day);
+	bool dayMatches(int year, int month, int day) const;
+
+private:
+	std::string m_expression;
+	uint64_t m_seconds;
+	uint64_t m_minutes;
+	uint64_t m_hours;
+	uint64_t m_days;
+	uint64_t m_months;
+	uint64_t m_weekdays;
+	// day or weekday field is '*', otherwise a day matching either field fires
+	bool m_anyDay;
+	bool m_anyWeekday;
+};
+
+#endif
@@ -2,7 +2,7 @@
 
 
 HttpRequest::HttpRequest(const web::http::http_request& message)
-	:http_request(message)
+	:http_request(message), m_remotePermissionsResolved(false)
 {
 }
 
@@ -66,6 +66,13 @@ pplx::task<void> HttpRequest::reply(status_code status, const concurrency::strea
 	return reply(response);
 }
 
+void HttpRequest::setRemotePermissions(const std::set<std::string>& permissions, const std::string& error)
+{
+	m_remotePermissionsResolved = true;
+	m_remotePermissions = permissions;
+	m_remotePermissionsError = error;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // HttpRequestWithCallback
 ////////////////////////////////////////////////////////////////////////////////
@@ -1,5 +1,7 @@
 #ifndef REST_HTTP_REQUEST_H
 #define REST_HTTP_REQUEST_H
+#include <set>
+#include <string>
 #include <functional>
 #include <cpprest/http_client.h>
 
@@ -108,6 +110,21 @@ public:
 		const concurrency::streams::istream& body,
 		utility::size64_t content_length,
 		const utility::string_t& content_type = _XPLATSTR("application/octet-stream")) const;
+
+	/// <summary>
+	/// Permissions of the token user resolved by JWT redirect server before the request is handled.
+	/// </summary>
+	/// <param name="permissions">Permissions returned by redirect server.</param>
+	/// <param name="error">Reply of redirect server when resolve failed, empty for success.</param>
+	void setRemotePermissions(const std::set<std::string>& permissions, const std::string& error);
+	bool remotePermissionsResolved() const { return m_remotePermissionsResolved; }
+	const std::set<std::string>& getRemotePermissions() const { return m_remotePermissions; }
+	const std::string& getRemotePermissionsError() const { return m_remotePermissionsError; }
+
+private:
+	bool m_remotePermissionsResolved;
+	std::set<std::string> m_remotePermissions;
+	std::string m_remotePermissionsError;
 };
 
 class HttpRequestWithCallback : public HttpRequest
@@ -0,0 +1,349 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "JsonWriter.h"
+
+// same indent as jsoncpp StyledWriter
+#define JSON_WRITER_INDENT "   "
+
+JsonWriter::JsonWriter(bool pretty)
+	:m_pretty(pretty), m_afterKey(false)
+{
+}
+
+JsonWriter::~JsonWriter()
+{
+}
+
+JsonWriter& JsonWriter::startObject()
+{
+	beforeValue();
+	m_buffer.push_back('{');
+	m_stack.push_back(0);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+	auto count = m_stack.back();
+	m_stack.pop_back();
+	if (count) newLine();
+	m_buffer.push_back('}');
+	return *this;
+}
+
+JsonWriter& JsonWriter::startArray()
+{
+	beforeValue();
+	m_buffer.push_back('[');
+	m_stack.push_back(0);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+	auto count = m_stack.back();
+	m_stack.pop_back();
+	if (count) newLine();
+	m_buffer.push_back(']');
+	return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string& name)
+{
+	beforeValue();
+	writeString(name);
+	m_buffer.append(m_pretty ? " : " : ":");
+	m_afterKey = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& str)
+{
+	beforeValue();
+	writeString(str);
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* str)
+{
+	return value(std::string(str));
+}
+
+JsonWriter& JsonWriter::value(int64_t number)
+{
+	beforeValue();
+	char buf[32];
+	auto len = std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(number));
+	m_buffer.append(buf, len);
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t number)
+{
+	beforeValue();
+	char buf[32];
+	auto len = std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(number));
+	m_buffer.append(buf, len);
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(int number)
+{
+	return value(static_cast<int64_t>(number));
+}
+
+JsonWriter& JsonWriter::value(double number)
+{
+	beforeValue();
+	if (!std::isfinite(number))
+	{
+		// JSON have no NaN and Infinity
+		m_buffer.append("null");
+		return *this;
+	}
+	// shortest text which read back to the same double
+	char buf[32];
+	auto len = std::snprintf(buf, sizeof(buf), "%.15g", number);
+	if (std::strtod(buf, nullptr) != number) len = std::snprintf(buf, sizeof(buf), "%.17g", number);
+	m_buffer.append(buf, len);
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(bool boolean)
+{
+	beforeValue();
+	m_buffer.append(boolean ? "true" : "false");
+	return *this;
+}
+
+JsonWriter& JsonWriter::null()
+{
+	beforeValue();
+	m_buffer.append("null");
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const web::json::value& json)
+{
+	switch (json.type())
+	{
+	case web::json::value::Object:
+		startObject();
+		for (const auto& field : json.as_object())
+		{
+			key(field.first);
+			value(field.second);
+		}
+		endObject();
+		break;
+	case web::json::value::Array:
+		startArray();
+		for (const auto& element : json.as_array())
+		{
+			value(element);
+		}
+		endArray();
+		break;
+	case web::json::value::String:
+		value(json.as_string());
+		break;
+	case web::json::value::Number:
+	{
+		const auto& number = json.as_number();
+		if (number.is_int64()) value(number.to_int64());
+		else if (number.is_uint64()) value(number.to_uint64());
+		else value(number.to_double());
+		break;
+	}
+	case web::json::value::Boolean:
+		value(json.as_bool());
+		break;
+	default:
+		null();
+		break;
+	}
+	return *this;
+}
+
+void JsonWriter::reset(bool pretty)
+{
+	m_buffer.clear();
+	m_stack.clear();
+	m_pretty = pretty;
+	m_afterKey = false;
+}
+
+std::string JsonWriter::toString(const web::json::value& json, bool pretty)
+{
+	thread_local JsonWriter writer;
+	writer.reset(pretty);
+	writer.value(json);
+	if (pretty) writer.m_buffer.push_back('\n');
+	return writer.m_buffer;
+}
+
+std::string JsonWriter::toString(const std::function<void(JsonWriter&)>& write, bool pretty)
+{
+	// not the writer of toString(json), write() may serialize a tree inside
+	thread_local JsonWriter writer;
+	writer.reset(pretty);
+	write(writer);
+	if (pretty) writer.m_buffer.push_back('\n');
+	return writer.m_buffer;
+}
+
+void JsonWriter::beforeValue()
+{
+	if (m_afterKey)
+	{
+		// value of a key
+		m_afterKey = false;
+		return;
+	}
+	if (!m_stack.empty())
+	{
+		if (m_stack.back()++) m_buffer.push_back(',');
+		newLine();
+	}
+}
+
+void JsonWriter::newLine()
+{
+	if (m_pretty)
+	{
+		m_buffer.push_back('\n');
+		for (size_t i = 0; i < m_stack.size(); i++) m_buffer.append(JSON_WRITER_INDENT);
+	}
+}
+
+void JsonWriter::writeString(const std::string& str)
+{
+	static const char hex[] = "0123456789abcdef";
+	m_buffer.push_back('"');
+	for (unsigned char c : str)
+	{
+		switch (c)
+		{
+		case '"': m_buffer.append("\\\""); break;
+		case '\\': m_buffer.append("\\\\"); break;
+		case '\b': m_buffer.append("\\b"); break;
+		case '\f': m_buffer.append("\\f"); break;
+		case '\n': m_buffer.append("\\n"); break;
+		case '\r': m_buffer.append("\\r"); break;
+		case '\t': m_buffer.append("\\t"); break;
+		default:
+			if (c < 0x20)
+			{
+				m_buffer.append("\\u00");
+				m_buffer.push_back(hex[c >> 4]);
+				m_buffer.push_back(hex[c & 0xF]);
+			}
+			else
+			{
+				m_buffer.push_back(static_cast<char>(c));
+			}
+			break;
+		}
+	}
+	m_buffer.push_back('"');
+}
+
+JsonTreeWriter::JsonTreeWriter()
+{
+}
+
+JsonTreeWriter::~JsonTreeWriter()
+{
+}
+
+JsonWriter& JsonTreeWriter::startObject()
+{
+	auto& json = slot();
+	json = web::json::value::object();
+	m_stack.push_back(&json);
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::endObject()
+{
+	m_stack.pop_back();
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::startArray()
+{
+	auto& json = slot();
+	json = web::json::value::array();
+	m_stack.push_back(&json);
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::endArray()
+{
+	m_stack.pop_back();
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::key(const std::string& name)
+{
+	m_key = name;
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::value(const std::string& str)
+{
+	slot() = web::json::value::string(utility::conversions::to_string_t(str));
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::value(int64_t number)
+{
+	slot() = web::json::value::number(number);
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::value(uint64_t number)
+{
+	slot() = web::json::value::number(number);
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::value(double number)
+{
+	slot() = web::json::value::number(number);
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::value(bool boolean)
+{
+	slot() = web::json::value::boolean(boolean);
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::null()
+{
+	slot() = web::json::value::null();
+	return *this;
+}
+
+JsonWriter& JsonTreeWriter::value(const web::json::value& json)
+{
+	slot() = json;
+	return *this;
+}
+
+web::json::value JsonTreeWriter::toJson(const std::function<void(JsonWriter&)>& write)
+{
+	JsonTreeWriter writer;
+	write(writer);
+	return std::move(writer.m_root);
+}
+
+web::json::value& JsonTreeWriter::slot()
+{
+	if (m_stack.empty()) return m_root;
+	auto& parent = *m_stack.back();
+	if (parent.is_array()) return parent[parent.size()];
+	return parent[utility::conversions::to_string_t(m_key)];
+}
@@ -0,0 +1,96 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Single pass JSON writer, append compact or pretty JSON text into a
+// reusable buffer without building an intermediate string or tree
+//////////////////////////////////////////////////////////////////////////
+class JsonWriter
+{
+public:
+	explicit JsonWriter(bool pretty = false);
+	virtual ~JsonWriter();
+
+	virtual JsonWriter& startObject();
+	virtual JsonWriter& endObject();
+	virtual JsonWriter& startArray();
+	virtual JsonWriter& endArray();
+	virtual JsonWriter& key(const std::string& name);
+	virtual JsonWriter& value(const std::string& str);
+	JsonWriter& value(const char* str);
+	virtual JsonWriter& value(int64_t number);
+	virtual JsonWriter& value(uint64_t number);
+	JsonWriter& value(int number);
+	virtual JsonWriter& value(double number);
+	virtual JsonWriter& value(bool boolean);
+	virtual JsonWriter& null();
+	// walk a cpprest json tree and write it
+	virtual JsonWriter& value(const web::json::value& json);
+
+	// clear content and keep allocated buffer for next use
+	void reset(bool pretty);
+	const std::string& str() const { return m_buffer; }
+
+	// serialize with a per-thread writer, buffer memory is reused between calls
+	static std::string toString(const web::json::value& json, bool pretty);
+	static std::string toString(const std::function<void(JsonWriter&)>& write, bool pretty);
+
+private:
+	void beforeValue();
+	void newLine();
+	void writeString(const std::string& str);
+
+private:
+	std::string m_buffer;
+	bool m_pretty;
+	bool m_afterKey;
+	// element count of each open object or array
+	std::vector<size_t> m_stack;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Same writer interface building a cpprest json tree, used where a tree is
+// still needed (CBOR encoding, configuration update), so each schema is
+// written once by a function taking JsonWriter
+//////////////////////////////////////////////////////////////////////////
+class JsonTreeWriter : public JsonWriter
+{
+public:
+	JsonTreeWriter();
+	virtual ~JsonTreeWriter();
+
+	virtual JsonWriter& startObject() override;
+	virtual JsonWriter& endObject() override;
+	virtual JsonWriter& startArray() override;
+	virtual JsonWriter& endArray() override;
+	virtual JsonWriter& key(const std::string& name) override;
+	using JsonWriter::value;
+	virtual JsonWriter& value(const std::string& str) override;
+	virtual JsonWriter& value(int64_t number) override;
+	virtual JsonWriter& value(uint64_t number) override;
+	virtual JsonWriter& value(double number) override;
+	virtual JsonWriter& value(bool boolean) override;
+	virtual JsonWriter& null() override;
+	virtual JsonWriter& value(const web::json::value& json) override;
+
+	web::json::value& json() { return m_root; }
+
+	static web::json::value toJson(const std::function<void(JsonWriter&)>& write);
+
+private:
+	// slot of next value: root, pending key of current object or end of current array
+	web::json::value& slot();
+
+private:
+	web::json::value m_root;
+	// open objects and arrays, a child is not moved while it is open
+	std::vector<web::json::value*> m_stack;
+	std::string m_key;
+};
+
+#endif
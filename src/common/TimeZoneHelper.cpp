@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <boost/date_time/local_time/local_time.hpp>
 #include "TimeZoneHelper.h"
 #include "Utility.h"
@@ -47,4 +48,86 @@ std::chrono::system_clock::time_point TimeZoneHelper::convert2tzTime(std::chrono
 		LOG_WAR << fname << "unknown exception : " << std::strerror(errno);
 		return origin_time;
 	}
-}
\ No newline at end of file
+}
+
+std::tm TimeZoneHelper::toLocalTime(const std::chrono::system_clock::time_point& time, const std::string& posixTimezone)
+{
+	std::time_t timet = std::chrono::system_clock::to_time_t(time);
+	std::tm local = {};
+	if (posixTimezone.empty())
+	{
+		localtime_r(&timet, &local);
+		return local;
+	}
+	boost::local_time::time_zone_ptr zone(new boost::local_time::posix_time_zone(posixTimezone));
+	boost::local_time::local_date_time localTime(boost::posix_time::from_time_t(timet), zone);
+	return boost::posix_time::to_tm(localTime.local_time());
+}
+
+std::vector<std::chrono::system_clock::time_point> TimeZoneHelper::fromLocalTime(const std::tm& local, const std::string& posixTimezone)
+{
+	std::vector<std::chrono::system_clock::time_point> times;
+	if (posixTimezone.empty())
+	{
+		// resolve with each daylight saving flag, mktime moves wall clock which does not exist with that flag
+		for (int isdst : { 1, 0 })
+		{
+			std::tm normalized = local;
+			normalized.tm_isdst = isdst;
+			auto timet = std::mktime(&normalized);
+			if (timet == -1 || normalized.tm_mday != local.tm_mday || normalized.tm_hour != local.tm_hour ||
+				normalized.tm_min != local.tm_min || normalized.tm_sec != local.tm_sec) continue;
+			auto time = std::chrono::system_clock::from_time_t(timet);
+			if (std::find(times.begin(), times.end(), time) == times.end()) times.push_back(time);
+		}
+		std::sort(times.begin(), times.end());
+		return times;
+	}
+	boost::local_time::time_zone_ptr zone(new boost::local_time::posix_time_zone(posixTimezone));
+	boost::gregorian::date date(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+	boost::posix_time::time_duration duration(local.tm_hour, local.tm_min, local.tm_sec);
+	try
+	{
+		boost::local_time::local_date_time localTime(date, duration, zone, boost::local_time::local_date_time::EXCEPTION_ON_ERROR);
+		times.push_back(std::chrono::system_clock::from_time_t(boost::posix_time::to_time_t(localTime.utc_time())));
+	}
+	catch (const boost::local_time::ambiguous_result&)
+	{
+		for (bool dst : { true, false })
+		{
+			boost::local_time::local_date_time localTime(date, duration, zone, dst);
+			times.push_back(std::chrono::system_clock::from_time_t(boost::posix_time::to_time_t(localTime.utc_time())));
+		}
+	}
+	catch (const boost::local_time::time_label_invalid&)
+	{
+	}
+	return times;
+}
+
+std::chrono::system_clock::time_point TimeZoneHelper::gapEnd(const std::tm& local, const std::string& posixTimezone)
+{
+	std::tm wallTm = local;
+	const std::time_t wall = timegm(&wallTm);
+	// UTC offset at <time>, transitions are assumed to be more than one day apart
+	auto offsetAt = [&posixTimezone](std::time_t time)
+	{
+		auto localTm = toLocalTime(std::chrono::system_clock::from_time_t(time), posixTimezone);
+		return timegm(&localTm) - time;
+	};
+	const auto offsetBefore = offsetAt(wall - 24 * 60 * 60);
+	const auto offsetAfter = offsetAt(wall + 24 * 60 * 60);
+	if (offsetAfter <= offsetBefore) return std::chrono::system_clock::time_point::min();
+
+	// wall clock of <low> is before <local> and wall clock of <high> is not, the transition is between them
+	std::time_t low = wall - offsetAfter;
+	std::time_t high = wall - offsetBefore;
+	while (high - low > 1)
+	{
+		auto middle = low + (high - low) / 2;
+		auto localTm = toLocalTime(std::chrono::system_clock::from_time_t(middle), posixTimezone);
+		if (timegm(&localTm) >= wall) high = middle;
+		else low = middle;
+	}
+	return std::chrono::system_clock::from_time_t(high);
+}
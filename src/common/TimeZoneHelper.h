@@ -1,7 +1,9 @@
 #ifndef TIME_ZONE_HELPER_H
 #define TIME_ZONE_HELPER_H
+#include <ctime>
 #include <string>
 #include <chrono>
+#include <vector>
 
 class TimeZoneHelper
 {
@@ -11,6 +13,13 @@ public:
 
 	// Convert target zone time to current zone
 	static std::chrono::system_clock::time_point convert2tzTime(std::chrono::system_clock::time_point& dst, std::string& posixTimezone);
+	// wall clock of <time> in <posixTimezone>, system time zone when empty, throw for invalid time zone
+	static std::tm toLocalTime(const std::chrono::system_clock::time_point& time, const std::string& posixTimezone);
+	// times of wall clock <local> in <posixTimezone> in ascending order, empty when the wall clock is skipped
+	// by daylight saving, two when it is repeated (daylight saving one first)
+	static std::vector<std::chrono::system_clock::time_point> fromLocalTime(const std::tm& local, const std::string& posixTimezone);
+	// first time after the daylight saving gap which skipped wall clock <local>, time_point::min() when <local> is not in a gap
+	static std::chrono::system_clock::time_point gapEnd(const std::tm& local, const std::string& posixTimezone);
 };
 #endif
 
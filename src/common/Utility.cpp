@@ -24,6 +24,7 @@
 #include <log4cpp/OstreamAppender.hh>
 #include <json/reader.h>
 #include <ace/UUID.h>
+#include <openssl/evp.h>
 
 #include "../common/Utility.h"
 #include "../common/date.h"
@@ -53,6 +54,28 @@ bool Utility::isNumber(std::string s)
 	return !s.empty() && std::find_if(s.begin(), s.end(), [](char c) { return !std::isdigit(c); }) == s.end();
 }
 
+int Utility::parseDurationSeconds(const std::string& str)
+{
+	auto value = stdStringTrim(str);
+	int unit = 1;
+	if (value.length())
+	{
+		switch (value.back())
+		{
+		case 's': unit = 1; value.pop_back(); break;
+		case 'm': unit = 60; value.pop_back(); break;
+		case 'h': unit = 60 * 60; value.pop_back(); break;
+		case 'd': unit = 60 * 60 * 24; value.pop_back(); break;
+		default: break;
+		}
+	}
+	if (!isNumber(value) || value.length() > 6)
+	{
+		throw std::invalid_argument(std::string("invalid duration: ") + str);
+	}
+	return std::stoi(value) * unit;
+}
+
 std::string Utility::stdStringTrim(const std::string& str)
 {
 	char* line = const_cast <char*> (str.c_str());
@@ -455,6 +478,46 @@ std::string Utility::readFileCpp(const std::string& path)
 	return std::move(str);
 }
 
+std::string Utility::hashFile(const std::string& path)
+{
+	const static char fname[] = "Utility::hashFile() ";
+
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		LOG_ERR << fname << "can not open file <" << path << ">";
+		return std::string();
+	}
+
+	// EVP digest, SHA256_* low level functions are deprecated since OpenSSL 3.0
+	std::unique_ptr<EVP_MD_CTX, void(*)(EVP_MD_CTX*)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+	if (ctx == nullptr || EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr) != 1)
+	{
+		LOG_ERR << fname << "failed to initialize SHA-256 digest";
+		return std::string();
+	}
+	std::vector<char> buffer(1024 * 1024);
+	while (file)
+	{
+		file.read(buffer.data(), buffer.size());
+		if (file.gcount() > 0) EVP_DigestUpdate(ctx.get(), buffer.data(), file.gcount());
+	}
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digestLength = 0;
+	if (EVP_DigestFinal_ex(ctx.get(), digest, &digestLength) != 1)
+	{
+		LOG_ERR << fname << "failed to finalize SHA-256 digest of file <" << path << ">";
+		return std::string();
+	}
+
+	std::stringstream ss;
+	for (size_t i = 0; i < digestLength; i++)
+	{
+		ss << std::hex << std::setw(2) << std::setfill('0') << (int)digest[i];
+	}
+	return ss.str();
+}
+
 std::string Utility::createUUID()
 {
 	static bool initialized = false;
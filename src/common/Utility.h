@@ -59,6 +59,7 @@ namespace std
 #define GET_JSON_STR_T_VALUE(jsonObj, key) (HAS_JSON_FIELD(jsonObj, key) ? jsonObj.at(GET_STRING_T(key)).as_string() : GET_STRING_T(""))
 #define GET_JSON_INT_VALUE(jsonObj, key) (HAS_JSON_FIELD(jsonObj, key) ? jsonObj.at(GET_STRING_T(key)).as_integer() : 0)
 #define GET_JSON_NUMBER_VALUE(jsonObj, key) (HAS_JSON_FIELD(jsonObj, key) ? jsonObj.at(GET_STRING_T(key)).as_number().to_int64() : 0L)
+#define GET_JSON_DOUBLE_VALUE(jsonObj, key) (HAS_JSON_FIELD(jsonObj, key) ? jsonObj.at(GET_STRING_T(key)).as_double() : 0.0)
 #define SET_JSON_INT_VALUE(jsonObj, key, value) if (HAS_JSON_FIELD(jsonObj, key)) value = GET_JSON_INT_VALUE(jsonObj, key);
 #define GET_JSON_BOOL_VALUE(jsonObj, key) (HAS_JSON_FIELD(jsonObj, key) ? jsonObj.at(GET_STRING_T(key)).as_bool() : false)
 #define SET_JSON_BOOL_VALUE(jsonObj, key, value) if (HAS_JSON_FIELD(jsonObj, key)) value = GET_JSON_BOOL_VALUE(jsonObj, key);
@@ -68,6 +69,8 @@ namespace std
 #define DEFAULT_PROM_LISTEN_PORT 0
 #define DEFAULT_REST_LISTEN_PORT 6060
 #define DEFAULT_SCHEDULE_INTERVAL 2
+#define DEFAULT_STARTUP_CONCURRENCY 4
+#define MAX_STARTUP_CONCURRENCY 64
 
 #define JWT_USER_KEY "password"
 #define JWT_USER_NAME "user"
@@ -75,7 +78,37 @@ namespace std
 #define APPMGR_PASSWD_MIN_LENGTH 3
 #define DEFAULT_RUN_APP_RETENTION_DURATION 10
 #define DEFAULT_HEALTH_CHECK_INTERVAL 10
+#define DEFAULT_RESOURCE_SAMPLE_INTERVAL 5
+#define MAX_RESOURCE_SAMPLE_INTERVAL 300
+#define DEFAULT_PROCESS_TRACKER_SCAN_INTERVAL 10	// /proc scan interval when proc connector is not available
+#define MAX_RESOURCE_HISTORY_SIZE 720		// 1 hour history with default sample interval
+#define DEFAULT_TIMESERIES_RETENTION_SECONDS (60 * 60 * 24)
+#define MAX_TIMESERIES_MEMORY_BYTES (64 * 1024 * 1024)
+#define MAX_TIMESERIES_QUERY_POINTS 1000
+#define REEXEC_STATE_VERSION 1
+#define DEFAULT_OUTPUT_STORE_DIR "output"
+#define DEFAULT_OUTPUT_SEGMENT_BYTES (16 * 1024 * 1024)
+#define DEFAULT_OUTPUT_RETENTION_SECONDS (60 * 60 * 24 * 3)
+#define MAX_OUTPUT_STORE_APP_BYTES (1024ULL * 1024 * 1024)
+#define OUTPUT_STORE_FLUSH_BYTES (64 * 1024)	// in-memory tail of each application
+#define MAX_OUTPUT_READ_BYTES (4 * 1024 * 1024)
+#define DEFAULT_OUTPUT_SEARCH_MATCHES 100
+#define MAX_OUTPUT_SEARCH_MATCHES 1000
+#define MAX_OUTPUT_SEARCH_BYTES (1024ULL * 1024 * 1024)	// CPU budget of one search request
+#define MAX_OUTPUT_SEARCH_MILLISECONDS 500
 #define MAX_COMMAND_LINE_LENGH 2048
+#define CRON_MAX_SEARCH_YEARS 10		// covers leap day, expression matching nothing in it is refused
+#define CRON_MAX_SLEEP_SECONDS 60		// wake up to follow wall clock change
+#define MAX_DAILY_LIMITATION_WINDOWS 64
+#define DEFAULT_RESTART_BACKOFF_INITIAL_SECONDS 1
+#define DEFAULT_RESTART_BACKOFF_MAX_SECONDS 300
+#define DEFAULT_RESTART_BACKOFF_MULTIPLIER 2.0
+#define DEFAULT_RESTART_JITTER_PERCENT 20
+#define DEFAULT_RESTART_MAX_RESTARTS 5		// restarts in window to open circuit breaker, 0 means never
+#define DEFAULT_RESTART_WINDOW_SECONDS 60
+#define DEFAULT_RESTART_BREAKER_SECONDS 600
+#define DEFAULT_RESTART_STABLE_SECONDS 60		// a process running longer resets backoff
+#define RESTART_HISTORY_SIZE 32		// restart times kept for each application, max_restarts can not exceed it
 
 #define DEFAULT_LABLE_HOST_NAME "HOST_NAME"
 
@@ -113,6 +146,8 @@ public:
 	static bool startWith(const std::string& str, std::string head);
 	static std::string stringReplace(const std::string& strBase, const std::string& strSrc, const std::string& strDst);
 	static std::string humanReadableSize(long double bytesSize);
+	// "90", "90s", "5m", "2h" to seconds, throw std::invalid_argument for bad format
+	static int parseDurationSeconds(const std::string& str);
 	static std::string prettyJson(const std::string& jsonStr);
 
 	static void initLogging();
@@ -142,6 +177,8 @@ public:
 	// Read file to string
 	static std::string readFile(const std::string& path);
 	static std::string readFileCpp(const std::string& path);
+	// SHA-256 hex digest of file content, empty when file can not be read
+	static std::string hashFile(const std::string& path);
 
 	static std::string createUUID();
 	static std::string runShellCommand(std::string cmd);
@@ -149,6 +186,7 @@ public:
 };
 #define ENV_APP_MANAGER_LISTEN_PORT "APPMGR_OVERRIDE_LISTEN_PORT"
 #define ENV_APP_MANAGER_LAUNCH_TIME "APP_MANAGER_LAUNCH_TIME"
+#define ENV_APP_MANAGER_REEXEC_FDS "APP_MANAGER_REEXEC_FDS"					// hot upgrade: runtime state handle and inherited pipe handles
 #define ENV_APP_MANAGER_DOCKER_PARAMS "APP_DOCKER_OPTS"							// used to pass docker extra parameters to docker startup cmd
 #define ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT "APP_DOCKER_IMG_PULL_TIMEOUT"	// app manager pull docker image timeout seconds
 #define DATE_TIME_FORMAT "%Y-%m-%d %H:%M:%S"
@@ -157,6 +195,20 @@ public:
 #define MAX_TOKEN_EXPIRE_SECONDS (60 * 60 * 24) // max 24 hour
 #define DEFAULT_RUN_APP_TIMEOUT_SECONDS 10		// run app default timeout
 #define MAX_APP_CACHED_LINES 1024
+#define JOB_SLAB_RECORDS 256			// job records allocated together for /app/run
+#define JOB_WHEEL_SECONDS 4096		// slots of job retention wheel, power of 2
+#define MAX_RUN_JOBS 65536
+#define JOB_NAME_PREFIX "job-"
+#define DEFAULT_JOB_MAX_RUNNING 64
+#define DEFAULT_JOB_MAX_QUEUED 4096
+#define DEFAULT_JOB_QUEUE_TIMEOUT_SECONDS (60 * 60)
+#define JOB_POLL_MILLISECONDS 100		// job exit is found and next queued job started in this period
+#define JOB_WAIT_SAMPLES 1024			// latest queue wait times kept for percentile
+#define MAX_OUTPUT_LINE_LENGTH (64 * 1024)	// a longer line is split to avoid unlimited memory usage
+#define DEFAULT_DOCKER_SOCKET_FILE "/var/run/docker.sock"
+#define DEFAULT_UPLOAD_CHUNK_SIZE (4 * 1024 * 1024)
+#define MAX_UPLOAD_CHUNK_SIZE (64 * 1024 * 1024)
+#define DEFAULT_UPLOAD_SESSION_IDLE_SECONDS (60 * 60)	// unfinished upload session will be removed after 1 hour idle
 
 #define JSON_KEY_Description "Description"
 #define JSON_KEY_RestListenPort "RestListenPort"
@@ -175,6 +227,13 @@ public:
 #define JSON_KEY_Applications "Applications"
 #define JSON_KEY_Labels "Labels"
 #define JSON_KEY_JWTRedirectUrl "JWTRedirectUrl"
+#define JSON_KEY_DockerSocketFile "DockerSocketFile"
+#define JSON_KEY_ResourceSampleIntervalSeconds "ResourceSampleIntervalSeconds"
+#define JSON_KEY_ProcessTrackerEnabled "ProcessTrackerEnabled"
+#define JSON_KEY_OutputStoreEnabled "OutputStoreEnabled"
+#define JSON_KEY_RateLimit "RateLimit"
+#define JSON_KEY_JobQueue "JobQueue"
+#define JSON_KEY_StartupConcurrency "StartupConcurrency"
 
 #define JSON_KEY_APP_name "name"
 #define JSON_KEY_APP_user "user"
@@ -189,13 +248,80 @@ public:
 #define JSON_KEY_APP_posix_timezone "posix_timezone"
 #define JSON_KEY_APP_cache_lines "cache_lines"
 #define JSON_KEY_APP_docker_image "docker_image"
+#define JSON_KEY_APP_depends_on "depends_on"
+#define JSON_KEY_DEPENDS_name "name"
+#define JSON_KEY_DEPENDS_condition "condition"
+#define DEPENDS_CONDITION_started "started"
+#define DEPENDS_CONDITION_healthy "healthy"
+#define JSON_KEY_APP_restart_policy "restart_policy"
+#define JSON_KEY_RESTART_backoff_initial_seconds "backoff_initial_seconds"
+#define JSON_KEY_RESTART_backoff_max_seconds "backoff_max_seconds"
+#define JSON_KEY_RESTART_backoff_multiplier "backoff_multiplier"
+#define JSON_KEY_RESTART_jitter_percent "jitter_percent"
+#define JSON_KEY_RESTART_max_restarts "max_restarts"
+#define JSON_KEY_RESTART_window_seconds "window_seconds"
+#define JSON_KEY_RESTART_breaker_seconds "breaker_seconds"
+#define JSON_KEY_RESTART_stable_seconds "stable_seconds"
+#define RESTART_STATE_normal "normal"
+#define RESTART_STATE_backoff "backoff"
+#define RESTART_STATE_circuit_open "circuit_open"
 // runtime attr
 #define JSON_KEY_APP_pid "pid"
+#define JSON_KEY_APP_pid_start_time "pid_start_time"
 #define JSON_KEY_APP_return "return"
 #define JSON_KEY_APP_memory "memory"
+#define JSON_KEY_APP_cpu_percent "cpu_percent"
+#define JSON_KEY_APP_cpu_seconds "cpu_seconds"
+// application metrics in time series store
+#define TIMESERIES_METRIC_memory "memory"
+#define TIMESERIES_METRIC_cpu "cpu_percent"
+#define TIMESERIES_METRIC_threads "threads"
+#define TIMESERIES_METRIC_fds "fds"
+#define TIMESERIES_METRIC_restarts "restarts"
+#define JSON_KEY_TIMESERIES_time "time"
+#define JSON_KEY_TIMESERIES_min "min"
+#define JSON_KEY_TIMESERIES_max "max"
+#define JSON_KEY_TIMESERIES_avg "avg"
+#define JSON_KEY_TIMESERIES_from "from"
+#define JSON_KEY_TIMESERIES_to "to"
+#define JSON_KEY_TIMESERIES_step "step"
+#define JSON_KEY_TIMESERIES_metrics "metrics"
+#define JSON_KEY_TIMESERIES_series "series"
+#define JSON_KEY_TIMESERIES_chunks "chunks"
+#define JSON_KEY_TIMESERIES_points "points"
+#define JSON_KEY_TIMESERIES_memory_bytes "memory_bytes"
+#define JSON_KEY_TIMESERIES_memory_limit_bytes "memory_limit_bytes"
+#define JSON_KEY_TIMESERIES_retention_seconds "retention_seconds"
+#define JSON_KEY_SEARCH_matches "matches"
+#define JSON_KEY_SEARCH_offset "offset"
+#define JSON_KEY_SEARCH_time "time"
+#define JSON_KEY_SEARCH_line "line"
+#define JSON_KEY_SEARCH_next_offset "next_offset"
+#define JSON_KEY_SEARCH_complete "complete"
+#define JSON_KEY_SEARCH_scanned_bytes "scanned_bytes"
+#define JSON_KEY_SEARCH_history "history"
 #define JSON_KEY_APP_last_start "last_start_time"
 #define JSON_KEY_APP_container_id "container_id"
 #define JSON_KEY_APP_health "health"
+#define JSON_KEY_APP_restart_state "restart_state"
+#define JSON_KEY_APP_next_restart_time "next_restart_time"
+#define JSON_KEY_APP_restarts_in_window "restarts_in_window"
+
+#define JSON_KEY_REEXEC_version "version"
+#define JSON_KEY_REEXEC_applications "applications"
+#define JSON_KEY_REEXEC_restart_count "restart_count"
+#define JSON_KEY_REEXEC_pipe_fd "pipe_fd"
+#define JSON_KEY_REEXEC_output "output"
+#define JSON_KEY_REEXEC_kill_time "kill_time"
+#define JSON_KEY_REEXEC_buffer_process "buffer_process"
+#define JSON_KEY_REEXEC_restart_policy "restart_policy"
+#define JSON_KEY_REEXEC_history "history"
+#define JSON_KEY_REEXEC_failures "failures"
+#define JSON_KEY_REEXEC_state "state"
+#define JSON_KEY_REEXEC_spawned "spawned"
+#define JSON_KEY_REEXEC_trial "trial"
+#define JSON_KEY_REEXEC_spawn_time "spawn_time"
+#define JSON_KEY_REEXEC_next_start "next_start"
 
 #define JSON_KEY_PERIOD_APP_keep_running "keep_running"
 
@@ -203,9 +329,12 @@ public:
 #define JSON_KEY_SHORT_APP_start_time "start_time"
 #define JSON_KEY_SHORT_APP_start_interval_timeout "start_interval_timeout"
 #define JSON_KEY_SHORT_APP_next_start_time "next_start_time"
+#define JSON_KEY_SHORT_APP_cron "cron"
 
 #define JSON_KEY_DAILY_LIMITATION_daily_start "daily_start"
 #define JSON_KEY_DAILY_LIMITATION_daily_end "daily_end"
+#define JSON_KEY_DAILY_LIMITATION_weekdays "weekdays"
+#define JSON_KEY_DAILY_LIMITATION_windows "windows"
 
 #define JSON_KEY_RESOURCE_LIMITATION_memory_mb "memory_mb"
 #define JSON_KEY_RESOURCE_LIMITATION_memory_virt_mb "memory_virt_mb"
@@ -230,9 +359,17 @@ public:
 #define HTTP_HEADER_JWT_auth_permission "auth_permission"
 #define HTTP_HEADER_JWT_redirect_from "redirect_from"
 #define HTTP_HEADER_KEY_exit_code "exit_code"
+#define HTTP_HEADER_KEY_generation "generation"
+#define HTTP_HEADER_KEY_Accept "Accept"
+#define HTTP_CONTENT_TYPE_json "application/json"
+#define HTTP_CONTENT_TYPE_cbor "application/cbor"
 #define HTTP_HEADER_KEY_file_path "file_path"
 #define HTTP_HEADER_KEY_file_mode "file_mode"
 #define HTTP_HEADER_KEY_file_user "file_user"
+#define HTTP_HEADER_KEY_file_size "file_size"
+#define HTTP_HEADER_KEY_file_chunk_size "file_chunk_size"
+#define HTTP_HEADER_KEY_file_sha256 "file_sha256"
+#define HTTP_HEADER_KEY_output_offset "output_offset"
 
 #define HTTP_QUERY_KEY_keep_history "keep_history"
 #define HTTP_QUERY_KEY_process_uuid "process_uuid"
@@ -242,6 +379,104 @@ public:
 #define HTTP_QUERY_KEY_loglevel "level"
 #define HTTP_QUERY_KEY_label_value "value"
 #define HTTP_QUERY_KEY_retention "retention" // for async run, the output hold timeout in sever side
+#define HTTP_QUERY_KEY_offset "offset"
+#define HTTP_QUERY_KEY_overwrite "overwrite"
+#define HTTP_QUERY_KEY_fields "fields"
+#define HTTP_QUERY_KEY_since "since"
+#define HTTP_QUERY_KEY_pretty "pretty"
+#define HTTP_QUERY_KEY_history "history"
+#define HTTP_QUERY_KEY_metric "metric"
+#define HTTP_QUERY_KEY_range "range"
+#define HTTP_QUERY_KEY_step "step"
+#define HTTP_QUERY_KEY_from "from"
+#define HTTP_QUERY_KEY_to "to"
+#define HTTP_QUERY_KEY_length "length"
+#define HTTP_QUERY_KEY_pattern "pattern"
+#define HTTP_QUERY_KEY_regex "regex"
+#define HTTP_QUERY_KEY_limit "limit"
+
+#define JSON_KEY_UPLOAD_session_id "session_id"
+#define JSON_KEY_UPLOAD_file_path "file_path"
+#define JSON_KEY_UPLOAD_file_size "file_size"
+#define JSON_KEY_UPLOAD_chunk_size "chunk_size"
+#define JSON_KEY_UPLOAD_chunk_count "chunk_count"
+#define JSON_KEY_UPLOAD_received_chunks "received_chunks"
+#define JSON_KEY_UPLOAD_missing_chunks "missing_chunks"
+
+#define JSON_KEY_BATCH_operation "operation"
+#define JSON_KEY_BATCH_name "name"
+#define JSON_KEY_BATCH_app "app"
+#define JSON_KEY_BATCH_result "result"
+#define JSON_KEY_BATCH_message "message"
+#define JSON_KEY_BATCH_applied "applied"
+#define JSON_KEY_BATCH_results "results"
+#define BATCH_OPERATION_register "register"
+#define BATCH_OPERATION_enable "enable"
+#define BATCH_OPERATION_disable "disable"
+#define BATCH_OPERATION_delete "delete"
+#define BATCH_RESULT_success "success"
+#define BATCH_RESULT_failed "failed"
+#define BATCH_RESULT_skipped "skipped"
+#define MAX_BATCH_OPERATIONS 2048
+
+#define JSON_KEY_DELTA_generation "generation"
+#define JSON_KEY_DELTA_full "full"
+#define JSON_KEY_DELTA_apps "apps"
+#define JSON_KEY_DELTA_removed "removed"
+#define MAX_REMOVED_APP_HISTORY 1024
+
+#define JSON_KEY_EVENT_seq "seq"
+#define JSON_KEY_EVENT_type "type"
+#define JSON_KEY_EVENT_app "app"
+#define JSON_KEY_EVENT_time "time"
+#define JSON_KEY_EVENT_pid "pid"
+#define JSON_KEY_EVENT_exit_code "exit_code"
+#define JSON_KEY_EVENT_health "health"
+#define JSON_KEY_EVENT_status "status"
+#define EVENT_TYPE_started "started"
+#define EVENT_TYPE_restarted "restarted"
+#define EVENT_TYPE_exited "exited"
+#define EVENT_TYPE_health "health_changed"
+#define EVENT_TYPE_registered "registered"
+#define EVENT_TYPE_removed "removed"
+#define EVENT_TYPE_config "config_changed"
+#define EVENT_TYPE_lost "lost"
+#define DEFAULT_EVENT_RING_SIZE 4096
+#define MAX_EVENT_STREAM_CLIENTS 64
+#define DEFAULT_EVENT_STREAM_SECONDS 300
+#define MAX_EVENT_STREAM_SECONDS 3600
+#define EVENT_STREAM_HEARTBEAT_SECONDS 30
+
+#define JSON_KEY_RATE_user_rate "user_rate"
+#define JSON_KEY_RATE_user_burst "user_burst"
+#define JSON_KEY_RATE_client_rate "client_rate"
+#define JSON_KEY_RATE_client_burst "client_burst"
+#define RATE_LIMIT_CLASS_view "view"
+#define RATE_LIMIT_CLASS_run "run"
+#define RATE_LIMIT_CLASS_control "control"
+#define RATE_LIMIT_CLASS_file "file"
+#define RATE_LIMIT_BY_user "user"
+#define RATE_LIMIT_BY_client "client"
+#define RATE_LIMIT_SWEEP_SECONDS 60
+#define HTTP_HEADER_KEY_Retry_After "Retry-After"
+#define HTTP_STATUS_TooManyRequests 429
+#define JSON_KEY_JOB_max_running "max_running"
+#define JSON_KEY_JOB_user_max_running "user_max_running"
+#define JSON_KEY_JOB_label_max_running "label_max_running"
+#define JSON_KEY_JOB_max_queued "max_queued"
+#define JSON_KEY_JOB_queue_timeout_seconds "queue_timeout_seconds"
+#define JSON_KEY_JOB_priority "priority"
+#define JSON_KEY_JOB_label "label"
+#define JSON_KEY_JOB_queue_position "queue_position"
+#define JSON_KEY_JOB_running "running"
+#define JSON_KEY_JOB_queued "queued"
+#define JSON_KEY_JOB_state "state"
+#define JSON_KEY_JOB_wait_seconds "wait_seconds"
+#define JSON_KEY_JOB_jobs "jobs"
+#define JOB_PRIORITY_high "high"
+#define JOB_PRIORITY_normal "normal"
+#define JOB_PRIORITY_low "low"
+#define HTTP_HEADER_KEY_queue_position "queue_position"
 
 #define PERMISSION_KEY_view_app					"view-app"
 #define PERMISSION_KEY_view_app_output			"view-app-output"
@@ -23,6 +23,7 @@
 
 #include <sys/stat.h>
 #include <pwd.h>
+#include <algorithm>
 #include <list>
 #include <set>
 #include <string>
@@ -376,6 +377,13 @@ namespace os {
 		return result;
 	}
 
+	// Number of clock ticks per second, used for cpu accounting.
+	inline long clockTicks()
+	{
+		static const long ticks = sysconf(_SC_CLK_TCK);
+		return ticks;
+	}
+
 	inline std::shared_ptr<Process> process(pid_t pid)
 	{
 		const static char fname[] = "os::process() ";
@@ -383,8 +391,7 @@ namespace os {
 		// Page size, used for memory accounting.
 		static const size_t pageSize = os::pagesize();
 
-		// Number of clock ticks per second, used for cpu accounting.
-		static const long ticks = sysconf(_SC_CLK_TCK);
+		const long ticks = os::clockTicks();
 		if (ticks <= 0) {
 			LOG_ERR << fname << "Failed to get sysconf(_SC_CLK_TCK)";
 			return nullptr;
@@ -412,10 +419,29 @@ namespace os {
 			processStatus->rss * pageSize,
 			utime,
 			stime,
+			(uint64_t)processStatus->utime + processStatus->stime + std::max(0L, processStatus->cutime) + std::max(0L, processStatus->cstime),
+			processStatus->num_threads,
 			commandLine.length() ? commandLine : processStatus->comm,
 			processStatus->state == 'Z');
 	}
 
+	// Returns the number of open file descriptors of a process, -1 when not accessible.
+	inline int fdCount(pid_t pid)
+	{
+		const std::string path = "/proc/" + std::to_string(pid) + "/fd";
+		DIR* dir = opendir(path.c_str());
+		if (dir == nullptr) {
+			return -1;
+		}
+		int count = 0;
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != nullptr) {
+			if (entry->d_name[0] != '.') count++;
+		}
+		closedir(dir);
+		return count;
+	}
+
 	// Returns the total size of main and free memory.
 	inline std::shared_ptr<Memory> memory()
 	{
@@ -24,6 +24,8 @@ namespace os {
 			const uint64_t& _rss_bytes,
 			const std::chrono::seconds& _utime,
 			const std::chrono::seconds& _stime,
+			const uint64_t& _cpu_ticks,
+			long _threads,
 			const std::string& _command,
 			bool _zombie)
 			: pid(_pid),
@@ -33,6 +35,8 @@ namespace os {
 			rss_bytes(_rss_bytes),
 			utime(_utime),
 			stime(_stime),
+			cpu_ticks(_cpu_ticks),
+			threads(_threads),
 			command(_command),
 			zombie(_zombie) {}
 
@@ -44,6 +48,9 @@ namespace os {
 		const uint64_t rss_bytes;
 		const std::chrono::seconds utime;
 		const std::chrono::seconds stime;
+		// user + system clock ticks of this process and its waited-for children
+		const uint64_t cpu_ticks;
+		const long threads;
 		const std::string command;
 		const bool zombie;
 
@@ -83,7 +90,16 @@ namespace os {
 		// Count the total RES memory usage in the process tree
 		const uint64_t totalRSS() const
 		{
-			uint64_t result = std::accumulate(children.begin(), children.end(), process.rss_bytes);
+			uint64_t result = process.rss_bytes;
+			for (const auto& tree : children) result += tree.totalRSS();
+			return result;
+		}
+
+		// Count the total cpu clock ticks in the process tree
+		const uint64_t totalCpuTicks() const
+		{
+			uint64_t result = process.cpu_ticks;
+			for (const auto& tree : children) result += tree.totalCpuTicks();
 			return result;
 		}
 
@@ -83,14 +83,15 @@ void AppProcess::setCgroup(std::shared_ptr<ResourceLimitation>& limit)
 	}
 }
 
-const std::string AppProcess::getuuid() const
+void AppProcess::regKillTimer(size_t timeout, const std::string from)
 {
-	return m_uuid;
+	m_killTimerId = this->registerTimer(timeout, 0, std::bind(&AppProcess::killgroup, this, std::placeholders::_1), from);
+	m_killTime = std::chrono::system_clock::now() + std::chrono::seconds(timeout);
 }
 
-void AppProcess::regKillTimer(size_t timeout, const std::string from)
+std::chrono::system_clock::time_point AppProcess::getKillTime() const
 {
-	m_killTimerId = this->registerTimer(timeout, 0, std::bind(&AppProcess::killgroup, this, std::placeholders::_1), from);
+	return m_killTimerId > 0 ? m_killTime : std::chrono::system_clock::time_point();
 }
 
 
@@ -133,7 +134,7 @@ int AppProcess::spawnProcess(std::string cmd, std::string user, std::string work
 		LOG_DBG << "spawnProcess env: " << pair.first.c_str() << "=" << pair.second.c_str();
 	});
 	// do not inherit LD_LIBRARY_PATH to child
-	static const std::string ldEnv = ::getenv("LD_LIBRARY_PATH");
+	static const std::string ldEnv = ::getenv("LD_LIBRARY_PATH") ? ::getenv("LD_LIBRARY_PATH") : "";
 	if (!ldEnv.empty())
 	{
 		std::string env = ldEnv;
@@ -155,34 +156,6 @@ int AppProcess::spawnProcess(std::string cmd, std::string user, std::string work
 	return pid;
 }
 
-void AppProcess::getSysProcessList(std::map<std::string, int>& processList, const void * pt)
-{
-	const static char fname[] = "AppProcess::getSysProcessList() ";
-
-	std::shared_ptr<os::ProcessTree> ptree;
-	const os::ProcessTree* tree;
-	if (pt == nullptr)
-	{
-		// 1 is linux root process
-		ptree = os::pstree(1);
-		tree = ptree.get();
-	}
-	else
-	{
-		tree = (os::ProcessTree*)pt;
-	}
-
-	auto pname = Utility::stdStringTrim(tree->process.command);
-	processList[pname] = tree->process.pid;
-
-	LOG_DBG << fname << "Process: <" << pname << "> pid: " << tree->process.pid;
-
-	for (auto it = tree->children.begin(); it != tree->children.end(); ++it)
-	{
-		getSysProcessList(processList, &(*it));
-	}
-}
-
 std::string AppProcess::getOutputMsg()
 {
 	return std::string();
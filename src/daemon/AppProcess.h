@@ -2,6 +2,8 @@
 #define APP_PROCESS_H
 #include <map>
 #include <string>
+#include <chrono>
+#include <memory>
 #include <algorithm>
 
 #include <ace/Process.h>
@@ -10,6 +12,9 @@
 #include "ResourceLimitation.h"
 #include "TimerHandler.h"
 
+class OutputLog;
+class OutputSearch;
+
 //////////////////////////////////////////////////////////////////////////
 // Process Object
 //////////////////////////////////////////////////////////////////////////
@@ -24,23 +29,30 @@ public:
 	virtual pid_t getpid(void) const;
 	virtual void killgroup(int timerId = 0);
 	virtual void setCgroup(std::shared_ptr<ResourceLimitation>& limit);
-	const std::string getuuid() const;
+	const std::string& getuuid() const { return m_uuid; }
 	void regKillTimer(size_t timeoutSec, const std::string from);
+	// deadline of kill timer, epoch when no kill timer
+	std::chrono::system_clock::time_point getKillTime() const;
 	virtual std::string containerId() { return std::string(); };
 	virtual void containerId(std::string containerId) {};
 
 	virtual int spawnProcess(std::string cmd, std::string user, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit);
-	static void getSysProcessList(std::map<std::string, int>& processList, const void* pt = nullptr);
 
 	virtual std::string getOutputMsg();
 	virtual std::string fetchOutputMsg();
+	// search cached output lines
+	virtual void searchOutput(OutputSearch& search, uint64_t offset, int64_t since) {}
 	virtual bool complete() { return true; }
+	// keep all output on disk besides the cached lines
+	void setOutputLog(const std::shared_ptr<OutputLog>& log) { m_outputLog = log; }
 protected:
 	const int m_cacheOutputLines;
+	std::shared_ptr<OutputLog> m_outputLog;
 private:
 	std::unique_ptr<LinuxCgroup> m_cgroup;
 	std::string m_uuid;
 	int m_killTimerId;
+	std::chrono::system_clock::time_point m_killTime;
 };
 
 #endif 
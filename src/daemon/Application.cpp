@@ -3,12 +3,19 @@
 #include "Application.h"
 #include "ResourceCollection.h"
 #include "../common/Utility.h"
-#include "../common/TimeZoneHelper.h"
+#include "../common/JsonWriter.h"
+#include "../common/os/pstree.hpp"
 #include "Configuration.h"
 #include "DockerProcess.h"
+#include "EventStream.h"
+#include "ProcessSnapshot.h"
+#include "MonitoredProcess.h"
+#include "TimeSeries.h"
+#include "OutputStore.h"
 
 Application::Application()
-	:m_status(ENABLED), m_health(true), m_cacheOutputLines(0), m_pid(ACE_INVALID_PID)
+	:m_status(ENABLED), m_health(true), m_healthChecked(false), m_cacheOutputLines(0), m_pid(ACE_INVALID_PID), m_pidStartTime(0), m_generation(0),
+	m_cpuPid(ACE_INVALID_PID), m_cpuTicks(0), m_cpuPercent(0), m_restartCount(0), m_restartPolicy(std::make_shared<RestartPolicy>())
 {
 	const static char fname[] = "Application::Application() ";
 	LOG_DBG << fname << "Entered.";
@@ -57,14 +64,14 @@ void Application::FromJson(std::shared_ptr<Application>& app, const web::json::v
 	{
 		app->m_status = static_cast<STATUS>GET_JSON_INT_VALUE(jobj, JSON_KEY_APP_status);
 	}
-	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_daily_limitation))
-	{
-		app->m_dailyLimit = DailyLimitation::FromJson(jobj.at(JSON_KEY_APP_daily_limitation));
-	}
 	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_resource_limit))
 	{
 		app->m_resourceLimit = ResourceLimitation::FromJson(jobj.at(JSON_KEY_APP_resource_limit), app->m_name);
 	}
+	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_restart_policy))
+	{
+		app->m_restartPolicy = RestartPolicy::FromJson(jobj.at(JSON_KEY_APP_restart_policy));
+	}
 	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_env))
 	{
 		auto envs = jobj.at(JSON_KEY_APP_env).as_object();
@@ -74,14 +81,31 @@ void Application::FromJson(std::shared_ptr<Application>& app, const web::json::v
 		}
 	}
 	app->m_posixTimeZone = GET_JSON_STR_VALUE(jobj, JSON_KEY_APP_posix_timezone);
-	if (app->m_posixTimeZone.length() && app->m_dailyLimit != nullptr)
+	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_daily_limitation))
 	{
-		app->m_dailyLimit->m_startTime = TimeZoneHelper::convert2tzTime(app->m_dailyLimit->m_startTime, app->m_posixTimeZone);
-		app->m_dailyLimit->m_endTime = TimeZoneHelper::convert2tzTime(app->m_dailyLimit->m_endTime, app->m_posixTimeZone);
+		// windows are wall clock in posix_timezone
+		app->m_dailyLimit = DailyLimitation::FromJson(jobj.at(JSON_KEY_APP_daily_limitation), app->m_posixTimeZone);
 	}
 	app->m_cacheOutputLines = std::min(GET_JSON_INT_VALUE(jobj, JSON_KEY_APP_cache_lines), MAX_APP_CACHED_LINES);
 	app->m_dockerImage = GET_JSON_STR_VALUE(jobj, JSON_KEY_APP_docker_image);
-	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_pid)) app->attach(GET_JSON_INT_VALUE(jobj, JSON_KEY_APP_pid));
+	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_depends_on))
+	{
+		for (const auto& dependency : jobj.at(JSON_KEY_APP_depends_on).as_array())
+		{
+			// "name" is short for {"name": "name", "condition": "started"}
+			std::string name = dependency.is_string() ? GET_STD_STRING(dependency.as_string()) : GET_JSON_STR_VALUE(dependency, JSON_KEY_DEPENDS_name);
+			std::string condition = dependency.is_string() ? "" : GET_JSON_STR_VALUE(dependency, JSON_KEY_DEPENDS_condition);
+			name = Utility::stdStringTrim(name);
+			if (condition.empty()) condition = DEPENDS_CONDITION_started;
+			if (name.empty()) throw std::invalid_argument("depends_on should have application name");
+			if (condition != DEPENDS_CONDITION_started && condition != DEPENDS_CONDITION_healthy)
+			{
+				throw std::invalid_argument(std::string("depends_on condition should be ") + DEPENDS_CONDITION_started + " or " + DEPENDS_CONDITION_healthy);
+			}
+			app->m_dependsOn[name] = condition;
+		}
+	}
+	if (HAS_JSON_FIELD(jobj, JSON_KEY_APP_pid)) app->attach(GET_JSON_INT_VALUE(jobj, JSON_KEY_APP_pid), GET_JSON_NUMBER_VALUE(jobj, JSON_KEY_APP_pid_start_time));
 
 	app->dump();
 }
@@ -101,49 +125,64 @@ void Application::refreshPid()
 			if (ret > 0)
 			{
 				m_return = std::make_unique<int>(m_process->return_value());
+				web::json::value event = web::json::value::object();
+				event[JSON_KEY_EVENT_pid] = web::json::value::number(m_pid);
+				event[JSON_KEY_EVENT_exit_code] = web::json::value::number(*m_return);
+				EventStream::instance()->publish(EVENT_TYPE_exited, m_name, event);
 				m_pid = ACE_INVALID_PID;
 			}
 			checkAndUpdateHealth();
 		}
 		else if (m_pid > 0)
 		{
+			// exit code is not available for attached process
+			web::json::value event = web::json::value::object();
+			event[JSON_KEY_EVENT_pid] = web::json::value::number(m_pid);
+			EventStream::instance()->publish(EVENT_TYPE_exited, m_name, event);
 			m_pid = ACE_INVALID_PID;
 		}		
 	}
 }
 
-bool Application::attach(std::map<std::string, int>& process)
+bool Application::attach(ProcessSnapshot& snapshot)
 {
 	const static char fname[] = "Application::attach() ";
 
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	auto iter = process.find(m_commandLine);
-	if (iter != process.end())
+	if (m_pid > 0)
 	{
-		m_process->attach(iter->second);
+		// attached by pid from configuration, keep it from other applications with same command line
+		return snapshot.claim(m_pid, m_commandLine, m_pidStartTime);
+	}
+	uint64_t startTime = 0;
+	auto pid = snapshot.claim(m_commandLine, startTime);
+	if (pid > 0)
+	{
+		m_process->attach(pid);
 		m_pid = m_process->getpid();
+		m_pidStartTime = startTime;
+		m_restartPolicy->onAttach(std::chrono::steady_clock::now());
+		auto docker = std::dynamic_pointer_cast<DockerProcess>(m_process);
+		if (docker != nullptr) docker->attachContainer();
 		LOG_INF << fname << "Process <" << m_commandLine << "> is running with pid <" << m_pid << ">.";
-		process.erase(iter);
 		return true;
 	}
 	return false;
 }
 
-bool Application::attach(int pid)
+bool Application::attach(int pid, uint64_t startTime)
 {
 	const static char fname[] = "Application::attach() ";
 
-	std::map<std::string, int> process;
-	AppProcess::getSysProcessList(process, nullptr);
-	auto cmd = m_commandLine;
-	auto iter = std::find_if(process.begin(), process.end(), 
-		[pid, &cmd](const std::pair<std::string, int> p) { return p.second == pid && p.first == cmd; }
-	);
-	if (iter != process.end())
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (pid > 0 && ProcessSnapshot::verify(pid, m_commandLine, startTime))
 	{
-		std::lock_guard<std::recursive_mutex> guard(m_mutex);
-		m_process->attach(iter->second);
+		m_process->attach(pid);
 		m_pid = m_process->getpid();
+		m_pidStartTime = startTime;
+		m_restartPolicy->onAttach(std::chrono::steady_clock::now());
+		auto docker = std::dynamic_pointer_cast<DockerProcess>(m_process);
+		if (docker != nullptr) docker->attachContainer();
 		LOG_INF << fname << "attached pid <" << pid << "> to application " << m_name;
 		return true;
 	}
@@ -154,6 +193,114 @@ bool Application::attach(int pid)
 	}
 }
 
+int Application::getPid()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_pid;
+}
+
+web::json::value Application::freezeRuntime(std::vector<int>& fds)
+{
+	// keep locked until exec, unfreezeRuntime() release it when exec failed
+	m_mutex.lock();
+	auto state = freezeProcess(m_process, fds);
+	state[JSON_KEY_APP_name] = web::json::value::string(m_name);
+	if (m_return != nullptr) state[JSON_KEY_APP_return] = web::json::value::number(*m_return);
+	state[JSON_KEY_APP_last_start] = web::json::value::number(std::chrono::duration_cast<std::chrono::seconds>(m_procStartTime.time_since_epoch()).count());
+	state[JSON_KEY_REEXEC_restart_count] = web::json::value::number(m_restartCount);
+	state[JSON_KEY_REEXEC_restart_policy] = m_restartPolicy->freezeState();
+	return state;
+}
+
+void Application::unfreezeRuntime()
+{
+	unfreezeProcess(m_process);
+	m_mutex.unlock();
+}
+
+void Application::restoreRuntime(const web::json::value& state)
+{
+	const static char fname[] = "Application::restoreRuntime() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_process = restoreProcess(state);
+	m_pid = m_process->getpid();
+	m_pidStartTime = m_pid > 0 ? GET_JSON_NUMBER_VALUE(state, JSON_KEY_APP_pid_start_time) : 0;
+	if (HAS_JSON_FIELD(state, JSON_KEY_APP_return)) m_return = std::make_unique<int>(GET_JSON_INT_VALUE(state, JSON_KEY_APP_return));
+	m_procStartTime = std::chrono::system_clock::time_point(std::chrono::seconds(GET_JSON_NUMBER_VALUE(state, JSON_KEY_APP_last_start)));
+	m_restartCount = GET_JSON_NUMBER_VALUE(state, JSON_KEY_REEXEC_restart_count);
+	// state from older daemon has no restart policy, exit of restored process is still handled
+	if (HAS_JSON_FIELD(state, JSON_KEY_REEXEC_restart_policy)) m_restartPolicy->restoreState(state.at(JSON_KEY_REEXEC_restart_policy));
+	else if (m_pid > 0) m_restartPolicy->onAttach(std::chrono::steady_clock::now());
+	LOG_INF << fname << "Application <" << m_name << "> restored with pid <" << m_pid << ">";
+}
+
+web::json::value Application::freezeProcess(std::shared_ptr<AppProcess>& process, std::vector<int>& fds)
+{
+	web::json::value state = web::json::value::object();
+	auto status = process->running() ? os::status(process->getpid()) : nullptr;
+	if (status != nullptr)
+	{
+		state[JSON_KEY_APP_pid] = web::json::value::number(status->pid);
+		state[JSON_KEY_APP_pid_start_time] = web::json::value::number(status->starttime);
+	}
+	// docker container is attached by container name
+	auto monitored = std::dynamic_pointer_cast<MonitoredProcess>(process);
+	if (monitored != nullptr && m_dockerImage.empty())
+	{
+		std::string output;
+		auto handle = monitored->freeze(output);
+		if (handle >= 0)
+		{
+			state[JSON_KEY_REEXEC_pipe_fd] = web::json::value::number(handle);
+			fds.push_back(handle);
+		}
+		state[JSON_KEY_REEXEC_output] = web::json::value::string(output);
+	}
+	return state;
+}
+
+void Application::unfreezeProcess(std::shared_ptr<AppProcess>& process)
+{
+	auto monitored = std::dynamic_pointer_cast<MonitoredProcess>(process);
+	if (monitored != nullptr && m_dockerImage.empty()) monitored->unfreeze();
+}
+
+std::shared_ptr<AppProcess> Application::restoreProcess(const web::json::value& state)
+{
+	const static char fname[] = "Application::restoreProcess() ";
+
+	auto process = allocProcess(m_cacheOutputLines, m_dockerImage, m_name);
+	auto pid = GET_JSON_INT_VALUE(state, JSON_KEY_APP_pid);
+	if (pid > 0)
+	{
+		// still child of this process, an exited one is a zombie with the same start time
+		auto status = os::status(pid);
+		if (status != nullptr && status->starttime == (uint64_t)GET_JSON_NUMBER_VALUE(state, JSON_KEY_APP_pid_start_time))
+		{
+			process->attach(pid);
+			auto docker = std::dynamic_pointer_cast<DockerProcess>(process);
+			if (docker != nullptr) docker->attachContainer();
+		}
+		else
+		{
+			LOG_WAR << fname << "process <" << pid << "> of application <" << m_name << "> does not exist";
+		}
+	}
+	auto handle = HAS_JSON_FIELD(state, JSON_KEY_REEXEC_pipe_fd) ? GET_JSON_INT_VALUE(state, JSON_KEY_REEXEC_pipe_fd) : -1;
+	auto monitored = std::dynamic_pointer_cast<MonitoredProcess>(process);
+	if (monitored != nullptr && m_dockerImage.empty())
+	{
+		monitored->restore(handle, GET_STD_STRING(GET_JSON_STR_T_VALUE(state, JSON_KEY_REEXEC_output)));
+	}
+	else if (handle >= 0)
+	{
+		// output is not cached by new binary, nobody read the pipe
+		::close(handle);
+	}
+	return process;
+}
+
 void Application::invoke()
 {
 	const static char fname[] = "Application::invoke() ";
@@ -162,12 +309,28 @@ void Application::invoke()
 		std::lock_guard<std::recursive_mutex> guard(m_mutex);
 		if (this->avialable())
 		{
-			if (!m_process->running())
+			if (!m_process->running() && !restartReady())
+			{
+				LOG_DBG << fname << "Application <" << m_name << "> restart is delayed, state <" << m_restartPolicy->getStateName() << ">";
+			}
+			else if (!m_process->running() && !dependenciesReady())
+			{
+				LOG_DBG << fname << "Application <" << m_name << "> is waiting for dependencies";
+			}
+			else if (!m_process->running())
 			{
 				LOG_INF << fname << "Starting application <" << m_name << ">.";
+				// exit code is kept means the previous process exited
+				bool restart = (m_return != nullptr);
+				if (restart) m_restartCount++;
 				m_process = allocProcess(m_cacheOutputLines, m_dockerImage, m_name);
 				m_procStartTime = std::chrono::system_clock::now();
+				m_healthChecked = false;
 				m_pid = m_process->spawnProcess(m_commandLine, m_user, m_workdir, m_envMap, m_resourceLimit);
+				m_restartPolicy->onSpawn(std::chrono::steady_clock::now());
+				web::json::value event = web::json::value::object();
+				event[JSON_KEY_EVENT_pid] = web::json::value::number(m_pid);
+				EventStream::instance()->publish(restart ? EVENT_TYPE_restarted : EVENT_TYPE_started, m_name, event);
 			}
 		}
 		else if (m_process->running())
@@ -179,6 +342,25 @@ void Application::invoke()
 	refreshPid();
 }
 
+bool Application::restartReady()
+{
+	const static char fname[] = "Application::restartReady() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	const auto now = std::chrono::steady_clock::now();
+	if (m_restartPolicy->spawned())
+	{
+		m_restartPolicy->onExit(now);
+		// logged once for each exit
+		if (!m_restartPolicy->ready(now))
+		{
+			LOG_WAR << fname << "Application <" << m_name << "> exited after " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - m_procStartTime).count()
+				<< " seconds, restart state <" << m_restartPolicy->getStateName() << ">, next start time: " << Utility::convertTime2Str(m_restartPolicy->getNextStartTime());
+		}
+	}
+	return m_restartPolicy->ready(now);
+}
+
 void Application::invokeNow(int timerId)
 {
 	Application::invoke();
@@ -206,6 +388,8 @@ void Application::enable()
 	if (m_status == DISABLED)
 	{
 		m_status = ENABLED;
+		// enable again closes circuit breaker
+		m_restartPolicy->reset();
 		invokeNow(0);
 		LOG_INF << fname << "Application <" << m_name << "> started.";
 	}
@@ -215,63 +399,6 @@ void Application::enable()
 	}
 }
 
-std::string Application::runAsyncrize(int timeoutSeconds)
-{
-	const static char fname[] = "Application::runSyncrize() ";
-	LOG_DBG << fname << " Entered.";
-
-	m_process = allocProcess(m_cacheOutputLines, m_dockerImage, m_name);
-	return runApp(timeoutSeconds);
-}
-
-std::string Application::runSyncrize(int timeoutSeconds, void* asyncHttpRequest)
-{
-	const static char fname[] = "Application::runAsyncrize() ";
-	LOG_DBG << fname << " Entered.";
-
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	if (m_cacheOutputLines <= 0)
-	{
-		LOG_ERR << fname << " m_cacheOutputLines is zero, force set to default value for MonitoredProcess";
-		m_cacheOutputLines = MAX_APP_CACHED_LINES;
-	}
-	m_process = allocProcess(m_cacheOutputLines, m_dockerImage, m_name);
-	auto monitProc = std::dynamic_pointer_cast<MonitoredProcess>(m_process);
-	assert(monitProc != nullptr);
-	monitProc->setAsyncHttpRequest(asyncHttpRequest);
-	
-	return runApp(timeoutSeconds);
-}
-
-std::string Application::runApp(int timeoutSeconds)
-{
-	const static char fname[] = "Application::runApp() ";
-	LOG_DBG << fname << " Entered.";
-
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	if (m_dockerImage.length())
-	{
-		throw std::invalid_argument("Docker application does not support this API");
-	}
-	assert(m_status != STATUS::ENABLED);
-
-	LOG_INF << fname << "Running application <" << m_name << ">.";
-
-	m_procStartTime = std::chrono::system_clock::now();
-	m_pid = m_process->spawnProcess(m_commandLine, m_user, m_workdir, m_envMap, m_resourceLimit);
-
-	if (m_pid > 0)
-	{
-		m_process->regKillTimer(timeoutSeconds, __FUNCTION__);
-	}
-	else
-	{
-		throw std::invalid_argument("Start process failed");
-	}
-
-	return m_process->getuuid();
-}
-
 std::string Application::getAsyncRunOutput(const std::string& processUuid, int& exitCode, bool& finished)
 {
 	const static char fname[] = "Application::getAsyncRunOutput() ";
@@ -295,6 +422,19 @@ std::string Application::getAsyncRunOutput(const std::string& processUuid, int&
 	}
 }
 
+void Application::setHealth(bool health)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_healthChecked = true;
+	if (m_health != health)
+	{
+		m_health = health;
+		web::json::value event = web::json::value::object();
+		event[JSON_KEY_EVENT_health] = web::json::value::number(getHealth());
+		EventStream::instance()->publish(EVENT_TYPE_health, m_name, event);
+	}
+}
+
 void Application::checkAndUpdateHealth()
 {
 	if (m_pid <= 0)
@@ -303,6 +443,42 @@ void Application::checkAndUpdateHealth()
 		setHealth(true);
 }
 
+void Application::resolveDependencies(const std::map<std::string, std::shared_ptr<Application>>& apps)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_dependencyApps.clear();
+	for (const auto& dependency : m_dependsOn)
+	{
+		auto it = apps.find(dependency.first);
+		if (it != apps.end()) m_dependencyApps[dependency.first] = it->second;
+	}
+}
+
+bool Application::satisfies(const std::string& condition)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_pid <= 0) return false;
+	if (condition == DEPENDS_CONDITION_healthy)
+	{
+		// health is true before the first check, wait for a real result
+		return m_health && (m_healthCheckCmd.empty() || m_healthChecked);
+	}
+	return true;
+}
+
+bool Application::dependenciesReady()
+{
+	// lock order is dependent before dependency, no cycle is allowed in depends_on
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (const auto& dependency : m_dependsOn)
+	{
+		auto it = m_dependencyApps.find(dependency.first);
+		auto app = (it != m_dependencyApps.end()) ? it->second.lock() : nullptr;
+		if (app == nullptr || !app->satisfies(dependency.second)) return false;
+	}
+	return true;
+}
+
 std::string Application::getOutput(bool keepHistory)
 {
 	if (m_process != nullptr)
@@ -319,52 +495,196 @@ std::string Application::getOutput(bool keepHistory)
 	return std::string();
 }
 
-web::json::value Application::AsJson(bool returnRuntimeInfo)
+void Application::searchOutput(OutputSearch& search, uint64_t offset, int64_t since)
 {
-	web::json::value result = web::json::value::object();
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_process != nullptr) m_process->searchOutput(search, offset, since);
+}
 
+void Application::sampleUsage(const std::list<os::Process>& processes, const std::chrono::system_clock::time_point& sampleTime)
+{
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	result[JSON_KEY_APP_name] = web::json::value::string(GET_STRING_T(m_name));
-	if (m_user.length()) result[JSON_KEY_APP_user] = web::json::value::string(GET_STRING_T(m_user));
-	if (m_commandLine.length()) result[GET_STRING_T(JSON_KEY_APP_command)] = web::json::value::string(GET_STRING_T(m_commandLine));
-	if (m_healthCheckCmd.length()) result[GET_STRING_T(JSON_KEY_APP_health_check_cmd)] = web::json::value::string(GET_STRING_T(m_healthCheckCmd));
-	if (m_workdir.length()) result[JSON_KEY_APP_working_dir] = web::json::value::string(GET_STRING_T(m_workdir));
-	result[JSON_KEY_APP_status] = web::json::value::number(m_status);
-	if (m_comments.length()) result[JSON_KEY_APP_comments] = web::json::value::string(GET_STRING_T(m_comments));
+	auto now = std::chrono::steady_clock::now();
+	uint64_t ticks = 0;
+	uint64_t memory = 0;
+	long threads = 0;
+	int fds = 0;
+	if (m_pid > 0)
+	{
+		auto tree = os::pstree(m_pid, processes);
+		if (tree != nullptr)
+		{
+			ticks = tree->totalCpuTicks();
+			memory = tree->totalRSS();
+			for (const auto& proc : tree->getProcesses())
+			{
+				threads += proc.threads;
+				fds += std::max(0, os::fdCount(proc.pid));
+			}
+		}
+	}
+	if (m_pid != m_cpuPid)
+	{
+		// new process, the first sample is the baseline
+		m_cpuPid = m_pid;
+		m_cpuPercent = 0;
+		auto status = m_pid > 0 ? os::status(m_pid) : nullptr;
+		m_pidStartTime = status != nullptr ? status->starttime : 0;
+	}
+	else
+	{
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_cpuSampleTime).count();
+		// ticks of a descendant reparented to init are lost, do not report negative usage
+		if (elapsed > 0 && os::clockTicks() > 0)
+		{
+			auto delta = ticks > m_cpuTicks ? ticks - m_cpuTicks : 0;
+			m_cpuPercent = 100.0 * delta / os::clockTicks() / (elapsed / 1000000.0);
+		}
+	}
+	m_cpuTicks = ticks;
+	m_cpuSampleTime = now;
+
+	// temp app for remote run is not recorded
+	if (!isUnAvialable())
+	{
+		auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(sampleTime.time_since_epoch()).count();
+		auto& store = TimeSeriesStore::instance();
+		store->append(m_name, TIMESERIES_METRIC_memory, timestamp, memory);
+		store->append(m_name, TIMESERIES_METRIC_cpu, timestamp, m_pid > 0 ? m_cpuPercent : 0);
+		store->append(m_name, TIMESERIES_METRIC_threads, timestamp, threads);
+		store->append(m_name, TIMESERIES_METRIC_fds, timestamp, fds);
+		store->append(m_name, TIMESERIES_METRIC_restarts, timestamp, m_restartCount);
+	}
+}
+
+double Application::getCpuPercent()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_pid > 0 ? m_cpuPercent : 0;
+}
+
+double Application::getCpuSeconds()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return (m_pid > 0 && os::clockTicks() > 0) ? (double)m_cpuTicks / os::clockTicks() : 0;
+}
+
+int Application::getRestartState()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return static_cast<int>(m_restartPolicy->getState());
+}
+
+web::json::value Application::AsJson(bool returnRuntimeInfo, const std::set<std::string>& fields)
+{
+	return JsonTreeWriter::toJson([&](JsonWriter& writer) { writeJson(writer, returnRuntimeInfo, fields); });
+}
+
+void Application::writeJson(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	writer.startObject();
+	writeJsonFields(writer, returnRuntimeInfo, fields);
+	writer.endObject();
+}
+
+void Application::writeJsonFields(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields)
+{
+	// name is always returned to identify app
+	writer.key(JSON_KEY_APP_name).value(m_name);
+	if (m_user.length() && isFieldRequested(fields, JSON_KEY_APP_user)) writer.key(JSON_KEY_APP_user).value(m_user);
+	if (m_commandLine.length() && isFieldRequested(fields, JSON_KEY_APP_command)) writer.key(JSON_KEY_APP_command).value(m_commandLine);
+	if (m_healthCheckCmd.length() && isFieldRequested(fields, JSON_KEY_APP_health_check_cmd)) writer.key(JSON_KEY_APP_health_check_cmd).value(m_healthCheckCmd);
+	if (m_workdir.length() && isFieldRequested(fields, JSON_KEY_APP_working_dir)) writer.key(JSON_KEY_APP_working_dir).value(m_workdir);
+	if (isFieldRequested(fields, JSON_KEY_APP_status)) writer.key(JSON_KEY_APP_status).value((int)m_status);
+	if (m_comments.length() && isFieldRequested(fields, JSON_KEY_APP_comments)) writer.key(JSON_KEY_APP_comments).value(m_comments);
 	if (returnRuntimeInfo)
 	{
-		if (m_pid > 0) result[JSON_KEY_APP_pid] = web::json::value::number(m_pid);
-		if (m_return != nullptr) result[JSON_KEY_APP_return] = web::json::value::number(*m_return);
-		if (m_pid > 0) result[JSON_KEY_APP_memory] = web::json::value::number(ResourceCollection::instance()->getRssMemory(m_pid));
-		if (std::chrono::time_point_cast<std::chrono::hours>(m_procStartTime).time_since_epoch().count() > 24) // avoid print 1970-01-01 08:00:00
-			result[JSON_KEY_APP_last_start] = web::json::value::number(std::chrono::duration_cast<std::chrono::seconds>(m_procStartTime.time_since_epoch()).count());
-		if (!m_process->containerId().empty())
+		if (m_pid > 0 && isFieldRequested(fields, JSON_KEY_APP_pid)) writer.key(JSON_KEY_APP_pid).value(m_pid);
+		if (m_pid > 0 && m_pidStartTime > 0 && isFieldRequested(fields, JSON_KEY_APP_pid_start_time)) writer.key(JSON_KEY_APP_pid_start_time).value(m_pidStartTime);
+		if (m_return != nullptr && isFieldRequested(fields, JSON_KEY_APP_return)) writer.key(JSON_KEY_APP_return).value(*m_return);
+		// memory need read /proc, only calculate when requested
+		if (m_pid > 0 && isFieldRequested(fields, JSON_KEY_APP_memory)) writer.key(JSON_KEY_APP_memory).value(ResourceCollection::instance()->getRssMemory(m_pid));
+		// cpu is sampled by resource sampler thread, 100 means one core busy
+		if (m_pid > 0 && m_pid == m_cpuPid)
+		{
+			if (isFieldRequested(fields, JSON_KEY_APP_cpu_percent)) writer.key(JSON_KEY_APP_cpu_percent).value(getCpuPercent());
+			if (isFieldRequested(fields, JSON_KEY_APP_cpu_seconds)) writer.key(JSON_KEY_APP_cpu_seconds).value(getCpuSeconds());
+		}
+		if (std::chrono::time_point_cast<std::chrono::hours>(m_procStartTime).time_since_epoch().count() > 24 && isFieldRequested(fields, JSON_KEY_APP_last_start)) // avoid print 1970-01-01 08:00:00
+			writer.key(JSON_KEY_APP_last_start).value((int64_t)std::chrono::duration_cast<std::chrono::seconds>(m_procStartTime.time_since_epoch()).count());
+		if (!m_process->containerId().empty() && isFieldRequested(fields, JSON_KEY_APP_container_id))
 		{
-			result[JSON_KEY_APP_container_id] = web::json::value::string(GET_STRING_T(m_process->containerId()));
+			writer.key(JSON_KEY_APP_container_id).value(m_process->containerId());
+		}
+		if (isFieldRequested(fields, JSON_KEY_APP_health)) writer.key(JSON_KEY_APP_health).value(this->getHealth());
+		if (isFieldRequested(fields, JSON_KEY_APP_restart_state)) writer.key(JSON_KEY_APP_restart_state).value(m_restartPolicy->getStateName());
+		if (isFieldRequested(fields, JSON_KEY_APP_restarts_in_window)) writer.key(JSON_KEY_APP_restarts_in_window).value((uint64_t)m_restartPolicy->restartsInWindow(std::chrono::steady_clock::now()));
+		if (m_restartPolicy->getState() != RestartPolicy::State::NORMAL && isFieldRequested(fields, JSON_KEY_APP_next_restart_time))
+		{
+			writer.key(JSON_KEY_APP_next_restart_time).value(Utility::convertTime2Str(m_restartPolicy->getNextStartTime()));
 		}
-		result[JSON_KEY_APP_health] = web::json::value::number(this->getHealth());
 	}
-	if (m_dailyLimit != nullptr)
+	if (m_dailyLimit != nullptr && isFieldRequested(fields, JSON_KEY_APP_daily_limitation))
 	{
-		result[JSON_KEY_APP_daily_limitation] = m_dailyLimit->AsJson();
+		writer.key(JSON_KEY_APP_daily_limitation).value(m_dailyLimit->AsJson());
 	}
-	if (m_resourceLimit != nullptr)
+	if (m_resourceLimit != nullptr && isFieldRequested(fields, JSON_KEY_APP_resource_limit))
 	{
-		result[JSON_KEY_APP_resource_limit] = m_resourceLimit->AsJson();
+		writer.key(JSON_KEY_APP_resource_limit).value(m_resourceLimit->AsJson());
 	}
-	if (m_envMap.size())
+	if (isFieldRequested(fields, JSON_KEY_APP_restart_policy))
 	{
-		web::json::value envs = web::json::value::object();
-		std::for_each(m_envMap.begin(), m_envMap.end(), [&envs](const std::pair<std::string, std::string>& pair)
+		auto restartPolicy = m_restartPolicy->AsJson();
+		if (!restartPolicy.is_null()) writer.key(JSON_KEY_APP_restart_policy).value(restartPolicy);
+	}
+	if (m_envMap.size() && isFieldRequested(fields, JSON_KEY_APP_env))
+	{
+		writer.key(JSON_KEY_APP_env).startObject();
+		for (const auto& env : m_envMap) writer.key(env.first).value(env.second);
+		writer.endObject();
+	}
+	if (m_posixTimeZone.length() && isFieldRequested(fields, JSON_KEY_APP_posix_timezone)) writer.key(JSON_KEY_APP_posix_timezone).value(m_posixTimeZone);
+	if (m_cacheOutputLines && isFieldRequested(fields, JSON_KEY_APP_cache_lines)) writer.key(JSON_KEY_APP_cache_lines).value(m_cacheOutputLines);
+	if (m_dockerImage.length() && isFieldRequested(fields, JSON_KEY_APP_docker_image)) writer.key(JSON_KEY_APP_docker_image).value(m_dockerImage);
+	if (m_dependsOn.size() && isFieldRequested(fields, JSON_KEY_APP_depends_on))
+	{
+		writer.key(JSON_KEY_APP_depends_on).startArray();
+		for (const auto& dependency : m_dependsOn)
 		{
-			envs[GET_STRING_T(pair.first)] = web::json::value::string(GET_STRING_T(pair.second));
-		});
-		result[JSON_KEY_APP_env] = envs;
+			writer.startObject();
+			writer.key(JSON_KEY_DEPENDS_name).value(dependency.first);
+			writer.key(JSON_KEY_DEPENDS_condition).value(dependency.second);
+			writer.endObject();
+		}
+		writer.endArray();
+	}
+}
+
+uint64_t Application::getGeneration()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto key = runtimeStateKey();
+	if (m_generation == 0 || key != m_generationKey)
+	{
+		m_generationKey = key;
+		m_generation = Configuration::nextGeneration();
 	}
-	if (m_posixTimeZone.length()) result[JSON_KEY_APP_posix_timezone] = web::json::value::string(m_posixTimeZone);
-	if (m_cacheOutputLines) result[JSON_KEY_APP_cache_lines] = web::json::value::number(m_cacheOutputLines);
-	if (m_dockerImage.length()) result[JSON_KEY_APP_docker_image] = web::json::value::string(m_dockerImage);
-	return result;
+	return m_generation;
+}
+
+std::string Application::runtimeStateKey()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	std::string key;
+	key.append(std::to_string(m_status)).append(",")
+		.append(std::to_string(m_pid)).append(",")
+		.append(m_return != nullptr ? std::to_string(*m_return) : "-").append(",")
+		.append(std::to_string(m_health)).append(",")
+		.append(std::to_string(m_procStartTime.time_since_epoch().count())).append(",")
+		.append(m_process->containerId()).append(",")
+		.append(m_restartPolicy->getStateName());
+	return key;
 }
 
 void Application::dump()
@@ -384,6 +704,7 @@ void Application::dump()
 	LOG_DBG << fname << "m_dockerImage:" << m_dockerImage;
 	if (m_dailyLimit != nullptr) m_dailyLimit->dump();
 	if (m_resourceLimit != nullptr) m_resourceLimit->dump();
+	m_restartPolicy->dump();
 }
 
 std::shared_ptr<AppProcess> Application::allocProcess(int cacheOutputLines, std::string dockerImage, std::string appName)
@@ -411,28 +732,17 @@ std::shared_ptr<AppProcess> Application::allocProcess(int cacheOutputLines, std:
 			process.reset(new AppProcess(cacheOutputLines));
 		}
 	}
+	// output of remote run is returned to client, not kept for temp app
+	if ((cacheOutputLines > 0 || dockerImage.length()) && !isUnAvialable() && Configuration::instance()->getOutputStoreEnabled())
+	{
+		process->setOutputLog(OutputStore::instance()->getLog(appName));
+	}
 	return std::move(process);
 }
 
 bool Application::isInDailyTimeRange()
 {
-	if (m_dailyLimit != nullptr)
-	{
-		// Convert now to day time [%H:%M:%S], less than 24h
-		auto now = Utility::convertStr2DayTime(Utility::convertDayTime2Str(std::chrono::system_clock::now()));
-
-		if (m_dailyLimit->m_startTime < m_dailyLimit->m_endTime)
-		{
-			// Start less than End means valid range should between start and end.
-			return (now >= m_dailyLimit->m_startTime && now < m_dailyLimit->m_endTime);
-		}
-		else if (m_dailyLimit->m_startTime > m_dailyLimit->m_endTime)
-		{
-			// Start greater than End means from end to start is invalid range (the valid range is across 0:00).
-			return !(now >= m_dailyLimit->m_endTime && now < m_dailyLimit->m_startTime);
-		}
-	}
-	return true;
+	return (m_dailyLimit == nullptr || m_dailyLimit->contains(std::chrono::system_clock::now()));
 }
 
 bool Application::avialable()
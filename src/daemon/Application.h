@@ -4,6 +4,8 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 #include <mutex>
 #include <chrono>
 #include <cpprest/json.h>
@@ -12,8 +14,14 @@
 #include "MonitoredProcess.h"
 #include "DailyLimitation.h"
 #include "ResourceLimitation.h"
+#include "RestartPolicy.h"
 #include "TimerHandler.h"
 #include "../common/Utility.h"
+#include "../common/os/process.hpp"
+
+class ProcessSnapshot;
+class OutputSearch;
+class JsonWriter;
 
 
 /**
@@ -33,8 +41,19 @@ public:
 	static void FromJson(std::shared_ptr<Application>& app, const web::json::value& obj);
 
 	virtual void refreshPid();
-	bool attach(std::map<std::string, int>& process);
-	bool attach(int pid);
+	// attach by command line from startup snapshot
+	bool attach(ProcessSnapshot& snapshot);
+	// attach an existing process, startTime (clock ticks after boot) 0 means not verified
+	bool attach(int pid, uint64_t startTime = 0);
+	int getPid();
+
+	// hot upgrade: serialize runtime state and keep application locked until exec,
+	// pipe handles to be inherited by new binary are appended to fds
+	virtual web::json::value freezeRuntime(std::vector<int>& fds);
+	// hot upgrade failed, continue running
+	virtual void unfreezeRuntime();
+	// hot upgrade: restore runtime state from previous daemon
+	virtual void restoreRuntime(const web::json::value& state);
 
 	// Invoke immediately
 	virtual void invokeNow(int timerId);
@@ -44,28 +63,58 @@ public:
 	virtual void disable();
 	virtual void enable();
 
-	// run app in a new process object
-	std::string runApp(int timeoutSeconds);
-	std::string runAsyncrize(int timeoutSeconds);
-	std::string runSyncrize(int timeoutSeconds, void* asyncHttpRequest);
 	std::string getAsyncRunOutput(const std::string& processUuid, int& exitCode, bool& finished);
 	
 	// health: 0-health, 1-unhealth
-	void setHealth(bool health) { m_health = health; }
+	void setHealth(bool health);
 	const std::string& getHealthCheck() { return m_healthCheckCmd; }
 	int getHealth() { return 1- m_health; }
 	void checkAndUpdateHealth();
 
+	// depends_on: application name to condition (DEPENDS_CONDITION_started or DEPENDS_CONDITION_healthy)
+	const std::map<std::string, std::string>& getDependsOn() const { return m_dependsOn; }
+	// bind depends_on names to registered applications, called when registry changed
+	void resolveDependencies(const std::map<std::string, std::shared_ptr<Application>>& apps);
+	// process is running, and has passed a health check since started for DEPENDS_CONDITION_healthy
+	bool satisfies(const std::string& condition);
+	// every depends_on application satisfies its condition
+	bool dependenciesReady();
+
 	// get normal stdout for running app
 	std::string getOutput(bool keepHistory);
+	void searchOutput(OutputSearch& search, uint64_t offset, int64_t since);
+	// calculate cpu usage of the process tree from the tick delta to last sample,
+	// and record memory/cpu/threads/fds/restarts to time series store
+	void sampleUsage(const std::list<os::Process>& processes, const std::chrono::system_clock::time_point& sampleTime);
+	double getCpuPercent();
+	double getCpuSeconds();
+	// RestartPolicy::State as integer
+	int getRestartState();
 
 	void destroy();
-	virtual web::json::value AsJson(bool returnRuntimeInfo);
+	// fields: projection of top level fields, name is always returned, empty means all
+	web::json::value AsJson(bool returnRuntimeInfo, const std::set<std::string>& fields = std::set<std::string>());
+	// same content as AsJson(), written to <writer> without building a tree
+	void writeJson(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields = std::set<std::string>());
 	virtual void dump();
+	// registry generation when this application last changed
+	uint64_t getGeneration();
 
 protected:
+	// write fields of this application type into the open object, called with m_mutex locked
+	virtual void writeJsonFields(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields);
+	static bool isFieldRequested(const std::set<std::string>& fields, const char* field) { return fields.empty() || fields.count(field); }
+	// signature of runtime state used to detect change, should not access /proc
+	virtual std::string runtimeStateKey();
 	std::shared_ptr<AppProcess> allocProcess(int cacheOutputLines, std::string dockerImage, std::string appName);
 	bool isInDailyTimeRange();
+	// count exit of the last spawned process once, false when restart is delayed by backoff or circuit breaker
+	bool restartReady();
+	// hot upgrade of one process: pid, start time, pipe handle and cached output
+	web::json::value freezeProcess(std::shared_ptr<AppProcess>& process, std::vector<int>& fds);
+	void unfreezeProcess(std::shared_ptr<AppProcess>& process);
+	// attach process restored by hot upgrade, identity is checked by start time
+	std::shared_ptr<AppProcess> restoreProcess(const web::json::value& state);
 	virtual bool avialable();
 
 protected:
@@ -79,17 +128,33 @@ protected:
 	std::unique_ptr<int> m_return;
 	std::string m_posixTimeZone;
 	bool m_health;
+	// health check result received after process started
+	bool m_healthChecked;
 	std::string m_healthCheckCmd;
+	std::map<std::string, std::string> m_dependsOn;
+	// weak reference, removed application is not kept by its dependents
+	std::map<std::string, std::weak_ptr<Application>> m_dependencyApps;
 	
 	int m_cacheOutputLines;
 	std::shared_ptr<AppProcess> m_process;
 	int m_pid;
+	// start time of m_pid, identify the process together with pid
+	uint64_t m_pidStartTime;
 	std::recursive_mutex m_mutex;
 	std::shared_ptr<DailyLimitation> m_dailyLimit;
 	std::shared_ptr<ResourceLimitation> m_resourceLimit;
+	std::shared_ptr<RestartPolicy> m_restartPolicy;
 	std::map<std::string, std::string> m_envMap;
 	std::string m_dockerImage;
 	std::chrono::system_clock::time_point m_procStartTime;
+	uint64_t m_generation;
+	std::string m_generationKey;
+	// cpu usage of process tree, reset when pid changed
+	int m_cpuPid;
+	uint64_t m_cpuTicks;
+	double m_cpuPercent;
+	std::chrono::steady_clock::time_point m_cpuSampleTime;
+	uint64_t m_restartCount;
 };
 
 #endif 
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "ApplicationPeriodRun.h"
 #include "Configuration.h"
 #include  "../common/Utility.h"
+#include "../common/JsonWriter.h"
 
 ApplicationPeriodRun::ApplicationPeriodRun()
 {
@@ -35,14 +36,10 @@ void ApplicationPeriodRun::FromJson(std::shared_ptr<ApplicationPeriodRun>& app,
 	ApplicationShortRun::FromJson(fatherApp, jobj);
 }
 
-web::json::value ApplicationPeriodRun::AsJson(bool returnRuntimeInfo)
+void ApplicationPeriodRun::writeJsonFields(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields)
 {
-	const static char fname[] = "ApplicationPeriodRun::AsJson() ";
-	LOG_DBG << fname << "Entered.";
-
-	web::json::value result = ApplicationShortRun::AsJson(returnRuntimeInfo);
-	result[JSON_KEY_PERIOD_APP_keep_running] = web::json::value::boolean(true);
-	return result;
+	ApplicationShortRun::writeJsonFields(writer, returnRuntimeInfo, fields);
+	if (isFieldRequested(fields, JSON_KEY_PERIOD_APP_keep_running)) writer.key(JSON_KEY_PERIOD_APP_keep_running).value(true);
 }
 
 void ApplicationPeriodRun::dump()
@@ -16,11 +16,13 @@ public:
 	virtual ~ApplicationPeriodRun();
 
 	static void FromJson(std::shared_ptr<ApplicationPeriodRun>& app, const web::json::value& jobj);
-	virtual web::json::value AsJson(bool returnRuntimeInfo) override;
 
 	virtual void refreshPid() override;
 
 	virtual void dump() override;
+
+protected:
+	virtual void writeJsonFields(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields) override;
 };
 
 #endif
\ No newline at end of file
@@ -1,10 +1,14 @@
 #include "ApplicationShortRun.h"
 #include "Configuration.h"
 #include "../common/Utility.h"
+#include "../common/JsonWriter.h"
 #include "../common/TimeZoneHelper.h"
+#include "../common/CronExpression.h"
+#include "EventStream.h"
+#include "CronScheduler.h"
 
 ApplicationShortRun::ApplicationShortRun()
-	:m_startInterval(0), m_bufferTime(0), m_timerId(0)
+	:m_startInterval(0), m_bufferTime(0), m_timerId(0), m_cronToken(0)
 {
 	const static char fname[] = "ApplicationShortRun::ApplicationShortRun() ";
 	LOG_DBG << fname << "Entered.";
@@ -24,12 +28,34 @@ void ApplicationShortRun::FromJson(std::shared_ptr<ApplicationShortRun>& app, co
 	std::shared_ptr<Application> fatherApp = app;
 	Application::FromJson(fatherApp, jobj);
 	app->m_startInterval = GET_JSON_INT_VALUE(jobj, JSON_KEY_SHORT_APP_start_interval_seconds);
+	if (HAS_JSON_FIELD(jobj, JSON_KEY_SHORT_APP_cron))
+	{
+		if (app->m_startInterval > 0)
+		{
+			throw std::invalid_argument("cron and start_interval_seconds can not be set together");
+		}
+		app->m_cron = std::make_shared<CronExpression>(GET_JSON_STR_VALUE(jobj, JSON_KEY_SHORT_APP_cron));
+		try
+		{
+			app->m_cron->next(std::chrono::system_clock::now(), app->m_posixTimeZone);
+		}
+		catch (...)
+		{
+			throw std::invalid_argument("invalid posix_timezone: " + app->m_posixTimeZone);
+		}
+		LOG_DBG << fname << "cron is set to: " << app->m_cron->getExpression();
+	}
 	if (HAS_JSON_FIELD(jobj, JSON_KEY_SHORT_APP_start_time))
 	{
 		auto start_time = GET_JSON_STR_VALUE(jobj, JSON_KEY_SHORT_APP_start_time);
 		app->m_startTime = Utility::convertStr2Time(start_time);
 		LOG_DBG << fname << "start_time is set to: " << start_time;
 	}
+	else if (app->m_cron != nullptr)
+	{
+		// cron expression decides the first start time
+		app->m_startTime = std::chrono::system_clock::now();
+	}
 	else
 	{
 		// If missed set start_time, set to next schedule time point, so the first start time will be now.
@@ -84,6 +110,7 @@ void ApplicationShortRun::invoke()
 
 void ApplicationShortRun::invokeNow(int timerId)
 {
+	const static char fname[] = "ApplicationShortRun::invokeNow() ";
 	// Check app existance
 	if (timerId > 0 && !this->isEnabled())
 	{
@@ -92,6 +119,12 @@ void ApplicationShortRun::invokeNow(int timerId)
 	}
 	if (isUnAvialable()) return;
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// skip this round, the old process is kept
+	if (!dependenciesReady())
+	{
+		LOG_DBG << fname << "Application <" << m_name << "> is waiting for dependencies";
+		return;
+	}
 	// clean old process
 	if (m_process->running())
 	{
@@ -114,26 +147,42 @@ void ApplicationShortRun::invokeNow(int timerId)
 		// Spawn new process
 		m_process = allocProcess(m_cacheOutputLines, m_dockerImage, m_name);
 		m_procStartTime = std::chrono::system_clock::now();
-		m_process->spawnProcess(m_commandLine, m_user, m_workdir, m_envMap, m_resourceLimit);
-		m_nextLaunchTime = std::make_unique<std::chrono::system_clock::time_point>(std::chrono::system_clock::now() + std::chrono::seconds(this->getStartInterval()));
+		m_healthChecked = false;
+		auto pid = m_process->spawnProcess(m_commandLine, m_user, m_workdir, m_envMap, m_resourceLimit);
+		web::json::value event = web::json::value::object();
+		event[JSON_KEY_EVENT_pid] = web::json::value::number(pid);
+		EventStream::instance()->publish(EVENT_TYPE_started, m_name, event);
+		// cron application next launch time is set when scheduled
+		if (m_cron == nullptr) m_nextLaunchTime = std::make_unique<std::chrono::system_clock::time_point>(std::chrono::system_clock::now() + std::chrono::seconds(this->getStartInterval()));
 	}
 }
 
-web::json::value ApplicationShortRun::AsJson(bool returnRuntimeInfo)
+void ApplicationShortRun::writeJsonFields(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields)
 {
-	const static char fname[] = "ApplicationShortRun::AsJson() ";
-	LOG_DBG << fname << "Entered.";
-	web::json::value result = Application::AsJson(returnRuntimeInfo);
+	Application::writeJsonFields(writer, returnRuntimeInfo, fields);
 
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	result[JSON_KEY_SHORT_APP_start_time] = web::json::value::string(GET_STRING_T(Utility::convertTime2Str(m_startTime)));
-	result[JSON_KEY_SHORT_APP_start_interval_seconds] = web::json::value::number(m_startInterval);
-	result[JSON_KEY_SHORT_APP_start_interval_timeout] = web::json::value::number(m_bufferTime);
+	if (isFieldRequested(fields, JSON_KEY_SHORT_APP_start_time)) writer.key(JSON_KEY_SHORT_APP_start_time).value(Utility::convertTime2Str(m_startTime));
+	if (m_cron != nullptr)
+	{
+		if (isFieldRequested(fields, JSON_KEY_SHORT_APP_cron)) writer.key(JSON_KEY_SHORT_APP_cron).value(m_cron->getExpression());
+	}
+	else
+	{
+		if (isFieldRequested(fields, JSON_KEY_SHORT_APP_start_interval_seconds)) writer.key(JSON_KEY_SHORT_APP_start_interval_seconds).value(m_startInterval);
+	}
+	if (isFieldRequested(fields, JSON_KEY_SHORT_APP_start_interval_timeout)) writer.key(JSON_KEY_SHORT_APP_start_interval_timeout).value(m_bufferTime);
 	if (returnRuntimeInfo)
 	{
-		if (m_nextLaunchTime != nullptr) result[JSON_KEY_SHORT_APP_next_start_time] = web::json::value::string(GET_STRING_T(Utility::convertTime2Str(*m_nextLaunchTime)));
+		if (m_nextLaunchTime != nullptr && isFieldRequested(fields, JSON_KEY_SHORT_APP_next_start_time)) writer.key(JSON_KEY_SHORT_APP_next_start_time).value(Utility::convertTime2Str(*m_nextLaunchTime));
 	}
-	return result;
+}
+
+std::string ApplicationShortRun::runtimeStateKey()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto key = Application::runtimeStateKey();
+	if (m_nextLaunchTime != nullptr) key.append(",").append(std::to_string(m_nextLaunchTime->time_since_epoch().count()));
+	return key;
 }
 
 void ApplicationShortRun::enable()
@@ -159,6 +208,8 @@ void ApplicationShortRun::disable()
 		this->cancleTimer(m_timerId);
 		m_timerId = 0;
 	}
+	// schedule left in heap will be ignored
+	m_cronToken = 0;
 	m_nextLaunchTime = nullptr;
 }
 
@@ -175,7 +226,14 @@ void ApplicationShortRun::initTimer()
 		m_timerId = 0;
 	}
 
-	// 2. reg new timer
+	// 2. cron application is fired by CronScheduler
+	if (m_cron != nullptr)
+	{
+		scheduleCron(std::chrono::system_clock::now());
+		return;
+	}
+
+	// 3. reg new timer
 	long long firstSleepSec = 0;
 	if (this->getStartTime() > std::chrono::system_clock::now())
 	{
@@ -190,6 +248,37 @@ void ApplicationShortRun::initTimer()
 	m_nextLaunchTime = std::make_unique<std::chrono::system_clock::time_point>(std::chrono::system_clock::now() + std::chrono::seconds(firstSleepSec));
 }
 
+void ApplicationShortRun::scheduleCron(const std::chrono::system_clock::time_point& after)
+{
+	const static char fname[] = "ApplicationShortRun::scheduleCron() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// not fire before start_time
+	auto next = m_cron->next(std::max(after, m_startTime - std::chrono::seconds(1)), m_posixTimeZone);
+	if (next == std::chrono::system_clock::time_point::max())
+	{
+		LOG_WAR << fname << "Application <" << m_name << "> cron <" << m_cron->getExpression() << "> will not fire any more";
+		m_cronToken = 0;
+		m_nextLaunchTime = nullptr;
+		return;
+	}
+	m_cronToken = CronScheduler::instance()->schedule(std::dynamic_pointer_cast<ApplicationShortRun>(shared_from_this()), next);
+	m_nextLaunchTime = std::make_unique<std::chrono::system_clock::time_point>(next);
+	LOG_DBG << fname << "Application <" << m_name << "> next start time: " << Utility::convertTime2Str(next);
+}
+
+void ApplicationShortRun::fireCron(uint64_t token, const std::chrono::system_clock::time_point& fireTime)
+{
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		// cancelled or rescheduled
+		if (token == 0 || token != m_cronToken || m_status != ENABLED) return;
+		// missed fire times when scheduler is late are skipped
+		scheduleCron(std::max(std::chrono::system_clock::now(), fireTime));
+	}
+	invokeNow(0);
+}
+
 int ApplicationShortRun::getStartInterval()
 {
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
@@ -215,6 +304,48 @@ void ApplicationShortRun::dump()
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
 	LOG_DBG << fname << "m_startTime:" << Utility::convertTime2Str(m_startTime);
 	LOG_DBG << fname << "m_startInterval:" << m_startInterval;
+	if (m_cron != nullptr) LOG_DBG << fname << "m_cron:" << m_cron->getExpression();
 	LOG_DBG << fname << "m_bufferTime:" << m_bufferTime;
 	if (m_nextLaunchTime != nullptr) LOG_DBG << fname << "m_nextLaunchTime:" << Utility::convertTime2Str(*m_nextLaunchTime);
 }
+
+web::json::value ApplicationShortRun::freezeRuntime(std::vector<int>& fds)
+{
+	// locked by Application::freezeRuntime()
+	auto state = Application::freezeRuntime(fds);
+	if (m_bufferProcess != nullptr)
+	{
+		auto buffer = freezeProcess(m_bufferProcess, fds);
+		auto killTime = m_bufferProcess->getKillTime();
+		buffer[JSON_KEY_REEXEC_kill_time] = web::json::value::number(std::chrono::duration_cast<std::chrono::seconds>(killTime.time_since_epoch()).count());
+		state[JSON_KEY_REEXEC_buffer_process] = buffer;
+	}
+	return state;
+}
+
+void ApplicationShortRun::unfreezeRuntime()
+{
+	if (m_bufferProcess != nullptr) unfreezeProcess(m_bufferProcess);
+	Application::unfreezeRuntime();
+}
+
+void ApplicationShortRun::restoreRuntime(const web::json::value& state)
+{
+	const static char fname[] = "ApplicationShortRun::restoreRuntime() ";
+
+	Application::restoreRuntime(state);
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (HAS_JSON_FIELD(state, JSON_KEY_REEXEC_buffer_process))
+	{
+		const auto& buffer = state.at(JSON_KEY_REEXEC_buffer_process);
+		m_bufferProcess = restoreProcess(buffer);
+		auto killTime = std::chrono::system_clock::time_point(std::chrono::seconds(GET_JSON_NUMBER_VALUE(buffer, JSON_KEY_REEXEC_kill_time)));
+		if (m_bufferProcess->running() && killTime.time_since_epoch().count() > 0)
+		{
+			auto now = std::chrono::system_clock::now();
+			auto timeout = killTime > now ? std::chrono::duration_cast<std::chrono::seconds>(killTime - now).count() : 0;
+			m_bufferProcess->regKillTimer(timeout, __FUNCTION__);
+			LOG_DBG << fname << "buffer process <" << m_bufferProcess->getpid() << "> will be killed in " << timeout << " seconds";
+		}
+	}
+}
@@ -7,6 +7,8 @@
 #include <mutex>
 #include "Application.h"
 
+class CronExpression;
+
 /**
 * @class Application
 *
@@ -25,13 +27,22 @@ public:
 	virtual void invokeNow(int timerId) override;
 	virtual void enable() override;
 	virtual void disable() override;
-	virtual web::json::value AsJson(bool returnRuntimeInfo) override;
 	void initTimer();
+	// called by CronScheduler, <token> not current means schedule was cancelled
+	void fireCron(uint64_t token, const std::chrono::system_clock::time_point& fireTime);
 	virtual void refreshPid() override;
 	int getStartInterval();
 	std::chrono::system_clock::time_point getStartTime();
 	virtual bool avialable() override;
 	virtual void dump() override;
+	virtual web::json::value freezeRuntime(std::vector<int>& fds) override;
+	virtual void unfreezeRuntime() override;
+	virtual void restoreRuntime(const web::json::value& state) override;
+protected:
+	virtual void writeJsonFields(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields) override;
+	virtual std::string runtimeStateKey() override;
+	void scheduleCron(const std::chrono::system_clock::time_point& after);
+
 protected:
 	std::chrono::system_clock::time_point m_startTime;
 	std::unique_ptr<std::chrono::system_clock::time_point> m_nextLaunchTime;
@@ -39,6 +50,9 @@ protected:
 	int m_bufferTime;
 	int m_timerId;
 	std::shared_ptr<AppProcess> m_bufferProcess;
+	// start by cron expression instead of m_startInterval
+	std::shared_ptr<CronExpression> m_cron;
+	uint64_t m_cronToken;
 };
 
 #endif 
\ No newline at end of file
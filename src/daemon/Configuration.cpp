@@ -1,17 +1,29 @@
 #include <ace/Signal.h>
 #include "Configuration.h"
 #include "../common/Utility.h"
+#include "../common/JsonWriter.h"
 #include "ApplicationPeriodRun.h"
 #include "ResourceCollection.h"
 #include "PrometheusRest.h"
+#include "EventStream.h"
+#include "TimeSeries.h"
+#include "OutputStore.h"
+#include "JobTable.h"
+#include "StartupPlan.h"
 
 std::shared_ptr<Configuration> Configuration::m_instance = nullptr;
+// start generation from current time, so generation from a previous daemon process is always older
+std::atomic<uint64_t> Configuration::m_generation(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
 Configuration::Configuration()
-	:m_threadPoolSize(6), m_scheduleInterval(0), m_restListenPort(DEFAULT_REST_LISTEN_PORT),
-	m_promListenPort(DEFAULT_PROM_LISTEN_PORT),	m_sslEnabled(false), m_restEnabled(true), m_jwtEnabled(true)
+	:m_threadPoolSize(6), m_scheduleInterval(0), m_startupConcurrency(DEFAULT_STARTUP_CONCURRENCY), m_resourceSampleInterval(DEFAULT_RESOURCE_SAMPLE_INTERVAL), m_restListenPort(DEFAULT_REST_LISTEN_PORT),
+	m_promListenPort(DEFAULT_PROM_LISTEN_PORT), m_dockerSocketFile(DEFAULT_DOCKER_SOCKET_FILE), m_sslEnabled(false), m_restEnabled(true), m_jwtEnabled(true), m_processTrackerEnabled(false), m_outputStoreEnabled(false),
+	m_removedAppsForgotten(m_generation)
 {
 	m_jsonFilePath = Utility::getSelfFullPath() + ".json";
 	m_label = std::make_unique<Label>();
+	m_rateLimiter = std::make_shared<RateLimiter>();
+	m_jobQueuePolicy = std::make_shared<JobQueuePolicy>();
+	m_startupPlan = std::make_shared<StartupPlan>(m_apps);
 	LOG_INF << "Configuration file <" << m_jsonFilePath << ">";
 }
 
@@ -56,6 +68,8 @@ std::shared_ptr<Configuration> Configuration::FromJson(const std::string& str)
 	SET_JSON_BOOL_VALUE(jsonValue, JSON_KEY_SSLEnabled, config->m_sslEnabled);
 	SET_JSON_BOOL_VALUE(jsonValue, JSON_KEY_RestEnabled, config->m_restEnabled);
 	SET_JSON_BOOL_VALUE(jsonValue, JSON_KEY_JWTEnabled, config->m_jwtEnabled);
+	SET_JSON_BOOL_VALUE(jsonValue, JSON_KEY_ProcessTrackerEnabled, config->m_processTrackerEnabled);
+	SET_JSON_BOOL_VALUE(jsonValue, JSON_KEY_OutputStoreEnabled, config->m_outputStoreEnabled);
 	config->m_sslCertificateFile = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_SSLCertificateFile);
 	config->m_sslCertificateKeyFile = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_SSLCertificateKeyFile);
 	if (config->m_scheduleInterval < 1 || config->m_scheduleInterval > 100)
@@ -70,6 +84,12 @@ std::shared_ptr<Configuration> Configuration::FromJson(const std::string& str)
 		LOG_INF << "Default value <" << config->m_restListenPort << "> will by used for RestListenPort";
 	}
 	SET_JSON_INT_VALUE(jsonValue, JSON_KEY_PrometheusExporterListenPort, config->m_promListenPort);
+	SET_JSON_INT_VALUE(jsonValue, JSON_KEY_ResourceSampleIntervalSeconds, config->m_resourceSampleInterval);
+	if (config->m_resourceSampleInterval < 1 || config->m_resourceSampleInterval > MAX_RESOURCE_SAMPLE_INTERVAL)
+	{
+		config->m_resourceSampleInterval = DEFAULT_RESOURCE_SAMPLE_INTERVAL;
+		LOG_INF << "Default value <" << config->m_resourceSampleInterval << "> will by used for ResourceSampleIntervalSeconds";
+	}
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_Applications))
 	{
 		auto& jArr = jsonValue.at(JSON_KEY_Applications).as_array();
@@ -80,6 +100,15 @@ std::shared_ptr<Configuration> Configuration::FromJson(const std::string& str)
 			app->dump();
 			config->registerApp(app);
 		}
+		// dependency cycle is not recoverable by scheduler, refuse the configuration
+		StartupPlan::validate(config->m_apps);
+		config->resolveDependencies();
+	}
+	SET_JSON_INT_VALUE(jsonValue, JSON_KEY_StartupConcurrency, config->m_startupConcurrency);
+	if (config->m_startupConcurrency < 1 || config->m_startupConcurrency > MAX_STARTUP_CONCURRENCY)
+	{
+		config->m_startupConcurrency = DEFAULT_STARTUP_CONCURRENCY;
+		LOG_INF << "Default value <" << config->m_startupConcurrency << "> will by used for StartupConcurrency";
 	}
 	auto threadpool = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_HttpThreadPoolSize);
 	if (threadpool > 0 && threadpool < 40)
@@ -87,11 +116,14 @@ std::shared_ptr<Configuration> Configuration::FromJson(const std::string& str)
 		config->m_threadPoolSize = threadpool;
 	}
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_Labels)) config->m_label = Label::FromJson(jsonValue.at(JSON_KEY_Labels));
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RateLimit)) config->m_rateLimiter = RateLimiter::FromJson(jsonValue.at(JSON_KEY_RateLimit));
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_JobQueue)) config->m_jobQueuePolicy = JobQueuePolicy::FromJson(jsonValue.at(JSON_KEY_JobQueue));
 	
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_Roles))	config->m_roles = Roles::FromJson(jsonValue.at(JSON_KEY_Roles));
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_JWT)) config->m_jwtUsers = Users::FromJson(jsonValue.at(JSON_KEY_JWT), config->m_roles);
 
 	config->m_JwtRedirectUrl = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_JWTRedirectUrl);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_DockerSocketFile)) config->m_dockerSocketFile = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_DockerSocketFile);
 
 	return config;
 }
@@ -137,37 +169,47 @@ void Configuration::handleReloadSignal()
 
 web::json::value Configuration::AsJson(bool returnRuntimeInfo)
 {
-	// get applications
-	auto apps = getApplicationJson(false);
+	return JsonTreeWriter::toJson([&](JsonWriter& writer) { writeJson(writer, returnRuntimeInfo); });
+}
 
-	// get global parameters
+void Configuration::writeJson(JsonWriter& writer, bool returnRuntimeInfo)
+{
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	web::json::value result = web::json::value::object();
-
-	result[JSON_KEY_Description] = web::json::value::string(GET_STRING_T(m_hostDescription));
-	result[JSON_KEY_RestListenPort] = web::json::value::number(m_restListenPort);
-	result[JSON_KEY_PrometheusExporterListenPort] = web::json::value::number(m_promListenPort);
-	result[JSON_KEY_RestListenAddress] = web::json::value::string(m_RestListenAddress);
-	result[JSON_KEY_ScheduleIntervalSeconds] = web::json::value::number(m_scheduleInterval);
-	result[JSON_KEY_LogLevel] = web::json::value::string(GET_STRING_T(m_logLevel));
-
-	result[JSON_KEY_RestEnabled] = web::json::value::boolean(m_restEnabled);
-	result[JSON_KEY_SSLEnabled] = web::json::value::boolean(m_sslEnabled);
-	result[JSON_KEY_SSLCertificateFile] = web::json::value::string(GET_STRING_T(m_sslCertificateFile));
-	result[JSON_KEY_SSLCertificateKeyFile] = web::json::value::string(GET_STRING_T(m_sslCertificateKeyFile));
-	result[JSON_KEY_JWTEnabled] = web::json::value::boolean(m_jwtEnabled);
-	result[JSON_KEY_HttpThreadPoolSize] = web::json::value::number((uint32_t)m_threadPoolSize);
+	writer.startObject();
+
+	// global parameters
+	writer.key(JSON_KEY_Description).value(m_hostDescription);
+	writer.key(JSON_KEY_RestListenPort).value(m_restListenPort);
+	writer.key(JSON_KEY_PrometheusExporterListenPort).value(m_promListenPort);
+	writer.key(JSON_KEY_RestListenAddress).value(m_RestListenAddress);
+	writer.key(JSON_KEY_ScheduleIntervalSeconds).value(m_scheduleInterval);
+	writer.key(JSON_KEY_StartupConcurrency).value((uint64_t)m_startupConcurrency);
+	writer.key(JSON_KEY_ResourceSampleIntervalSeconds).value(m_resourceSampleInterval);
+	writer.key(JSON_KEY_LogLevel).value(m_logLevel);
+
+	writer.key(JSON_KEY_RestEnabled).value(m_restEnabled);
+	writer.key(JSON_KEY_SSLEnabled).value(m_sslEnabled);
+	writer.key(JSON_KEY_SSLCertificateFile).value(m_sslCertificateFile);
+	writer.key(JSON_KEY_SSLCertificateKeyFile).value(m_sslCertificateKeyFile);
+	writer.key(JSON_KEY_JWTEnabled).value(m_jwtEnabled);
+	writer.key(JSON_KEY_ProcessTrackerEnabled).value(m_processTrackerEnabled);
+	writer.key(JSON_KEY_OutputStoreEnabled).value(m_outputStoreEnabled);
+	writer.key(JSON_KEY_HttpThreadPoolSize).value((uint64_t)m_threadPoolSize);
 	if (!returnRuntimeInfo)
 	{
-		result[JSON_KEY_JWT] = m_jwtUsers->AsJson();
-		result[JSON_KEY_Roles] = m_roles->AsJson();
+		writer.key(JSON_KEY_JWT).value(m_jwtUsers->AsJson());
+		writer.key(JSON_KEY_Roles).value(m_roles->AsJson());
 	}
 
-	result[JSON_KEY_Applications] = apps;
-	result[JSON_KEY_Labels] = getLabel()->AsJson();
-	result[JSON_KEY_JWTRedirectUrl] = web::json::value::string(GET_STRING_T(m_JwtRedirectUrl));
+	writer.key(JSON_KEY_Applications);
+	writeApplicationJson(writer, false);
+	writer.key(JSON_KEY_Labels).value(getLabel()->AsJson());
+	writer.key(JSON_KEY_RateLimit).value(getRateLimiter()->AsJson());
+	writer.key(JSON_KEY_JobQueue).value(getJobQueuePolicy()->AsJson());
+	writer.key(JSON_KEY_JWTRedirectUrl).value(m_JwtRedirectUrl);
+	writer.key(JSON_KEY_DockerSocketFile).value(m_dockerSocketFile);
 
-	return result;
+	writer.endObject();
 }
 
 std::vector<std::shared_ptr<Application>> Configuration::getApps()
@@ -230,10 +272,15 @@ std::string Configuration::getRestListenAddress()
 
 const utility::string_t Configuration::getConfigContentStr()
 {
-	return this->AsJson(false).serialize();
+	return JsonWriter::toString([this](JsonWriter& writer) { writeJson(writer, false); }, false);
 }
 
 const utility::string_t Configuration::getSecureConfigContentStr()
+{
+	return getSecureConfigJson().serialize();
+}
+
+web::json::value Configuration::getSecureConfigJson()
 {
 	auto json = this->AsJson(false);
 	if (HAS_JSON_FIELD(json, JSON_KEY_JWT))
@@ -247,38 +294,75 @@ const utility::string_t Configuration::getSecureConfigContentStr()
 			}
 		}
 	}
+	return json;
+}
 
-	return json.serialize();
+web::json::value Configuration::getApplicationJson(bool returnRuntimeInfo, const std::set<std::string>& fields, uint64_t since)
+{
+	return JsonTreeWriter::toJson([&](JsonWriter& writer) { writeApplicationJson(writer, returnRuntimeInfo, fields, since); });
 }
 
-web::json::value Configuration::getApplicationJson(bool returnRuntimeInfo)
+void Configuration::writeApplicationJson(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields, uint64_t since)
 {
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	std::vector<std::shared_ptr<Application>> apps;
-	for (auto app : m_apps)
+	writer.startArray();
+	for (const auto& app : m_apps)
 	{
 		// do not persist temp application
-		if (returnRuntimeInfo || !app->isUnAvialable()) apps.push_back(app);
+		if (!returnRuntimeInfo && app->isUnAvialable()) continue;
+		if (since && app->getGeneration() <= since) continue;
+		app->writeJson(writer, returnRuntimeInfo, fields);
 	}
-	// Build Json
-	auto result = web::json::value::array(apps.size());
-	for (size_t i = 0; i < apps.size(); ++i)
+	writer.endArray();
+}
+
+std::vector<std::string> Configuration::getRemovedApps(uint64_t since, bool& complete)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	complete = (since >= m_removedAppsForgotten);
+	std::set<std::string> exists;
+	for (const auto& app : m_apps) exists.insert(app->getName());
+	std::vector<std::string> removed;
+	for (const auto& item : m_removedApps)
 	{
-		result[i] = apps[i]->AsJson(returnRuntimeInfo);
+		// app re-registered after removed will be returned as changed
+		if (item.second > since && exists.count(item.first) == 0) removed.push_back(item.first);
 	}
-	return result;
+	return removed;
+}
+
+uint64_t Configuration::getGeneration()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// app runtime change is detected lazily here, so generation read must refresh all apps
+	for (const auto& app : m_apps) app->getGeneration();
+	return m_generation;
+}
+
+uint64_t Configuration::nextGeneration()
+{
+	return ++m_generation;
 }
 
 void Configuration::disableApp(const std::string& appName)
 {
 	getApp(appName)->disable();
 	saveConfigToDisk();
+	publishStatusEvent(appName, false);
 }
 void Configuration::enableApp(const std::string& appName)
 {
 	auto app = getApp(appName);
 	app->enable();
 	saveConfigToDisk();
+	publishStatusEvent(appName, true);
+}
+
+void Configuration::publishStatusEvent(const std::string& appName, bool enabled)
+{
+	web::json::value event = web::json::value::object();
+	event[JSON_KEY_EVENT_status] = web::json::value::number(enabled ? ENABLED : DISABLED);
+	EventStream::instance()->publish(EVENT_TYPE_config, appName, event);
 }
 
 const std::string Configuration::getLogLevel() const
@@ -336,7 +420,7 @@ void Configuration::dump()
 {
 	const static char fname[] = "Configuration::dump() ";
 
-	LOG_DBG << fname << '\n' << Utility::prettyJson(this->getSecureConfigContentStr());
+	LOG_DBG << fname << '\n' << JsonWriter::toString(this->getSecureConfigJson(), true);
 
 	auto apps = getApps();
 	for (auto app : apps)
@@ -348,6 +432,36 @@ void Configuration::dump()
 std::shared_ptr<Application> Configuration::addApp(const web::json::value& jsonApp)
 {
 	auto app = parseApp(jsonApp);
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// check depends_on against registry with this app
+	auto apps = m_apps;
+	auto exist = std::find_if(apps.begin(), apps.end(), [&app](const std::shared_ptr<Application>& a) { return a->getName() == app->getName(); });
+	if (exist != apps.end())
+	{
+		*exist = app;
+	}
+	else
+	{
+		apps.push_back(app);
+	}
+	try
+	{
+		StartupPlan::validate(apps);
+	}
+	catch (...)
+	{
+		app->destroy();
+		throw;
+	}
+	// Write to disk
+	if (replaceApp(app)) saveConfigToDisk();
+
+	return app;
+}
+
+bool Configuration::replaceApp(std::shared_ptr<Application> app)
+{
 	bool update = false;
 
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
@@ -367,18 +481,33 @@ std::shared_ptr<Application> Configuration::addApp(const web::json::value& jsonA
 		// Register app
 		registerApp(app);
 	}
-	// Write to disk
-	if (!app->isUnAvialable()) saveConfigToDisk();
-
-	return app;
+	resolveDependencies();
+	// temp app for run API is not a registry change
+	if (!app->isUnAvialable()) EventStream::instance()->publish(update ? EVENT_TYPE_config : EVENT_TYPE_registered, app->getName());
+	return !app->isUnAvialable();
 }
 
 void Configuration::removeApp(const std::string& appName)
 {
-	const static char fname[] = "Configuration::removeApp() ";
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (const auto& app : m_apps)
+	{
+		if (app->getName() != appName && app->getDependsOn().count(appName))
+		{
+			throw std::invalid_argument("application <" + appName + "> is required by application <" + app->getName() + ">");
+		}
+	}
+	// Write to disk
+	if (eraseApp(appName)) saveConfigToDisk();
+}
+
+bool Configuration::eraseApp(const std::string& appName)
+{
+	const static char fname[] = "Configuration::eraseApp() ";
 
 	LOG_DBG << fname << appName;
 
+	bool persist = false;
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
 	// Update in-memory app
 	for (auto iterA = m_apps.begin(); iterA != m_apps.end();)
@@ -388,8 +517,20 @@ void Configuration::removeApp(const std::string& appName)
 			bool tempApp = (*iterA)->isUnAvialable();
 			(*iterA)->destroy();
 			iterA = m_apps.erase(iterA);
-			// Write to disk
-			if (!tempApp) saveConfigToDisk();
+			if (!tempApp)
+			{
+				persist = true;
+				EventStream::instance()->publish(EVENT_TYPE_removed, appName);
+				TimeSeriesStore::instance()->removeApp(appName);
+				if (m_outputStoreEnabled) OutputStore::instance()->removeApp(appName);
+			}
+			// remember removed app for delta query
+			m_removedApps.push_back(std::make_pair(appName, nextGeneration()));
+			while (m_removedApps.size() > MAX_REMOVED_APP_HISTORY)
+			{
+				m_removedAppsForgotten = m_removedApps.front().second;
+				m_removedApps.pop_front();
+			}
 			LOG_DBG << fname << "removed " << appName;
 		}
 		else
@@ -397,21 +538,218 @@ void Configuration::removeApp(const std::string& appName)
 			iterA++;
 		}
 	}
+	resolveDependencies();
+	return persist;
+}
+
+web::json::value Configuration::applyBatch(const web::json::value& operations, bool& applied)
+{
+	const static char fname[] = "Configuration::applyBatch() ";
+
+	applied = false;
+	if (!operations.is_array())
+	{
+		throw std::invalid_argument("batch operations should be a json array");
+	}
+	auto& opArray = operations.as_array();
+	if (opArray.size() == 0 || opArray.size() > MAX_BATCH_OPERATIONS)
+	{
+		throw std::invalid_argument(std::string("batch operation count should be between 1 and ") + std::to_string(MAX_BATCH_OPERATIONS));
+	}
+
+	struct BatchItem
+	{
+		std::string operation;
+		std::string name;
+		std::shared_ptr<Application> app;
+		std::string error;
+	};
+	std::vector<BatchItem> items(opArray.size());
+
+	// hold registry lock during validate and apply, so no other request can change apps in between
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+
+	// 1. validate all operations, track app names as they will be after each operation
+	std::set<std::string> existNames;
+	for (const auto& app : m_apps) existNames.insert(app->getName());
+	bool valid = true;
+	for (size_t i = 0; i < opArray.size(); i++)
+	{
+		auto& item = items[i];
+		const auto& op = opArray.at(i);
+		try
+		{
+			if (!op.is_object())
+			{
+				throw std::invalid_argument("operation should be a json object");
+			}
+			item.operation = GET_JSON_STR_VALUE(op, JSON_KEY_BATCH_operation);
+			if (item.operation == BATCH_OPERATION_register)
+			{
+				if (!HAS_JSON_FIELD(op, JSON_KEY_BATCH_app) || !op.at(JSON_KEY_BATCH_app).is_object())
+				{
+					throw std::invalid_argument("register operation should have an app definition");
+				}
+				item.app = parseApp(op.at(JSON_KEY_BATCH_app));
+				item.name = item.app->getName();
+				if (item.app->isUnAvialable())
+				{
+					throw std::invalid_argument("can not register a temporary application");
+				}
+				existNames.insert(item.name);
+			}
+			else if (item.operation == BATCH_OPERATION_enable ||
+				item.operation == BATCH_OPERATION_disable ||
+				item.operation == BATCH_OPERATION_delete)
+			{
+				item.name = GET_JSON_STR_VALUE(op, JSON_KEY_BATCH_name);
+				if (existNames.count(item.name) == 0)
+				{
+					throw std::invalid_argument("No such application found");
+				}
+				if (item.operation == BATCH_OPERATION_delete) existNames.erase(item.name);
+			}
+			else
+			{
+				throw std::invalid_argument(std::string("unsupported operation <") + item.operation + ">");
+			}
+		}
+		catch (const std::exception& e)
+		{
+			item.error = e.what();
+			valid = false;
+		}
+	}
+
+	// depends_on is checked on the registry as it will be after the whole batch
+	if (valid)
+	{
+		auto apps = m_apps;
+		for (const auto& item : items)
+		{
+			if (item.operation != BATCH_OPERATION_register && item.operation != BATCH_OPERATION_delete) continue;
+			apps.erase(std::remove_if(apps.begin(), apps.end(), [&item](const std::shared_ptr<Application>& app) { return app->getName() == item.name; }), apps.end());
+			if (item.app != nullptr) apps.push_back(item.app);
+		}
+		StartupPlan plan(apps);
+		if (plan.error().length())
+		{
+			for (auto& item : items)
+			{
+				if (item.app != nullptr) item.app->destroy();
+			}
+			throw std::invalid_argument(plan.error());
+		}
+	}
+
+	// 2. apply all operations in order, only persist once
+	if (valid)
+	{
+		bool persist = false;
+		auto applyItem = [this, &persist](BatchItem& item)
+		{
+			try
+			{
+				if (item.operation == BATCH_OPERATION_register)
+				{
+					persist = replaceApp(item.app) || persist;
+				}
+				else if (item.operation == BATCH_OPERATION_enable)
+				{
+					getApp(item.name)->enable();
+					publishStatusEvent(item.name, true);
+					persist = true;
+				}
+				else if (item.operation == BATCH_OPERATION_disable)
+				{
+					getApp(item.name)->disable();
+					publishStatusEvent(item.name, false);
+					persist = true;
+				}
+				else if (item.operation == BATCH_OPERATION_delete)
+				{
+					persist = eraseApp(item.name) || persist;
+				}
+			}
+			catch (const std::exception& e)
+			{
+				item.error = e.what();
+			}
+		};
+		// consecutive enable operations start dependencies first,
+		// consecutive disable and delete operations stop dependents first
+		auto orderKind = [](const std::string& operation)
+		{
+			if (operation == BATCH_OPERATION_enable) return 1;
+			if (operation == BATCH_OPERATION_disable || operation == BATCH_OPERATION_delete) return 2;
+			return 0;
+		};
+		for (size_t begin = 0; begin < items.size();)
+		{
+			const auto kind = orderKind(items[begin].operation);
+			size_t end = begin + 1;
+			while (kind && end < items.size() && orderKind(items[end].operation) == kind) end++;
+			std::vector<BatchItem*> run;
+			for (size_t i = begin; i < end; i++) run.push_back(&items[i]);
+			if (run.size() > 1)
+			{
+				auto plan = getStartupPlan();
+				std::stable_sort(run.begin(), run.end(), [&plan, kind](const BatchItem* a, const BatchItem* b)
+				{
+					return (kind == 1) ? plan->level(a->name) < plan->level(b->name) : plan->level(a->name) > plan->level(b->name);
+				});
+			}
+			for (auto item : run) applyItem(*item);
+			begin = end;
+		}
+		if (persist) saveConfigToDisk();
+		applied = true;
+	}
+	else
+	{
+		// release timers created by parsed short running apps
+		for (auto& item : items)
+		{
+			if (item.app != nullptr) item.app->destroy();
+		}
+	}
+
+	// 3. per-item result
+	auto result = web::json::value::array(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		auto& item = items[i];
+		web::json::value itemResult = web::json::value::object();
+		itemResult[JSON_KEY_BATCH_operation] = web::json::value::string(item.operation);
+		itemResult[JSON_KEY_BATCH_name] = web::json::value::string(item.name);
+		if (item.error.length())
+		{
+			itemResult[JSON_KEY_BATCH_result] = web::json::value::string(BATCH_RESULT_failed);
+			itemResult[JSON_KEY_BATCH_message] = web::json::value::string(item.error);
+		}
+		else
+		{
+			itemResult[JSON_KEY_BATCH_result] = web::json::value::string(applied ? BATCH_RESULT_success : BATCH_RESULT_skipped);
+		}
+		result[i] = itemResult;
+	}
+	LOG_INF << fname << "batch with <" << items.size() << "> operations " << (applied ? "applied" : "rejected");
+	return result;
 }
 
 void Configuration::saveConfigToDisk()
 {
 	const static char fname[] = "Configuration::saveConfigToDisk() ";
 
-	auto content = GET_STD_STRING(this->getConfigContentStr());
-	if (content.length())
+	// write formatted json in one pass, no intermediate json tree
+	auto formatJson = JsonWriter::toString([this](JsonWriter& writer) { writeJson(writer, false); }, true);
+	if (formatJson.length())
 	{
 		std::lock_guard<std::recursive_mutex> guard(m_mutex);
 		auto tmpFile = m_jsonFilePath + "." + std::to_string(Utility::getThreadId());
 		std::ofstream ofs(tmpFile, ios::trunc);
 		if (ofs.is_open())
 		{
-			auto formatJson = Utility::prettyJson(content);
 			ofs << formatJson;
 			ofs.close();
 			if (ACE_OS::rename(tmpFile.c_str(), m_jsonFilePath.c_str()) == 0)
@@ -472,24 +810,53 @@ void Configuration::hotUpdate(const web::json::value& config, bool updateBasicCo
 		}
 	}
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_ScheduleIntervalSeconds)) SET_COMPARE(this->m_scheduleInterval, newConfig->m_scheduleInterval);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StartupConcurrency)) SET_COMPARE(this->m_startupConcurrency, newConfig->m_startupConcurrency);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_ResourceSampleIntervalSeconds)) SET_COMPARE(this->m_resourceSampleInterval, newConfig->m_resourceSampleInterval);
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_SSLCertificateFile)) SET_COMPARE(this->m_sslCertificateFile, newConfig->m_sslCertificateFile);
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_SSLCertificateKeyFile)) SET_COMPARE(this->m_sslCertificateKeyFile, newConfig->m_sslCertificateKeyFile);
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_SSLEnabled)) SET_COMPARE(this->m_sslEnabled, newConfig->m_sslEnabled);
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_JWTRedirectUrl)) SET_COMPARE(this->m_JwtRedirectUrl, newConfig->m_JwtRedirectUrl);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_DockerSocketFile)) SET_COMPARE(this->m_dockerSocketFile, newConfig->m_dockerSocketFile);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RateLimit))
+	{
+		std::atomic_store(&this->m_rateLimiter, newConfig->getRateLimiter());
+		LOG_INF << fname << "Configuration value updated : " << "m_rateLimiter";
+	}
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_JobQueue))
+	{
+		std::atomic_store(&this->m_jobQueuePolicy, newConfig->getJobQueuePolicy());
+		LOG_INF << fname << "Configuration value updated : " << "m_jobQueuePolicy";
+		JobTable::instance()->setPolicy(newConfig->getJobQueuePolicy());
+	}
 
 	this->dump();
 	ResourceCollection::instance()->dump();
 }
 
+void Configuration::resolveDependencies()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	std::map<std::string, std::shared_ptr<Application>> apps;
+	for (const auto& app : m_apps) apps[app->getName()] = app;
+	for (const auto& app : m_apps) app->resolveDependencies(apps);
+	m_startupPlan = std::make_shared<StartupPlan>(m_apps);
+}
+
+std::shared_ptr<StartupPlan> Configuration::getStartupPlan()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_startupPlan;
+}
+
 std::shared_ptr<Application> Configuration::parseApp(const web::json::value& jsonApp)
 {
 	const static char fname[] = "Configuration::parseApp() ";
 
-	LOG_DBG << fname << "Json Object:\n" << Utility::prettyJson(jsonApp.serialize());
+	LOG_DBG << fname << "Json Object:\n" << JsonWriter::toString(jsonApp, true);
 
 	std::shared_ptr<Application> app;
 
-	if (GET_JSON_INT_VALUE(jsonApp, JSON_KEY_SHORT_APP_start_interval_seconds) > 0)
+	if (GET_JSON_INT_VALUE(jsonApp, JSON_KEY_SHORT_APP_start_interval_seconds) > 0 || HAS_JSON_FIELD(jsonApp, JSON_KEY_SHORT_APP_cron))
 	{
 		// Consider as short running application
 		std::shared_ptr<ApplicationShortRun> shortApp;
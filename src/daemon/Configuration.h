@@ -5,6 +5,8 @@
 #include <vector>
 #include <mutex>
 #include <map>
+#include <deque>
+#include <atomic>
 
 #include <cpprest/json.h>
 
@@ -12,6 +14,10 @@
 #include "Role.h"
 #include "User.h"
 #include "Label.h"
+#include "RateLimiter.h"
+#include "JobQueuePolicy.h"
+
+class StartupPlan;
 
 //////////////////////////////////////////////////////////////////////////
 // All the operation functions to access appmg.json
@@ -29,6 +35,8 @@ public:
 
 	static std::shared_ptr<Configuration> FromJson(const std::string& str);
 	web::json::value AsJson(bool returnRuntimeInfo);
+	// same content as AsJson(), written to <writer> without building a tree
+	void writeJson(JsonWriter& writer, bool returnRuntimeInfo);
 	void saveConfigToDisk();
 	void hotUpdate(const web::json::value& config, bool updateBasicConfig = false);
 
@@ -39,17 +47,36 @@ public:
 	std::shared_ptr<Application> parseApp(const web::json::value& jsonApp);
 
 	int getScheduleInterval();
+	size_t getStartupConcurrency() const { return m_startupConcurrency; }
+	// start order of current registry, rebuilt when registry changed
+	std::shared_ptr<StartupPlan> getStartupPlan();
+	int getResourceSampleInterval() const { return m_resourceSampleInterval; }
 	int getRestListenPort();
 	int getPromListenPort() { return m_promListenPort; }
 	std::string getRestListenAddress();
 	const utility::string_t getConfigContentStr();
 	const utility::string_t getSecureConfigContentStr();
-	web::json::value getApplicationJson(bool returnRuntimeInfo);
+	// configuration json with user key masked
+	web::json::value getSecureConfigJson();
+	// fields: only return these fields, empty means all; since: only return apps changed after this generation
+	web::json::value getApplicationJson(bool returnRuntimeInfo, const std::set<std::string>& fields = std::set<std::string>(), uint64_t since = 0);
+	void writeApplicationJson(JsonWriter& writer, bool returnRuntimeInfo, const std::set<std::string>& fields = std::set<std::string>(), uint64_t since = 0);
+	// names of apps removed after generation <since>, complete is false when the history is not enough
+	std::vector<std::string> getRemovedApps(uint64_t since, bool& complete);
+	// refresh and return current registry generation
+	uint64_t getGeneration();
+	static uint64_t nextGeneration();
 	std::shared_ptr<Application> getApp(const std::string& appName);
 	void disableApp(const std::string& appName);
 	void enableApp(const std::string& appName);
+	// validate all register/enable/disable/delete operations first, then apply
+	// them under one registry lock with one persistence, return per-item results
+	web::json::value applyBatch(const web::json::value& operations, bool& applied);
 
 	std::shared_ptr<Label> getLabel() { return m_label; }
+	// read by request threads without lock, replaced atomically by hotUpdate()
+	std::shared_ptr<RateLimiter> getRateLimiter() { return std::atomic_load(&m_rateLimiter); }
+	std::shared_ptr<JobQueuePolicy> getJobQueuePolicy() { return std::atomic_load(&m_jobQueuePolicy); }
 
 	const std::string getLogLevel() const;
 	bool getSslEnabled() const;
@@ -57,25 +84,41 @@ public:
 	std::string getSSLCertificateKeyFile() const;
 	bool getRestEnabled() const;
 	bool getJwtEnabled() const;
+	bool getProcessTrackerEnabled() const { return m_processTrackerEnabled; }
+	bool getOutputStoreEnabled() const { return m_outputStoreEnabled; }
 	const size_t getThreadPoolSize() const { return m_threadPoolSize; }
 	const std::string getDescription() const { return m_hostDescription; }
 
 	const std::shared_ptr<User> getUserInfo(const std::string& userName);
 	std::set<std::string> getUserPermissions(const std::string& userName);
 	const std::string& getJwtRedirectUrl();
+	const std::string getDockerSocketFile() const { return m_dockerSocketFile; }
 
 	void dump();
 
+private:
+	// register or replace app in memory, return true when configuration file need update
+	bool replaceApp(std::shared_ptr<Application> app);
+	// remove app from memory, return true when configuration file need update
+	bool eraseApp(const std::string& appName);
+	void publishStatusEvent(const std::string& appName, bool enabled);
+	// bind depends_on of all apps and rebuild start order after registry changed
+	void resolveDependencies();
+
 private:
 	std::vector<std::shared_ptr<Application>> m_apps;
+	std::shared_ptr<StartupPlan> m_startupPlan;
 	std::string m_hostDescription;
 	size_t m_threadPoolSize;
 	int m_scheduleInterval;
+	size_t m_startupConcurrency;
+	int m_resourceSampleInterval;
 	int m_restListenPort;
 	int m_promListenPort;
 	std::string m_RestListenAddress;
 	std::string m_logLevel;
 	std::string m_JwtRedirectUrl;
+	std::string m_dockerSocketFile;
 
 	std::recursive_mutex m_mutex;
 	std::string m_jsonFilePath;
@@ -83,14 +126,23 @@ private:
 	bool m_sslEnabled;
 	bool m_restEnabled;
 	bool m_jwtEnabled;
+	bool m_processTrackerEnabled;
+	bool m_outputStoreEnabled;
 	std::string m_sslCertificateFile;
 	std::string m_sslCertificateKeyFile;
 
 	std::shared_ptr<Roles> m_roles;
 	std::shared_ptr<Users> m_jwtUsers;
 	std::shared_ptr<Label> m_label;
+	std::shared_ptr<RateLimiter> m_rateLimiter;
+	std::shared_ptr<JobQueuePolicy> m_jobQueuePolicy;
+
+	// removed app name and generation, keep last MAX_REMOVED_APP_HISTORY
+	std::deque<std::pair<std::string, uint64_t>> m_removedApps;
+	uint64_t m_removedAppsForgotten;
 
 	static std::shared_ptr<Configuration> m_instance;
+	static std::atomic<uint64_t> m_generation;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include "CronScheduler.h"
+#include "ApplicationShortRun.h"
+#include "../common/Utility.h"
+
+CronScheduler::CronScheduler()
+	:m_token(0), m_exit(false)
+{
+}
+
+CronScheduler::~CronScheduler()
+{
+}
+
+std::unique_ptr<CronScheduler>& CronScheduler::instance()
+{
+	static std::unique_ptr<CronScheduler> singleton = std::make_unique<CronScheduler>();
+	return singleton;
+}
+
+uint64_t CronScheduler::schedule(const std::shared_ptr<ApplicationShortRun>& app, const std::chrono::system_clock::time_point& time)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	const bool earliest = m_heap.empty() || time < m_heap.top().time;
+	m_heap.push(Entry{ time, ++m_token, app });
+	// wake up thread to sleep until the new earliest time
+	if (earliest) m_cond.notify_one();
+	return m_token;
+}
+
+size_t CronScheduler::size()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_heap.size();
+}
+
+int CronScheduler::svc(void)
+{
+	const static char fname[] = "CronScheduler::svc() ";
+	LOG_INF << fname << "Entered";
+
+	while (!m_exit)
+	{
+		std::vector<Entry> due;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			const auto now = std::chrono::system_clock::now();
+			while (m_heap.size() && m_heap.top().time <= now)
+			{
+				due.push_back(m_heap.top());
+				m_heap.pop();
+			}
+			if (due.empty())
+			{
+				// wall clock may be changed, do not sleep too long
+				auto wakeup = now + std::chrono::seconds(CRON_MAX_SLEEP_SECONDS);
+				if (m_heap.size()) wakeup = std::min(wakeup, m_heap.top().time);
+				m_cond.wait_until(lock, wakeup);
+				continue;
+			}
+		}
+		// application is invoked without heap locked, it schedules the next fire
+		for (const auto& entry : due)
+		{
+			auto app = entry.app.lock();
+			if (app == nullptr) continue;
+			try
+			{
+				app->fireCron(entry.token, entry.time);
+			}
+			catch (const std::exception& ex)
+			{
+				LOG_WAR << fname << app->getName() << " got exception: " << ex.what();
+			}
+			catch (...)
+			{
+				LOG_WAR << fname << app->getName() << " exception";
+			}
+		}
+	}
+
+	LOG_WAR << fname << " thread exit";
+	return 0;
+}
+
+int CronScheduler::open(void* args)
+{
+	return activate(THR_NEW_LWP | THR_JOINABLE | THR_CANCEL_ENABLE | THR_CANCEL_ASYNCHRONOUS, 1);
+}
+
+int CronScheduler::close(u_long flags)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_exit = true;
+	}
+	m_cond.notify_one();
+	return ACE_Task_Base::close(flags);
+}
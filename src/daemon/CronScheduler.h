@@ -0,0 +1,53 @@
+#ifndef CRON_SCHEDULER_H
+#define CRON_SCHEDULER_H
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+#include <ace/Task.h>
+
+class ApplicationShortRun;
+
+//////////////////////////////////////////////////////////////////////////
+// One thread and one min-heap of next fire time for all cron applications,
+// instead of one reactor timer each. A schedule is not removed from heap
+// when cancelled: application keeps the token of its current schedule and
+// ignores a fire with another token.
+//////////////////////////////////////////////////////////////////////////
+class CronScheduler : public ACE_Task_Base
+{
+public:
+	CronScheduler();
+	virtual ~CronScheduler();
+	static std::unique_ptr<CronScheduler>& instance();
+
+	virtual int svc(void) override;
+	virtual int open(void* args = 0) override;
+	virtual int close(u_long flags = 0) override;
+
+	// fire <app> at <time>, return token of this schedule
+	uint64_t schedule(const std::shared_ptr<ApplicationShortRun>& app, const std::chrono::system_clock::time_point& time);
+	// schedules in heap, include cancelled ones not fired yet
+	size_t size();
+
+private:
+	struct Entry
+	{
+		std::chrono::system_clock::time_point time;
+		uint64_t token;
+		std::weak_ptr<ApplicationShortRun> app;
+		bool operator>(const Entry& other) const { return time > other.time; }
+	};
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_heap;
+	uint64_t m_token;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	// read by svc() without lock, set under lock so the wakeup is not lost
+	std::atomic<bool> m_exit;
+};
+
+#endif
@@ -1,7 +1,21 @@
+#include <map>
+#include <mutex>
+#include <ctime>
+#include <algorithm>
 #include "DailyLimitation.h"
 #include "../common/Utility.h"
+#include "../common/TimeZoneHelper.h"
+
+namespace
+{
+	const int SECONDS_PER_DAY = 24 * 60 * 60;
+	const int SECONDS_PER_WEEK = 7 * SECONDS_PER_DAY;
+	const uint8_t ALL_WEEKDAYS = 0x7F;
+	const char* const WEEKDAY_NAMES[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+}
 
 DailyLimitation::DailyLimitation()
+	:m_granularity(60)
 {
 }
 
@@ -14,31 +28,210 @@ void DailyLimitation::dump()
 {
 	const static char fname[] = "DailyLimitation::dump() ";
 
-	LOG_DBG << fname << "m_startTime:" << Utility::convertDayTime2Str(m_startTime);
-	LOG_DBG << fname << "m_endTime:" << Utility::convertDayTime2Str(m_endTime);
+	for (const auto& window : m_windows)
+	{
+		LOG_DBG << fname << "window:" << dayTime2Str(window.m_start) << "-" << dayTime2Str(window.m_end) << " weekdays:" << (int)window.m_weekdays;
+	}
+	LOG_DBG << fname << "m_posixTimeZone:" << m_posixTimeZone;
+	LOG_DBG << fname << "m_granularity:" << m_granularity;
 }
 
 web::json::value DailyLimitation::AsJson()
 {
-	web::json::value result = web::json::value::object();
+	auto windowJson = [](const Window& window)
+	{
+		web::json::value result = web::json::value::object();
+		result[JSON_KEY_DAILY_LIMITATION_daily_start] = web::json::value::string(GET_STRING_T(dayTime2Str(window.m_start)));
+		result[JSON_KEY_DAILY_LIMITATION_daily_end] = web::json::value::string(GET_STRING_T(dayTime2Str(window.m_end)));
+		if (window.m_weekdays != ALL_WEEKDAYS)
+		{
+			std::string weekdays;
+			for (int day = 0; day < 7; day++)
+			{
+				if (!(window.m_weekdays & (1 << day))) continue;
+				if (weekdays.length()) weekdays.append(",");
+				weekdays.append(WEEKDAY_NAMES[day]);
+			}
+			result[JSON_KEY_DAILY_LIMITATION_weekdays] = web::json::value::string(GET_STRING_T(weekdays));
+		}
+		return result;
+	};
 
-	result[JSON_KEY_DAILY_LIMITATION_daily_start] = web::json::value::string(GET_STRING_T(Utility::convertDayTime2Str(m_startTime)));
-	result[JSON_KEY_DAILY_LIMITATION_daily_end] = web::json::value::string(GET_STRING_T(Utility::convertDayTime2Str(m_endTime)));
+	// one window keeps the original format
+	if (m_windows.size() == 1) return windowJson(m_windows.front());
+
+	web::json::value result = web::json::value::object();
+	auto windows = web::json::value::array(m_windows.size());
+	for (size_t i = 0; i < m_windows.size(); i++) windows[i] = windowJson(m_windows[i]);
+	result[JSON_KEY_DAILY_LIMITATION_windows] = windows;
 	return result;
 }
 
-std::shared_ptr<DailyLimitation> DailyLimitation::FromJson(const web::json::value& jobj)
+std::shared_ptr<DailyLimitation> DailyLimitation::FromJson(const web::json::value& jobj, const std::string& posixTimezone)
 {
 	std::shared_ptr<DailyLimitation> result;
 	if (!jobj.is_null())
 	{
-		if (!(HAS_JSON_FIELD(jobj, JSON_KEY_DAILY_LIMITATION_daily_start) && HAS_JSON_FIELD(jobj, JSON_KEY_DAILY_LIMITATION_daily_end)))
+		result = std::make_shared<DailyLimitation>();
+		if (HAS_JSON_FIELD(jobj, JSON_KEY_DAILY_LIMITATION_windows))
 		{
-			throw std::invalid_argument("should both have daily_start and daily_end parameter");
+			for (const auto& window : jobj.at(JSON_KEY_DAILY_LIMITATION_windows).as_array())
+			{
+				result->m_windows.push_back(parseWindow(window));
+			}
+			if (result->m_windows.empty() || result->m_windows.size() > MAX_DAILY_LIMITATION_WINDOWS)
+			{
+				throw std::invalid_argument("daily_limitation windows should have 1 to " + std::to_string(MAX_DAILY_LIMITATION_WINDOWS) + " items");
+			}
 		}
-		result = std::make_shared<DailyLimitation>();
-		result->m_startTime = Utility::convertStr2DayTime(GET_JSON_STR_VALUE(jobj, JSON_KEY_DAILY_LIMITATION_daily_start));
-		result->m_endTime = Utility::convertStr2DayTime(GET_JSON_STR_VALUE(jobj, JSON_KEY_DAILY_LIMITATION_daily_end));
+		else
+		{
+			result->m_windows.push_back(parseWindow(jobj));
+		}
+		result->m_posixTimeZone = posixTimezone;
+		try
+		{
+			secondOfWeek(std::chrono::system_clock::now(), posixTimezone);
+		}
+		catch (...)
+		{
+			throw std::invalid_argument("invalid posix_timezone: " + posixTimezone);
+		}
+		result->compile();
 	}
 	return result;
 }
+
+bool DailyLimitation::contains(const std::chrono::system_clock::time_point& time) const
+{
+	const int unit = secondOfWeek(time, m_posixTimeZone) / m_granularity;
+	return (m_bitmap[unit >> 6] >> (unit & 63)) & 1;
+}
+
+int DailyLimitation::secondOfWeek(const std::chrono::system_clock::time_point& time, const std::string& posixTimezone)
+{
+	static std::mutex mutex;
+	// time zone => (time, second of week) of last conversion
+	static std::map<std::string, std::pair<std::time_t, int>> cache;
+
+	const auto timet = std::chrono::system_clock::to_time_t(time);
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto it = cache.find(posixTimezone);
+		if (it != cache.end() && it->second.first == timet) return it->second.second;
+	}
+	// local time is converted every time, so daylight saving change is followed
+	const auto local = TimeZoneHelper::toLocalTime(time, posixTimezone);
+	const int second = local.tm_wday * SECONDS_PER_DAY + local.tm_hour * 3600 + local.tm_min * 60 + std::min(local.tm_sec, 59);
+	std::lock_guard<std::mutex> guard(mutex);
+	cache[posixTimezone] = std::make_pair(timet, second);
+	return second;
+}
+
+DailyLimitation::Window DailyLimitation::parseWindow(const web::json::value& jobj)
+{
+	if (!(HAS_JSON_FIELD(jobj, JSON_KEY_DAILY_LIMITATION_daily_start) && HAS_JSON_FIELD(jobj, JSON_KEY_DAILY_LIMITATION_daily_end)))
+	{
+		throw std::invalid_argument("should both have daily_start and daily_end parameter");
+	}
+	Window window;
+	window.m_start = parseDayTime(GET_JSON_STR_VALUE(jobj, JSON_KEY_DAILY_LIMITATION_daily_start)) % SECONDS_PER_DAY;
+	window.m_end = parseDayTime(GET_JSON_STR_VALUE(jobj, JSON_KEY_DAILY_LIMITATION_daily_end)) % SECONDS_PER_DAY;
+	window.m_weekdays = HAS_JSON_FIELD(jobj, JSON_KEY_DAILY_LIMITATION_weekdays) ? parseWeekdays(jobj.at(JSON_KEY_DAILY_LIMITATION_weekdays)) : ALL_WEEKDAYS;
+	return window;
+}
+
+int DailyLimitation::parseDayTime(const std::string& strTime)
+{
+	// "%H:%M:%S" or "%H:%M", 24:00:00 is the end of day
+	int hour = 0, minute = 0, second = 0;
+	char tail = 0;
+	int count = sscanf(strTime.c_str(), "%d:%d:%d%c", &hour, &minute, &second, &tail);
+	if (count < 2 || count > 3 || hour < 0 || hour > 24 || minute < 0 || minute > 59 || second < 0 || second > 59 || (hour == 24 && (minute || second)))
+	{
+		throw std::invalid_argument("invalid daily time <" + strTime + ">, should be %H:%M:%S");
+	}
+	return hour * 3600 + minute * 60 + second;
+}
+
+std::string DailyLimitation::dayTime2Str(int seconds)
+{
+	char buff[16] = { 0 };
+	snprintf(buff, sizeof(buff), "%02d:%02d:%02d", seconds / 3600, seconds / 60 % 60, seconds % 60);
+	return std::string(buff);
+}
+
+uint8_t DailyLimitation::parseWeekdays(const web::json::value& jobj)
+{
+	// "MON-FRI", "SAT,SUN", "1-5" or ["MON", 3], 0 and 7 are Sunday
+	std::vector<std::string> items;
+	if (jobj.is_array())
+	{
+		for (const auto& item : jobj.as_array())
+		{
+			items.push_back(item.is_number() ? std::to_string(item.as_integer()) : GET_STD_STRING(item.as_string()));
+		}
+	}
+	else
+	{
+		items = Utility::splitString(GET_STD_STRING(jobj.as_string()), ",");
+	}
+	auto parseDay = [](const std::string& token)
+	{
+		auto day = Utility::stdStringTrim(token);
+		std::transform(day.begin(), day.end(), day.begin(), ::toupper);
+		for (int i = 0; i < 7; i++)
+		{
+			if (day == WEEKDAY_NAMES[i]) return i;
+		}
+		if (day.length() == 1 && day[0] >= '0' && day[0] <= '7') return (day[0] - '0') % 7;
+		throw std::invalid_argument("invalid weekday <" + token + ">");
+	};
+
+	uint8_t mask = 0;
+	for (const auto& item : items)
+	{
+		auto dash = item.find('-');
+		int from = parseDay(item.substr(0, dash));
+		int to = (dash == std::string::npos) ? from : parseDay(item.substr(dash + 1));
+		// FRI-MON wraps over Sunday
+		for (int day = from; ; day = (day + 1) % 7)
+		{
+			mask |= (1 << day);
+			if (day == to) break;
+		}
+	}
+	if (mask == 0)
+	{
+		throw std::invalid_argument("weekdays should not be empty");
+	}
+	return mask;
+}
+
+void DailyLimitation::compile()
+{
+	m_granularity = 60;
+	for (const auto& window : m_windows)
+	{
+		if (window.m_start % 60 || window.m_end % 60) m_granularity = 1;
+	}
+	const int units = SECONDS_PER_WEEK / m_granularity;
+	m_bitmap.assign((units + 63) / 64, 0);
+	for (const auto& window : m_windows)
+	{
+		// same start and end is the whole day
+		int length = window.m_end - window.m_start;
+		if (length <= 0) length += SECONDS_PER_DAY;
+		for (int day = 0; day < 7; day++)
+		{
+			if (!(window.m_weekdays & (1 << day))) continue;
+			const int from = (day * SECONDS_PER_DAY + window.m_start) / m_granularity;
+			for (int unit = from; unit < from + length / m_granularity; unit++)
+			{
+				// Saturday window crossing 0:00 goes on Sunday
+				const int bit = unit % units;
+				m_bitmap[bit >> 6] |= (1ULL << (bit & 63));
+			}
+		}
+	}
+}
@@ -4,23 +4,52 @@
 #include <string>
 #include <chrono>
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include <cpprest/json.h>
 
 //////////////////////////////////////////////////////////////////////////
-// Define the valid time range in one day
+// Define the valid time ranges in a week: one or more daily windows, each
+// one on selected weekdays, a window with start later than end crosses
+// 0:00 into the next day. Windows are wall clock of the application time
+// zone and compiled to one bit per minute (per second when a window does
+// not start or end at a whole minute) of the week when loaded.
 //////////////////////////////////////////////////////////////////////////
 class DailyLimitation
 {
 public:
+	struct Window
+	{
+		int m_start;		// seconds of day
+		int m_end;
+		uint8_t m_weekdays;	// bit 0 is Sunday
+	};
+
 	DailyLimitation();
 	virtual ~DailyLimitation();
 	void dump();
 
 	virtual web::json::value AsJson();
-	static std::shared_ptr<DailyLimitation> FromJson(const web::json::value& obj);
+	// <posixTimezone> is time zone of windows, system time zone when empty
+	static std::shared_ptr<DailyLimitation> FromJson(const web::json::value& obj, const std::string& posixTimezone);
+
+	bool contains(const std::chrono::system_clock::time_point& time) const;
+
+	// second of week (0 is Sunday 00:00:00) of wall clock in <posixTimezone>,
+	// converted once for each second and time zone and shared by all applications
+	static int secondOfWeek(const std::chrono::system_clock::time_point& time, const std::string& posixTimezone);
+
+private:
+	static Window parseWindow(const web::json::value& obj);
+	static int parseDayTime(const std::string& strTime);
+	static std::string dayTime2Str(int seconds);
+	static uint8_t parseWeekdays(const web::json::value& obj);
+	void compile();
 
-	std::chrono::system_clock::time_point m_startTime;
-	std::chrono::system_clock::time_point m_endTime;
+	std::vector<Window> m_windows;
+	std::string m_posixTimeZone;
+	int m_granularity;
+	std::vector<uint64_t> m_bitmap;
 };
 
-#endif
\ No newline at end of file
+#endif
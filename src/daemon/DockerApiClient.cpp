@@ -0,0 +1,358 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <iomanip>
+#include <boost/algorithm/string.hpp>
+#include "DockerApiClient.h"
+#include "../common/Utility.h"
+
+DockerApiClient::DockerApiClient(const std::string& socketFile, int timeoutSeconds)
+	:m_socketFile(socketFile), m_timeoutSeconds(timeoutSeconds)
+{
+}
+
+DockerApiClient::~DockerApiClient()
+{
+	cancel();
+}
+
+std::string DockerApiClient::createContainer(const std::string& name, const web::json::value& config)
+{
+	std::string body;
+	auto status = request("POST", std::string("/containers/create?name=") + urlEncode(name), GET_STD_STRING(config.serialize()), body, m_timeoutSeconds);
+	if (status != 201) throwError("create container", status, body);
+	auto result = web::json::value::parse(GET_STRING_T(body));
+	return GET_JSON_STR_VALUE(result, "Id");
+}
+
+void DockerApiClient::startContainer(const std::string& containerId)
+{
+	std::string body;
+	auto status = request("POST", std::string("/containers/") + containerId + "/start", "", body, m_timeoutSeconds);
+	// 304: container already started
+	if (status != 204 && status != 304) throwError("start container", status, body);
+}
+
+web::json::value DockerApiClient::inspectContainer(const std::string& containerId)
+{
+	std::string body;
+	auto status = request("GET", std::string("/containers/") + containerId + "/json", "", body, m_timeoutSeconds);
+	if (status == 404) return web::json::value::null();
+	if (status != 200) throwError("inspect container", status, body);
+	return web::json::value::parse(GET_STRING_T(body));
+}
+
+bool DockerApiClient::removeContainer(const std::string& containerId, bool force)
+{
+	std::string body;
+	auto status = request("DELETE", std::string("/containers/") + containerId + (force ? "?force=1" : ""), "", body, m_timeoutSeconds);
+	if (status == 404) return false;
+	if (status != 204) throwError("remove container", status, body);
+	return true;
+}
+
+std::string DockerApiClient::containerLogs(const std::string& containerId, int tail, long long since)
+{
+	std::string path = std::string("/containers/") + containerId + "/logs?stdout=1&stderr=1";
+	if (tail > 0) path += "&tail=" + std::to_string(tail);
+	if (since > 0) path += "&since=" + std::to_string(since);
+
+	std::string body, output;
+	auto status = request("GET", path, "", body, m_timeoutSeconds);
+	if (status == 404) return output;
+	if (status != 200) throwError("get container logs", status, body);
+	demuxStream(body, output);
+	return output;
+}
+
+web::json::value DockerApiClient::inspectImage(const std::string& image)
+{
+	std::string body;
+	auto status = request("GET", std::string("/images/") + image + "/json", "", body, m_timeoutSeconds);
+	if (status == 404) return web::json::value::null();
+	if (status != 200) throwError("inspect image", status, body);
+	return web::json::value::parse(GET_STRING_T(body));
+}
+
+void DockerApiClient::pullImage(const std::string& image, int timeoutSeconds, std::function<void(const web::json::value&)> progress)
+{
+	const static char fname[] = "DockerApiClient::pullImage() ";
+
+	// split repository and tag, pull all tags when tag is empty, so use latest by default
+	std::string repository = image, tag = "latest";
+	auto tagPos = image.find_last_of(':');
+	if (image.find('@') != std::string::npos)
+	{
+		tag.clear();
+	}
+	else if (tagPos != std::string::npos && image.find('/', tagPos) == std::string::npos)
+	{
+		repository = image.substr(0, tagPos);
+		tag = image.substr(tagPos + 1);
+	}
+	std::string path = std::string("/images/create?fromImage=") + urlEncode(repository);
+	if (tag.length()) path += "&tag=" + urlEncode(tag);
+
+	// progress is a stream of json message split by line break
+	std::string line, body, error;
+	auto status = request("POST", path, "", body, timeoutSeconds, [&](const char* data, size_t len)
+		{
+			line.append(data, len);
+			size_t pos;
+			while ((pos = line.find('\n')) != std::string::npos)
+			{
+				auto msg = Utility::stdStringTrim(line.substr(0, pos));
+				line.erase(0, pos + 1);
+				if (msg.empty()) continue;
+				try
+				{
+					auto json = web::json::value::parse(GET_STRING_T(msg));
+					if (HAS_JSON_FIELD(json, "error")) error = GET_JSON_STR_VALUE(json, "error");
+					if (progress) progress(json);
+				}
+				catch (...)
+				{
+					body.append(msg);
+				}
+			}
+			return true;
+		});
+	if (status != 200) throwError("pull image", status, body + line);
+	if (error.length())
+	{
+		LOG_ERR << fname << "pull image <" << image << "> failed: " << error;
+		throw std::invalid_argument(std::string("pull image failed: ") + error);
+	}
+	LOG_INF << fname << "image <" << image << "> pulled";
+}
+
+void DockerApiClient::cancel()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (auto fd : m_activeSockets)
+	{
+		::shutdown(fd, SHUT_RDWR);
+	}
+}
+
+int DockerApiClient::request(const std::string& method, const std::string& path, const std::string& body, std::string& responseBody,
+	int timeoutSeconds, std::function<bool(const char* data, size_t len)> dataHandler)
+{
+	const static char fname[] = "DockerApiClient::request() ";
+
+	LOG_DBG << fname << method << " " << path;
+	int fd = connectSocket(timeoutSeconds);
+	int status = 0;
+	try
+	{
+		// 1. send request
+		std::stringstream ss;
+		ss << method << " " << path << " HTTP/1.1\r\n"
+			<< "Host: docker\r\n"
+			<< "User-Agent: appsvc\r\n"
+			<< "Connection: close\r\n";
+		if (body.length()) ss << "Content-Type: application/json\r\n";
+		ss << "Content-Length: " << body.length() << "\r\n\r\n" << body;
+		auto req = ss.str();
+		size_t sent = 0;
+		while (sent < req.length())
+		{
+			auto rt = ::send(fd, req.data() + sent, req.length() - sent, MSG_NOSIGNAL);
+			if (rt < 0)
+			{
+				if (errno == EINTR) continue;
+				throw std::invalid_argument(std::string("send to docker failed: ") + std::strerror(errno));
+			}
+			sent += rt;
+		}
+
+		// 2. read response
+		auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(timeoutSeconds);
+		std::string buffer;
+		auto readMore = [&]() -> bool
+		{
+			char data[16 * 1024];
+			while (true)
+			{
+				if (timeoutSeconds > 0 && std::chrono::system_clock::now() > deadline)
+				{
+					throw std::invalid_argument("docker request timeout");
+				}
+				auto rt = ::recv(fd, data, sizeof(data), 0);
+				if (rt < 0)
+				{
+					if (errno == EINTR) continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK) throw std::invalid_argument("docker request timeout");
+					throw std::invalid_argument(std::string("read from docker failed: ") + std::strerror(errno));
+				}
+				if (rt == 0) return false;
+				buffer.append(data, rt);
+				return true;
+			}
+		};
+		auto deliver = [&](const char* data, size_t len) -> bool
+		{
+			if (dataHandler) return dataHandler(data, len);
+			responseBody.append(data, len);
+			return true;
+		};
+
+		// status line and headers
+		size_t headerEnd;
+		while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+		{
+			if (!readMore()) throw std::invalid_argument("docker closed connection");
+		}
+		auto headers = Utility::splitString(buffer.substr(0, headerEnd), "\r\n");
+		buffer.erase(0, headerEnd + 4);
+		if (headers.empty() || headers[0].length() < 12) throw std::invalid_argument("invalid response from docker");
+		status = std::stoi(headers[0].substr(9, 3));
+		bool chunked = false;
+		long long contentLength = -1;
+		for (size_t i = 1; i < headers.size(); i++)
+		{
+			auto pos = headers[i].find(':');
+			if (pos == std::string::npos) continue;
+			auto key = boost::algorithm::to_lower_copy(Utility::stdStringTrim(headers[i].substr(0, pos)));
+			auto value = Utility::stdStringTrim(headers[i].substr(pos + 1));
+			if (key == "transfer-encoding" && boost::algorithm::icontains(value, "chunked")) chunked = true;
+			if (key == "content-length") contentLength = std::stoll(value);
+		}
+
+		// body
+		if (chunked)
+		{
+			while (true)
+			{
+				size_t lineEnd;
+				while ((lineEnd = buffer.find("\r\n")) == std::string::npos)
+				{
+					if (!readMore()) throw std::invalid_argument("docker closed connection");
+				}
+				auto chunkSize = std::stoul(buffer.substr(0, lineEnd), nullptr, 16);
+				buffer.erase(0, lineEnd + 2);
+				if (chunkSize == 0) break;
+				while (buffer.length() < chunkSize + 2)
+				{
+					if (!readMore()) throw std::invalid_argument("docker closed connection");
+				}
+				if (!deliver(buffer.data(), chunkSize)) break;
+				buffer.erase(0, chunkSize + 2);
+			}
+		}
+		else
+		{
+			long long received = 0;
+			do
+			{
+				auto len = buffer.length();
+				if (contentLength >= 0) len = std::min<long long>(len, contentLength - received);
+				if (len && !deliver(buffer.data(), len)) break;
+				received += len;
+				buffer.clear();
+			} while ((contentLength < 0 || received < contentLength) && readMore());
+		}
+	}
+	catch (...)
+	{
+		closeSocket(fd);
+		throw;
+	}
+	closeSocket(fd);
+	LOG_DBG << fname << method << " " << path << " return " << status;
+	return status;
+}
+
+size_t DockerApiClient::demuxStream(const std::string& source, std::string& output)
+{
+	const size_t headerLen = 8;
+	size_t pos = 0;
+	while (pos < source.length())
+	{
+		auto header = reinterpret_cast<const unsigned char*>(source.data() + pos);
+		// container with tty enabled output raw stream without frame header
+		if ((source.length() - pos >= 4) && (header[0] > 2 || header[1] || header[2] || header[3]))
+		{
+			output.append(source, pos, std::string::npos);
+			return source.length();
+		}
+		if (source.length() - pos < headerLen) break;
+		size_t payloadLen = (size_t(header[4]) << 24) | (size_t(header[5]) << 16) | (size_t(header[6]) << 8) | size_t(header[7]);
+		if (source.length() - pos - headerLen < payloadLen) break;
+		output.append(source, pos + headerLen, payloadLen);
+		pos += headerLen + payloadLen;
+	}
+	return pos;
+}
+
+std::string DockerApiClient::urlEncode(const std::string& str)
+{
+	std::stringstream ss;
+	ss << std::hex << std::uppercase;
+	for (auto c : str)
+	{
+		if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~')
+			ss << c;
+		else
+			ss << '%' << std::setw(2) << std::setfill('0') << int((unsigned char)c);
+	}
+	return ss.str();
+}
+
+int DockerApiClient::connectSocket(int timeoutSeconds)
+{
+	const static char fname[] = "DockerApiClient::connectSocket() ";
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		throw std::invalid_argument(std::string("create socket failed: ") + std::strerror(errno));
+	}
+	if (timeoutSeconds > 0)
+	{
+		struct timeval tv;
+		tv.tv_sec = timeoutSeconds;
+		tv.tv_usec = 0;
+		::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	}
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strncpy(addr.sun_path, m_socketFile.c_str(), sizeof(addr.sun_path) - 1);
+	if (::connect(fd, (struct sockaddr*) & addr, sizeof(addr)) != 0)
+	{
+		auto error = std::string(std::strerror(errno));
+		::close(fd);
+		LOG_ERR << fname << "connect to <" << m_socketFile << "> failed with error: " << error;
+		throw std::invalid_argument(std::string("connect to docker failed: ") + error);
+	}
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_activeSockets.insert(fd);
+	return fd;
+}
+
+void DockerApiClient::closeSocket(int fd)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_activeSockets.erase(fd);
+	::close(fd);
+}
+
+void DockerApiClient::throwError(const std::string& action, int status, const std::string& body)
+{
+	const static char fname[] = "DockerApiClient::throwError() ";
+
+	// docker error body: {"message": "xxx"}
+	std::string msg = body;
+	try
+	{
+		auto json = web::json::value::parse(GET_STRING_T(body));
+		if (HAS_JSON_FIELD(json, "message")) msg = GET_JSON_STR_VALUE(json, "message");
+	}
+	catch (...)
+	{
+	}
+	LOG_WAR << fname << action << " failed with status <" << status << ">: " << msg;
+	throw std::invalid_argument(action + " failed: " + msg);
+}
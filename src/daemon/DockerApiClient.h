@@ -0,0 +1,58 @@
+#ifndef DOCKER_API_CLIENT_H
+#define DOCKER_API_CLIENT_H
+#include <set>
+#include <mutex>
+#include <string>
+#include <functional>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Docker Engine API client, HTTP/1.1 over unix domain socket
+//////////////////////////////////////////////////////////////////////////
+class DockerApiClient
+{
+public:
+	explicit DockerApiClient(const std::string& socketFile, int timeoutSeconds = 5);
+	virtual ~DockerApiClient();
+
+	// container
+	std::string createContainer(const std::string& name, const web::json::value& config);
+	void startContainer(const std::string& containerId);
+	// return null json when container not exist
+	web::json::value inspectContainer(const std::string& containerId);
+	// return false when container not exist
+	bool removeContainer(const std::string& containerId, bool force);
+	// stdout and stderr of the last lines or since a unix timestamp
+	std::string containerLogs(const std::string& containerId, int tail, long long since = 0);
+
+	// image
+	// return null json when image not exist
+	web::json::value inspectImage(const std::string& image);
+	void pullImage(const std::string& image, int timeoutSeconds, std::function<void(const web::json::value&)> progress = nullptr);
+
+	// shutdown all ongoing requests, used to stop a long time image pull
+	void cancel();
+
+	// send one request and read the whole response, response body is passed to dataHandler
+	// when provided (streaming, return false to stop reading) or saved to responseBody
+	int request(const std::string& method, const std::string& path, const std::string& body, std::string& responseBody,
+		int timeoutSeconds, std::function<bool(const char* data, size_t len)> dataHandler = nullptr);
+
+	// Docker log stream frame: [stream type:1][0:3][payload size:4 big endian][payload]
+	// append payloads to output and return consumed bytes, a partial frame is left in source
+	static size_t demuxStream(const std::string& source, std::string& output);
+	static std::string urlEncode(const std::string& str);
+
+private:
+	int connectSocket(int timeoutSeconds);
+	void closeSocket(int fd);
+	void throwError(const std::string& action, int status, const std::string& body);
+
+private:
+	const std::string m_socketFile;
+	const int m_timeoutSeconds;
+	std::set<int> m_activeSockets;
+	std::mutex m_mutex;
+};
+
+#endif
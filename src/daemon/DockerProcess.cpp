@@ -1,15 +1,20 @@
+#include <ctime>
 #include <thread>
 #include <ace/Barrier.h>
 #include "DockerProcess.h"
 #include "../common/Utility.h"
 #include "../common/os/pstree.hpp"
 #include "LinuxCgroup.h"
-#include "MonitoredProcess.h"
+#include "Configuration.h"
+#include "DockerApiClient.h"
+#include "OutputStore.h"
 
 DockerProcess::DockerProcess(int cacheOutputLines, std::string dockerImage, std::string appName)
 	: AppProcess(cacheOutputLines), m_dockerImage(dockerImage),
-	m_appName(appName), m_lastFetchTime(std::chrono::system_clock::now())
+	m_appName(appName), m_outputBuffer(cacheOutputLines)
 {
+	m_dockerClient = std::make_shared<DockerApiClient>(Configuration::instance()->getDockerSocketFile());
+	m_logClient = std::make_shared<DockerApiClient>(Configuration::instance()->getDockerSocketFile());
 }
 
 
@@ -30,23 +35,24 @@ void DockerProcess::killgroup(int timerId)
 		m_containerId.clear();
 	}
 
+	// stop ongoing image pull
+	m_dockerClient->cancel();
+
 	// clean docker container
 	if (!containerId.empty())
 	{
-		std::string cmd = "docker rm -f " + containerId;
-		AppProcess proc(0);
-		proc.spawnProcess(cmd, "", "", {}, nullptr);
-		if (proc.wait(ACE_Time_Value(3)) <= 0)
+		try
+		{
+			m_dockerClient->removeContainer(containerId, true);
+		}
+		catch (const std::exception& e)
 		{
-			LOG_ERR << fname << "cmd <" << cmd << "> killed due to timeout";
-			proc.killgroup();
+			LOG_ERR << fname << "remove container <" << containerId << "> failed: " << e.what();
 		}
 	}
 
-	if (m_imagePullProc != nullptr && m_imagePullProc->running())
-	{
-		m_imagePullProc->killgroup();
-	}
+	// log stream is closed by docker when container removed
+	stopLogThread();
 }
 
 int DockerProcess::syncSpawnProcess(std::string cmd, std::string user, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit)
@@ -55,25 +61,20 @@ int DockerProcess::syncSpawnProcess(std::string cmd, std::string user, std::stri
 
 	killgroup();
 	int pid = ACE_INVALID_PID;
-	const int dockerCliTimeoutSec = 5;
 	std::string containerName = m_appName;
 
 	// 0. clean old docker contianer (docker container will left when host restart)
-	std::string dockerCommand = "docker rm -f " + containerName;
-	AppProcess proc(0);
-	proc.spawnProcess(dockerCommand, "", "", {}, nullptr);
-	proc.wait();
+	try
+	{
+		m_dockerClient->removeContainer(containerName, true);
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERR << fname << "remove container <" << containerName << "> failed: " << e.what();
+	}
 
 	// 1. check docker image
-	dockerCommand = "docker inspect -f '{{.Size}}' " + m_dockerImage;
-	auto dockerProcess = std::make_shared<MonitoredProcess>(32, false);
-	pid = dockerProcess->spawnProcess(dockerCommand, "", "", {}, nullptr);
-	dockerProcess->regKillTimer(dockerCliTimeoutSec, fname);
-	dockerProcess->runPipeReaderThread();
-	auto imageSizeStr = dockerProcess->fetchOutputMsg();
-	Utility::trimLineBreak(imageSizeStr);
-	imageSizeStr = getLine(imageSizeStr);
-	if (!Utility::isNumber(imageSizeStr) || std::stoi(imageSizeStr) < 1)
+	if (m_dockerClient->inspectImage(m_dockerImage).is_null())
 	{
 		LOG_WAR << fname << "docker image <" << m_dockerImage << "> not exist, try to pull.";
 
@@ -90,11 +91,11 @@ int DockerProcess::syncSpawnProcess(std::string cmd, std::string user, std::stri
 			{
 				LOG_WAR << fname << "ENV APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT <" << pullTimeoutStr << "> is not number, use default value : " << pullTimeout;
 			}
-			m_imagePullProc = std::make_shared<MonitoredProcess>(m_cacheOutputLines);
-			m_imagePullProc->spawnProcess("docker pull " + m_dockerImage, "root", workDir, {}, nullptr);
-			m_imagePullProc->regKillTimer(pullTimeout, fname);
-			this->attach(m_imagePullProc->getpid());
-			return m_imagePullProc->getpid();
+			auto image = m_dockerImage;
+			m_dockerClient->pullImage(m_dockerImage, pullTimeout, [image](const web::json::value& progress)
+				{
+					LOG_DBG << "DockerProcess::pullImage() " << image << " " << GET_JSON_STR_VALUE(progress, "status") << " " << GET_JSON_STR_VALUE(progress, "progress");
+				});
 		}
 		else
 		{
@@ -102,100 +103,201 @@ int DockerProcess::syncSpawnProcess(std::string cmd, std::string user, std::stri
 		}
 	}
 
-	// 2. build docker start command line
-	dockerCommand = std::string("docker run -d ") + "--name " + containerName;
-	for (auto env : envMap)
+	// 2. create and start docker container
+	auto containerId = m_dockerClient->createContainer(containerName, createContainerConfig(cmd, envMap, limit));
+	if (containerId.empty())
 	{
-		if (env.first == ENV_APP_MANAGER_DOCKER_PARAMS)
+		throw std::invalid_argument(std::string("Create docker container failed for app ").append(m_appName));
+	}
+	{
+		// set container id here for future clean
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		m_containerId = containerId;
+	}
+	m_dockerClient->startContainer(containerId);
+	startLogThread(containerId);
+
+	// 3. get docker root pid
+	auto container = m_dockerClient->inspectContainer(containerId);
+	if (HAS_JSON_FIELD(container, "State"))
+	{
+		pid = GET_JSON_INT_VALUE(container.at("State"), "Pid");
+	}
+	if (pid > 1)
+	{
+		this->attach(pid);
+		LOG_INF << fname << "started pid <" << pid << "> for container :" << containerId;
+		return pid;
+	}
+	this->detach();
+	killgroup();
+	return pid;
+}
+
+web::json::value DockerProcess::createContainerConfig(const std::string& cmd, const std::map<std::string, std::string>& envMap, std::shared_ptr<ResourceLimitation> limit)
+{
+	const static char fname[] = "DockerProcess::createContainerConfig() ";
+
+	web::json::value config = web::json::value::object();
+	web::json::value hostConfig = web::json::value::object();
+	std::vector<web::json::value> envs, binds;
+	std::map<std::string, std::vector<web::json::value>> portBindings;
+
+	config["Image"] = web::json::value::string(m_dockerImage);
+	auto args = splitCommandLine(cmd);
+	if (args.size())
+	{
+		std::vector<web::json::value> cmdArgs;
+		for (const auto& arg : args) cmdArgs.push_back(web::json::value::string(arg));
+		config["Cmd"] = web::json::value::array(cmdArgs);
+	}
+
+	for (const auto& env : envMap)
+	{
+		if (env.first != ENV_APP_MANAGER_DOCKER_PARAMS)
 		{
-			// used for -p -v parameter
-			dockerCommand.append(" ");
-			dockerCommand.append(env.second);
+			envs.push_back(web::json::value::string(env.first + "=" + env.second));
+			continue;
 		}
-		else
+
+		// used for -p -v parameter, translate docker cli options
+		auto opts = splitCommandLine(env.second);
+		for (size_t i = 0; i < opts.size(); i++)
 		{
-			bool containSpace = (env.second.find(' ') != env.second.npos);
-
-			dockerCommand += " -e ";
-			dockerCommand += env.first;
-			dockerCommand += "=";
-			if (containSpace) dockerCommand.append("'");
-			dockerCommand += env.second;
-			if (containSpace) dockerCommand.append("'");
+			auto key = opts[i];
+			std::string value;
+			auto eqPos = key.find('=');
+			if (Utility::startWith(key, "--") && eqPos != std::string::npos)
+			{
+				value = key.substr(eqPos + 1);
+				key = key.substr(0, eqPos);
+			}
+			else if (key != "--privileged" && i + 1 < opts.size())
+			{
+				value = opts[++i];
+			}
+
+			if (key == "-p" || key == "--publish")
+			{
+				// [ip:]hostPort:containerPort[/protocol]
+				auto parts = Utility::splitString(value, ":");
+				if (parts.empty()) continue;
+				auto containerPort = parts.back();
+				if (containerPort.find('/') == std::string::npos) containerPort += "/tcp";
+				web::json::value binding = web::json::value::object();
+				binding["HostIp"] = web::json::value::string(parts.size() > 2 ? parts[0] : "");
+				binding["HostPort"] = web::json::value::string(parts.size() > 1 ? parts[parts.size() - 2] : "");
+				portBindings[containerPort].push_back(binding);
+			}
+			else if (key == "-v" || key == "--volume")
+			{
+				binds.push_back(web::json::value::string(value));
+			}
+			else if (key == "-e" || key == "--env")
+			{
+				envs.push_back(web::json::value::string(value));
+			}
+			else if (key == "--net" || key == "--network")
+			{
+				hostConfig["NetworkMode"] = web::json::value::string(value);
+			}
+			else if (key == "-w" || key == "--workdir")
+			{
+				config["WorkingDir"] = web::json::value::string(value);
+			}
+			else if (key == "-h" || key == "--hostname")
+			{
+				config["Hostname"] = web::json::value::string(value);
+			}
+			else if (key == "-u" || key == "--user")
+			{
+				config["User"] = web::json::value::string(value);
+			}
+			else if (key == "--restart")
+			{
+				web::json::value policy = web::json::value::object();
+				policy["Name"] = web::json::value::string(value);
+				hostConfig["RestartPolicy"] = policy;
+			}
+			else if (key == "--privileged")
+			{
+				hostConfig["Privileged"] = web::json::value::boolean(true);
+			}
+			else
+			{
+				LOG_WAR << fname << "docker option <" << key << "> not supported, ignored";
+			}
 		}
 	}
 	if (limit != nullptr)
 	{
 		if (limit->m_memoryMb)
 		{
-			dockerCommand += " --memory " + std::to_string(limit->m_memoryMb) + "M";
+			hostConfig["Memory"] = web::json::value::number((int64_t)limit->m_memoryMb * 1024 * 1024);
 			if (limit->m_memoryVirtMb && limit->m_memoryVirtMb > limit->m_memoryMb)
 			{
-				dockerCommand += " --memory-swap " + std::to_string(limit->m_memoryVirtMb - limit->m_memoryVirtMb) + "M";
+				hostConfig["MemorySwap"] = web::json::value::number((int64_t)limit->m_memoryVirtMb * 1024 * 1024);
 			}
 		}
 		if (limit->m_cpuShares)
 		{
-			dockerCommand += " --cpu-shares " + std::to_string(limit->m_cpuShares);
+			hostConfig["CpuShares"] = web::json::value::number(limit->m_cpuShares);
 		}
 	}
-	dockerCommand += " " + m_dockerImage;
-	dockerCommand += " " + cmd;
-
-	// 3. start docker container
-	dockerProcess = std::make_shared<MonitoredProcess>(32, false);
-	pid = dockerProcess->spawnProcess(dockerCommand, "", "", {}, nullptr);
-	dockerProcess->regKillTimer(dockerCliTimeoutSec, fname);
-	dockerProcess->runPipeReaderThread();
-	auto dockerRunOut = dockerProcess->fetchOutputMsg();
-	Utility::trimLineBreak(dockerRunOut);
-
-	size_t startPos = 0;
-	std::string containerId;
-	do
-	{
-		containerId = getLine(dockerRunOut, startPos);
-		startPos += containerId.length() + 1;
-	}
-	while (containerId.length() && containerId.find(" ") != containerId.npos);
-	
-	if (containerId.length())
-	{
-		// set container id here for future clean
-		std::lock_guard<std::recursive_mutex> guard(m_mutex);
-		m_containerId = containerId;
-	}
-	else
+	config["Env"] = web::json::value::array(envs);
+	hostConfig["Binds"] = web::json::value::array(binds);
+	web::json::value exposedPorts = web::json::value::object();
+	web::json::value bindings = web::json::value::object();
+	for (const auto& port : portBindings)
 	{
-		throw std::invalid_argument(std::string("Start docker container failed :").append(dockerCommand));
+		exposedPorts[port.first] = web::json::value::object();
+		bindings[port.first] = web::json::value::array(port.second);
 	}
+	hostConfig["PortBindings"] = bindings;
+	config["ExposedPorts"] = exposedPorts;
+	config["HostConfig"] = hostConfig;
+	return config;
+}
 
-	// 4. get docker root pid
-	dockerCommand = "docker inspect -f '{{.State.Pid}}' " + containerId;
-	dockerProcess = std::make_shared<MonitoredProcess>(32, false);
-	pid = dockerProcess->spawnProcess(dockerCommand, "", "", {}, nullptr);
-	dockerProcess->regKillTimer(dockerCliTimeoutSec, fname);
-	dockerProcess->runPipeReaderThread();
-	auto pidStr = dockerProcess->fetchOutputMsg();
-	Utility::trimLineBreak(pidStr);
-	pidStr = getLine(pidStr);
-	if (Utility::isNumber(pidStr))
+std::vector<std::string> DockerProcess::splitCommandLine(const std::string& cmd)
+{
+	std::vector<std::string> args;
+	std::string arg;
+	bool hasArg = false;
+	char quote = 0;
+	for (size_t i = 0; i < cmd.length(); i++)
 	{
-		pid = std::stoi(pidStr);
-		if (pid > 1)
+		char c = cmd[i];
+		if (quote)
 		{
-			this->attach(pid);
-			std::lock_guard<std::recursive_mutex> guard(m_mutex);
-			m_containerId = containerId;
-			LOG_INF << fname << "started pid <" << pid << "> for container :" << m_containerId;
-			return pid;
+			if (c == quote) quote = 0;
+			else if (c == '\\' && quote == '"' && i + 1 < cmd.length()) arg += cmd[++i];
+			else arg += c;
+		}
+		else if (c == '\'' || c == '"')
+		{
+			quote = c;
+			hasArg = true;
+		}
+		else if (c == '\\' && i + 1 < cmd.length())
+		{
+			arg += cmd[++i];
+			hasArg = true;
+		}
+		else if (std::isspace((unsigned char)c))
+		{
+			if (hasArg) args.push_back(arg);
+			arg.clear();
+			hasArg = false;
+		}
+		else
+		{
+			arg += c;
+			hasArg = true;
 		}
 	}
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	m_containerId = containerId;
-	this->detach();
-	killgroup();
-	return pid;
+	if (hasArg) args.push_back(arg);
+	return args;
 }
 
 pid_t DockerProcess::getpid(void) const
@@ -218,6 +320,33 @@ void DockerProcess::containerId(std::string containerId)
 	m_containerId = containerId;
 }
 
+void DockerProcess::attachContainer()
+{
+	const static char fname[] = "DockerProcess::attachContainer() ";
+
+	try
+	{
+		auto container = m_dockerClient->inspectContainer(m_appName);
+		if (container.is_null() || !HAS_JSON_FIELD(container, "State") || !GET_JSON_BOOL_VALUE(container.at("State"), "Running"))
+		{
+			LOG_WAR << fname << "container <" << m_appName << "> is not running";
+			return;
+		}
+		auto containerId = GET_JSON_STR_VALUE(container, "Id");
+		{
+			std::lock_guard<std::recursive_mutex> guard(m_mutex);
+			m_containerId = containerId;
+		}
+		// output before attach was read by previous daemon
+		startLogThread(containerId, std::time(nullptr));
+		LOG_INF << fname << "attached container <" << containerId << "> of application <" << m_appName << ">";
+	}
+	catch (const std::exception& e)
+	{
+		LOG_WAR << fname << "inspect container <" << m_appName << "> failed: " << e.what();
+	}
+}
+
 int DockerProcess::spawnProcess(std::string cmd, std::string user, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit)
 {
 	const static char fname[] = "DockerProcess::spawnProcess() ";
@@ -272,41 +401,87 @@ int DockerProcess::spawnProcess(std::string cmd, std::string user, std::string w
 	return 1;
 }
 
-std::string DockerProcess::getOutputMsg()
+void DockerProcess::startLogThread(const std::string& containerId, int64_t since)
 {
+	const static char fname[] = "DockerProcess::startLogThread() ";
+
 	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	if (m_containerId.length())
-	{
-		std::string dockerCommand = "docker logs --tail " + std::to_string(m_cacheOutputLines) + " " + m_containerId;
-		return Utility::runShellCommand(dockerCommand);
-	}
-	return std::string();
+	if (m_logThread != nullptr) return;
+
+	// this thread is always joined in killgroup() before DockerProcess released
+	m_logThread = std::make_shared<std::thread>(
+		[this, containerId, since]()
+		{
+			const static char fname[] = "DockerProcess::m_logThread() ";
+			LOG_DBG << fname << "Entered";
+
+			std::string pending;
+			std::string responseBody;
+			auto path = std::string("/containers/").append(DockerApiClient::urlEncode(containerId)).append("/logs?follow=1&stdout=1&stderr=1");
+			if (since > 0) path.append("&since=").append(std::to_string(since));
+			try
+			{
+				auto status = m_logClient->request("GET", path, "", responseBody, 0,
+					[this, &pending](const char* data, size_t len)
+					{
+						pending.append(data, len);
+						std::string output;
+						pending.erase(0, DockerApiClient::demuxStream(pending, output));
+						if (output.length())
+						{
+							m_outputBuffer.append(output.data(), output.length());
+							if (m_outputLog != nullptr) m_outputLog->append(output.data(), output.length(), std::time(nullptr));
+						}
+						return true;
+					});
+				if (status != 200)
+				{
+					LOG_WAR << fname << "follow logs for container <" << containerId << "> failed with status <" << status << ">: " << responseBody;
+				}
+			}
+			catch (const std::exception& e)
+			{
+				LOG_WAR << fname << e.what();
+			}
+			LOG_DBG << fname << "Exited";
+		}
+	);
+	LOG_DBG << fname << "follow logs for container <" << containerId << ">";
 }
 
-std::string DockerProcess::fetchOutputMsg()
+void DockerProcess::stopLogThread()
 {
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	if (m_containerId.length())
+	std::shared_ptr<std::thread> logThread;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		logThread = m_logThread;
+		m_logThread = nullptr;
+	}
+	if (logThread != nullptr)
 	{
-		//auto microsecondsUTC = std::chrono::duration_cast<std::chrono::seconds>(m_lastFetchTime.time_since_epoch()).count();
-		auto timeSince = Utility::getRfc3339Time(m_lastFetchTime);
-		std::string dockerCommand = "docker logs --since " + timeSince + " " + m_containerId;
-		auto msg = Utility::runShellCommand(dockerCommand);
-		m_lastFetchTime = std::chrono::system_clock::now();
-		return std::move(msg);
+		m_logClient->cancel();
+		if (logThread->joinable() && logThread->get_id() != std::this_thread::get_id())
+		{
+			logThread->join();
+		}
+		else
+		{
+			logThread->detach();
+		}
 	}
-	return std::string();
 }
 
-std::string DockerProcess::getLine(const std::string& str, size_t startPos)
+std::string DockerProcess::getOutputMsg()
 {
-	assert(startPos <= str.length());
-	char* line = const_cast <char*> (str.c_str()) + startPos;
-	size_t start = 0;
-	while ((*line) != '\r' && (*line) != '\n' && (*line) != '\0')
-	{
-		++line;
-		++start;
-	}
-	return str.substr(startPos, start);
+	return m_outputBuffer.getOutput();
+}
+
+void DockerProcess::searchOutput(OutputSearch& search, uint64_t offset, int64_t since)
+{
+	m_outputBuffer.search(search, offset, since);
+}
+
+std::string DockerProcess::fetchOutputMsg()
+{
+	return m_outputBuffer.fetchOutput();
 }
@@ -6,9 +6,11 @@
 #include <chrono>
 #include <thread>
 #include <ace/Process.h>
+#include <cpprest/json.h>
 #include "AppProcess.h"
-#include "MonitoredProcess.h"
+#include "OutputBuffer.h"
 
+class DockerApiClient;
 //////////////////////////////////////////////////////////////////////////
 // Docker Process Object
 //////////////////////////////////////////////////////////////////////////
@@ -25,21 +27,35 @@ public:
 	virtual pid_t getpid(void) const override;
 	virtual std::string containerId() override;
 	virtual void containerId(std::string containerId) override;
+	// container attached by pid after daemon restart or hot upgrade, find it by name and follow new logs
+	void attachContainer();
 
 	// docker logs
 	virtual std::string getOutputMsg() override;
 	virtual std::string fetchOutputMsg() override;
-	std::string getLine(const std::string& str, size_t startPos = 0);
+	virtual void searchOutput(OutputSearch& search, uint64_t offset, int64_t since) override;
+
+private:
+	// translate app definition to Docker Engine API container create body
+	web::json::value createContainerConfig(const std::string& cmd, const std::map<std::string, std::string>& envMap, std::shared_ptr<ResourceLimitation> limit);
+	// split command line to arguments like shell, support quotes
+	static std::vector<std::string> splitCommandLine(const std::string& cmd);
+	// follow container log stream and cache to output buffer, since is unix time, 0 for all logs
+	void startLogThread(const std::string& containerId, int64_t since = 0);
+	void stopLogThread();
 
 private:
 	std::string m_dockerImage;
 	std::string m_containerId;
 	std::string m_appName;
 	std::shared_ptr<std::thread> m_spawnThread;
-	std::shared_ptr<MonitoredProcess> m_imagePullProc;
+	std::shared_ptr<DockerApiClient> m_dockerClient;
 	std::recursive_mutex m_mutex;
 
-	std::chrono::system_clock::time_point m_lastFetchTime;
+	// container stdout/stderr followed from docker
+	std::shared_ptr<DockerApiClient> m_logClient;
+	std::shared_ptr<std::thread> m_logThread;
+	OutputBuffer m_outputBuffer;
 };
 
 #endif
\ No newline at end of file
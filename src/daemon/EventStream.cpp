@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "EventStream.h"
+#include "../common/Utility.h"
+
+EventStream::EventStream()
+	:m_clients(0)
+{
+	// start sequence from current time, so sequence from a previous daemon process is detected as lost
+	m_sequence = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+EventStream::~EventStream()
+{
+}
+
+std::unique_ptr<EventStream>& EventStream::instance()
+{
+	static auto singleton = std::make_unique<EventStream>();
+	return singleton;
+}
+
+uint64_t EventStream::publish(const std::string& type, const std::string& appName, web::json::value fields)
+{
+	const static char fname[] = "EventStream::publish() ";
+
+	uint64_t seq = 0;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		seq = ++m_sequence;
+		fields[JSON_KEY_EVENT_seq] = web::json::value::number(seq);
+		fields[JSON_KEY_EVENT_type] = web::json::value::string(type);
+		fields[JSON_KEY_EVENT_app] = web::json::value::string(appName);
+		fields[JSON_KEY_EVENT_time] = web::json::value::number(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+		// serialize once here, all clients share the same line
+		m_events.push_back(std::make_pair(seq, GET_STD_STRING(fields.serialize()).append("\n")));
+		while (m_events.size() > DEFAULT_EVENT_RING_SIZE) m_events.pop_front();
+	}
+	m_cond.notify_all();
+	LOG_DBG << fname << "<" << seq << "> " << type << " " << appName;
+	return seq;
+}
+
+std::string EventStream::wait(uint64_t& since, const std::chrono::system_clock::time_point& deadline, bool& lost)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cond.wait_until(lock, deadline, [this, since]() { return m_sequence > since; });
+
+	lost = false;
+	std::string lines;
+	if (m_sequence <= since) return lines;
+
+	// ring is ordered by sequence, find first event after since
+	auto it = std::upper_bound(m_events.begin(), m_events.end(), since,
+		[](uint64_t seq, const std::pair<uint64_t, std::string>& event) { return seq < event.first; });
+	// since 0 means replay all events in ring
+	if (since && (it == m_events.end() || it->first > since + 1)) lost = true;
+	for (; it != m_events.end(); ++it)
+	{
+		lines.append(it->second);
+	}
+	since = m_sequence;
+	return lines;
+}
+
+uint64_t EventStream::lastSequence()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_sequence;
+}
+
+bool EventStream::addClient()
+{
+	if (++m_clients > MAX_EVENT_STREAM_CLIENTS)
+	{
+		--m_clients;
+		return false;
+	}
+	return true;
+}
+
+void EventStream::removeClient()
+{
+	--m_clients;
+}
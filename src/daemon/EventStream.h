@@ -0,0 +1,43 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <condition_variable>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Application lifecycle events kept in an in-memory ring, each event has
+// a sequence number so a client can resume after reconnect.
+//////////////////////////////////////////////////////////////////////////
+class EventStream
+{
+public:
+	EventStream();
+	virtual ~EventStream();
+	static std::unique_ptr<EventStream>& instance();
+
+	// publish one event, fields are extra attributes of the event, return sequence number
+	uint64_t publish(const std::string& type, const std::string& appName, web::json::value fields = web::json::value::object());
+	// wait until there are events after <since> or deadline reached, return events as NDJSON lines
+	// and update since to the last returned sequence; lost is true when events after since were dropped,
+	// since 0 means all events in ring
+	std::string wait(uint64_t& since, const std::chrono::system_clock::time_point& deadline, bool& lost);
+	uint64_t lastSequence();
+
+	// limit concurrent stream clients
+	bool addClient();
+	void removeClient();
+
+private:
+	std::deque<std::pair<uint64_t, std::string>> m_events;
+	uint64_t m_sequence;
+	std::atomic<int> m_clients;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+};
+
+#endif
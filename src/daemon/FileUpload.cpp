@@ -0,0 +1,265 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <ace/OS.h>
+#include "FileUpload.h"
+#include "../common/Utility.h"
+#include "../common/os/linux.hpp"
+#include "../common/os/chown.hpp"
+
+UploadSession::UploadSession(const std::string& id, const std::string& targetFile, uint64_t fileSize, size_t chunkSize)
+	:m_id(id), m_targetFile(targetFile), m_tempFile(targetFile + "." + id + ".part"),
+	m_fileSize(fileSize), m_chunkSize(chunkSize), m_receivedChunks(0), m_fd(-1)
+{
+	m_chunks.resize((fileSize + chunkSize - 1) / chunkSize, false);
+	m_lastActive = std::chrono::system_clock::now();
+}
+
+UploadSession::~UploadSession()
+{
+	abort();
+}
+
+void UploadSession::open()
+{
+	const static char fname[] = "UploadSession::open() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_fd = ::open(m_tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (m_fd < 0)
+	{
+		LOG_ERR << fname << "Failed to create <" << m_tempFile << "> with error: " << std::strerror(errno);
+		throw std::invalid_argument(std::string("Failed to create file in server: ") + std::strerror(errno));
+	}
+	// reserve whole file size, so chunks can be written in any order
+	if (::ftruncate(m_fd, m_fileSize) != 0)
+	{
+		LOG_ERR << fname << "Failed to resize <" << m_tempFile << "> with error: " << std::strerror(errno);
+		closeFile();
+		ACE_OS::unlink(m_tempFile.c_str());
+		throw std::invalid_argument(std::string("Failed to allocate file in server: ") + std::strerror(errno));
+	}
+	LOG_DBG << fname << "session <" << m_id << "> file <" << m_targetFile << "> size <" << m_fileSize << "> chunks <" << m_chunks.size() << ">";
+}
+
+void UploadSession::writeChunk(uint64_t offset, const std::vector<unsigned char>& data)
+{
+	const static char fname[] = "UploadSession::writeChunk() ";
+
+	if (offset % m_chunkSize != 0 || offset >= m_fileSize)
+	{
+		throw std::invalid_argument("invalid chunk offset");
+	}
+	auto index = offset / m_chunkSize;
+	auto expectSize = std::min<uint64_t>(m_chunkSize, m_fileSize - offset);
+	if (data.size() != expectSize)
+	{
+		throw std::invalid_argument(std::string("chunk size should be ") + std::to_string(expectSize));
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_fd < 0)
+	{
+		throw std::invalid_argument("upload session already closed");
+	}
+	size_t written = 0;
+	while (written < data.size())
+	{
+		auto rt = ::pwrite(m_fd, data.data() + written, data.size() - written, offset + written);
+		if (rt < 0)
+		{
+			if (errno == EINTR) continue;
+			LOG_ERR << fname << "Failed to write <" << m_tempFile << "> with error: " << std::strerror(errno);
+			throw std::invalid_argument(std::string("Failed to write file in server: ") + std::strerror(errno));
+		}
+		written += rt;
+	}
+	if (!m_chunks[index])
+	{
+		m_chunks[index] = true;
+		m_receivedChunks++;
+	}
+	m_lastActive = std::chrono::system_clock::now();
+}
+
+void UploadSession::commit(const std::string& sha256, const std::string& fileMode, const std::string& fileUser)
+{
+	const static char fname[] = "UploadSession::commit() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_fd < 0)
+	{
+		throw std::invalid_argument("upload session already closed");
+	}
+	if (m_receivedChunks != m_chunks.size())
+	{
+		throw std::invalid_argument(std::string("upload not finished, missing ") + std::to_string(m_chunks.size() - m_receivedChunks) + " chunks");
+	}
+	::fsync(m_fd);
+	closeFile();
+
+	// temp file is removed when anything below fails, session is closed and can not be committed again
+	try
+	{
+		if (sha256.length())
+		{
+			auto serverHash = Utility::hashFile(m_tempFile);
+			if (serverHash != Utility::stdStringTrim(sha256))
+			{
+				LOG_WAR << fname << "session <" << m_id << "> checksum mismatch, expect <" << sha256 << "> got <" << serverHash << ">";
+				throw std::invalid_argument("file checksum mismatch");
+			}
+		}
+		if (fileMode.length()) os::fileChmod(m_tempFile, std::stoi(fileMode));
+		if (fileUser.length()) os::chown(m_tempFile, fileUser);
+
+		if (ACE_OS::rename(m_tempFile.c_str(), m_targetFile.c_str()) != 0)
+		{
+			LOG_ERR << fname << "Failed to rename <" << m_tempFile << "> to <" << m_targetFile << "> with error: " << std::strerror(errno);
+			throw std::invalid_argument(std::string("Failed to save file in server: ") + std::strerror(errno));
+		}
+	}
+	catch (...)
+	{
+		ACE_OS::unlink(m_tempFile.c_str());
+		throw;
+	}
+	LOG_INF << fname << "file <" << m_targetFile << "> uploaded with size <" << m_fileSize << ">";
+}
+
+void UploadSession::abort()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_fd >= 0)
+	{
+		closeFile();
+		ACE_OS::unlink(m_tempFile.c_str());
+	}
+}
+
+bool UploadSession::isExpired(int idleSeconds)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_lastActive + std::chrono::seconds(idleSeconds) < std::chrono::system_clock::now();
+}
+
+bool UploadSession::isClosed()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_fd < 0;
+}
+
+web::json::value UploadSession::AsJson()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	web::json::value result = web::json::value::object();
+	result[JSON_KEY_UPLOAD_session_id] = web::json::value::string(m_id);
+	result[JSON_KEY_UPLOAD_file_path] = web::json::value::string(m_targetFile);
+	result[JSON_KEY_UPLOAD_file_size] = web::json::value::number(m_fileSize);
+	result[JSON_KEY_UPLOAD_chunk_size] = web::json::value::number((uint64_t)m_chunkSize);
+	result[JSON_KEY_UPLOAD_chunk_count] = web::json::value::number((uint64_t)m_chunks.size());
+	result[JSON_KEY_UPLOAD_received_chunks] = web::json::value::number((uint64_t)m_receivedChunks);
+	std::vector<web::json::value> missing;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (!m_chunks[i]) missing.push_back(web::json::value::number((uint64_t)i));
+	}
+	result[JSON_KEY_UPLOAD_missing_chunks] = web::json::value::array(missing);
+	return result;
+}
+
+void UploadSession::closeFile()
+{
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+		m_fd = -1;
+	}
+}
+
+UploadManager::UploadManager()
+{
+}
+
+UploadManager::~UploadManager()
+{
+}
+
+std::unique_ptr<UploadManager>& UploadManager::instance()
+{
+	static auto singleton = std::make_unique<UploadManager>();
+	return singleton;
+}
+
+std::shared_ptr<UploadSession> UploadManager::createSession(const std::string& targetFile, uint64_t fileSize, size_t chunkSize, bool overwrite)
+{
+	const static char fname[] = "UploadManager::createSession() ";
+
+	cleanExpiredSession();
+
+	if (chunkSize == 0 || chunkSize > MAX_UPLOAD_CHUNK_SIZE)
+	{
+		throw std::invalid_argument(std::string("chunk size should be between 1 and ") + std::to_string(MAX_UPLOAD_CHUNK_SIZE));
+	}
+	if (!overwrite && Utility::isFileExist(targetFile))
+	{
+		throw std::invalid_argument("file already exist");
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (const auto& session : m_sessions)
+	{
+		if (session.second->getTargetFile() == targetFile)
+		{
+			throw std::invalid_argument(std::string("file is uploading by session ") + session.first);
+		}
+	}
+	auto session = std::make_shared<UploadSession>(Utility::createUUID(), targetFile, fileSize, chunkSize);
+	session->open();
+	m_sessions[session->getId()] = session;
+	LOG_DBG << fname << "session <" << session->getId() << "> created, active sessions: " << m_sessions.size();
+	return session;
+}
+
+std::shared_ptr<UploadSession> UploadManager::getSession(const std::string& id)
+{
+	cleanExpiredSession();
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+	{
+		throw std::invalid_argument(std::string("No such upload session: ") + id);
+	}
+	return it->second;
+}
+
+void UploadManager::removeSession(const std::string& id)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto it = m_sessions.find(id);
+	if (it != m_sessions.end())
+	{
+		it->second->abort();
+		m_sessions.erase(it);
+	}
+}
+
+void UploadManager::cleanExpiredSession()
+{
+	const static char fname[] = "UploadManager::cleanExpiredSession() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (auto it = m_sessions.begin(); it != m_sessions.end();)
+	{
+		if (it->second->isExpired(DEFAULT_UPLOAD_SESSION_IDLE_SECONDS))
+		{
+			LOG_WAR << fname << "upload session <" << it->first << "> for file <" << it->second->getTargetFile() << "> expired";
+			it->second->abort();
+			it = m_sessions.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
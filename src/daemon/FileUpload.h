@@ -0,0 +1,73 @@
+#ifndef FILE_UPLOAD_H
+#define FILE_UPLOAD_H
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Resumable upload session, chunks are written at their offset into a
+// temp file beside the target, commit verify checksum and rename it.
+//////////////////////////////////////////////////////////////////////////
+class UploadSession
+{
+public:
+	UploadSession(const std::string& id, const std::string& targetFile, uint64_t fileSize, size_t chunkSize);
+	virtual ~UploadSession();
+
+	void open();
+	void writeChunk(uint64_t offset, const std::vector<unsigned char>& data);
+	void commit(const std::string& sha256, const std::string& fileMode, const std::string& fileUser);
+	void abort();
+
+	const std::string& getId() const { return m_id; }
+	const std::string& getTargetFile() const { return m_targetFile; }
+	bool isExpired(int idleSeconds);
+	bool isClosed();
+
+	web::json::value AsJson();
+
+private:
+	void closeFile();
+
+private:
+	const std::string m_id;
+	const std::string m_targetFile;
+	const std::string m_tempFile;
+	const uint64_t m_fileSize;
+	const size_t m_chunkSize;
+	// received flag of each chunk
+	std::vector<bool> m_chunks;
+	size_t m_receivedChunks;
+	int m_fd;
+	std::chrono::system_clock::time_point m_lastActive;
+	std::recursive_mutex m_mutex;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Keep all active upload sessions
+//////////////////////////////////////////////////////////////////////////
+class UploadManager
+{
+public:
+	UploadManager();
+	virtual ~UploadManager();
+	static std::unique_ptr<UploadManager>& instance();
+
+	std::shared_ptr<UploadSession> createSession(const std::string& targetFile, uint64_t fileSize, size_t chunkSize, bool overwrite);
+	std::shared_ptr<UploadSession> getSession(const std::string& id);
+	void removeSession(const std::string& id);
+
+private:
+	// remove sessions idle longer than DEFAULT_UPLOAD_SESSION_IDLE_SECONDS
+	void cleanExpiredSession();
+
+private:
+	std::map<std::string, std::shared_ptr<UploadSession>> m_sessions;
+	std::recursive_mutex m_mutex;
+};
+
+#endif
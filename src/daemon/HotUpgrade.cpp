@@ -0,0 +1,233 @@
+#include <set>
+#include <map>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "HotUpgrade.h"
+#include "Application.h"
+#include "Configuration.h"
+#include "JobTable.h"
+#include "OutputStore.h"
+#include "../common/Utility.h"
+#include "../common/os/linux.hpp"
+
+HotUpgrade::HotUpgrade()
+	:m_requested(false)
+{
+}
+
+HotUpgrade::~HotUpgrade()
+{
+}
+
+std::unique_ptr<HotUpgrade>& HotUpgrade::instance()
+{
+	static auto singleton = std::make_unique<HotUpgrade>();
+	return singleton;
+}
+
+void HotUpgrade::setArguments(int argc, char* argv[])
+{
+	m_arguments.assign(argv, argv + argc);
+}
+
+void HotUpgrade::request()
+{
+	const static char fname[] = "HotUpgrade::request() ";
+
+	auto path = getBinaryPath();
+	if (::access(path.c_str(), X_OK) != 0)
+	{
+		throw std::invalid_argument(std::string("binary <") + path + "> is not executable");
+	}
+	// remote run session is bound to its http connection
+	if (JobTable::instance()->size())
+	{
+		throw std::invalid_argument(std::string("remote run jobs <") + std::to_string(JobTable::instance()->size()) + "> are in progress");
+	}
+	m_requested = true;
+	LOG_INF << fname << "re-exec <" << path << "> scheduled";
+}
+
+void HotUpgrade::reexec()
+{
+	const static char fname[] = "HotUpgrade::reexec() ";
+
+	m_requested = false;
+	auto path = getBinaryPath();
+	std::vector<std::shared_ptr<Application>> frozen;
+	std::vector<web::json::value> states;
+	std::vector<int> fds;
+	bool aborted = false;
+	if (JobTable::instance()->size())
+	{
+		LOG_ERR << fname << "remote run started, re-exec aborted";
+		aborted = true;
+	}
+	else
+	{
+		for (const auto& app : Configuration::instance()->getApps())
+		{
+			// application is locked until exec, no process will be started
+			states.push_back(app->freezeRuntime(fds));
+			frozen.push_back(app);
+		}
+	}
+
+	web::json::value state = web::json::value::object();
+	state[JSON_KEY_REEXEC_version] = web::json::value::number(REEXEC_STATE_VERSION);
+	state[JSON_KEY_REEXEC_applications] = web::json::value::array(states);
+	int stateFd = aborted ? -1 : writeState(GET_STD_STRING(state.serialize()));
+	if (stateFd >= 0)
+	{
+		// only state and pipes are inherited, listen sockets and other handles are closed by exec
+		fds.push_back(stateFd);
+		// output tail in memory is lost by exec
+		OutputStore::instance()->flush(std::time(nullptr));
+		std::map<int, int> flags;
+		for (const auto& name : os::ls("/proc/self/fd"))
+		{
+			int fd = std::atoi(name.c_str());
+			int flag = ::fcntl(fd, F_GETFD);
+			if (fd <= STDERR_FILENO || flag < 0) continue;
+			flags[fd] = flag;
+			bool inherit = std::find(fds.begin(), fds.end(), fd) != fds.end();
+			::fcntl(fd, F_SETFD, inherit ? (flag & ~FD_CLOEXEC) : (flag | FD_CLOEXEC));
+		}
+
+		std::vector<char*> argv;
+		for (auto& arg : m_arguments) argv.push_back(&arg[0]);
+		argv.push_back(nullptr);
+		// state handle first, pipes are closed by new binary when not restored
+		std::string handles = std::to_string(stateFd);
+		for (auto fd : fds) if (fd != stateFd) handles.append(",").append(std::to_string(fd));
+		::setenv(ENV_APP_MANAGER_REEXEC_FDS, handles.c_str(), 1);
+		LOG_INF << fname << "exec <" << path << "> with <" << frozen.size() << "> applications and <" << fds.size() - 1 << "> pipes";
+		::execv(path.c_str(), argv.data());
+
+		// continue with current binary
+		LOG_ERR << fname << "exec <" << path << "> failed with error: " << std::strerror(errno);
+		::unsetenv(ENV_APP_MANAGER_REEXEC_FDS);
+		for (const auto& flag : flags) ::fcntl(flag.first, F_SETFD, flag.second);
+		::close(stateFd);
+	}
+	for (auto& app : frozen)
+	{
+		app->unfreezeRuntime();
+	}
+}
+
+bool HotUpgrade::restore()
+{
+	const static char fname[] = "HotUpgrade::restore() ";
+
+	auto env = ::getenv(ENV_APP_MANAGER_REEXEC_FDS);
+	if (env == nullptr) return false;
+	auto handles = Utility::splitString(env, ",");
+	// should not be passed to applications
+	::unsetenv(ENV_APP_MANAGER_REEXEC_FDS);
+	if (handles.empty()) return false;
+	int stateFd = std::atoi(handles.front().c_str());
+	std::set<int> pipes;
+	for (size_t i = 1; i < handles.size(); i++) pipes.insert(std::atoi(handles[i].c_str()));
+
+	bool result = false;
+	try
+	{
+		std::string content;
+		char buffer[64 * 1024];
+		ssize_t size = 0;
+		::lseek(stateFd, 0, SEEK_SET);
+		while ((size = ::read(stateFd, buffer, sizeof(buffer))) > 0) content.append(buffer, size);
+
+		auto state = web::json::value::parse(GET_STRING_T(content));
+		if (GET_JSON_INT_VALUE(state, JSON_KEY_REEXEC_version) != REEXEC_STATE_VERSION)
+		{
+			throw std::invalid_argument("unsupported state version");
+		}
+		size_t restored = 0;
+		for (const auto& appState : state.at(JSON_KEY_REEXEC_applications).as_array())
+		{
+			auto name = GET_JSON_STR_VALUE(appState, JSON_KEY_APP_name);
+			try
+			{
+				Configuration::instance()->getApp(name)->restoreRuntime(appState);
+				restored++;
+				pipes.erase(GET_JSON_INT_VALUE(appState, JSON_KEY_REEXEC_pipe_fd));
+				if (HAS_JSON_FIELD(appState, JSON_KEY_REEXEC_buffer_process))
+				{
+					pipes.erase(GET_JSON_INT_VALUE(appState.at(JSON_KEY_REEXEC_buffer_process), JSON_KEY_REEXEC_pipe_fd));
+				}
+			}
+			catch (const std::exception& ex)
+			{
+				// application removed from configuration file
+				LOG_WAR << fname << "Application <" << name << "> not restored: " << ex.what();
+			}
+		}
+		LOG_INF << fname << "<" << restored << "> applications restored";
+		result = true;
+	}
+	catch (const std::exception& ex)
+	{
+		LOG_ERR << fname << "failed to restore state, attach applications by command line: " << ex.what();
+	}
+	catch (...)
+	{
+		LOG_ERR << fname << "failed to restore state, attach applications by command line";
+	}
+	::close(stateFd);
+	// nobody read the rest pipes, close them so applications get EPIPE instead of blocking on a full pipe
+	for (auto fd : pipes) ::close(fd);
+	return result;
+}
+
+std::string HotUpgrade::getBinaryPath()
+{
+	// readlink of /proc/self/exe ends with " (deleted)" when the binary file was replaced
+	const std::string deleted = " (deleted)";
+	auto path = Utility::getSelfFullPath();
+	if (path.length() > deleted.length() && path.compare(path.length() - deleted.length(), deleted.length(), deleted) == 0)
+	{
+		path.erase(path.length() - deleted.length());
+	}
+	return path;
+}
+
+int HotUpgrade::writeState(const std::string& state)
+{
+	const static char fname[] = "HotUpgrade::writeState() ";
+
+	// memfd is not closed by exec, fall back to an unlinked temp file for kernel before 3.17
+	int fd = -1;
+#ifdef SYS_memfd_create
+	fd = ::syscall(SYS_memfd_create, "appmgr-state", 0);
+#endif
+	if (fd < 0)
+	{
+		char path[] = "/tmp/appmgr-state-XXXXXX";
+		fd = ::mkstemp(path);
+		if (fd >= 0) ::unlink(path);
+	}
+	if (fd < 0)
+	{
+		LOG_ERR << fname << "Failed to create state file with error: " << std::strerror(errno);
+		return -1;
+	}
+	size_t written = 0;
+	while (written < state.length())
+	{
+		auto size = ::write(fd, state.data() + written, state.length() - written);
+		if (size < 0 && errno == EINTR) continue;
+		if (size <= 0)
+		{
+			LOG_ERR << fname << "Failed to write state with error: " << std::strerror(errno);
+			::close(fd);
+			return -1;
+		}
+		written += size;
+	}
+	return fd;
+}
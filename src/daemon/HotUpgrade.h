@@ -0,0 +1,42 @@
+#ifndef HOT_UPGRADE_H
+#define HOT_UPGRADE_H
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+// Replace daemon binary in place: runtime state (pids, return codes, cached output,
+// kill timer deadlines) is written to a memfd, stdout/stderr pipes of applications
+// are inherited, and the new binary is exec-ed with the same pid, so running
+// applications are still children of the daemon.
+//////////////////////////////////////////////////////////////////////////
+class HotUpgrade
+{
+public:
+	HotUpgrade();
+	virtual ~HotUpgrade();
+	// Internal Singleton.
+	static std::unique_ptr<HotUpgrade>& instance();
+
+	// keep command line to exec the new binary
+	void setArguments(int argc, char* argv[]);
+	// check and schedule re-exec, performed by main thread in next schedule cycle
+	void request();
+	bool requested() const { return m_requested; }
+	// serialize runtime state and exec, only return when failed
+	void reexec();
+	// restore runtime state from previous daemon, return false when not started by re-exec or restore failed
+	bool restore();
+
+private:
+	// path of current binary, the file may be replaced after start
+	std::string getBinaryPath();
+	int writeState(const std::string& state);
+
+private:
+	std::vector<std::string> m_arguments;
+	std::atomic<bool> m_requested;
+};
+
+#endif
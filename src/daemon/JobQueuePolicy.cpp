@@ -0,0 +1,68 @@
+#include <stdexcept>
+#include "JobQueuePolicy.h"
+#include "../common/Utility.h"
+
+JobQueuePolicy::JobQueuePolicy()
+	:m_maxRunning(DEFAULT_JOB_MAX_RUNNING), m_userMaxRunning(0), m_maxQueued(DEFAULT_JOB_MAX_QUEUED), m_queueTimeoutSeconds(DEFAULT_JOB_QUEUE_TIMEOUT_SECONDS)
+{
+}
+
+JobQueuePolicy::~JobQueuePolicy()
+{
+}
+
+web::json::value JobQueuePolicy::AsJson() const
+{
+	auto result = web::json::value::object();
+	result[JSON_KEY_JOB_max_running] = web::json::value::number((uint32_t)m_maxRunning);
+	result[JSON_KEY_JOB_user_max_running] = web::json::value::number((uint32_t)m_userMaxRunning);
+	auto labels = web::json::value::object();
+	for (const auto& label : m_labelMaxRunning)
+	{
+		labels[label.first] = web::json::value::number((uint32_t)label.second);
+	}
+	result[JSON_KEY_JOB_label_max_running] = labels;
+	result[JSON_KEY_JOB_max_queued] = web::json::value::number((uint32_t)m_maxQueued);
+	result[JSON_KEY_JOB_queue_timeout_seconds] = web::json::value::number(m_queueTimeoutSeconds);
+	return result;
+}
+
+const std::shared_ptr<JobQueuePolicy> JobQueuePolicy::FromJson(const web::json::value& obj)
+{
+	const static char fname[] = "JobQueuePolicy::FromJson() ";
+
+	auto policy = std::make_shared<JobQueuePolicy>();
+	auto readLimit = [](const web::json::value& json, const std::string& key, size_t& value)
+	{
+		if (!HAS_JSON_FIELD(json, key)) return;
+		auto number = json.at(key).as_integer();
+		if (number < 0) throw std::invalid_argument(std::string("negative job queue limit: ") + key);
+		value = number;
+	};
+	readLimit(obj, JSON_KEY_JOB_max_running, policy->m_maxRunning);
+	readLimit(obj, JSON_KEY_JOB_user_max_running, policy->m_userMaxRunning);
+	readLimit(obj, JSON_KEY_JOB_max_queued, policy->m_maxQueued);
+	if (HAS_JSON_FIELD(obj, JSON_KEY_JOB_label_max_running))
+	{
+		const auto& labels = obj.at(JSON_KEY_JOB_label_max_running);
+		for (const auto& label : labels.as_object())
+		{
+			const auto name = GET_STD_STRING(label.first);
+			readLimit(labels, name, policy->m_labelMaxRunning[name]);
+		}
+	}
+	if (HAS_JSON_FIELD(obj, JSON_KEY_JOB_queue_timeout_seconds))
+	{
+		policy->m_queueTimeoutSeconds = GET_JSON_INT_VALUE(obj, JSON_KEY_JOB_queue_timeout_seconds);
+		if (policy->m_queueTimeoutSeconds <= 0) throw std::invalid_argument("queue_timeout_seconds should be positive");
+	}
+	LOG_INF << fname << "max running: " << policy->m_maxRunning << ", user max running: " << policy->m_userMaxRunning
+		<< ", labels limited: " << policy->m_labelMaxRunning.size() << ", max queued: " << policy->m_maxQueued;
+	return policy;
+}
+
+size_t JobQueuePolicy::getLabelMaxRunning(const std::string& label) const
+{
+	auto it = m_labelMaxRunning.find(label);
+	return (it == m_labelMaxRunning.end()) ? 0 : it->second;
+}
@@ -0,0 +1,37 @@
+#ifndef JOB_QUEUE_POLICY_H
+#define JOB_QUEUE_POLICY_H
+#include <map>
+#include <memory>
+#include <string>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Concurrency limits of remote run jobs: a job leaves the queue only when
+// the global, its user and its label running counts are below the limits;
+// 0 means no limit
+//////////////////////////////////////////////////////////////////////////
+class JobQueuePolicy
+{
+public:
+	JobQueuePolicy();
+	virtual ~JobQueuePolicy();
+
+	virtual web::json::value AsJson() const;
+	static const std::shared_ptr<JobQueuePolicy> FromJson(const web::json::value& obj);
+
+	size_t getMaxRunning() const { return m_maxRunning; }
+	size_t getUserMaxRunning() const { return m_userMaxRunning; }
+	// 0 when label is not limited
+	size_t getLabelMaxRunning(const std::string& label) const;
+	size_t getMaxQueued() const { return m_maxQueued; }
+	int getQueueTimeoutSeconds() const { return m_queueTimeoutSeconds; }
+
+private:
+	size_t m_maxRunning;
+	size_t m_userMaxRunning;
+	std::map<std::string, size_t> m_labelMaxRunning;
+	size_t m_maxQueued;
+	int m_queueTimeoutSeconds;
+};
+
+#endif
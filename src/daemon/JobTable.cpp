@@ -0,0 +1,533 @@
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include "JobTable.h"
+#include "AppProcess.h"
+
+static const char* const PRIORITY_NAMES[JobTable::PRIORITY_COUNT] = { JOB_PRIORITY_high, JOB_PRIORITY_normal, JOB_PRIORITY_low };
+static const char* const STATE_NAMES[] = { "queued", "starting", "running", "done" };
+
+JobTable::JobTable()
+	:m_count(0), m_wheel(JOB_WHEEL_SECONDS), m_wheelTime(now()), m_policy(std::make_shared<JobQueuePolicy>()), m_started(0), m_exit(false)
+{
+	std::fill(m_queued, m_queued + PRIORITY_COUNT, 0);
+}
+
+JobTable::~JobTable()
+{
+}
+
+std::unique_ptr<JobTable>& JobTable::instance()
+{
+	static std::unique_ptr<JobTable> singleton = std::make_unique<JobTable>();
+	return singleton;
+}
+
+int JobTable::svc(void)
+{
+	const static char fname[] = "JobTable::svc() ";
+	LOG_INF << fname << "Entered";
+
+	while (!m_exit)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(JOB_POLL_MILLISECONDS));
+		try
+		{
+			tick(now());
+		}
+		catch (const std::exception& ex)
+		{
+			LOG_WAR << fname << "exception: " << ex.what();
+		}
+		catch (...)
+		{
+			LOG_WAR << fname << "exception";
+		}
+	}
+
+	LOG_WAR << fname << " thread exit";
+	return 0;
+}
+
+int JobTable::open(void* args)
+{
+	return activate(THR_NEW_LWP | THR_JOINABLE | THR_CANCEL_ENABLE | THR_CANCEL_ASYNCHRONOUS, 1);
+}
+
+int JobTable::close(u_long flags)
+{
+	m_exit = true;
+	return ACE_Task_Base::close(flags);
+}
+
+int64_t JobTable::now()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void JobTable::setPolicy(const std::shared_ptr<JobQueuePolicy>& policy)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_policy = policy;
+}
+
+int JobTable::parsePriority(const std::string& priority)
+{
+	if (priority.empty()) return 1;
+	for (int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		if (priority == PRIORITY_NAMES[i]) return i;
+	}
+	throw std::invalid_argument(std::string("unknown job priority: ") + priority);
+}
+
+std::string JobTable::jobName(uint32_t slot, uint32_t generation)
+{
+	return std::string(JOB_NAME_PREFIX) + std::to_string(slot) + "-" + std::to_string(generation);
+}
+
+std::string JobTable::submit(const std::shared_ptr<AppProcess>& process, const JobRequest& request, size_t& queuePosition)
+{
+	const static char fname[] = "JobTable::submit() ";
+
+	std::vector<Launch> launches;
+	std::string name;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		if (request.priority < 0 || request.priority >= PRIORITY_COUNT)
+		{
+			throw std::invalid_argument("invalid job priority");
+		}
+		size_t queued = 0;
+		for (auto count : m_queued) queued += count;
+		if (m_count >= MAX_RUN_JOBS || (m_policy->getMaxQueued() && queued >= m_policy->getMaxQueued()))
+		{
+			throw std::invalid_argument("job queue is full");
+		}
+		if (m_freeSlots.empty())
+		{
+			const uint32_t first = m_slabs.size() * JOB_SLAB_RECORDS;
+			m_slabs.push_back(std::unique_ptr<Job[]>(new Job[JOB_SLAB_RECORDS]()));
+			// lower slot is used first
+			for (uint32_t slot = first + JOB_SLAB_RECORDS; slot > first; slot--) m_freeSlots.push_back(slot - 1);
+			LOG_DBG << fname << "slab <" << m_slabs.size() << "> allocated";
+		}
+		const auto slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		auto& job = record(slot);
+		job.used = true;
+		job.state = QUEUED;
+		job.priority = request.priority;
+		job.timeoutSeconds = request.timeoutSeconds;
+		job.retentionSeconds = request.retentionSeconds;
+		job.submitTime = std::chrono::steady_clock::now();
+		job.user = request.user;
+		job.label = request.label;
+		job.process = process;
+		job.launch = request.launch;
+		job.fail = request.fail;
+		m_count++;
+		m_queues[job.priority].push_back(QueueEntry{ slot, job.generation });
+		m_queued[job.priority]++;
+		schedule(slot, job.generation, now() + m_policy->getQueueTimeoutSeconds(), QUEUE_TIMEOUT);
+
+		name = jobName(slot, job.generation);
+		dispatch(launches);
+		queuePosition = (job.state == QUEUED) ? this->queuePosition(slot, job) : 0;
+	}
+	runLaunches(launches);
+	return name;
+}
+
+JobTable::Job* JobTable::lookup(const std::string& name, uint32_t& slot)
+{
+	const size_t prefix = strlen(JOB_NAME_PREFIX);
+	if (name.compare(0, prefix, JOB_NAME_PREFIX) != 0) return nullptr;
+	const auto dash = name.find('-', prefix);
+	if (dash == std::string::npos || dash == prefix || dash + 1 == name.length()) return nullptr;
+
+	char* end = nullptr;
+	const auto slotValue = std::strtoul(name.c_str() + prefix, &end, 10);
+	if (end != name.c_str() + dash) return nullptr;
+	const auto generation = std::strtoul(name.c_str() + dash + 1, &end, 10);
+	if (*end != '\0') return nullptr;
+	if (slotValue >= m_slabs.size() * JOB_SLAB_RECORDS) return nullptr;
+
+	slot = slotValue;
+	auto& job = record(slot);
+	if (!job.used || job.generation != generation) return nullptr;
+	return &job;
+}
+
+std::shared_ptr<AppProcess> JobTable::find(const std::string& name)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	uint32_t slot = 0;
+	auto job = lookup(name, slot);
+	return job ? job->process : nullptr;
+}
+
+bool JobTable::fetchOutput(const std::string& name, const std::string& processUuid, std::string& output, int& exitCode, bool& finished, size_t& queuePosition)
+{
+	const static char fname[] = "JobTable::fetchOutput() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	uint32_t slot = 0;
+	auto job = lookup(name, slot);
+	if (job == nullptr || job->process == nullptr || job->process->getuuid() != processUuid) return false;
+
+	finished = false;
+	queuePosition = 0;
+	output.clear();
+	if (job->state == QUEUED)
+	{
+		queuePosition = this->queuePosition(slot, *job);
+		return true;
+	}
+	if (job->state == STARTING) return true;
+	if (job->error.length())
+	{
+		output = job->error;
+		exitCode = -1;
+		finished = true;
+		schedule(slot, job->generation, now(), REMOVE);
+		return true;
+	}
+
+	output = job->process->fetchOutputMsg();
+	if (output.length() == 0 && !job->process->running() && job->process->complete())
+	{
+		exitCode = job->process->return_value();
+		finished = true;
+		LOG_DBG << fname << "job <" << name << "> finished with exit code: " << exitCode;
+		// remove job immediately
+		schedule(slot, job->generation, now(), REMOVE);
+	}
+	return true;
+}
+
+void JobTable::release(const std::string& name)
+{
+	const static char fname[] = "JobTable::release() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	uint32_t slot = 0;
+	auto job = lookup(name, slot);
+	if (job != nullptr)
+	{
+		LOG_DBG << fname << name;
+		schedule(slot, job->generation, now(), REMOVE);
+	}
+}
+
+size_t JobTable::size()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_count;
+}
+
+void JobTable::schedule(uint32_t slot, uint32_t generation, int64_t time, WheelAction action)
+{
+	// slot of current second is already fired
+	time = std::max(time, m_wheelTime + 1);
+	m_wheel[time & (JOB_WHEEL_SECONDS - 1)].push_back(WheelEntry{ slot, generation, time, action });
+}
+
+void JobTable::freeSlot(uint32_t slot, std::vector<std::shared_ptr<AppProcess>>& released)
+{
+	auto& job = record(slot);
+	if (job.state == QUEUED) m_queued[job.priority]--;
+	finishJob(slot, job);
+	job.used = false;
+	job.generation++;
+	job.user.clear();
+	job.label.clear();
+	job.error.clear();
+	job.launch = nullptr;
+	job.fail = nullptr;
+	released.push_back(std::move(job.process));
+	job.process = nullptr;
+	m_freeSlots.push_back(slot);
+	m_count--;
+}
+
+bool JobTable::admit(const Job& job) const
+{
+	if (m_policy->getMaxRunning() && m_runningSlots.size() >= m_policy->getMaxRunning()) return false;
+	if (m_policy->getUserMaxRunning())
+	{
+		auto it = m_userRunning.find(job.user);
+		if (it != m_userRunning.end() && it->second >= m_policy->getUserMaxRunning()) return false;
+	}
+	const auto labelMax = job.label.length() ? m_policy->getLabelMaxRunning(job.label) : 0;
+	if (labelMax)
+	{
+		auto it = m_labelRunning.find(job.label);
+		if (it != m_labelRunning.end() && it->second >= labelMax) return false;
+	}
+	return true;
+}
+
+void JobTable::dispatch(std::vector<Launch>& launches)
+{
+	for (int priority = 0; priority < PRIORITY_COUNT; priority++)
+	{
+		auto& queue = m_queues[priority];
+		for (auto it = queue.begin(); it != queue.end();)
+		{
+			if (m_policy->getMaxRunning() && m_runningSlots.size() >= m_policy->getMaxRunning()) return;
+			const auto entry = *it;
+			auto& job = record(entry.slot);
+			if (!job.used || job.generation != entry.generation || job.state != QUEUED)
+			{
+				it = queue.erase(it);
+				continue;
+			}
+			if (!admit(job))
+			{
+				++it;
+				continue;
+			}
+			it = queue.erase(it);
+
+			job.state = STARTING;
+			m_queued[priority]--;
+			m_runningSlots.insert(entry.slot);
+			m_userRunning[job.user]++;
+			if (job.label.length()) m_labelRunning[job.label]++;
+			job.startTime = std::chrono::steady_clock::now();
+			const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(job.startTime - job.submitTime).count() / 1000.0;
+			if (m_waitSeconds.size() < JOB_WAIT_SAMPLES) m_waitSeconds.push_back(wait);
+			else m_waitSeconds[m_started % JOB_WAIT_SAMPLES] = wait;
+			m_started++;
+
+			const auto start = now();
+			schedule(entry.slot, entry.generation, start + job.timeoutSeconds, KILL);
+			schedule(entry.slot, entry.generation, start + job.timeoutSeconds + job.retentionSeconds, REMOVE);
+			launches.push_back(Launch{ entry.slot, entry.generation, jobName(entry.slot, entry.generation), std::move(job.launch), std::move(job.fail) });
+			job.launch = nullptr;
+			job.fail = nullptr;
+		}
+	}
+}
+
+void JobTable::finishJob(uint32_t slot, Job& job)
+{
+	if (job.state == STARTING || job.state == RUNNING)
+	{
+		m_runningSlots.erase(slot);
+		auto user = m_userRunning.find(job.user);
+		if (user != m_userRunning.end() && --(user->second) == 0) m_userRunning.erase(user);
+		auto label = m_labelRunning.find(job.label);
+		if (label != m_labelRunning.end() && --(label->second) == 0) m_labelRunning.erase(label);
+	}
+	job.state = DONE;
+}
+
+void JobTable::runLaunches(std::vector<Launch>& launches)
+{
+	const static char fname[] = "JobTable::runLaunches() ";
+
+	while (launches.size())
+	{
+		bool failed = false;
+		for (auto& launch : launches)
+		{
+			std::string error;
+			try
+			{
+				if (launch.launch) launch.launch(launch.name);
+			}
+			catch (const std::exception& ex)
+			{
+				error = ex.what();
+			}
+			catch (...)
+			{
+				error = "start process failed";
+			}
+
+			{
+				std::lock_guard<std::recursive_mutex> guard(m_mutex);
+				auto& job = record(launch.slot);
+				if (!job.used || job.generation != launch.generation || job.state != STARTING) continue;
+				if (error.empty())
+				{
+					job.state = RUNNING;
+					continue;
+				}
+				LOG_WAR << fname << "job <" << launch.name << "> failed: " << error;
+				finishJob(launch.slot, job);
+				job.error = error;
+				schedule(launch.slot, launch.generation, now() + job.retentionSeconds, REMOVE);
+				failed = true;
+			}
+			if (launch.fail) launch.fail(error);
+		}
+		launches.clear();
+		if (failed)
+		{
+			std::lock_guard<std::recursive_mutex> guard(m_mutex);
+			dispatch(launches);
+		}
+	}
+}
+
+size_t JobTable::queuePosition(uint32_t slot, const Job& job)
+{
+	size_t position = 1;
+	for (int priority = 0; priority < job.priority; priority++) position += m_queued[priority];
+	for (const auto& entry : m_queues[job.priority])
+	{
+		if (entry.slot == slot) break;
+		const auto& other = record(entry.slot);
+		if (other.used && other.generation == entry.generation && other.state == QUEUED) position++;
+	}
+	return position;
+}
+
+double JobTable::percentile(std::vector<double> values, double ratio)
+{
+	if (values.empty()) return 0;
+	auto nth = values.begin() + std::min(values.size() - 1, (size_t)(values.size() * ratio));
+	std::nth_element(values.begin(), nth, values.end());
+	return *nth;
+}
+
+JobTable::Stats JobTable::getStats()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	Stats stats;
+	stats.running = m_runningSlots.size();
+	std::copy(m_queued, m_queued + PRIORITY_COUNT, stats.queued);
+	stats.started = m_started;
+	stats.waitP50 = percentile(m_waitSeconds, 0.5);
+	stats.waitP99 = percentile(m_waitSeconds, 0.99);
+	return stats;
+}
+
+web::json::value JobTable::AsJson()
+{
+	const auto stats = getStats();
+	const auto current = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto result = web::json::value::object();
+	result[JSON_KEY_JOB_running] = web::json::value::number((uint32_t)stats.running);
+	auto queued = web::json::value::object();
+	for (int priority = 0; priority < PRIORITY_COUNT; priority++)
+	{
+		queued[PRIORITY_NAMES[priority]] = web::json::value::number((uint32_t)stats.queued[priority]);
+	}
+	result[JSON_KEY_JOB_queued] = queued;
+	auto wait = web::json::value::object();
+	wait["p50"] = web::json::value::number(stats.waitP50);
+	wait["p99"] = web::json::value::number(stats.waitP99);
+	result[JSON_KEY_JOB_wait_seconds] = wait;
+	result[JSON_KEY_JobQueue] = m_policy->AsJson();
+
+	auto jobs = web::json::value::array(m_count);
+	size_t index = 0;
+	for (uint32_t slot = 0; slot < m_slabs.size() * JOB_SLAB_RECORDS && index < m_count; slot++)
+	{
+		const auto& job = record(slot);
+		if (!job.used) continue;
+		auto json = web::json::value::object();
+		json[JSON_KEY_APP_name] = web::json::value::string(jobName(slot, job.generation));
+		json[JSON_KEY_APP_user] = web::json::value::string(job.user);
+		if (job.label.length()) json[JSON_KEY_JOB_label] = web::json::value::string(job.label);
+		json[JSON_KEY_JOB_priority] = web::json::value::string(PRIORITY_NAMES[job.priority]);
+		json[JSON_KEY_JOB_state] = web::json::value::string(STATE_NAMES[job.state]);
+		if (job.state == QUEUED)
+		{
+			json[JSON_KEY_JOB_queue_position] = web::json::value::number((uint32_t)queuePosition(slot, job));
+			json[JSON_KEY_JOB_wait_seconds] = web::json::value::number(std::chrono::duration_cast<std::chrono::seconds>(current - job.submitTime).count());
+		}
+		else
+		{
+			json[JSON_KEY_JOB_wait_seconds] = web::json::value::number(std::chrono::duration_cast<std::chrono::seconds>(job.startTime - job.submitTime).count());
+		}
+		jobs[index++] = json;
+	}
+	result[JSON_KEY_JOB_jobs] = jobs;
+	return result;
+}
+
+void JobTable::tick(int64_t now)
+{
+	const static char fname[] = "JobTable::tick() ";
+
+	// process kill, release and spawn wait for the process, not done with table locked
+	std::vector<std::shared_ptr<AppProcess>> timeout;
+	std::vector<std::shared_ptr<AppProcess>> released;
+	std::vector<std::function<void(const std::string&)>> queueTimeout;
+	std::vector<Launch> launches;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		// every slot is visited once at most, entry of a later round stays in slot
+		for (int64_t time = m_wheelTime + 1, visited = 0; time <= now && visited < JOB_WHEEL_SECONDS; time++, visited++)
+		{
+			auto& entries = m_wheel[time & (JOB_WHEEL_SECONDS - 1)];
+			for (size_t i = 0; i < entries.size();)
+			{
+				const auto entry = entries[i];
+				if (entry.time > now)
+				{
+					i++;
+					continue;
+				}
+				entries[i] = entries.back();
+				entries.pop_back();
+
+				auto& job = record(entry.slot);
+				if (!job.used || job.generation != entry.generation) continue;
+				if (entry.action == REMOVE)
+				{
+					freeSlot(entry.slot, released);
+				}
+				else if (entry.action == KILL)
+				{
+					if (job.state == RUNNING && job.process != nullptr) timeout.push_back(job.process);
+				}
+				else if (job.state == QUEUED)
+				{
+					m_queued[job.priority]--;
+					job.state = DONE;
+					job.error = "job queue timeout";
+					if (job.fail) queueTimeout.push_back(std::move(job.fail));
+					job.fail = nullptr;
+					job.launch = nullptr;
+					schedule(entry.slot, entry.generation, now + job.retentionSeconds, REMOVE);
+				}
+			}
+		}
+		m_wheelTime = std::max(m_wheelTime, now);
+
+		// exited jobs leave room for queued jobs
+		for (auto it = m_runningSlots.begin(); it != m_runningSlots.end();)
+		{
+			auto& job = record(*it);
+			auto slot = *it++;
+			if (job.state == RUNNING && (job.process == nullptr || !job.process->running())) finishJob(slot, job);
+		}
+		dispatch(launches);
+	}
+
+	for (auto& process : timeout)
+	{
+		if (process->running())
+		{
+			LOG_INF << fname << "process <" << process->getpid() << "> timeout";
+			process->killgroup();
+		}
+	}
+	for (auto& fail : queueTimeout) fail("job queue timeout");
+	runLaunches(launches);
+	if (released.size())
+	{
+		LOG_DBG << fname << released.size() << " jobs released, " << size() << " left";
+	}
+	// running process is killed by AppProcess destructor when released
+}
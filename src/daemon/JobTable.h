@@ -0,0 +1,181 @@
+#ifndef JOB_TABLE_H
+#define JOB_TABLE_H
+#include <map>
+#include <set>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <ace/Task.h>
+#include <cpprest/json.h>
+#include "JobQueuePolicy.h"
+#include "../common/Utility.h"
+
+class AppProcess;
+
+//////////////////////////////////////////////////////////////////////////
+// Remote run (/app/run, /app/syncrun) jobs, kept apart from configured
+// applications so registry, scheduler and health check never see them.
+// Records are allocated in slabs and reused through a free list, job name
+// carries slot and generation for O(1) lookup; timeout kill and expiry are
+// driven by a one-second wheel instead of one reactor timer per job.
+// Jobs wait in one FIFO for each priority class until JobQueuePolicy
+// allows them to start, a job blocked by its user or label limit does not
+// block the jobs behind it.
+//////////////////////////////////////////////////////////////////////////
+class JobTable : public ACE_Task_Base
+{
+public:
+	static const int PRIORITY_COUNT = 3;
+	enum JobState
+	{
+		QUEUED,
+		STARTING,	// left queue, process is being spawned
+		RUNNING,
+		DONE
+	};
+	struct JobRequest
+	{
+		std::string user;
+		std::string label;
+		int priority;		// index of JOB_PRIORITY_high, JOB_PRIORITY_normal, JOB_PRIORITY_low
+		int timeoutSeconds;
+		int retentionSeconds;
+		// spawn process of job name, throw when failed
+		std::function<void(const std::string&)> launch;
+		// job ended without process: launch failed or queue timeout, optional
+		std::function<void(const std::string&)> fail;
+	};
+	struct Stats
+	{
+		size_t running;
+		size_t queued[PRIORITY_COUNT];
+		uint64_t started;
+		// queue wait of latest JOB_WAIT_SAMPLES started jobs
+		double waitP50;
+		double waitP99;
+	};
+
+	JobTable();
+	virtual ~JobTable();
+	static std::unique_ptr<JobTable>& instance();
+
+	virtual int svc(void) override;
+	virtual int open(void* args = 0) override;
+	virtual int close(u_long flags = 0) override;
+
+	void setPolicy(const std::shared_ptr<JobQueuePolicy>& policy);
+	// priority class name to index, empty is normal, throw std::invalid_argument for unknown
+	static int parsePriority(const std::string& priority);
+
+	// queue job of <process>, it is started at once when policy allows; process group is
+	// killed <timeoutSeconds> after start and job is removed <retentionSeconds> later.
+	// return job name and queue position (0 when started), throw std::invalid_argument when queue is full
+	std::string submit(const std::shared_ptr<AppProcess>& process, const JobRequest& request, size_t& queuePosition);
+	// nullptr when job is not found or expired
+	std::shared_ptr<AppProcess> find(const std::string& name);
+	// return false when job or process uuid is not found, otherwise output since last fetch
+	// (queuePosition is not 0 when waiting), job is released when finished and all output fetched
+	bool fetchOutput(const std::string& name, const std::string& processUuid, std::string& output, int& exitCode, bool& finished, size_t& queuePosition);
+	// remove job on next tick, process is killed if still running
+	void release(const std::string& name);
+	// jobs not removed yet
+	size_t size();
+	Stats getStats();
+	// counts, wait time and every job with state and queue position
+	web::json::value AsJson();
+	// fire wheel slots until <now> (seconds of steady clock), reap exited jobs and start queued jobs
+	void tick(int64_t now);
+	static int64_t now();
+
+private:
+	struct Job
+	{
+		uint32_t generation;	// changed when slot is freed, stale name is not found
+		bool used;
+		JobState state;
+		int priority;
+		int timeoutSeconds;
+		int retentionSeconds;
+		std::chrono::steady_clock::time_point submitTime;
+		std::chrono::steady_clock::time_point startTime;
+		std::string user;
+		std::string label;
+		// reason when ended without process
+		std::string error;
+		std::shared_ptr<AppProcess> process;
+		std::function<void(const std::string&)> launch;
+		std::function<void(const std::string&)> fail;
+	};
+	enum WheelAction
+	{
+		KILL,
+		REMOVE,
+		QUEUE_TIMEOUT
+	};
+	struct WheelEntry
+	{
+		uint32_t slot;
+		uint32_t generation;
+		int64_t time;
+		WheelAction action;
+	};
+	struct QueueEntry
+	{
+		uint32_t slot;
+		uint32_t generation;
+	};
+	struct Launch
+	{
+		uint32_t slot;
+		uint32_t generation;
+		std::string name;
+		std::function<void(const std::string&)> launch;
+		std::function<void(const std::string&)> fail;
+	};
+	Job& record(uint32_t slot) { return m_slabs[slot / JOB_SLAB_RECORDS][slot % JOB_SLAB_RECORDS]; }
+	static std::string jobName(uint32_t slot, uint32_t generation);
+	// parse job-<slot>-<generation>, nullptr when not found
+	Job* lookup(const std::string& name, uint32_t& slot);
+	void schedule(uint32_t slot, uint32_t generation, int64_t time, WheelAction action);
+	void freeSlot(uint32_t slot, std::vector<std::shared_ptr<AppProcess>>& released);
+	// policy allows job to start
+	bool admit(const Job& job) const;
+	// move queued jobs allowed by policy to STARTING, highest priority first
+	void dispatch(std::vector<Launch>& launches);
+	// release running counts of a STARTING or RUNNING job
+	void finishJob(uint32_t slot, Job& job);
+	// spawn processes without table locked, start more jobs when spawn failed
+	void runLaunches(std::vector<Launch>& launches);
+	// 1 for the first job to start
+	size_t queuePosition(uint32_t slot, const Job& job);
+	static double percentile(std::vector<double> values, double ratio);
+
+private:
+	// slab is never freed, record address is stable
+	std::vector<std::unique_ptr<Job[]>> m_slabs;
+	std::vector<uint32_t> m_freeSlots;
+	size_t m_count;
+	std::vector<std::vector<WheelEntry>> m_wheel;
+	int64_t m_wheelTime;
+
+	std::shared_ptr<JobQueuePolicy> m_policy;
+	// entry of removed job is dropped when visited
+	std::list<QueueEntry> m_queues[PRIORITY_COUNT];
+	size_t m_queued[PRIORITY_COUNT];
+	// STARTING and RUNNING jobs
+	std::set<uint32_t> m_runningSlots;
+	std::map<std::string, size_t> m_userRunning;
+	std::map<std::string, size_t> m_labelRunning;
+	std::vector<double> m_waitSeconds;
+	uint64_t m_started;
+
+	std::recursive_mutex m_mutex;
+	bool m_exit;
+};
+
+#endif
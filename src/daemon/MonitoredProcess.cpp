@@ -1,10 +1,14 @@
+#include <cstring>
 #include <thread>
+#include <memory>
+#include <poll.h>
 #include "MonitoredProcess.h"
+#include "OutputStore.h"
 #include "../common/Utility.h"
 #include "../common/HttpRequest.h"
 
 MonitoredProcess::MonitoredProcess(int cacheOutputLines, bool enableBuildinThread)
-	:AppProcess(cacheOutputLines), m_readPipeFile(0), m_httpRequest(NULL), m_buildinThreadFinished(false), m_enableBuildinThread(enableBuildinThread)
+	:AppProcess(cacheOutputLines), m_outputBuffer(cacheOutputLines), m_httpRequest(NULL), m_buildinThreadFinished(false), m_enableBuildinThread(enableBuildinThread)
 {
 }
 
@@ -14,7 +18,6 @@ MonitoredProcess::~MonitoredProcess()
 
 	// clean pipe handlers and file
 	if (m_pipe != nullptr) m_pipe->close();
-	if (m_readPipeFile != nullptr) ACE_OS::fclose(m_readPipeFile);
 
 	if (m_httpRequest)
 	{
@@ -22,7 +25,7 @@ MonitoredProcess::~MonitoredProcess()
 		m_httpRequest = NULL;
 	}
 
-	std::lock_guard<std::recursive_mutex> guard(m_queueMutex);
+	std::lock_guard<std::recursive_mutex> guard(m_threadMutex);
 	if (m_thread != nullptr) m_thread->join();
 
 	LOG_DBG << fname << "Process <" << this->getpid() << "> released";
@@ -38,21 +41,13 @@ pid_t MonitoredProcess::spawn(ACE_Process_Options & options)
 		LOG_ERR << fname << "Create pipe failed with error : " << std::strerror(errno);
 		return ACE_INVALID_PID;
 	}
-	m_readPipeFile = ACE_OS::fdopen(m_pipe->read_handle(), "r");
-	if (m_readPipeFile == nullptr)
-	{
-		LOG_ERR << fname << "Get file stream failed with error : " << std::strerror(errno);
-		return ACE_INVALID_PID;
-	}
-	else
-	{
-		// release the handles if already set in process options
-		options.release_handles();
-		options.set_handles(ACE_STDIN, m_pipe->write_handle(), m_pipe->write_handle());
-	}
+	// release the handles if already set in process options
+	options.release_handles();
+	options.set_handles(ACE_STDIN, m_pipe->write_handle(), m_pipe->write_handle());
 	auto rt = AppProcess::spawn(options);
 
 	// Start thread to read stdout/stderr stream
+	std::lock_guard<std::recursive_mutex> guard(m_threadMutex);
 	if (m_enableBuildinThread) m_thread = std::make_unique<std::thread>(std::bind(&MonitoredProcess::runPipeReaderThread, this));
 
 	// close write in parent side (write handler is used for child process in our case)
@@ -63,7 +58,8 @@ pid_t MonitoredProcess::spawn(ACE_Process_Options & options)
 pid_t MonitoredProcess::wait(ACE_exitcode* status, int wait_options)
 {
 	auto rt = ACE_Process::wait(status, wait_options);
-	std::lock_guard<std::recursive_mutex> guard(m_queueMutex);
+	// safeWait timer and app thread can both wait, join only once
+	std::lock_guard<std::recursive_mutex> guard(m_threadMutex);
 	if (0 == status && 0 == wait_options && nullptr != m_thread)
 	{
 		// crash will happen if thread join itself
@@ -82,37 +78,21 @@ std::string MonitoredProcess::fetchOutputMsg()
 {
 	const static char fname[] = "MonitoredProcess::fecthPipeMessages() ";
 
-	std::stringstream stdoutMsg;
-	{
-		std::lock_guard<std::recursive_mutex> guard(m_queueMutex);
-		while (m_msgQueue.size())
-		{
-			stdoutMsg << m_msgQueue.front();
-			m_msgQueue.pop();
-		}
-		LOG_DBG << fname;
-	}
-	return std::move(stdoutMsg.str());
+	LOG_DBG << fname;
+	return m_outputBuffer.fetchOutput();
+}
+
+void MonitoredProcess::searchOutput(OutputSearch& search, uint64_t offset, int64_t since)
+{
+	m_outputBuffer.search(search, offset, since);
 }
 
 std::string MonitoredProcess::getOutputMsg()
 {
 	const static char fname[] = "MonitoredProcess::getPipeMessages() ";
 
-	std::stringstream stdoutMsg;
-	std::queue<std::string> msgQueue;
-	{
-		std::lock_guard<std::recursive_mutex> guard(m_queueMutex);
-		msgQueue = m_msgQueue;
-	}
-	while (msgQueue.size())
-	{
-		stdoutMsg << msgQueue.front();
-		msgQueue.pop();
-	}
-	std::string msgStr = stdoutMsg.str();
-	LOG_DBG << fname;// << msgStr;
-	return std::move(msgStr);
+	LOG_DBG << fname;
+	return m_outputBuffer.getOutput();
 }
 
 void MonitoredProcess::runPipeReaderThread()
@@ -124,22 +104,28 @@ void MonitoredProcess::runPipeReaderThread()
 	// hold self point to avoid release
 	auto self = this->shared_from_this();
 
-	const int stdoutQueueMaxLineCount = m_cacheOutputLines;
-	char buffer[1024] = { 0 };
+	// read pipe without stdio buffer, so hot upgrade can hand over the pipe without losing data
+	char buffer[4096];
+	const auto handle = m_pipe->read_handle();
 	while (true)
 	{
-		char* result = fgets(buffer, sizeof(buffer), m_readPipeFile);
-		if (result == nullptr)
+		struct pollfd event = { handle, POLLIN, 0 };
+		if (::poll(&event, 1, -1) < 0)
+		{
+			if (errno == EINTR) continue;
+			LOG_ERR << fname << "Poll pipe failed with error : " << std::strerror(errno);
+			break;
+		}
+		std::lock_guard<std::recursive_mutex> guard(m_readMutex);
+		auto size = ::read(handle, buffer, sizeof(buffer));
+		if (size < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+		if (size <= 0)
 		{
 			LOG_DBG << fname << "Get message from pipe finished";
 			break;
 		}
-		// LOG_DBG << fname << "Read line : " << buffer;
-
-		std::lock_guard<std::recursive_mutex> guard(m_queueMutex);
-		m_msgQueue.push(buffer);
-		// Do not store too much in memory
-		if ((int)m_msgQueue.size() > stdoutQueueMaxLineCount) m_msgQueue.pop();
+		m_outputBuffer.append(buffer, size);
+		if (m_outputLog != nullptr) m_outputLog->append(buffer, size, std::time(nullptr));
 	}
 
 	///////////////////////////////////////////////////////////////////////
@@ -152,9 +138,24 @@ void MonitoredProcess::runPipeReaderThread()
 			resp.headers().add(HTTP_HEADER_KEY_exit_code, this->return_value());
 			if (m_httpRequest)
 			{
-				((HttpRequest*)m_httpRequest)->reply(resp).get();
-				delete (HttpRequest*)m_httpRequest;
+				std::unique_ptr<HttpRequest> request((HttpRequest*)m_httpRequest);
 				m_httpRequest = NULL;
+				// reader thread does not wait for a slow client to receive the output
+				request->reply(resp).then([](pplx::task<void> t)
+					{
+						try
+						{
+							t.get();
+						}
+						catch (const std::exception& e)
+						{
+							LOG_ERR << fname << "message reply failed, maybe the http connection broken with error: " << e.what();
+						}
+						catch (...)
+						{
+							LOG_ERR << fname << "message reply failed, maybe the http connection broken";
+						}
+					});
 			}
 		}
 		catch (...)
@@ -167,3 +168,35 @@ void MonitoredProcess::runPipeReaderThread()
 	m_buildinThreadFinished = true;
 	this->registerTimer(0, 0, std::bind(&MonitoredProcess::safeWait, this, std::placeholders::_1), fname);
 }
+
+int MonitoredProcess::freeze(std::string& output)
+{
+	// keep locked until exec, unfreeze() release it when exec failed
+	m_readMutex.lock();
+	output = m_outputBuffer.getOutput();
+	if (m_pipe == nullptr || m_buildinThreadFinished) return -1;
+	return m_pipe->read_handle();
+}
+
+void MonitoredProcess::unfreeze()
+{
+	m_readMutex.unlock();
+}
+
+void MonitoredProcess::restore(int readHandle, const std::string& output)
+{
+	const static char fname[] = "MonitoredProcess::restore() ";
+
+	m_outputBuffer.append(output.data(), output.length());
+	if (readHandle >= 0)
+	{
+		m_pipe = std::make_unique<ACE_Pipe>(readHandle, ACE_INVALID_HANDLE);
+		std::lock_guard<std::recursive_mutex> guard(m_threadMutex);
+		m_thread = std::make_unique<std::thread>(std::bind(&MonitoredProcess::runPipeReaderThread, this));
+		LOG_DBG << fname << "continue reading pipe <" << readHandle << "> of process <" << this->getpid() << ">";
+	}
+	else
+	{
+		m_buildinThreadFinished = true;
+	}
+}
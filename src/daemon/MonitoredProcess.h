@@ -4,9 +4,9 @@
 #include <ace/Pipe.h>
 #include <thread>
 #include <memory>
-#include <queue>
 #include <mutex>
 #include "AppProcess.h"
+#include "OutputBuffer.h"
 
 //////////////////////////////////////////////////////////////////////////
 // Monitored Process Object
@@ -27,17 +27,26 @@ public:
 	// pipe message
 	virtual std::string getOutputMsg() override;
 	virtual std::string fetchOutputMsg() override;
+	virtual void searchOutput(OutputSearch& search, uint64_t offset, int64_t since) override;
 	void runPipeReaderThread();
 	virtual bool complete() override { return m_buildinThreadFinished; }
+
+	// hot upgrade: stop reading pipe until unfreeze(), return the pipe read handle (-1 when pipe finished) and cached output
+	int freeze(std::string& output);
+	void unfreeze();
+	// hot upgrade: continue reading the pipe passed from previous daemon, readHandle -1 means output only
+	void restore(int readHandle, const std::string& output);
 private:
 	ACE_HANDLE m_pipeHandler[2]; // 0 for read, 1 for write
 	std::unique_ptr<ACE_Pipe> m_pipe;
-	FILE* m_readPipeFile;
 	
-	std::queue<std::string> m_msgQueue;
-	std::recursive_mutex m_queueMutex;
+	OutputBuffer m_outputBuffer;
+	// hold when reading pipe, data is either in pipe or in output buffer
+	std::recursive_mutex m_readMutex;
 	void* m_httpRequest;
 
+	// serialize join of reader thread, wait() is called from timer and app thread
+	std::recursive_mutex m_threadMutex;
 	std::unique_ptr<std::thread> m_thread;
 	bool m_buildinThreadFinished;
 	bool m_enableBuildinThread;
@@ -0,0 +1,75 @@
+#include <ctime>
+#include <cstring>
+#include "OutputBuffer.h"
+#include "OutputSearch.h"
+#include "../common/Utility.h"
+
+OutputBuffer::OutputBuffer(size_t maxLines)
+	:m_firstOffset(0), m_maxLines(maxLines)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+}
+
+void OutputBuffer::append(const char* data, size_t len)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	size_t pos = 0;
+	while (pos < len)
+	{
+		auto lineBreak = static_cast<const char*>(memchr(data + pos, '\n', len - pos));
+		size_t end = lineBreak ? (lineBreak - data + 1) : len;
+		m_partialLine.append(data + pos, end - pos);
+		pos = end;
+		if (lineBreak || m_partialLine.length() >= MAX_OUTPUT_LINE_LENGTH)
+		{
+			m_lines.push_back(std::make_pair(std::move(m_partialLine), (int64_t)std::time(nullptr)));
+			m_partialLine.clear();
+			// Do not store too much in memory
+			while (m_lines.size() > m_maxLines)
+			{
+				m_firstOffset += m_lines.front().first.length();
+				m_lines.pop_front();
+			}
+		}
+	}
+}
+
+std::string OutputBuffer::getOutput()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	std::string output;
+	for (const auto& line : m_lines) output.append(line.first);
+	output.append(m_partialLine);
+	return output;
+}
+
+std::string OutputBuffer::fetchOutput()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto output = getOutput();
+	m_firstOffset += output.length();
+	m_lines.clear();
+	m_partialLine.clear();
+	return output;
+}
+
+void OutputBuffer::search(OutputSearch& search, uint64_t offset, int64_t since)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	uint64_t lineOffset = m_firstOffset;
+	for (const auto& line : m_lines)
+	{
+		if (lineOffset >= offset && line.second >= since)
+		{
+			if (!search.scan(lineOffset, line.first.data(), line.first.length(), line.second)) return;
+		}
+		lineOffset += line.first.length();
+	}
+	if (lineOffset >= offset && search.scan(lineOffset, m_partialLine.data(), m_partialLine.length(), std::time(nullptr)))
+	{
+		search.finish();
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+#include <deque>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+class OutputSearch;
+
+//////////////////////////////////////////////////////////////////////////
+// In-memory stdout/stderr cache for a process, keep the last N lines
+//////////////////////////////////////////////////////////////////////////
+class OutputBuffer
+{
+public:
+	explicit OutputBuffer(size_t maxLines);
+	virtual ~OutputBuffer();
+
+	// split data to lines, the last incomplete line is kept until line break arrive
+	void append(const char* data, size_t len);
+	// return all cached output
+	std::string getOutput();
+	// return and remove all cached output
+	std::string fetchOutput();
+	// search cached lines from <offset> (position in all output appended), skip lines before <since>
+	void search(OutputSearch& search, uint64_t offset, int64_t since);
+
+private:
+	// line and the time it was completed
+	std::deque<std::pair<std::string, int64_t>> m_lines;
+	std::string m_partialLine;
+	// offset of the first cached line in all output appended
+	uint64_t m_firstOffset;
+	const size_t m_maxLines;
+	std::recursive_mutex m_mutex;
+};
+
+#endif
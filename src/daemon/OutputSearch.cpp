@@ -0,0 +1,150 @@
+#include <cstring>
+#include <stdexcept>
+#include "OutputSearch.h"
+#include "../common/Utility.h"
+
+OutputSearch::OutputSearch(const std::string& pattern, bool regex, uint64_t offset, size_t maxMatches, size_t maxBytes, int maxMilliseconds)
+	:m_pattern(pattern), m_maxMatches(maxMatches), m_maxBytes(maxBytes),
+	m_deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(maxMilliseconds)),
+	m_partialOffset(0), m_partialTime(0), m_nextOffset(offset), m_scannedBytes(0), m_complete(true), m_started(false)
+{
+	if (regex)
+	{
+		try
+		{
+			m_regex = std::make_unique<boost::regex>(pattern, boost::regex::perl);
+		}
+		catch (const boost::regex_error& ex)
+		{
+			throw std::invalid_argument(std::string("invalid regex: ") + ex.what());
+		}
+	}
+}
+
+OutputSearch::~OutputSearch()
+{
+}
+
+bool OutputSearch::matchLine(const char* begin, const char* end) const
+{
+	if (m_regex != nullptr)
+	{
+		// line break is not part of the line for $
+		while (end > begin && (*(end - 1) == '\n' || *(end - 1) == '\r')) end--;
+		return boost::regex_search(begin, end, *m_regex);
+	}
+	return ::memmem(begin, end - begin, m_pattern.data(), m_pattern.length()) != nullptr;
+}
+
+bool OutputSearch::addMatch(uint64_t offset, const char* begin, const char* end, int64_t time)
+{
+	while (end > begin && (*(end - 1) == '\n' || *(end - 1) == '\r')) end--;
+	if (end - begin > MAX_OUTPUT_LINE_LENGTH) end = begin + MAX_OUTPUT_LINE_LENGTH;
+	m_matches.push_back(Match{ offset, time, std::string(begin, end) });
+	return m_matches.size() < m_maxMatches;
+}
+
+bool OutputSearch::scanLines(uint64_t offset, const char* begin, const char* end, int64_t time)
+{
+	const char* pos = begin;
+	while (pos < end)
+	{
+		const char* lineBegin = pos;
+		const char* lineEnd = nullptr;
+		if (m_regex == nullptr)
+		{
+			// jump to the next hit, lines without hit are not visited one by one
+			auto hit = static_cast<const char*>(::memmem(pos, end - pos, m_pattern.data(), m_pattern.length()));
+			if (hit == nullptr) break;
+			auto lineBreak = static_cast<const char*>(::memrchr(pos, '\n', hit - pos));
+			if (lineBreak) lineBegin = lineBreak + 1;
+			lineBreak = static_cast<const char*>(::memchr(hit, '\n', end - hit));
+			lineEnd = lineBreak ? lineBreak + 1 : end;
+		}
+		else
+		{
+			auto lineBreak = static_cast<const char*>(::memchr(pos, '\n', end - pos));
+			lineEnd = lineBreak ? lineBreak + 1 : end;
+			if (!matchLine(lineBegin, lineEnd))
+			{
+				pos = lineEnd;
+				continue;
+			}
+		}
+		pos = lineEnd;
+		if (!addMatch(offset + (lineBegin - begin), lineBegin, lineEnd, time))
+		{
+			m_nextOffset = offset + (lineEnd - begin);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool OutputSearch::scan(uint64_t offset, const char* data, size_t len, int64_t time)
+{
+	if (!m_started)
+	{
+		m_started = true;
+		m_nextOffset = offset;
+	}
+	if (m_scannedBytes >= m_maxBytes || std::chrono::steady_clock::now() > m_deadline)
+	{
+		m_complete = false;
+		return false;
+	}
+	m_scannedBytes += len;
+
+	const char* begin = data;
+	const char* end = data + len;
+	if (m_partialLine.length())
+	{
+		auto lineBreak = static_cast<const char*>(::memchr(begin, '\n', len));
+		auto size = std::min<size_t>(lineBreak ? (lineBreak - begin + 1) : len, MAX_OUTPUT_LINE_LENGTH - m_partialLine.length());
+		m_partialLine.append(begin, size);
+		begin += size;
+		if (m_partialLine.back() != '\n' && m_partialLine.length() < MAX_OUTPUT_LINE_LENGTH) return true;
+
+		bool more = true;
+		if (matchLine(m_partialLine.data(), m_partialLine.data() + m_partialLine.length()))
+		{
+			more = addMatch(m_partialOffset, m_partialLine.data(), m_partialLine.data() + m_partialLine.length(), m_partialTime);
+		}
+		m_partialLine.clear();
+		m_nextOffset = offset + (begin - data);
+		if (!more)
+		{
+			m_complete = false;
+			return false;
+		}
+	}
+
+	// complete lines, a line longer than MAX_OUTPUT_LINE_LENGTH is split as OutputBuffer does
+	auto lastBreak = static_cast<const char*>(::memrchr(begin, '\n', end - begin));
+	const char* linesEnd = lastBreak ? (lastBreak + 1) : begin;
+	while (end - linesEnd >= MAX_OUTPUT_LINE_LENGTH) linesEnd += MAX_OUTPUT_LINE_LENGTH;
+	if (!scanLines(offset + (begin - data), begin, linesEnd, time))
+	{
+		m_complete = false;
+		return false;
+	}
+	m_nextOffset = offset + (linesEnd - data);
+	if (linesEnd < end)
+	{
+		m_partialLine.assign(linesEnd, end);
+		m_partialOffset = m_nextOffset;
+		m_partialTime = time;
+	}
+	return true;
+}
+
+void OutputSearch::finish()
+{
+	if (m_partialLine.empty()) return;
+	if (matchLine(m_partialLine.data(), m_partialLine.data() + m_partialLine.length()))
+	{
+		addMatch(m_partialOffset, m_partialLine.data(), m_partialLine.data() + m_partialLine.length(), m_partialTime);
+	}
+	m_nextOffset = m_partialOffset + m_partialLine.length();
+	m_partialLine.clear();
+}
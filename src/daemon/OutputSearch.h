@@ -0,0 +1,65 @@
+#ifndef OUTPUT_SEARCH_H
+#define OUTPUT_SEARCH_H
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <boost/regex.hpp>
+
+//////////////////////////////////////////////////////////////////////////
+// Search lines of application output block by block:
+//  literal pattern is located by memmem over the whole block (SIMD in glibc),
+//  only the lines containing a hit are cut out; regex is compiled once and
+//  applied line by line. Scan stops at match limit, byte budget or deadline.
+//////////////////////////////////////////////////////////////////////////
+class OutputSearch
+{
+public:
+	struct Match
+	{
+		uint64_t offset;	// offset of the line in output stream
+		int64_t time;		// 0 when not known by the scanned source
+		std::string line;
+	};
+
+	// throw std::invalid_argument for invalid regex, <offset> is returned as next offset when nothing scanned
+	OutputSearch(const std::string& pattern, bool regex, uint64_t offset, size_t maxMatches, size_t maxBytes, int maxMilliseconds);
+	virtual ~OutputSearch();
+
+	// data at <offset> of output stream, consecutive blocks continue the same lines,
+	// return false when scan should stop
+	bool scan(uint64_t offset, const char* data, size_t len, int64_t time = 0);
+	// end of output, unterminated last line is searched
+	void finish();
+	// false when stopped by match limit or budget
+	bool complete() const { return m_complete; }
+	// offset to continue next page
+	uint64_t nextOffset() const { return m_nextOffset; }
+	uint64_t scannedBytes() const { return m_scannedBytes; }
+	std::vector<Match>& matches() { return m_matches; }
+
+private:
+	bool matchLine(const char* begin, const char* end) const;
+	// search complete lines in [begin, end), return false when match limit reached
+	bool scanLines(uint64_t offset, const char* begin, const char* end, int64_t time);
+	bool addMatch(uint64_t offset, const char* begin, const char* end, int64_t time);
+
+private:
+	const std::string m_pattern;
+	std::unique_ptr<boost::regex> m_regex;
+	const size_t m_maxMatches;
+	const size_t m_maxBytes;
+	const std::chrono::steady_clock::time_point m_deadline;
+	std::vector<Match> m_matches;
+	// line not terminated in the last block
+	std::string m_partialLine;
+	uint64_t m_partialOffset;
+	int64_t m_partialTime;
+	uint64_t m_nextOffset;
+	uint64_t m_scannedBytes;
+	bool m_complete;
+	bool m_started;
+};
+
+#endif
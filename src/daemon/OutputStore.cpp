@@ -0,0 +1,455 @@
+#include <ctime>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "OutputStore.h"
+#include "../common/Utility.h"
+#include "../common/os/linux.hpp"
+
+#define OUTPUT_SEGMENT_SUFFIX ".seg"
+#define OUTPUT_INDEX_SUFFIX ".idx"
+// mapped segment is visited in blocks, so a scan can stop in the middle of a segment
+#define OUTPUT_SCAN_BLOCK_BYTES (1024 * 1024)
+
+namespace
+{
+	struct ReadPiece
+	{
+		int fd;
+		uint64_t pos;
+		uint64_t length;
+	};
+
+	// map the range of a sealed segment and visit it block by block, return bytes visited
+	uint64_t visitPiece(const ReadPiece& piece, uint64_t offset, const std::function<bool(uint64_t, const char*, size_t)>& visitor)
+	{
+		struct stat st;
+		// file shorter than index when write failed, access beyond end of file is SIGBUS
+		if (::fstat(piece.fd, &st) != 0 || (uint64_t)st.st_size < piece.pos + piece.length) return 0;
+		static const uint64_t pageSize = ::sysconf(_SC_PAGESIZE);
+		uint64_t aligned = piece.pos - piece.pos % pageSize;
+		size_t length = piece.length + (piece.pos - aligned);
+		auto addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, piece.fd, aligned);
+		if (addr == MAP_FAILED) return 0;
+		::madvise(addr, length, MADV_SEQUENTIAL);
+		auto data = static_cast<const char*>(addr) + (piece.pos - aligned);
+		uint64_t visited = 0;
+		while (visited < piece.length)
+		{
+			auto size = std::min<uint64_t>(OUTPUT_SCAN_BLOCK_BYTES, piece.length - visited);
+			if (!visitor(offset + visited, data + visited, size)) break;
+			visited += size;
+		}
+		// mapping is released after each read, so history does not stay in RSS
+		::munmap(addr, length);
+		return visited;
+	}
+
+	// application name may contain chars not valid for a directory name
+	std::string encodeName(const std::string& name)
+	{
+		static const char hex[] = "0123456789ABCDEF";
+		std::string result;
+		for (size_t i = 0; i < name.length(); i++)
+		{
+			unsigned char c = name[i];
+			if (std::isalnum(c) || c == '_' || c == '-' || (c == '.' && i > 0))
+			{
+				result.push_back(c);
+			}
+			else
+			{
+				result.push_back('%');
+				result.push_back(hex[c >> 4]);
+				result.push_back(hex[c & 0xF]);
+			}
+		}
+		return result;
+	}
+}
+
+OutputLog::OutputLog(const std::string& dir, size_t segmentBytes, int retentionSeconds, uint64_t maxBytes)
+	:m_dir(dir), m_segmentBytes(segmentBytes), m_retentionSeconds(retentionSeconds), m_maxBytes(maxBytes),
+	m_activeFd(-1), m_indexFd(-1), m_flushedIndex(0), m_totalBytes(0), m_failed(false)
+{
+	load();
+}
+
+OutputLog::~OutputLog()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_activeFd >= 0) sealSegment();
+}
+
+void OutputLog::load()
+{
+	const static char fname[] = "OutputLog::load() ";
+
+	if (!Utility::createRecursiveDirectory(m_dir, 0750))
+	{
+		LOG_ERR << fname << "Failed to create directory <" << m_dir << ">";
+		m_failed = true;
+		return;
+	}
+	std::vector<uint64_t> bases;
+	const std::string suffix = OUTPUT_SEGMENT_SUFFIX;
+	for (const auto& file : os::ls(m_dir))
+	{
+		if (file.length() > suffix.length() && file.compare(file.length() - suffix.length(), suffix.length(), suffix) == 0)
+		{
+			// segment name is the decimal base offset, ignore other files
+			auto base = file.substr(0, file.length() - suffix.length());
+			if (!Utility::isNumber(base) || base.length() > std::numeric_limits<uint64_t>::digits10)
+			{
+				LOG_WAR << fname << "Ignore unknown file <" << file << "> in <" << m_dir << ">";
+				continue;
+			}
+			bases.push_back(std::stoull(base));
+		}
+	}
+	std::sort(bases.begin(), bases.end());
+	for (auto base : bases)
+	{
+		struct stat st;
+		if (::stat(segmentPath(base, OUTPUT_SEGMENT_SUFFIX).c_str(), &st) != 0) continue;
+		auto segment = std::make_unique<OutputSegment>();
+		segment->base = base;
+		segment->size = st.st_size;
+		int fd = ::open(segmentPath(base, OUTPUT_INDEX_SUFFIX).c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd >= 0)
+		{
+			OutputSegment::IndexEntry entry;
+			while (::read(fd, &entry, sizeof(entry)) == sizeof(entry))
+			{
+				if (entry.offset <= segment->size) segment->index.push_back(entry);
+			}
+			::close(fd);
+		}
+		if (segment->index.empty())
+		{
+			segment->index.push_back(OutputSegment::IndexEntry{ st.st_mtime, 0 });
+		}
+		m_totalBytes += segment->size;
+		m_segments.push_back(std::move(segment));
+	}
+	LOG_DBG << fname << "<" << m_dir << "> segments <" << m_segments.size() << "> bytes <" << m_totalBytes << ">";
+	expire(std::time(nullptr));
+}
+
+std::string OutputLog::segmentPath(uint64_t base, const std::string& suffix) const
+{
+	// fixed width name keeps ls order same as offset order
+	char name[32] = { 0 };
+	std::snprintf(name, sizeof(name), "%020llu", (unsigned long long)base);
+	return m_dir + "/" + name + suffix;
+}
+
+bool OutputLog::openSegment(uint64_t base)
+{
+	const static char fname[] = "OutputLog::openSegment() ";
+
+	m_activeFd = ::open(segmentPath(base, OUTPUT_SEGMENT_SUFFIX).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+	m_indexFd = ::open(segmentPath(base, OUTPUT_INDEX_SUFFIX).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+	if (m_activeFd < 0 || m_indexFd < 0)
+	{
+		// stop writing instead of logging for every append
+		LOG_ERR << fname << "Failed to create segment in <" << m_dir << "> with error: " << std::strerror(errno);
+		if (m_activeFd >= 0) ::close(m_activeFd);
+		if (m_indexFd >= 0) ::close(m_indexFd);
+		m_activeFd = m_indexFd = -1;
+		m_failed = true;
+		return false;
+	}
+	auto segment = std::make_unique<OutputSegment>();
+	segment->base = base;
+	segment->size = 0;
+	m_segments.push_back(std::move(segment));
+	m_flushedIndex = 0;
+	return true;
+}
+
+void OutputLog::sealSegment()
+{
+	flushTail();
+	::close(m_activeFd);
+	::close(m_indexFd);
+	m_activeFd = m_indexFd = -1;
+}
+
+void OutputLog::flushTail()
+{
+	const static char fname[] = "OutputLog::flushTail() ";
+
+	if (m_activeFd < 0) return;
+	size_t written = 0;
+	while (written < m_tail.length())
+	{
+		auto size = ::write(m_activeFd, m_tail.data() + written, m_tail.length() - written);
+		if (size < 0 && errno == EINTR) continue;
+		if (size <= 0)
+		{
+			// read stops at the truncated position
+			LOG_ERR << fname << "Failed to write <" << m_dir << "> with error: " << std::strerror(errno);
+			break;
+		}
+		written += size;
+	}
+	m_tail.clear();
+	const auto& index = m_segments.back()->index;
+	if (m_flushedIndex < index.size())
+	{
+		auto bytes = (index.size() - m_flushedIndex) * sizeof(OutputSegment::IndexEntry);
+		if (::write(m_indexFd, &index[m_flushedIndex], bytes) != (ssize_t)bytes)
+		{
+			LOG_WAR << fname << "Failed to write index of <" << m_dir << "> with error: " << std::strerror(errno);
+		}
+		m_flushedIndex = index.size();
+	}
+}
+
+void OutputLog::expire(int64_t now)
+{
+	// never drop the active segment
+	auto sealed = m_segments.size() - (m_activeFd >= 0 ? 1 : 0);
+	while (sealed > 0)
+	{
+		const auto& segment = m_segments.front();
+		bool outdated = m_retentionSeconds > 0 && segment->lastTime() < now - m_retentionSeconds;
+		if (!outdated && m_totalBytes <= m_maxBytes) break;
+		// reader holding the file descriptor still can read the unlinked file
+		::unlink(segmentPath(segment->base, OUTPUT_SEGMENT_SUFFIX).c_str());
+		::unlink(segmentPath(segment->base, OUTPUT_INDEX_SUFFIX).c_str());
+		m_totalBytes -= segment->size;
+		m_segments.pop_front();
+		sealed--;
+	}
+}
+
+void OutputLog::append(const char* data, size_t len, int64_t now)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_failed) return;
+	while (len > 0)
+	{
+		if (m_activeFd < 0 || m_segments.back()->size >= m_segmentBytes)
+		{
+			if (m_activeFd >= 0) sealSegment();
+			if (!openSegment(endOffset())) return;
+			expire(now);
+		}
+		auto& segment = *m_segments.back();
+		if (segment.index.empty() || segment.index.back().time < now)
+		{
+			segment.index.push_back(OutputSegment::IndexEntry{ now, segment.size });
+		}
+		size_t size = std::min<size_t>(len, m_segmentBytes - segment.size);
+		m_tail.append(data, size);
+		segment.size += size;
+		m_totalBytes += size;
+		data += size;
+		len -= size;
+		if (m_tail.length() >= OUTPUT_STORE_FLUSH_BYTES) flushTail();
+	}
+}
+
+void OutputLog::flush(int64_t now)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	flushTail();
+	expire(now);
+}
+
+uint64_t OutputLog::read(uint64_t offset, uint64_t endOffset, size_t maxBytes, std::string& output)
+{
+	return scan(offset, endOffset, maxBytes, [&output](uint64_t, const char* data, size_t len)
+		{
+			output.append(data, len);
+			return true;
+		});
+}
+
+uint64_t OutputLog::scan(uint64_t offset, uint64_t endOffset, uint64_t maxBytes, const std::function<bool(uint64_t offset, const char* data, size_t len)>& visitor)
+{
+	std::vector<ReadPiece> pieces;
+	std::string tail;
+	uint64_t begin = 0;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		offset = std::min(std::max(offset, beginOffset()), this->endOffset());
+		begin = offset;
+		endOffset = std::min(endOffset, this->endOffset());
+		uint64_t remain = offset < endOffset ? std::min<uint64_t>(maxBytes, endOffset - offset) : 0;
+		for (size_t i = 0; i < m_segments.size() && remain > 0; i++)
+		{
+			const auto& segment = m_segments[i];
+			if (offset >= segment->base + segment->size) continue;
+			uint64_t pos = offset - segment->base;
+			uint64_t size = std::min<uint64_t>(remain, segment->size - pos);
+			bool active = (m_activeFd >= 0 && i == m_segments.size() - 1);
+			if (active)
+			{
+				// active segment is small part of the result, copy under lock
+				uint64_t flushed = segment->size - m_tail.length();
+				if (pos < flushed)
+				{
+					size_t fileSize = std::min<uint64_t>(size, flushed - pos);
+					tail.resize(fileSize);
+					auto got = ::pread(m_activeFd, &tail[0], fileSize, pos);
+					tail.resize(got > 0 ? got : 0);
+					if ((size_t)tail.length() < fileSize) break;
+				}
+				if (pos + size > flushed)
+				{
+					uint64_t tailPos = std::max(pos, flushed) - flushed;
+					tail.append(m_tail, tailPos, pos + size - flushed - tailPos);
+				}
+			}
+			else
+			{
+				int fd = ::open(segmentPath(segment->base, OUTPUT_SEGMENT_SUFFIX).c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd < 0) break;
+				pieces.push_back(ReadPiece{ fd, pos, size });
+			}
+			offset += size;
+			remain -= size;
+		}
+	}
+	// visit sealed segments without lock, active segment is always the last piece,
+	// stop at a truncated segment, next read continues from what was visited
+	offset = begin;
+	bool complete = true;
+	for (const auto& piece : pieces)
+	{
+		if (complete)
+		{
+			auto visited = visitPiece(piece, offset, visitor);
+			offset += visited;
+			complete = (visited == piece.length);
+		}
+		::close(piece.fd);
+	}
+	if (complete && tail.length() && visitor(offset, tail.data(), tail.length()))
+	{
+		offset += tail.length();
+	}
+	return offset;
+}
+
+uint64_t OutputLog::seek(int64_t time)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (const auto& segment : m_segments)
+	{
+		if (segment->lastTime() >= time)
+		{
+			auto entry = std::lower_bound(segment->index.begin(), segment->index.end(), time,
+				[](const OutputSegment::IndexEntry& e, int64_t t) { return e.time < t; });
+			return segment->base + entry->offset;
+		}
+	}
+	return endOffset();
+}
+
+int64_t OutputLog::timeAt(uint64_t offset)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (const auto& segment : m_segments)
+	{
+		if (offset < segment->base + segment->size && !segment->index.empty())
+		{
+			// the last second started before offset
+			auto pos = offset >= segment->base ? offset - segment->base : 0;
+			auto entry = std::upper_bound(segment->index.begin(), segment->index.end(), pos,
+				[](uint64_t p, const OutputSegment::IndexEntry& e) { return p < e.offset; });
+			return (entry == segment->index.begin()) ? entry->time : (entry - 1)->time;
+		}
+	}
+	return 0;
+}
+
+uint64_t OutputLog::beginOffset()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_segments.empty() ? 0 : m_segments.front()->base;
+}
+
+uint64_t OutputLog::endOffset()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_segments.empty() ? 0 : m_segments.back()->base + m_segments.back()->size;
+}
+
+void OutputLog::destroy()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_activeFd >= 0) sealSegment();
+	for (const auto& segment : m_segments)
+	{
+		::unlink(segmentPath(segment->base, OUTPUT_SEGMENT_SUFFIX).c_str());
+		::unlink(segmentPath(segment->base, OUTPUT_INDEX_SUFFIX).c_str());
+	}
+	m_segments.clear();
+	m_totalBytes = 0;
+	m_tail.clear();
+	::rmdir(m_dir.c_str());
+	// the removed application may still have a running process writing to this log
+	m_failed = true;
+}
+
+OutputStore::OutputStore(const std::string& dir, size_t segmentBytes, int retentionSeconds, uint64_t maxAppBytes)
+	:m_dir(dir), m_segmentBytes(segmentBytes), m_retentionSeconds(retentionSeconds), m_maxAppBytes(maxAppBytes)
+{
+}
+
+OutputStore::~OutputStore()
+{
+}
+
+std::unique_ptr<OutputStore>& OutputStore::instance()
+{
+	static auto singleton = std::make_unique<OutputStore>(Utility::getSelfDir() + "/" + DEFAULT_OUTPUT_STORE_DIR,
+		DEFAULT_OUTPUT_SEGMENT_BYTES, DEFAULT_OUTPUT_RETENTION_SECONDS, MAX_OUTPUT_STORE_APP_BYTES);
+	return singleton;
+}
+
+std::shared_ptr<OutputLog> OutputStore::getLog(const std::string& app)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto& log = m_logs[app];
+	if (log == nullptr)
+	{
+		log = std::make_shared<OutputLog>(m_dir + "/" + encodeName(app), m_segmentBytes, m_retentionSeconds, m_maxAppBytes);
+	}
+	return log;
+}
+
+void OutputStore::removeApp(const std::string& app)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto log = m_logs.find(app);
+	if (log != m_logs.end())
+	{
+		log->second->destroy();
+		m_logs.erase(log);
+	}
+	else if (Utility::isDirExist(m_dir + "/" + encodeName(app)))
+	{
+		// segments left by previous run, not loaded yet
+		OutputLog(m_dir + "/" + encodeName(app), m_segmentBytes, m_retentionSeconds, m_maxAppBytes).destroy();
+	}
+}
+
+void OutputStore::flush(int64_t now)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (const auto& log : m_logs)
+	{
+		log.second->flush(now);
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef OUTPUT_STORE_H
+#define OUTPUT_STORE_H
+#include <map>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+//////////////////////////////////////////////////////////////////////////
+// One fixed size segment of an application output log, file name is the
+// offset of its first byte in the whole output stream: <base>.seg, with a
+// sparse time index <base>.idx (one entry for each second that has output)
+//////////////////////////////////////////////////////////////////////////
+struct OutputSegment
+{
+	struct IndexEntry
+	{
+		int64_t time;
+		uint64_t offset;	// offset in segment
+	};
+	uint64_t base;
+	uint64_t size;
+	std::vector<IndexEntry> index;
+
+	int64_t lastTime() const { return index.empty() ? 0 : index.back().time; }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Disk backed output history of one application:
+//  only the unflushed tail of the active segment is kept in memory,
+//  sealed segments are read by mmap, oldest segments are dropped by
+//  retention time and total size
+//////////////////////////////////////////////////////////////////////////
+class OutputLog
+{
+public:
+	OutputLog(const std::string& dir, size_t segmentBytes, int retentionSeconds, uint64_t maxBytes);
+	virtual ~OutputLog();
+
+	void append(const char* data, size_t len, int64_t now);
+	// write tail to active segment file and drop segments out of retention
+	void flush(int64_t now);
+	// copy at most maxBytes in [offset, endOffset) to output, offset before the first kept byte
+	// starts from the first kept byte; return offset after the copied data
+	uint64_t read(uint64_t offset, uint64_t endOffset, size_t maxBytes, std::string& output);
+	// same range as read(), sealed segments are visited in place, stop when visitor return false
+	uint64_t scan(uint64_t offset, uint64_t endOffset, uint64_t maxBytes, const std::function<bool(uint64_t offset, const char* data, size_t len)>& visitor);
+	// offset of the first output written at or after <time>
+	uint64_t seek(int64_t time);
+	// time of the output at <offset> in second, 0 when not kept
+	int64_t timeAt(uint64_t offset);
+	uint64_t beginOffset();
+	uint64_t endOffset();
+	// delete all segment files
+	void destroy();
+
+private:
+	void load();
+	bool openSegment(uint64_t base);
+	void sealSegment();
+	void flushTail();
+	void expire(int64_t now);
+	std::string segmentPath(uint64_t base, const std::string& suffix) const;
+
+private:
+	const std::string m_dir;
+	const size_t m_segmentBytes;
+	const int m_retentionSeconds;
+	const uint64_t m_maxBytes;
+	// ordered by base, the last one is active when m_activeFd is valid
+	std::deque<std::unique_ptr<OutputSegment>> m_segments;
+	int m_activeFd;
+	int m_indexFd;
+	// bytes and index entries of active segment not written to file yet
+	std::string m_tail;
+	size_t m_flushedIndex;
+	uint64_t m_totalBytes;
+	bool m_failed;
+	std::recursive_mutex m_mutex;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Output logs of all applications, one directory for each application
+//////////////////////////////////////////////////////////////////////////
+class OutputStore
+{
+public:
+	OutputStore(const std::string& dir, size_t segmentBytes, int retentionSeconds, uint64_t maxAppBytes);
+	virtual ~OutputStore();
+	// Internal Singleton.
+	static std::unique_ptr<OutputStore>& instance();
+
+	// existing segments are loaded when first get
+	std::shared_ptr<OutputLog> getLog(const std::string& app);
+	// delete stored output of app, nothing is created when app has no log
+	void removeApp(const std::string& app);
+	void flush(int64_t now);
+
+private:
+	const std::string m_dir;
+	const size_t m_segmentBytes;
+	const int m_retentionSeconds;
+	const uint64_t m_maxAppBytes;
+	std::map<std::string, std::shared_ptr<OutputLog>> m_logs;
+	std::recursive_mutex m_mutex;
+};
+
+#endif
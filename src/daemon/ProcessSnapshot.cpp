@@ -0,0 +1,87 @@
+#include "ProcessSnapshot.h"
+#include "../common/Utility.h"
+#include "../common/os/linux.hpp"
+
+ProcessSnapshot::ProcessSnapshot()
+{
+}
+
+ProcessSnapshot::~ProcessSnapshot()
+{
+}
+
+std::shared_ptr<ProcessSnapshot> ProcessSnapshot::capture()
+{
+	const static char fname[] = "ProcessSnapshot::capture() ";
+
+	auto snapshot = std::make_shared<ProcessSnapshot>();
+	for (auto pid : os::pids())
+	{
+		auto status = os::status(pid);
+		// ignore process exited during scan
+		if (status == nullptr) continue;
+		auto command = Utility::stdStringTrim(os::cmdline(pid));
+		if (command.length()) snapshot->add(pid, status->starttime, command);
+	}
+	LOG_INF << fname << "processes <" << snapshot->size() << ">";
+	return snapshot;
+}
+
+bool ProcessSnapshot::verify(pid_t pid, const std::string& command, uint64_t& startTime)
+{
+	auto status = os::status(pid);
+	if (status == nullptr) return false;
+	if (startTime > 0 && startTime != status->starttime) return false;
+	if (Utility::stdStringTrim(os::cmdline(pid)) != command) return false;
+	startTime = status->starttime;
+	return true;
+}
+
+void ProcessSnapshot::add(pid_t pid, uint64_t startTime, const std::string& command)
+{
+	m_processes[pid] = Entry{ startTime, command, false };
+	m_commands.emplace(m_hash(command), pid);
+}
+
+bool ProcessSnapshot::claim(pid_t pid, const std::string& command, uint64_t startTime)
+{
+	auto it = m_processes.find(pid);
+	if (it == m_processes.end() || it->second.claimed) return false;
+	if (startTime > 0 && startTime != it->second.startTime) return false;
+	if (it->second.command != command) return false;
+
+	it->second.claimed = true;
+	auto range = m_commands.equal_range(m_hash(command));
+	for (auto iter = range.first; iter != range.second; ++iter)
+	{
+		if (iter->second == pid)
+		{
+			m_commands.erase(iter);
+			break;
+		}
+	}
+	return true;
+}
+
+pid_t ProcessSnapshot::claim(const std::string& command, uint64_t& startTime)
+{
+	// the earliest started one is the most likely to be started by the previous daemon
+	auto range = m_commands.equal_range(m_hash(command));
+	auto found = m_commands.end();
+	for (auto iter = range.first; iter != range.second; ++iter)
+	{
+		const auto& entry = m_processes[iter->second];
+		if (entry.command == command && (found == m_commands.end() || entry.startTime < m_processes[found->second].startTime))
+		{
+			found = iter;
+		}
+	}
+	if (found == m_commands.end()) return 0;
+
+	pid_t pid = found->second;
+	auto& entry = m_processes[pid];
+	entry.claimed = true;
+	startTime = entry.startTime;
+	m_commands.erase(found);
+	return pid;
+}
@@ -0,0 +1,48 @@
+#ifndef PROCESS_SNAPSHOT_H
+#define PROCESS_SNAPSHOT_H
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <sys/types.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Host processes read from /proc once, indexed by pid and command line hash,
+// used to attach running processes to applications when daemon restart.
+// Process identity is pid + start time (clock ticks after boot), so a reused pid
+// is not taken as the original process.
+//////////////////////////////////////////////////////////////////////////
+class ProcessSnapshot
+{
+public:
+	struct Entry
+	{
+		uint64_t startTime;
+		std::string command;
+		bool claimed;
+	};
+
+	ProcessSnapshot();
+	virtual ~ProcessSnapshot();
+	// read all host processes, kernel threads (no command line) are ignored
+	static std::shared_ptr<ProcessSnapshot> capture();
+	// read one process from /proc, return false when not exist or command line not match,
+	// startTime 0 means any start time and is set to the actual one
+	static bool verify(pid_t pid, const std::string& command, uint64_t& startTime);
+
+	void add(pid_t pid, uint64_t startTime, const std::string& command);
+	// claim the specified process, startTime 0 means any start time
+	bool claim(pid_t pid, const std::string& command, uint64_t startTime);
+	// claim the earliest started process with the command line, return 0 when not found
+	pid_t claim(const std::string& command, uint64_t& startTime);
+	size_t size() const { return m_processes.size(); }
+
+private:
+	std::unordered_map<pid_t, Entry> m_processes;
+	// command line hash -> unclaimed pids, same command line share the hash
+	std::unordered_multimap<size_t, pid_t> m_commands;
+	std::hash<std::string> m_hash;
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include <thread>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include "ProcessTracker.h"
+#include "../common/Utility.h"
+#include "../common/os/linux.hpp"
+
+ProcessTracker::ProcessTracker()
+	:m_socket(-1), m_enabled(false), m_exit(false)
+{
+}
+
+ProcessTracker::~ProcessTracker()
+{
+	if (m_socket >= 0) ::close(m_socket);
+}
+
+std::unique_ptr<ProcessTracker>& ProcessTracker::instance()
+{
+	static auto singleton = std::make_unique<ProcessTracker>();
+	return singleton;
+}
+
+std::vector<pid_t> ProcessTracker::getMembers(pid_t root)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto it = m_members.find(root);
+	if (it == m_members.end())
+	{
+		if (m_parent.find(root) == m_parent.end()) return std::vector<pid_t>();
+		// first lookup of this root, collect its sub tree once
+		trackRoot(root);
+		it = m_members.find(root);
+	}
+	return std::vector<pid_t>(it->second.begin(), it->second.end());
+}
+
+std::list<os::Process> ProcessTracker::getProcesses(pid_t root)
+{
+	std::list<os::Process> result;
+	for (auto pid : getMembers(root))
+	{
+		auto process = os::process(pid);
+		// ignore process exited after event
+		if (process != nullptr) result.push_back(*process);
+	}
+	return result;
+}
+
+pid_t ProcessTracker::getOwner(pid_t pid)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto owners = m_owners.find(pid);
+	if (owners == m_owners.end()) return 0;
+	// nested root has the smaller member set
+	pid_t owner = 0;
+	size_t size = 0;
+	for (auto root : owners->second)
+	{
+		auto members = m_members.find(root);
+		if (members != m_members.end() && (owner == 0 || members->second.size() < size))
+		{
+			owner = root;
+			size = members->second.size();
+		}
+	}
+	return owner;
+}
+
+size_t ProcessTracker::size()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_parent.size();
+}
+
+void ProcessTracker::onFork(pid_t parent, pid_t child)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_parent[child] = parent;
+	m_children[parent].insert(child);
+	auto owners = m_owners.find(parent);
+	if (owners != m_owners.end())
+	{
+		// copy before insert, insert may rehash m_owners
+		auto roots = owners->second;
+		for (auto root : roots) m_members[root].insert(child);
+		m_owners[child] = std::move(roots);
+	}
+}
+
+void ProcessTracker::onExit(pid_t pid)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto parent = m_parent.find(pid);
+	if (parent == m_parent.end()) return;
+
+	auto siblings = m_children.find(parent->second);
+	if (siblings != m_children.end())
+	{
+		siblings->second.erase(pid);
+		if (siblings->second.empty()) m_children.erase(siblings);
+	}
+	m_parent.erase(parent);
+
+	// orphans are adopted by init (or a sub-reaper, corrected by next rescan),
+	// they are still members of the same application
+	auto children = m_children.find(pid);
+	if (children != m_children.end())
+	{
+		auto& initChildren = m_children[1];
+		for (auto child : children->second)
+		{
+			m_parent[child] = 1;
+			initChildren.insert(child);
+		}
+		m_children.erase(pid);
+	}
+
+	if (m_members.count(pid)) untrackRoot(pid);
+	// remove from roots above it, also when it was a root itself
+	auto owners = m_owners.find(pid);
+	if (owners != m_owners.end())
+	{
+		for (auto root : owners->second) m_members[root].erase(pid);
+		m_owners.erase(owners);
+	}
+}
+
+void ProcessTracker::rescan()
+{
+	const static char fname[] = "ProcessTracker::rescan() ";
+
+	std::unordered_map<pid_t, pid_t> parents;
+	for (auto pid : os::pids())
+	{
+		auto status = os::status(pid);
+		// ignore process exited during scan
+		if (status != nullptr) parents[pid] = status->ppid;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	std::vector<pid_t> roots;
+	for (const auto& root : m_members) roots.push_back(root.first);
+	m_parent.swap(parents);
+	m_children.clear();
+	for (const auto& pair : m_parent) m_children[pair.second].insert(pair.first);
+	m_owners.clear();
+	m_members.clear();
+	for (auto root : roots)
+	{
+		if (m_parent.count(root)) trackRoot(root);
+	}
+	LOG_DBG << fname << "processes <" << m_parent.size() << "> tracked roots <" << m_members.size() << ">";
+}
+
+void ProcessTracker::trackRoot(pid_t root)
+{
+	auto& members = m_members[root];
+	std::vector<pid_t> pending = { root };
+	while (!pending.empty())
+	{
+		auto pid = pending.back();
+		pending.pop_back();
+		members.insert(pid);
+		m_owners[pid].insert(root);
+		auto children = m_children.find(pid);
+		if (children != m_children.end())
+		{
+			pending.insert(pending.end(), children->second.begin(), children->second.end());
+		}
+	}
+}
+
+void ProcessTracker::untrackRoot(pid_t root)
+{
+	auto it = m_members.find(root);
+	if (it != m_members.end())
+	{
+		for (auto pid : it->second)
+		{
+			auto owners = m_owners.find(pid);
+			if (owners != m_owners.end())
+			{
+				owners->second.erase(root);
+				if (owners->second.empty()) m_owners.erase(owners);
+			}
+		}
+		m_members.erase(it);
+	}
+}
+
+int ProcessTracker::connectProcConnector()
+{
+	const static char fname[] = "ProcessTracker::connectProcConnector() ";
+
+	int sock = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+	if (sock < 0)
+	{
+		LOG_WAR << fname << "Failed to create netlink socket with error: " << std::strerror(errno);
+		return -1;
+	}
+	// fork burst should not overflow socket buffer
+	int bufferSize = 4 * 1024 * 1024;
+	::setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &bufferSize, sizeof(bufferSize));
+
+	struct sockaddr_nl addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = CN_IDX_PROC;
+	addr.nl_pid = 0;
+	if (::bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		LOG_WAR << fname << "Failed to bind netlink socket with error: " << std::strerror(errno);
+		::close(sock);
+		return -1;
+	}
+
+	// subscribe proc events
+	char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+	std::memset(buffer, 0, sizeof(buffer));
+	auto nlHeader = (struct nlmsghdr*)buffer;
+	nlHeader->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+	nlHeader->nlmsg_type = NLMSG_DONE;
+	nlHeader->nlmsg_pid = ::getpid();
+	auto cnMsg = (struct cn_msg*)NLMSG_DATA(nlHeader);
+	cnMsg->id.idx = CN_IDX_PROC;
+	cnMsg->id.val = CN_VAL_PROC;
+	cnMsg->len = sizeof(enum proc_cn_mcast_op);
+	*(enum proc_cn_mcast_op*)cnMsg->data = PROC_CN_MCAST_LISTEN;
+	if (::send(sock, nlHeader, nlHeader->nlmsg_len, 0) < 0)
+	{
+		LOG_WAR << fname << "Failed to subscribe proc connector with error: " << std::strerror(errno);
+		::close(sock);
+		return -1;
+	}
+	LOG_INF << fname << "proc connector subscribed";
+	return sock;
+}
+
+bool ProcessTracker::receiveEvents()
+{
+	const static char fname[] = "ProcessTracker::receiveEvents() ";
+
+	alignas(struct nlmsghdr) char buffer[64 * 1024];
+	auto len = ::recv(m_socket, buffer, sizeof(buffer), 0);
+	if (len < 0)
+	{
+		if (errno == EINTR) return true;
+		if (errno == ENOBUFS)
+		{
+			// events lost, rebuild tree
+			LOG_WAR << fname << "proc connector overflow, rescan /proc";
+			rescan();
+			return true;
+		}
+		LOG_ERR << fname << "Failed to receive from proc connector with error: " << std::strerror(errno);
+		return false;
+	}
+
+	for (auto nlHeader = (struct nlmsghdr*)buffer; NLMSG_OK(nlHeader, (unsigned int)len); nlHeader = NLMSG_NEXT(nlHeader, len))
+	{
+		if (nlHeader->nlmsg_type == NLMSG_NOOP || nlHeader->nlmsg_type == NLMSG_ERROR) continue;
+		auto cnMsg = (struct cn_msg*)NLMSG_DATA(nlHeader);
+		if (cnMsg->id.idx != CN_IDX_PROC || cnMsg->id.val != CN_VAL_PROC) continue;
+		auto event = (struct proc_event*)cnMsg->data;
+		switch (event->what)
+		{
+		case proc_event::PROC_EVENT_FORK:
+			// only track process, not thread
+			if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid)
+			{
+				onFork(event->event_data.fork.parent_tgid, event->event_data.fork.child_tgid);
+			}
+			break;
+		case proc_event::PROC_EVENT_EXIT:
+			if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid)
+			{
+				onExit(event->event_data.exit.process_tgid);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+int ProcessTracker::svc(void)
+{
+	const static char fname[] = "ProcessTracker::svc() ";
+	LOG_INF << fname << "Entered";
+
+	while (!m_exit)
+	{
+		try
+		{
+			if (m_socket >= 0)
+			{
+				if (!receiveEvents())
+				{
+					::close(m_socket);
+					m_socket = -1;
+					LOG_WAR << fname << "proc connector failed, fall back to /proc scan";
+				}
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::seconds(DEFAULT_PROCESS_TRACKER_SCAN_INTERVAL));
+				rescan();
+			}
+		}
+		catch (const std::exception& ex)
+		{
+			LOG_WAR << fname << "got exception: " << ex.what();
+		}
+		catch (...)
+		{
+			LOG_WAR << fname << " exception";
+		}
+	}
+
+	LOG_WAR << fname << " thread exit";
+	return 0;
+}
+
+int ProcessTracker::open(void* args)
+{
+	const static char fname[] = "ProcessTracker::open() ";
+
+	// subscribe before the first scan, so no fork is missed in between
+	m_socket = connectProcConnector();
+	rescan();
+	m_enabled = true;
+	LOG_INF << fname << "process tracker started with " << (m_socket >= 0 ? "proc connector" : "/proc scan");
+	return activate(THR_NEW_LWP | THR_JOINABLE | THR_CANCEL_ENABLE | THR_CANCEL_ASYNCHRONOUS, 1);
+}
+
+int ProcessTracker::close(u_long flags)
+{
+	m_exit = true;
+	m_enabled = false;
+	return ACE_Task_Base::close(flags);
+}
@@ -0,0 +1,76 @@
+#ifndef PROCESS_TRACKER_H
+#define PROCESS_TRACKER_H
+#include <mutex>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/types.h>
+#include <ace/Task.h>
+#include "../common/os/process.hpp"
+
+//////////////////////////////////////////////////////////////////////////
+// Live pid->parent tree maintained incrementally from kernel proc connector
+// (netlink CN_PROC fork/exit events), falls back to periodic /proc scan
+// when the connector is not available (no CAP_NET_ADMIN or not compiled in kernel).
+// Each tracked root pid (application process) keeps the set of its descendants,
+// so looking up members of an application does not depend on host process count.
+// Roots can be nested (applications are descendants of app manager), a process
+// is a member of every tracked root above it.
+//////////////////////////////////////////////////////////////////////////
+class ProcessTracker : public ACE_Task_Base
+{
+public:
+	ProcessTracker();
+	virtual ~ProcessTracker();
+	// Internal Singleton.
+	static std::unique_ptr<ProcessTracker>& instance();
+
+	// false when tracker is not started, caller should scan /proc by itself
+	bool enabled() const { return m_enabled; }
+	// netlink connector is working, otherwise tree is refreshed by periodic scan
+	bool connected() const { return m_socket >= 0; }
+
+	// root pid and all descendants, empty when root does not exist
+	std::vector<pid_t> getMembers(pid_t root);
+	// read /proc only for members of root
+	std::list<os::Process> getProcesses(pid_t root);
+	// innermost tracked root which pid belongs to, 0 when not belong to any tracked root
+	pid_t getOwner(pid_t pid);
+	size_t size();
+
+	// process events, public for /proc scan and benchmark
+	void onFork(pid_t parent, pid_t child);
+	void onExit(pid_t pid);
+	// rebuild the whole tree from /proc
+	void rescan();
+
+	virtual int svc(void) override;
+	virtual int open(void* args = 0) override;
+	virtual int close(u_long flags = 0) override;
+
+private:
+	int connectProcConnector();
+	// receive and apply events, return false when socket failed
+	bool receiveEvents();
+	// collect descendants of root and mark them as members, m_mutex should be locked
+	void trackRoot(pid_t root);
+	void untrackRoot(pid_t root);
+
+private:
+	std::unordered_map<pid_t, pid_t> m_parent;
+	std::unordered_map<pid_t, std::unordered_set<pid_t>> m_children;
+	// member pid -> tracked roots it belongs to
+	std::unordered_map<pid_t, std::unordered_set<pid_t>> m_owners;
+	// root pid -> member pids including root
+	std::unordered_map<pid_t, std::unordered_set<pid_t>> m_members;
+	std::recursive_mutex m_mutex;
+
+	std::atomic<int> m_socket;
+	std::atomic<bool> m_enabled;
+	std::atomic<bool> m_exit;
+};
+
+#endif
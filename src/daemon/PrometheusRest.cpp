@@ -1,13 +1,15 @@
 #include <boost/algorithm/string_regex.hpp>
 #include "PrometheusRest.h"
 #include "ResourceCollection.h"
+#include "Configuration.h"
+#include "JobTable.h"
 #include "../common/Utility.h"
 #include "../prom_exporter/text_serializer.h"
 
 std::shared_ptr<PrometheusRest> PrometheusRest::m_instance;
 
 PrometheusRest::PrometheusRest(std::string ipaddress, int port)
-	:m_promScrapeCounter(0)
+	:m_promScrapeCounter(0), m_appCpuPercentFamily(0), m_appCpuSecondsFamily(0), m_appRestartStateFamily(0), m_jobRunningGauge(0), m_jobWaitP50Gauge(0), m_jobWaitP99Gauge(0)
 {
 	const static char fname[] = "PrometheusRest::PrometheusRest() ";
 
@@ -195,6 +197,81 @@ void PrometheusRest::initPromCounter()
 		.Register(*m_promRegistry)
 		.Add({ {"id", ResourceCollection::instance()->getHostName()}, {"pid", std::to_string(ResourceCollection::instance()->getPid())} })
 		.Set(1);
+	// Application cpu
+	m_appCpuPercentFamily = &prometheus::BuildGauge().Name("appmgr_app_cpu_percent")
+		.Help("application process tree cpu usage percent, 100 means one core")
+		.Register(*m_promRegistry);
+	m_appCpuSecondsFamily = &prometheus::BuildGauge().Name("appmgr_app_cpu_seconds")
+		.Help("application process tree cpu time in seconds since process start")
+		.Register(*m_promRegistry);
+	m_appRestartStateFamily = &prometheus::BuildGauge().Name("appmgr_app_restart_state")
+		.Help("application restart state, 0 is normal, 1 is backoff and 2 is circuit breaker open")
+		.Register(*m_promRegistry);
+
+	m_jobRunningGauge = &prometheus::BuildGauge().Name("appmgr_job_running")
+		.Help("remote run jobs started and not exited")
+		.Register(*m_promRegistry)
+		.Add({ {"id", ResourceCollection::instance()->getHostName()} });
+	auto& queuedFamily = prometheus::BuildGauge().Name("appmgr_job_queued")
+		.Help("remote run jobs waiting for concurrency limit")
+		.Register(*m_promRegistry);
+	for (auto priority : { JOB_PRIORITY_high, JOB_PRIORITY_normal, JOB_PRIORITY_low })
+	{
+		m_jobQueuedGauges.push_back(&queuedFamily.Add({ {"id", ResourceCollection::instance()->getHostName()}, {"priority", priority} }));
+	}
+	auto& waitFamily = prometheus::BuildGauge().Name("appmgr_job_wait_seconds")
+		.Help("queue wait of latest started remote run jobs")
+		.Register(*m_promRegistry);
+	m_jobWaitP50Gauge = &waitFamily.Add({ {"id", ResourceCollection::instance()->getHostName()}, {"quantile", "0.5"} });
+	m_jobWaitP99Gauge = &waitFamily.Add({ {"id", ResourceCollection::instance()->getHostName()}, {"quantile", "0.99"} });
+}
+
+void PrometheusRest::updateAppMetrics()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	std::set<std::string> appNames;
+	for (const auto& app : Configuration::instance()->getApps())
+	{
+		const auto name = app->getName();
+		appNames.insert(name);
+		auto it = m_appGauges.find(name);
+		if (it == m_appGauges.end())
+		{
+			std::map<std::string, std::string> labels = { {"id", ResourceCollection::instance()->getHostName()}, {"app", name} };
+			AppGauges gauges{ &m_appCpuPercentFamily->Add(labels), &m_appCpuSecondsFamily->Add(labels), &m_appRestartStateFamily->Add(labels) };
+			it = m_appGauges.insert(std::make_pair(name, gauges)).first;
+		}
+		it->second.cpuPercent->Set(app->getCpuPercent());
+		it->second.cpuSeconds->Set(app->getCpuSeconds());
+		it->second.restartState->Set(app->getRestartState());
+	}
+	// remove metrics of removed application
+	for (auto it = m_appGauges.begin(); it != m_appGauges.end();)
+	{
+		if (appNames.count(it->first) == 0)
+		{
+			m_appCpuPercentFamily->Remove(it->second.cpuPercent);
+			m_appCpuSecondsFamily->Remove(it->second.cpuSeconds);
+			m_appRestartStateFamily->Remove(it->second.restartState);
+			it = m_appGauges.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void PrometheusRest::updateJobMetrics()
+{
+	const auto stats = JobTable::instance()->getStats();
+	m_jobRunningGauge->Set(stats.running);
+	for (size_t priority = 0; priority < m_jobQueuedGauges.size(); priority++)
+	{
+		m_jobQueuedGauges[priority]->Set(stats.queued[priority]);
+	}
+	m_jobWaitP50Gauge->Set(stats.waitP50);
+	m_jobWaitP99Gauge->Set(stats.waitP99);
 }
 
 prometheus::Counter* PrometheusRest::createPromHttpCounter(std::string method)
@@ -214,6 +291,23 @@ prometheus::Counter* PrometheusRest::createPromHttpCounter(std::string method)
 	}
 }
 
+prometheus::Counter* PrometheusRest::createPromThrottleCounter(std::string routeClass, std::string limitBy)
+{
+	if (m_promRegistry != nullptr)
+	{
+		auto& counter = prometheus::BuildCounter()
+			.Name("appmgr_http_throttled_count")
+			.Help("application manager http request rejected by rate limit")
+			.Register(*m_promRegistry)
+			.Add({ {"id", ResourceCollection::instance()->getHostName()}, {"pid", std::to_string(ResourceCollection::instance()->getPid())}, {"class", routeClass}, {"limit", limitBy} });
+		return &counter;
+	}
+	else
+	{
+		return NULL;
+	}
+}
+
 void PrometheusRest::apiMetrics(const HttpRequest& message)
 {
 	const static char fname[] = "PrometheusRest::apiMetrics() ";
@@ -222,6 +316,8 @@ void PrometheusRest::apiMetrics(const HttpRequest& message)
 	static auto promSerializer = std::unique_ptr<prometheus::Serializer>(new prometheus::TextSerializer());
 
 	m_promScrapeCounter->Increment();
+	updateAppMetrics();
+	updateJobMetrics();
 
 	message.reply(status_codes::OK, promSerializer->Serialize(m_promRegistry->Collect()), "text/plain; version=0.0.4");
 }
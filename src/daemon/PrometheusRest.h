@@ -1,9 +1,11 @@
 #ifndef PROMETHEUS_REST_H
 #define PROMETHEUS_REST_H
 #include <memory>
+#include <vector>
 #include <cpprest/http_listener.h> // HTTP server 
 #include "../common/HttpRequest.h"
 #include "../prom_exporter/counter.h"
+#include "../prom_exporter/gauge.h"
 #include "../prom_exporter/registry.h"
 
 using namespace web;
@@ -21,11 +23,17 @@ public:
 	virtual ~PrometheusRest();
 	
 	prometheus::Counter* createPromHttpCounter(std::string method);
+	// requests rejected by RateLimiter, <limitBy> is the exhausted bucket: user or client
+	prometheus::Counter* createPromThrottleCounter(std::string routeClass, std::string limitBy);
 
 protected:
 	void open();
 	void close();
 	void initPromCounter();
+	// refresh per application gauges before each scrape
+	void updateAppMetrics();
+	// refresh remote run job queue gauges before each scrape
+	void updateJobMetrics();
 
 private:
 	void handleRest(const http_request& message, std::map<utility::string_t, std::function<void(const HttpRequest&)>>& restFunctions);
@@ -52,6 +60,22 @@ private:
 	// prometheus
 	prometheus::Counter* m_promScrapeCounter;
 	std::unique_ptr<prometheus::Registry> m_promRegistry;
+	prometheus::Family<prometheus::Gauge>* m_appCpuPercentFamily;
+	prometheus::Family<prometheus::Gauge>* m_appCpuSecondsFamily;
+	prometheus::Family<prometheus::Gauge>* m_appRestartStateFamily;
+	struct AppGauges
+	{
+		prometheus::Gauge* cpuPercent;
+		prometheus::Gauge* cpuSeconds;
+		prometheus::Gauge* restartState;
+	};
+	// app name to its gauges
+	std::map<std::string, AppGauges> m_appGauges;
+	prometheus::Gauge* m_jobRunningGauge;
+	// one for each priority class
+	std::vector<prometheus::Gauge*> m_jobQueuedGauges;
+	prometheus::Gauge* m_jobWaitP50Gauge;
+	prometheus::Gauge* m_jobWaitP99Gauge;
 
 public:
 	static std::shared_ptr<PrometheusRest> instance() { return m_instance; }
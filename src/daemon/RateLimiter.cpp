@@ -0,0 +1,140 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "RateLimiter.h"
+#include "../common/Utility.h"
+
+RateLimiter::RateLimiter()
+	:m_lastSweep(std::chrono::steady_clock::now())
+{
+}
+
+RateLimiter::~RateLimiter()
+{
+}
+
+web::json::value RateLimiter::AsJson()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto result = web::json::value::object();
+	for (const auto& limit : m_limits)
+	{
+		auto json = web::json::value::object();
+		json[JSON_KEY_RATE_user_rate] = web::json::value::number(limit.second.first.rate);
+		json[JSON_KEY_RATE_user_burst] = web::json::value::number(limit.second.first.burst);
+		json[JSON_KEY_RATE_client_rate] = web::json::value::number(limit.second.second.rate);
+		json[JSON_KEY_RATE_client_burst] = web::json::value::number(limit.second.second.burst);
+		result[limit.first] = json;
+	}
+	return result;
+}
+
+const std::shared_ptr<RateLimiter> RateLimiter::FromJson(const web::json::value& obj)
+{
+	const static char fname[] = "RateLimiter::FromJson() ";
+
+	auto limiter = std::make_shared<RateLimiter>();
+	for (const auto& classJson : obj.as_object())
+	{
+		auto routeClass = GET_STD_STRING(classJson.first);
+		if (routeClass != RATE_LIMIT_CLASS_view && routeClass != RATE_LIMIT_CLASS_run &&
+			routeClass != RATE_LIMIT_CLASS_control && routeClass != RATE_LIMIT_CLASS_file)
+		{
+			throw std::invalid_argument(std::string("unknown rate limit route class: ") + routeClass);
+		}
+		const auto& json = classJson.second;
+		Limit user{ 0, 0 }, client{ 0, 0 };
+		if (HAS_JSON_FIELD(json, JSON_KEY_RATE_user_rate)) user.rate = json.at(JSON_KEY_RATE_user_rate).as_double();
+		if (HAS_JSON_FIELD(json, JSON_KEY_RATE_user_burst)) user.burst = json.at(JSON_KEY_RATE_user_burst).as_double();
+		if (HAS_JSON_FIELD(json, JSON_KEY_RATE_client_rate)) client.rate = json.at(JSON_KEY_RATE_client_rate).as_double();
+		if (HAS_JSON_FIELD(json, JSON_KEY_RATE_client_burst)) client.burst = json.at(JSON_KEY_RATE_client_burst).as_double();
+		if (user.rate < 0 || client.rate < 0)
+		{
+			throw std::invalid_argument(std::string("negative rate limit for route class: ") + routeClass);
+		}
+		// burst less than one token would reject every request, default to one second of rate
+		if (user.burst < 1) user.burst = std::max(user.rate, 1.0);
+		if (client.burst < 1) client.burst = std::max(client.rate, 1.0);
+		limiter->m_limits[routeClass] = std::make_pair(user, client);
+		LOG_INF << fname << "rate limit <" << routeClass << "> user: " << user.rate << "/s burst " << user.burst
+			<< ", client: " << client.rate << "/s burst " << client.burst;
+	}
+	return limiter;
+}
+
+RateLimiter::Bucket& RateLimiter::refill(const std::string& key, const Limit& limit, const std::chrono::steady_clock::time_point& now)
+{
+	auto it = m_buckets.find(key);
+	if (it == m_buckets.end())
+	{
+		return m_buckets[key] = Bucket{ limit.burst, now };
+	}
+	auto& bucket = it->second;
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - bucket.last).count() / 1000000.0;
+	bucket.tokens = std::min(limit.burst, bucket.tokens + elapsed * limit.rate);
+	bucket.last = now;
+	return bucket;
+}
+
+int RateLimiter::retryAfter(const Bucket& bucket, const Limit& limit)
+{
+	return std::max(1, (int)std::ceil((1 - bucket.tokens) / limit.rate));
+}
+
+void RateLimiter::sweep(const std::chrono::steady_clock::time_point& now)
+{
+	m_lastSweep = now;
+	for (auto it = m_buckets.begin(); it != m_buckets.end();)
+	{
+		auto routeClass = it->first.substr(0, it->first.find('/'));
+		auto limit = m_limits.find(routeClass);
+		bool full = true;
+		if (limit != m_limits.end())
+		{
+			const auto& l = (it->first.compare(routeClass.length() + 1, strlen(RATE_LIMIT_BY_user), RATE_LIMIT_BY_user) == 0) ? limit->second.first : limit->second.second;
+			auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - it->second.last).count();
+			full = (it->second.tokens + elapsed * l.rate >= l.burst);
+		}
+		if (full)
+			it = m_buckets.erase(it);
+		else
+			++it;
+	}
+}
+
+std::string RateLimiter::admit(const std::string& routeClass, const std::string& user, const std::string& client, int& retryAfterSeconds)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto limit = m_limits.find(routeClass);
+	if (limit == m_limits.end()) return "";
+
+	const auto now = std::chrono::steady_clock::now();
+	if (now - m_lastSweep > std::chrono::seconds(RATE_LIMIT_SWEEP_SECONDS)) sweep(now);
+
+	const auto& userLimit = limit->second.first;
+	const auto& clientLimit = limit->second.second;
+	Bucket* userBucket = nullptr;
+	Bucket* clientBucket = nullptr;
+	if (userLimit.rate > 0 && user.length())
+	{
+		userBucket = &refill(routeClass + "/" + RATE_LIMIT_BY_user + "/" + user, userLimit, now);
+		if (userBucket->tokens < 1)
+		{
+			retryAfterSeconds = retryAfter(*userBucket, userLimit);
+			return RATE_LIMIT_BY_user;
+		}
+	}
+	if (clientLimit.rate > 0 && client.length())
+	{
+		clientBucket = &refill(routeClass + "/" + RATE_LIMIT_BY_client + "/" + client, clientLimit, now);
+		if (clientBucket->tokens < 1)
+		{
+			retryAfterSeconds = retryAfter(*clientBucket, clientLimit);
+			return RATE_LIMIT_BY_client;
+		}
+	}
+	// rejected request does not take token from the other bucket
+	if (userBucket) userBucket->tokens -= 1;
+	if (clientBucket) clientBucket->tokens -= 1;
+	return "";
+}
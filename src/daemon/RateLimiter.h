@@ -0,0 +1,57 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cpprest/json.h>
+
+//////////////////////////////////////////////////////////////////////////
+// REST admission control: one token bucket for each JWT user and one for
+// each remote address in every route class (view/run/control/file), a
+// request is admitted only when both buckets have a token; bucket size is
+// the burst a client can queue before being rejected with 429
+//////////////////////////////////////////////////////////////////////////
+class RateLimiter
+{
+public:
+	struct Limit
+	{
+		double rate;	// tokens per second, 0 means no limit
+		double burst;
+	};
+
+	RateLimiter();
+	virtual ~RateLimiter();
+
+	virtual web::json::value AsJson();
+	static const std::shared_ptr<RateLimiter> FromJson(const web::json::value& obj);
+
+	// take one token for <routeClass> from bucket of <user> and bucket of <client>,
+	// return empty when admitted, otherwise RATE_LIMIT_BY_user or RATE_LIMIT_BY_client
+	// for the exhausted bucket and seconds until a token is available
+	std::string admit(const std::string& routeClass, const std::string& user, const std::string& client, int& retryAfterSeconds);
+
+private:
+	struct Bucket
+	{
+		double tokens;
+		std::chrono::steady_clock::time_point last;
+	};
+	// refill bucket of <key>, a new bucket starts full
+	Bucket& refill(const std::string& key, const Limit& limit, const std::chrono::steady_clock::time_point& now);
+	static int retryAfter(const Bucket& bucket, const Limit& limit);
+	// drop full buckets, an idle client is not different from a new one
+	void sweep(const std::chrono::steady_clock::time_point& now);
+
+private:
+	// route class to user limit and client limit
+	std::map<std::string, std::pair<Limit, Limit>> m_limits;
+	// key: <class>/<user|client>/<name>
+	std::map<std::string, Bucket> m_buckets;
+	std::chrono::steady_clock::time_point m_lastSweep;
+	std::recursive_mutex m_mutex;
+};
+
+#endif
@@ -1,14 +1,18 @@
 #include <set>
+#include <thread>
 #include <ace/OS.h>
 #include "ResourceCollection.h"
 #include "../common/Utility.h"
+#include "../common/JsonWriter.h"
 #include "../common/os/net.hpp"
 #include "../common/os/pstree.hpp"
 #include "Configuration.h"
+#include "ProcessTracker.h"
+#include "TimeSeries.h"
 
 
 ResourceCollection::ResourceCollection()
-	: m_appmgrStartTime(std::chrono::system_clock::now())
+	: m_history(MAX_RESOURCE_HISTORY_SIZE), m_historyNext(0), m_exit(false), m_appmgrStartTime(std::chrono::system_clock::now())
 {
 }
 
@@ -34,15 +38,24 @@ std::string ResourceCollection::getHostName(bool refresh)
 	return hostname;
 }
 
-const HostResource& ResourceCollection::getHostResource()
+std::shared_ptr<const ResourceSnapshot> ResourceCollection::getHostResource()
 {
-	static auto cpus = os::cpus();
-	auto nets = net::links();
-	auto mem = os::memory();
+	auto snapshot = std::atomic_load(&m_snapshot);
+	if (snapshot == nullptr)
+	{
+		snapshot = sample();
+	}
+	return snapshot;
+}
 
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+std::shared_ptr<const ResourceSnapshot> ResourceCollection::sample()
+{
+	const static char fname[] = "ResourceCollection::sample() ";
 
-	m_resources.m_ipaddress.clear();
+	static auto cpus = os::cpus();
+	auto snapshot = std::make_shared<ResourceSnapshot>();
+	snapshot->m_time = std::chrono::system_clock::now();
+	auto& res = snapshot->m_resources;
 
 	// CPU
 	std::set<int> sockets;
@@ -52,24 +65,78 @@ const HostResource& ResourceCollection::getHostResource()
 		sockets.insert(c.socket);
 		processers.insert(c.id);
 	}
-	m_resources.m_cores = cpus.size();
-	m_resources.m_sockets = sockets.size();
-	m_resources.m_processors = processers.size();
+	res.m_cores = cpus.size();
+	res.m_sockets = sockets.size();
+	res.m_processors = processers.size();
 
 	// Memory
+	auto mem = os::memory();
 	if (mem != nullptr)
 	{
-		m_resources.m_total_bytes = mem->total_bytes;
-		m_resources.m_totalSwap_bytes = mem->totalSwap_bytes;
-		m_resources.m_free_bytes = mem->free_bytes;
-		m_resources.m_freeSwap_bytes = mem->freeSwap_bytes;
+		res.m_total_bytes = mem->total_bytes;
+		res.m_totalSwap_bytes = mem->totalSwap_bytes;
+		res.m_free_bytes = mem->free_bytes;
+		res.m_freeSwap_bytes = mem->freeSwap_bytes;
 	}
-	else
+	// when tracked, each tree is resolved from its own root: docker containers, processes attached after
+	// restart and orphans are not descendants of app manager. /proc is read for all processes at most once,
+	// when tracker is not enabled or a root is not known by tracker yet
+	const bool tracked = ProcessTracker::instance()->enabled();
+	std::unique_ptr<std::list<os::Process>> allProcesses;
+	auto processesOf = [tracked, &allProcesses](pid_t root, std::list<os::Process>& members) -> const std::list<os::Process>&
+	{
+		if (tracked && root > 0)
+		{
+			members = ProcessTracker::instance()->getProcesses(root);
+			if (!members.empty()) return members;
+		}
+		if (allProcesses == nullptr) allProcesses = std::make_unique<std::list<os::Process>>(os::processes());
+		return *allProcesses;
+	};
+	std::list<os::Process> members;
+	auto allAppMem = os::pstree(getPid(), processesOf(getPid(), members));
+	if (nullptr != allAppMem)
 	{
-		m_resources.m_total_bytes = m_resources.m_totalSwap_bytes = m_resources.m_free_bytes = m_resources.m_freeSwap_bytes = 0;
+		res.m_appmgr_bytes = allAppMem->totalRSS();
+	}
+	if (Configuration::instance() != nullptr)
+	{
+		for (const auto& app : Configuration::instance()->getApps())
+		{
+			app->sampleUsage(processesOf(app->getPid(), members), snapshot->m_time);
+		}
+	}
+	TimeSeriesStore::instance()->expire(std::chrono::duration_cast<std::chrono::seconds>(snapshot->m_time.time_since_epoch()).count());
+
+	// Load
+	auto load = os::loadavg();
+	if (load != nullptr)
+	{
+		res.m_hasLoad = true;
+		res.m_load1 = load->one;
+		res.m_load5 = load->five;
+		res.m_load15 = load->fifteen;
+	}
+
+	// FS
+	auto mountPoints = os::getMoundPoints();
+	for (const auto& pair : mountPoints)
+	{
+		auto usage = os::df(pair.first);
+		if (usage != nullptr)
+		{
+			HostFileSystem fs;
+			fs.device = pair.second;
+			fs.mountPoint = pair.first;
+			fs.size = usage->size;
+			fs.used = usage->used;
+			fs.usage = usage->usage;
+			res.m_fs.push_back(fs);
+		}
 	}
 
 	// Net
+	auto nets = net::links();
 	for (auto net : nets)
 	{
 		// do not need show lo
@@ -79,11 +146,120 @@ const HostResource& ResourceCollection::getHostResource()
 			inet.address = net.address;
 			inet.ipv4 = net.ipv4;
 			inet.name = net.name;
-			m_resources.m_ipaddress.push_back(inet);
+			res.m_ipaddress.push_back(inet);
 		}
 	}
 
-	return m_resources;
+	// build json once here, REST request only copy it
+	web::json::value result = web::json::value::object();
+	result[GET_STRING_T("host_name")] = web::json::value::string(GET_STRING_T(getHostName()));
+	result[GET_STRING_T("host_description")] = web::json::value::string(Configuration::instance() ? Configuration::instance()->getDescription() : "");
+	auto arr = web::json::value::array(res.m_ipaddress.size());
+	int idx = 0;
+	for (const auto& inet : res.m_ipaddress)
+	{
+		web::json::value net_detail = web::json::value::object();
+		net_detail["name"] = web::json::value::string(inet.name);
+		net_detail["ipv4"] = web::json::value::boolean(inet.ipv4);
+		net_detail["address"] = web::json::value::string(inet.address);
+		arr[idx++] = net_detail;
+	}
+	result[GET_STRING_T("net")] = arr;
+	result[GET_STRING_T("cpu_cores")] = web::json::value::number(res.m_cores);
+	result[GET_STRING_T("cpu_sockets")] = web::json::value::number(res.m_sockets);
+	result[GET_STRING_T("cpu_processors")] = web::json::value::number(res.m_processors);
+	result[GET_STRING_T("mem_total_bytes")] = web::json::value::number(res.m_total_bytes);
+	result[GET_STRING_T("mem_free_bytes")] = web::json::value::number(res.m_free_bytes);
+	result[GET_STRING_T("mem_totalSwap_bytes")] = web::json::value::number(res.m_totalSwap_bytes);
+	result[GET_STRING_T("mem_freeSwap_bytes")] = web::json::value::number(res.m_freeSwap_bytes);
+	if (nullptr != allAppMem)
+	{
+		result[GET_STRING_T("mem_applications")] = web::json::value::number(res.m_appmgr_bytes);
+	}
+	web::json::value sysLoad = web::json::value::object();
+	if (res.m_hasLoad)
+	{
+		sysLoad["1min"] = web::json::value::number(res.m_load1);
+		sysLoad["5min"] = web::json::value::number(res.m_load5);
+		sysLoad["15min"] = web::json::value::number(res.m_load15);
+		result[GET_STRING_T("load")] = sysLoad;
+	}
+	auto fsArr = web::json::value::array(res.m_fs.size());
+	idx = 0;
+	for (const auto& usage : res.m_fs)
+	{
+		web::json::value fs = web::json::value::object();
+		fs["size"] = web::json::value::number((uint64_t)usage.size);
+		fs["used"] = web::json::value::number((uint64_t)usage.used);
+		fs["usage"] = web::json::value::number(usage.usage);
+		fs["device"] = web::json::value::string(usage.device);
+		fs["mount_point"] = web::json::value::string(usage.mountPoint);
+		fsArr[idx++] = fs;
+	}
+	result[GET_STRING_T("fs")] = fsArr;
+	result[GET_STRING_T("app_metrics_store")] = TimeSeriesStore::instance()->AsJson();
+	result[GET_STRING_T("sample_time")] = web::json::value::string(Utility::getRfc3339Time(snapshot->m_time));
+	result[GET_STRING_T("appmgr_start_time")] = web::json::value::string(Utility::getRfc3339Time(m_appmgrStartTime));
+	result[GET_STRING_T("pid")] = web::json::value::number(getPid());
+	snapshot->m_json = result;
+
+	// history point only keep the changing values
+	web::json::value point = web::json::value::object();
+	point[GET_STRING_T("sample_time")] = result[GET_STRING_T("sample_time")];
+	point[GET_STRING_T("mem_free_bytes")] = web::json::value::number(res.m_free_bytes);
+	point[GET_STRING_T("mem_freeSwap_bytes")] = web::json::value::number(res.m_freeSwap_bytes);
+	point[GET_STRING_T("mem_applications")] = web::json::value::number(res.m_appmgr_bytes);
+	if (res.m_hasLoad) point[GET_STRING_T("load")] = sysLoad;
+	snapshot->m_point = point;
+
+	// publish
+	std::shared_ptr<const ResourceSnapshot> published = snapshot;
+	std::atomic_store(&m_snapshot, published);
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		m_history[m_historyNext] = published;
+		m_historyNext = (m_historyNext + 1) % m_history.size();
+	}
+	LOG_DBG << fname << "sampled in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - snapshot->m_time).count() << " ms";
+	return published;
+}
+
+int ResourceCollection::svc(void)
+{
+	const static char fname[] = "ResourceCollection::svc() ";
+	LOG_INF << fname << "Entered";
+
+	while (!m_exit)
+	{
+		try
+		{
+			sample();
+		}
+		catch (const std::exception& ex)
+		{
+			LOG_WAR << fname << "sample got exception: " << ex.what();
+		}
+		catch (...)
+		{
+			LOG_WAR << fname << " exception";
+		}
+		// interval can be changed by hot update
+		std::this_thread::sleep_for(std::chrono::seconds(Configuration::instance()->getResourceSampleInterval()));
+	}
+
+	LOG_WAR << fname << " thread exit";
+	return 0;
+}
+
+int ResourceCollection::open(void* args)
+{
+	return activate(THR_NEW_LWP | THR_JOINABLE | THR_CANCEL_ENABLE | THR_CANCEL_ASYNCHRONOUS, 1);
+}
+
+int ResourceCollection::close(u_long flags)
+{
+	m_exit = true;
+	return ACE_Task_Base::close(flags);
 }
 
 const pid_t ResourceCollection::getPid()
@@ -97,6 +273,12 @@ uint64_t ResourceCollection::getRssMemory(pid_t pid)
 	const static char fname[] = "ResourceCollection::getRssMemory() ";
 	if (pid > 0)
 	{
+		if (ProcessTracker::instance()->enabled())
+		{
+			uint64_t memory = 0;
+			for (const auto& proc : ProcessTracker::instance()->getProcesses(pid)) memory += proc.rss_bytes;
+			if (memory > 0) return memory;
+		}
 		auto tree = os::pstree(pid);
 		if (nullptr != tree)
 		{
@@ -115,90 +297,55 @@ void ResourceCollection::dump()
 {
 	const static char fname[] = "ResourceCollection::dump() ";
 
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto snapshot = getHostResource();
+	const auto& res = snapshot->m_resources;
 
 	LOG_DBG << fname << "host_name:" << getHostName();
-	for (auto& pair : m_resources.m_ipaddress)
+	for (auto& pair : res.m_ipaddress)
 	{
 		LOG_DBG << fname << "m_ipaddress: " << pair.name << "," << pair.ipv4 << "," << pair.address;
 	}
-	LOG_DBG << fname << "m_cores:" << m_resources.m_cores;
-	LOG_DBG << fname << "m_sockets:" << m_resources.m_sockets;
-	LOG_DBG << fname << "m_processors:" << m_resources.m_processors;
-	LOG_DBG << fname << "m_total_bytes:" << m_resources.m_total_bytes;
-	LOG_DBG << fname << "m_free_bytes:" << m_resources.m_free_bytes;
-	LOG_DBG << fname << "m_totalSwap_bytes:" << m_resources.m_totalSwap_bytes;
-	LOG_DBG << fname << "m_freeSwap_bytes:" << m_resources.m_freeSwap_bytes;
+	LOG_DBG << fname << "m_cores:" << res.m_cores;
+	LOG_DBG << fname << "m_sockets:" << res.m_sockets;
+	LOG_DBG << fname << "m_processors:" << res.m_processors;
+	LOG_DBG << fname << "m_total_bytes:" << res.m_total_bytes;
+	LOG_DBG << fname << "m_free_bytes:" << res.m_free_bytes;
+	LOG_DBG << fname << "m_totalSwap_bytes:" << res.m_totalSwap_bytes;
+	LOG_DBG << fname << "m_freeSwap_bytes:" << res.m_freeSwap_bytes;
 
 }
 
 web::json::value ResourceCollection::AsJson()
 {
-	const static char fname[] = "ResourceCollection::AsJson() ";
-	LOG_DBG << fname << "Entered";
-
-	this->getHostResource();
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return JsonTreeWriter::toJson([this](JsonWriter& writer) { writeJson(writer); });
+}
 
-	web::json::value result = web::json::value::object();
-	result[GET_STRING_T("host_name")] = web::json::value::string(GET_STRING_T(getHostName()));
-	result[GET_STRING_T("host_description")] = web::json::value::string(Configuration::instance()->getDescription());
-	auto arr = web::json::value::array(m_resources.m_ipaddress.size());
-	int idx = 0;
-	std::for_each(m_resources.m_ipaddress.begin(), m_resources.m_ipaddress.end(), [&arr, &idx](const  HostNetInterface& pair)
-		{
-			web::json::value net_detail = web::json::value::object();
-			net_detail["name"] = web::json::value::string(pair.name);
-			net_detail["ipv4"] = web::json::value::boolean(pair.ipv4);
-			net_detail["address"] = web::json::value::string(pair.address);
-			arr[idx++] = net_detail;
-		});
-	result[GET_STRING_T("net")] = arr;
-	result[GET_STRING_T("cpu_cores")] = web::json::value::number(m_resources.m_cores);
-	result[GET_STRING_T("cpu_sockets")] = web::json::value::number(m_resources.m_sockets);
-	result[GET_STRING_T("cpu_processors")] = web::json::value::number(m_resources.m_processors);
-	result[GET_STRING_T("mem_total_bytes")] = web::json::value::number(m_resources.m_total_bytes);
-	result[GET_STRING_T("mem_free_bytes")] = web::json::value::number(m_resources.m_free_bytes);
-	result[GET_STRING_T("mem_totalSwap_bytes")] = web::json::value::number(m_resources.m_totalSwap_bytes);
-	result[GET_STRING_T("mem_freeSwap_bytes")] = web::json::value::number(m_resources.m_freeSwap_bytes);
-	auto allAppMem = os::pstree();
-	if (nullptr != allAppMem)
+void ResourceCollection::writeJson(JsonWriter& writer)
+{
+	// snapshot is immutable after published
+	auto snapshot = getHostResource();
+	writer.startObject();
+	for (const auto& field : snapshot->m_json.as_object())
 	{
-		result[GET_STRING_T("mem_applications")] = web::json::value::number(allAppMem->totalRSS());
+		writer.key(GET_STD_STRING(field.first)).value(field.second);
 	}
-	// Load
-	auto load = os::loadavg();
-	if (load != nullptr)
+	writer.key("systime").value(Utility::getRfc3339Time(std::chrono::system_clock::now()));
+	writer.endObject();
+}
+
+web::json::value ResourceCollection::getHistoryJson(int seconds)
+{
+	auto since = std::chrono::system_clock::now() - std::chrono::seconds(seconds);
+	std::vector<web::json::value> points;
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// start from the oldest
+	for (size_t i = 0; i < m_history.size(); i++)
 	{
-		web::json::value sysLoad = web::json::value::object();
-		sysLoad["1min"] = web::json::value::number(load->one);
-		sysLoad["5min"] = web::json::value::number(load->five);
-		sysLoad["15min"] = web::json::value::number(load->fifteen);
-		result[GET_STRING_T("load")] = sysLoad;
-	}
-	// FS
-	auto mountPoints = os::getMoundPoints();
-	auto fsArr = web::json::value::array(mountPoints.size());
-	idx = 0;
-	std::for_each(mountPoints.begin(), mountPoints.end(), [&fsArr, &idx](const std::pair<std::string, std::string>& pair)
+		const auto& snapshot = m_history[(m_historyNext + i) % m_history.size()];
+		if (snapshot != nullptr && snapshot->m_time >= since)
 		{
-			auto usage = os::df(pair.first);
-			if (usage != nullptr)
-			{
-				web::json::value fs = web::json::value::object();
-				fs["size"] = web::json::value::number(usage->size);
-				fs["used"] = web::json::value::number(usage->used);
-				fs["usage"] = web::json::value::number(usage->usage);
-				fs["device"] = web::json::value::string(pair.second);
-				fs["mount_point"] = web::json::value::string(pair.first);
-				fsArr[idx++] = fs;
-			}
-		});
-
-	result[GET_STRING_T("fs")] = fsArr;
-	result[GET_STRING_T("systime")] = web::json::value::string(Utility::getRfc3339Time(std::chrono::system_clock::now()));
-	result[GET_STRING_T("appmgr_start_time")] = web::json::value::string(Utility::getRfc3339Time(m_appmgrStartTime));
-	result[GET_STRING_T("pid")] = web::json::value::number(getPid());
-	LOG_DBG << fname << "Exit";
-	return result;
+			points.push_back(snapshot->m_point);
+		}
+	}
+	return web::json::value::array(points);
 }
@@ -1,25 +1,39 @@
 #ifndef RESOURCE_COLLECTION_H
 #define RESOURCE_COLLECTION_H
 #include <mutex>
+#include <atomic>
+#include <vector>
 #include <memory>
 #include <string>
 #include <list>
 #include <unistd.h>
 #include <chrono>
+#include <ace/Task.h>
 #include <cpprest/json.h>
 
+class JsonWriter;
+
 struct HostNetInterface
 {
 	std::string name;
 	bool ipv4;
 	std::string address;
 };
+struct HostFileSystem
+{
+	std::string device;
+	std::string mountPoint;
+	uint64_t size;
+	uint64_t used;
+	double usage;
+};
 //////////////////////////////////////////////////////////////////////////
 // Host resource attribute
 //////////////////////////////////////////////////////////////////////////
 struct HostResource
 {
-	HostResource() :m_cores(0), m_sockets(0), m_processors(0), m_total_bytes(0), m_free_bytes(0), m_totalSwap_bytes(0), m_freeSwap_bytes(0) {}
+	HostResource() :m_cores(0), m_sockets(0), m_processors(0), m_total_bytes(0), m_free_bytes(0), m_totalSwap_bytes(0), m_freeSwap_bytes(0),
+		m_appmgr_bytes(0), m_hasLoad(false), m_load1(0), m_load5(0), m_load15(0) {}
 
 	// CPU
 	size_t m_cores;
@@ -30,16 +44,37 @@ struct HostResource
 	uint64_t m_free_bytes;
 	uint64_t m_totalSwap_bytes;
 	uint64_t m_freeSwap_bytes;
-	// TODO: disk
+	uint64_t m_appmgr_bytes;
+	// LOAD
+	bool m_hasLoad;
+	double m_load1;
+	double m_load5;
+	double m_load15;
+	// DISK
+	std::list<HostFileSystem> m_fs;
 
 	// NET
 	std::list<HostNetInterface> m_ipaddress;
 };
 
+//////////////////////////////////////////////////////////////////////////
+// One sample of host resource, immutable after published
+//////////////////////////////////////////////////////////////////////////
+struct ResourceSnapshot
+{
+	std::chrono::system_clock::time_point m_time;
+	HostResource m_resources;
+	// full response of /app-manager/resources
+	web::json::value m_json;
+	// compact time series point for history query
+	web::json::value m_point;
+};
+
 //////////////////////////////////////////////////////////////////////////
 // Collect host and application resource usage metrics
+// a sampler thread refresh host metrics periodically, REST read the latest snapshot
 //////////////////////////////////////////////////////////////////////////
-class ResourceCollection
+class ResourceCollection : public ACE_Task_Base
 {
 public:
 	ResourceCollection();
@@ -48,7 +83,8 @@ public:
 	static std::unique_ptr<ResourceCollection>& instance();
 
 	std::string getHostName(bool refresh = false);
-	const HostResource& getHostResource();
+	// latest published snapshot, sample once when sampler not started
+	std::shared_ptr<const ResourceSnapshot> getHostResource();
 	const pid_t getPid();
 
 	uint64_t getRssMemory(pid_t pid = getpid());
@@ -56,10 +92,26 @@ public:
 	void dump();
 
 	web::json::value AsJson();
+	// same content as AsJson(), the shared snapshot is written without copy
+	void writeJson(JsonWriter& writer);
+	// samples collected in last <seconds>, oldest first
+	web::json::value getHistoryJson(int seconds);
+
+	// sampler thread
+	virtual int svc(void) override;
+	virtual int open(void* args = 0) override;
+	virtual int close(u_long flags = 0) override;
 
 private:
-	HostResource m_resources;
+	// collect all host metrics and publish a new snapshot
+	std::shared_ptr<const ResourceSnapshot> sample();
+
+private:
+	std::shared_ptr<const ResourceSnapshot> m_snapshot;	// access by std::atomic_load/atomic_store
+	std::vector<std::shared_ptr<const ResourceSnapshot>> m_history;	// fixed size ring
+	size_t m_historyNext;
 	std::recursive_mutex m_mutex;
+	std::atomic<bool> m_exit;
 	const std::chrono::system_clock::time_point m_appmgrStartTime;
 };
 
@@ -1,12 +1,24 @@
 #include <chrono>
+#include <limits>
 #include <boost/algorithm/string_regex.hpp>
 #include <cpprest/filestream.h>
 #include <cpprest/http_client.h>
+#include <cpprest/producerconsumerstream.h>
 #include "RestHandler.h"
 #include "PrometheusRest.h"
 #include "Configuration.h"
 #include "ResourceCollection.h"
+#include "FileUpload.h"
+#include "EventStream.h"
+#include "TimeSeries.h"
+#include "HotUpgrade.h"
+#include "OutputStore.h"
+#include "OutputSearch.h"
+#include "JobTable.h"
+#include "MonitoredProcess.h"
 #include "../common/Utility.h"
+#include "../common/JsonWriter.h"
+#include "../common/CborCodec.h"
 #include "../common/jwt-cpp/jwt.h"
 #include "../common/os/linux.hpp"
 #include "../common/os/chown.hpp"
@@ -100,10 +112,16 @@ RestHandler::RestHandler(std::string ipaddress, int port)
 	bindRestMethod(web::http::methods::GET, R"(/app/([^/\*]+))", std::bind(&RestHandler::apiGetApp, this, std::placeholders::_1));
 	// http://127.0.0.1:6060/app/app-name/output
 	bindRestMethod(web::http::methods::GET, R"(/app/([^/\*]+)/output)", std::bind(&RestHandler::apiGetAppOutput, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/app/app-name/output/search?pattern=error&regex=0&since=1h
+	bindRestMethod(web::http::methods::GET, R"(/app/([^/\*]+)/output/search)", std::bind(&RestHandler::apiSearchAppOutput, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/app/app-name/metrics?metric=memory&range=6h&step=5m
+	bindRestMethod(web::http::methods::GET, R"(/app/([^/\*]+)/metrics)", std::bind(&RestHandler::apiGetAppMetrics, this, std::placeholders::_1));
 	// http://127.0.0.1:6060/app-manager/applications
 	bindRestMethod(web::http::methods::GET, "/app-manager/applications", std::bind(&RestHandler::apiGetApps, this, std::placeholders::_1));
 	// http://127.0.0.1:6060/app-manager/resources
 	bindRestMethod(web::http::methods::GET, "/app-manager/resources", std::bind(&RestHandler::apiGetResources, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/app-manager/events?since=0&timeout=300
+	bindRestMethod(web::http::methods::GET, "/app-manager/events", std::bind(&RestHandler::apiGetEvents, this, std::placeholders::_1));
 
 	// 3. Manage Application
 	// http://127.0.0.1:6060/app/app-name
@@ -114,6 +132,8 @@ RestHandler::RestHandler(std::string ipaddress, int port)
 	bindRestMethod(web::http::methods::POST, R"(/app/([^/\*]+)/disable)", std::bind(&RestHandler::apiDisableApp, this, std::placeholders::_1));
 	// http://127.0.0.1:6060/app/appname
 	bindRestMethod(web::http::methods::DEL, R"(/app/([^/\*]+))", std::bind(&RestHandler::apiDeleteApp, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/apps/batch
+	bindRestMethod(web::http::methods::POST, "/apps/batch", std::bind(&RestHandler::apiBatchApps, this, std::placeholders::_1));
 
 	// 4. Operate Application
 	// http://127.0.0.1:6060/app/run?timeout=5
@@ -122,12 +142,24 @@ RestHandler::RestHandler(std::string ipaddress, int port)
 	bindRestMethod(web::http::methods::GET, R"(/app/([^/\*]+)/run/output)", std::bind(&RestHandler::apiRunAsyncOut, this, std::placeholders::_1));
 	// http://127.0.0.1:6060/app/syncrun?timeout=5
 	bindRestMethod(web::http::methods::POST, "/app/syncrun", std::bind(&RestHandler::apiRunSync, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/app-manager/jobs
+	bindRestMethod(web::http::methods::GET, "/app-manager/jobs", std::bind(&RestHandler::apiGetJobs, this, std::placeholders::_1));
 
 	// 5. File Management
 	// http://127.0.0.1:6060/download
 	bindRestMethod(web::http::methods::GET, "/download", std::bind(&RestHandler::apiFileDownload, this, std::placeholders::_1));
 	// http://127.0.0.1:6060/upload
 	bindRestMethod(web::http::methods::POST, "/upload", std::bind(&RestHandler::apiFileUpload, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/upload/session
+	bindRestMethod(web::http::methods::POST, "/upload/session", std::bind(&RestHandler::apiUploadSessionCreate, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/upload/session/session-id
+	bindRestMethod(web::http::methods::GET, R"(/upload/session/([^/\*]+))", std::bind(&RestHandler::apiUploadSessionStatus, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/upload/session/session-id?offset=0
+	bindRestMethod(web::http::methods::PUT, R"(/upload/session/([^/\*]+))", std::bind(&RestHandler::apiUploadSessionChunk, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/upload/session/session-id/commit
+	bindRestMethod(web::http::methods::POST, R"(/upload/session/([^/\*]+)/commit)", std::bind(&RestHandler::apiUploadSessionCommit, this, std::placeholders::_1));
+	// http://127.0.0.1:6060/upload/session/session-id
+	bindRestMethod(web::http::methods::DEL, R"(/upload/session/([^/\*]+))", std::bind(&RestHandler::apiUploadSessionAbort, this, std::placeholders::_1));
 
 	// 6. Label Management
 	// http://127.0.0.1:6060/labels
@@ -140,6 +172,7 @@ RestHandler::RestHandler(std::string ipaddress, int port)
 	// 7. Log level
 	bindRestMethod(web::http::methods::GET, "/app-manager/config", std::bind(&RestHandler::apiGetBasicConfig, this, std::placeholders::_1));
 	bindRestMethod(web::http::methods::POST, "/app-manager/config", std::bind(&RestHandler::apiSetBasicConfig, this, std::placeholders::_1));
+	bindRestMethod(web::http::methods::POST, "/app-manager/reexec", std::bind(&RestHandler::apiReexec, this, std::placeholders::_1));
 
 	// 8. Security
 	bindRestMethod(web::http::methods::POST, R"(/user/([^/\*]+)/passwd)", std::bind(&RestHandler::apiChangePassword, this, std::placeholders::_1));
@@ -153,6 +186,13 @@ RestHandler::RestHandler(std::string ipaddress, int port)
 	m_restPutCounter = PrometheusRest::instance()->createPromHttpCounter("PUT");
 	m_restDelCounter = PrometheusRest::instance()->createPromHttpCounter("DELETE");
 	m_restPostCounter = PrometheusRest::instance()->createPromHttpCounter("POST");
+	for (const auto& routeClass : { RATE_LIMIT_CLASS_view, RATE_LIMIT_CLASS_run, RATE_LIMIT_CLASS_control, RATE_LIMIT_CLASS_file })
+	{
+		for (const auto& limitBy : { RATE_LIMIT_BY_user, RATE_LIMIT_BY_client })
+		{
+			m_throttleCounters[std::string(routeClass) + "/" + limitBy] = PrometheusRest::instance()->createPromThrottleCounter(routeClass, limitBy);
+		}
+	}
 
 
 	this->open();
@@ -240,6 +280,72 @@ void RestHandler::handleRest(const http_request& message, std::map<utility::stri
 		return;
 	}
 
+	// admission control before any work of the request, include remote permission resolve
+	int retryAfter = 0;
+	auto routeClass = getRouteClass(request.method(), path);
+	auto limitBy = Configuration::instance()->getRateLimiter()->admit(routeClass, getRateLimitUser(request), GET_STD_STRING(request.remote_address()), retryAfter);
+	if (limitBy.length())
+	{
+		auto counter = m_throttleCounters.find(routeClass + "/" + limitBy);
+		if (counter != m_throttleCounters.end() && counter->second) counter->second->Increment();
+		LOG_DBG << fname << "rest " << path << " from " << request.remote_address() << " throttled by " << routeClass << " " << limitBy << " limit";
+		web::http::http_response resp(HTTP_STATUS_TooManyRequests);
+		resp.headers().add(HTTP_HEADER_KEY_Retry_After, retryAfter);
+		resp.set_body(std::string("Too many ") + routeClass + " requests for " + limitBy + ", retry after " + std::to_string(retryAfter) + " seconds");
+		request.reply(resp);
+		return;
+	}
+
+	// token user permissions are resolved by redirect server in continuation,
+	// pool thread is not held while waiting for the remote reply
+	if (Configuration::instance()->getJwtEnabled() && Configuration::instance()->getJwtRedirectUrl().length() &&
+		!request.headers().has(HTTP_HEADER_JWT_redirect_from) && request.headers().has(HTTP_HEADER_JWT_Authorization))
+	{
+		requestHttp(web::http::methods::GET, "/auth/permissions", {}, {}, NULL, getTokenStr(request))
+			.then([](http_response resp)
+				{
+					return resp.extract_utf8string(true).then([resp](utf8string body) { return std::make_pair(resp.status_code(), body); });
+				})
+			.then([this, request, path, stdFunction](pplx::task<std::pair<status_code, utf8string>> t)
+				{
+					std::set<std::string> permissions;
+					std::string error;
+					try
+					{
+						auto resp = t.get();
+						if (resp.first == status_codes::OK)
+						{
+							auto json = web::json::value::parse(resp.second);
+							for (const auto& permission : json.as_array()) permissions.insert(GET_STD_STRING(permission.as_string()));
+						}
+						else
+						{
+							LOG_WAR << fname << "Remote " << Configuration::instance()->getJwtRedirectUrl() << " permissions return code: " << resp.first;
+							error = resp.second.length() ? resp.second : "Remote permission check failed";
+						}
+					}
+					catch (const std::exception& e)
+					{
+						LOG_WAR << fname << "Remote " << Configuration::instance()->getJwtRedirectUrl() << " permissions failed: " << e.what();
+						error = e.what();
+					}
+					catch (...)
+					{
+						error = "Remote permission check failed";
+					}
+					auto remoteRequest = request;
+					remoteRequest.setRemotePermissions(permissions, error);
+					dispatchRest(remoteRequest, path, stdFunction);
+				});
+		return;
+	}
+	dispatchRest(request, path, stdFunction);
+}
+
+void RestHandler::dispatchRest(const HttpRequest& request, const std::string& path, const std::function<void(const HttpRequest&)>& stdFunction)
+{
+	static char fname[] = "RestHandler::dispatchRest() ";
+
 	try
 	{
 		// LOG_DBG << fname << "rest " << path;
@@ -257,6 +363,58 @@ void RestHandler::handleRest(const http_request& message, std::map<utility::stri
 	}
 }
 
+std::string RestHandler::getRouteClass(const web::http::method& mtd, const std::string& path) const
+{
+	if (path == "/app/run" || path == "/app/syncrun" ||
+		(path.length() > strlen("/run/output") && path.compare(path.length() - strlen("/run/output"), std::string::npos, "/run/output") == 0))
+	{
+		return RATE_LIMIT_CLASS_run;
+	}
+	if (path == "/download" || Utility::startWith(path, "/upload"))
+	{
+		return RATE_LIMIT_CLASS_file;
+	}
+	return (mtd == web::http::methods::GET) ? RATE_LIMIT_CLASS_view : RATE_LIMIT_CLASS_control;
+}
+
+std::string RestHandler::getRateLimitUser(const HttpRequest& message)
+{
+	if (!Configuration::instance()->getJwtEnabled() || !message.headers().has(HTTP_HEADER_JWT_Authorization)) return "";
+	try
+	{
+		// token is verified locally in redirect mode too, a forged user name is not admitted to a user bucket
+		return verifyToken(message);
+	}
+	catch (...)
+	{
+		return "";
+	}
+}
+
+void RestHandler::handleAsync(const HttpRequest& message, const pplx::task<void>& task)
+{
+	const static char fname[] = "RestHandler::handleAsync() ";
+
+	// exception from continuation is replied the same as dispatchRest() does
+	task.then([message](pplx::task<void> t)
+		{
+			try
+			{
+				t.get();
+			}
+			catch (const std::exception& e)
+			{
+				LOG_WAR << fname << "rest " << message.relative_uri().path() << " failed :" << e.what();
+				message.reply(web::http::status_codes::BadRequest, e.what());
+			}
+			catch (...)
+			{
+				LOG_WAR << fname << "rest " << message.relative_uri().path() << " failed";
+				message.reply(web::http::status_codes::BadRequest, "unknow exception");
+			}
+		});
+}
+
 void RestHandler::bindRestMethod(web::http::method method, std::string path, std::function< void(const HttpRequest&)> func)
 {
 	static char fname[] = "RestHandler::bindRest() ";
@@ -348,28 +506,27 @@ bool RestHandler::permissionCheck(const HttpRequest& message, const std::string&
 	auto userName = verifyToken(message);
 	if (permission.length() && userName.length() && Configuration::instance()->getJwtEnabled())
 	{
-		// 1. redirect to remote permission check
+		// 1. remote permissions resolved by handleRest() before dispatch
 		if (Configuration::instance()->getJwtRedirectUrl().length() &&
 			!message.headers().has(HTTP_HEADER_JWT_redirect_from))
 		{
-			std::map<std::string, std::string> headers;
-			if (permission.length()) headers[HTTP_HEADER_JWT_auth_permission] = permission;
-			auto userName = getTokenUser(message);
-			auto resp = requestHttp(
-				web::http::methods::POST,
-				std::string("/auth/") + userName,
-				{}, headers,
-				NULL,
-				getTokenStr(message));
-			if (resp.status_code() == status_codes::OK)
+			if (!message.remotePermissionsResolved())
+			{
+				throw std::invalid_argument("Remote permission not resolved");
+			}
+			if (message.getRemotePermissionsError().length())
+			{
+				throw std::invalid_argument(message.getRemotePermissionsError());
+			}
+			if (message.getRemotePermissions().count(permission))
 			{
 				return true;
 			}
 			else
 			{
 				LOG_WAR << fname << "Remote " << Configuration::instance()->getJwtRedirectUrl() << " permission <"
-					<< permission << "> for user: " << userName << " return code: " << resp.status_code();
-				throw std::invalid_argument(resp.extract_utf8string().get());
+					<< permission << "> denied for user: " << userName;
+				throw std::invalid_argument("Permission denied");
 			}
 		}
 		else
@@ -432,28 +589,54 @@ std::string RestHandler::createToken(const std::string& uname, const std::string
 	return std::move(token);
 }
 
-void RestHandler::cleanTempApp(int timerId)
+void RestHandler::replyJson(const HttpRequest& message, const web::json::value& json, bool defaultPretty) const
 {
-	const static char fname[] = "RestHandler::cleanTempApp() ";
+	std::string contentType;
+	auto body = serializeJson(message, json, defaultPretty, contentType);
+	message.reply(status_codes::OK, body, contentType);
+}
 
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	if (m_tempAppsForClean.count(timerId))
+std::string RestHandler::serializeJson(const HttpRequest& message, const web::json::value& json, bool defaultPretty, std::string& contentType) const
+{
+	// binary encoding by content negotiation, same field names as json
+	if (isCborAccepted(message))
 	{
-		auto app = m_tempAppsForClean[timerId];
-		Configuration::instance()->removeApp(app);
+		contentType = HTTP_CONTENT_TYPE_cbor;
+		return CborCodec::encode(json);
 	}
-	m_tempAppsForClean.erase(timerId);
+	// ?pretty=0 return compact json
+	bool pretty = getHttpQueryValue(message, HTTP_QUERY_KEY_pretty, defaultPretty, 0, 0);
+	contentType = HTTP_CONTENT_TYPE_json;
+	return JsonWriter::toString(json, pretty);
+}
 
-	LOG_DBG << fname << "timer id: " << timerId << " left map size : " << m_tempAppsForClean.size();
+void RestHandler::replyJson(const HttpRequest& message, const std::function<void(JsonWriter&)>& write, bool defaultPretty) const
+{
+	std::string contentType;
+	auto body = serializeJson(message, write, defaultPretty, contentType);
+	message.reply(status_codes::OK, body, contentType);
 }
 
-void RestHandler::cleanTempAppByName(std::string appNameStr)
+std::string RestHandler::serializeJson(const HttpRequest& message, const std::function<void(JsonWriter&)>& write, bool defaultPretty, std::string& contentType) const
 {
-	const static char fname[] = "RestHandler::cleanTempAppByName() ";
+	if (isCborAccepted(message))
+	{
+		contentType = HTTP_CONTENT_TYPE_cbor;
+		return CborCodec::encode(JsonTreeWriter::toJson(write));
+	}
+	bool pretty = getHttpQueryValue(message, HTTP_QUERY_KEY_pretty, defaultPretty, 0, 0);
+	contentType = HTTP_CONTENT_TYPE_json;
+	return JsonWriter::toString(write, pretty);
+}
 
-	// see RestHandler::apiSyncRun
-	LOG_DBG << fname << appNameStr;
-	Configuration::instance()->removeApp(appNameStr);
+bool RestHandler::isCborAccepted(const HttpRequest& message) const
+{
+	if (message.headers().has(U(HTTP_HEADER_KEY_Accept)))
+	{
+		auto accept = GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_Accept))->second);
+		return accept.find(HTTP_CONTENT_TYPE_cbor) != std::string::npos;
+	}
+	return false;
 }
 
 int RestHandler::getHttpQueryValue(const HttpRequest& message, const std::string key, int defaultValue, int min, int max) const
@@ -471,6 +654,33 @@ int RestHandler::getHttpQueryValue(const HttpRequest& message, const std::string
 	return rt;
 }
 
+uint64_t RestHandler::toUnsigned(const std::string& key, const std::string& value)
+{
+	// stoull accepts sign and trailing text
+	if (!Utility::isNumber(value)) throw std::invalid_argument(key + " should be a non-negative integer");
+	try
+	{
+		return std::stoull(value);
+	}
+	catch (const std::out_of_range&)
+	{
+		throw std::invalid_argument(key + " is out of range");
+	}
+}
+
+int64_t RestHandler::toSigned(const std::string& key, const std::string& value)
+{
+	if (!Utility::isNumber(value.length() && value[0] == '-' ? value.substr(1) : value)) throw std::invalid_argument(key + " should be an integer");
+	try
+	{
+		return std::stoll(value);
+	}
+	catch (const std::out_of_range&)
+	{
+		throw std::invalid_argument(key + " is out of range");
+	}
+}
+
 void RestHandler::apiEnableApp(const HttpRequest& message)
 {
 	permissionCheck(message, PERMISSION_KEY_app_control);
@@ -508,6 +718,38 @@ void RestHandler::apiDeleteApp(const HttpRequest& message)
 	message.reply(status_codes::OK, msg);
 }
 
+void RestHandler::apiBatchApps(const HttpRequest& message)
+{
+	const static char fname[] = "RestHandler::apiBatchApps() ";
+
+	handleAsync(message, message.extract_json(true).then([this, message](web::json::value operations)
+		{
+			if (!operations.is_array())
+			{
+				throw std::invalid_argument("invalid json format, batch operations should be a json array");
+			}
+
+			// check permission for each kind of operation in this batch
+			std::set<std::string> permissions;
+			for (const auto& op : operations.as_array())
+			{
+				auto operation = GET_JSON_STR_VALUE(op, JSON_KEY_BATCH_operation);
+				if (operation == BATCH_OPERATION_register) permissions.insert(PERMISSION_KEY_app_reg);
+				else if (operation == BATCH_OPERATION_enable || operation == BATCH_OPERATION_disable) permissions.insert(PERMISSION_KEY_app_control);
+				else if (operation == BATCH_OPERATION_delete) permissions.insert(PERMISSION_KEY_app_delete);
+			}
+			if (permissions.empty()) permissionCheck(message, "");
+			for (const auto& permission : permissions) permissionCheck(message, permission);
+
+			bool applied = false;
+			web::json::value result = web::json::value::object();
+			result[JSON_KEY_BATCH_results] = Configuration::instance()->applyBatch(operations, applied);
+			result[JSON_KEY_BATCH_applied] = web::json::value::boolean(applied);
+			LOG_DBG << fname << "operations: " << operations.size() << " applied: " << applied;
+			message.reply(applied ? status_codes::OK : status_codes::BadRequest, result);
+		}));
+}
+
 void RestHandler::apiFileDownload(const HttpRequest& message)
 {
 	const static char fname[] = "RestHandler::apiFileDownload() ";
@@ -603,10 +845,114 @@ void RestHandler::apiFileUpload(const HttpRequest& message)
 				});
 }
 
+std::string RestHandler::getUploadSessionId(const HttpRequest& message) const
+{
+	// /upload/session/$session-id[/commit]
+	auto path = GET_STD_STRING(http::uri::decode(message.relative_uri().path()));
+	auto vec = Utility::splitString(path, "/");
+	if (vec.size() < 3)
+	{
+		throw std::invalid_argument("failed to get upload session id from path");
+	}
+	return vec[2];
+}
+
+void RestHandler::apiUploadSessionCreate(const HttpRequest& message)
+{
+	const static char fname[] = "RestHandler::apiUploadSessionCreate() ";
+	permissionCheck(message, PERMISSION_KEY_file_upload);
+	if (!message.headers().has(U(HTTP_HEADER_KEY_file_path)) || !message.headers().has(U(HTTP_HEADER_KEY_file_size)))
+	{
+		message.reply(status_codes::BadRequest, "file_path and file_size header are required");
+		return;
+	}
+	auto file = GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_file_path))->second);
+	auto fileSize = std::stoull(GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_file_size))->second));
+	size_t chunkSize = DEFAULT_UPLOAD_CHUNK_SIZE;
+	if (message.headers().has(U(HTTP_HEADER_KEY_file_chunk_size)))
+	{
+		chunkSize = std::stoull(GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_file_chunk_size))->second));
+	}
+	bool overwrite = getHttpQueryValue(message, HTTP_QUERY_KEY_overwrite, false, 0, 0);
+
+	auto session = UploadManager::instance()->createSession(file, fileSize, chunkSize, overwrite);
+	LOG_DBG << fname << "Uploading file <" << file << "> with session <" << session->getId() << ">";
+	replyJson(message, session->AsJson(), false);
+}
+
+void RestHandler::apiUploadSessionStatus(const HttpRequest& message)
+{
+	permissionCheck(message, PERMISSION_KEY_file_upload);
+	auto session = UploadManager::instance()->getSession(getUploadSessionId(message));
+	replyJson(message, session->AsJson(), false);
+}
+
+void RestHandler::apiUploadSessionChunk(const HttpRequest& message)
+{
+	const static char fname[] = "RestHandler::apiUploadSessionChunk() ";
+	permissionCheck(message, PERMISSION_KEY_file_upload);
+	auto session = UploadManager::instance()->getSession(getUploadSessionId(message));
+
+	// offset can exceed int range, getHttpQueryValue() is not used here
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	if (querymap.find(U(HTTP_QUERY_KEY_offset)) == querymap.end())
+	{
+		throw std::invalid_argument("offset is required for upload chunk");
+	}
+	uint64_t offset = std::stoull(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_offset))->second));
+
+	message.extract_vector().then([=](pplx::task<std::vector<unsigned char>> t)
+		{
+			try
+			{
+				session->writeChunk(offset, t.get());
+				message.reply(status_codes::OK).then([this](pplx::task<void> t) { this->handle_error(t); });
+			}
+			catch (const std::exception& e)
+			{
+				LOG_WAR << fname << "session <" << session->getId() << "> offset <" << offset << "> failed: " << e.what();
+				message.reply(status_codes::BadRequest, e.what()).then([this](pplx::task<void> t) { this->handle_error(t); });
+			}
+		});
+}
+
+void RestHandler::apiUploadSessionCommit(const HttpRequest& message)
+{
+	permissionCheck(message, PERMISSION_KEY_file_upload);
+	auto sessionId = getUploadSessionId(message);
+	auto session = UploadManager::instance()->getSession(sessionId);
+
+	std::string sha256, fileMode, fileUser;
+	if (message.headers().has(U(HTTP_HEADER_KEY_file_sha256))) sha256 = GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_file_sha256))->second);
+	if (message.headers().has(U(HTTP_HEADER_KEY_file_mode))) fileMode = GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_file_mode))->second);
+	if (message.headers().has(U(HTTP_HEADER_KEY_file_user))) fileUser = GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_file_user))->second);
+	try
+	{
+		session->commit(sha256, fileMode, fileUser);
+	}
+	catch (...)
+	{
+		// a failed checksum invalidate the whole session, missing chunks can still be resumed
+		if (session->isClosed()) UploadManager::instance()->removeSession(sessionId);
+		throw;
+	}
+	UploadManager::instance()->removeSession(sessionId);
+	message.reply(status_codes::OK, "Success");
+}
+
+void RestHandler::apiUploadSessionAbort(const HttpRequest& message)
+{
+	permissionCheck(message, PERMISSION_KEY_file_upload);
+	auto sessionId = getUploadSessionId(message);
+	UploadManager::instance()->getSession(sessionId);
+	UploadManager::instance()->removeSession(sessionId);
+	message.reply(status_codes::OK);
+}
+
 void RestHandler::apiGetTags(const HttpRequest& message)
 {
 	permissionCheck(message, PERMISSION_KEY_label_view);
-	message.reply(status_codes::OK, Configuration::instance()->getLabel()->AsJson());
+	replyJson(message, Configuration::instance()->getLabel()->AsJson(), false);
 }
 
 void RestHandler::apiTagAdd(const HttpRequest& message)
@@ -648,21 +994,18 @@ void RestHandler::apiTagDel(const HttpRequest& message)
 
 void RestHandler::apiGetPermissions(const HttpRequest& message)
 {
-	if (Configuration::instance()->getJwtRedirectUrl().length() &&
-		!message.headers().has(HTTP_HEADER_JWT_redirect_from))
+	std::set<std::string> permissions;
+	if (message.remotePermissionsResolved())
 	{
-		auto resp = requestHttp(
-			web::http::methods::GET,
-			"/auth/permissions",
-			{}, {},
-			NULL,
-			getTokenStr(message));
-		message.reply(resp.status_code(), resp.body());
-		return;
+		// already resolved by redirect server before dispatch
+		if (message.getRemotePermissionsError().length()) throw std::invalid_argument(message.getRemotePermissionsError());
+		permissions = message.getRemotePermissions();
+	}
+	else
+	{
+		auto userName = verifyToken(message);
+		permissions = Configuration::instance()->getUserPermissions(userName);
 	}
-
-	auto userName = verifyToken(message);
-	auto permissions = Configuration::instance()->getUserPermissions(userName);
 	auto json = web::json::value::array(permissions.size());
 	int index = 0;
 	for (auto perm : permissions)
@@ -679,7 +1022,7 @@ void RestHandler::apiGetBasicConfig(const HttpRequest& message)
 	// admin can get whole configure info include user & role
 	bool isAdmin = (getTokenUser(message) == JWT_ADMIN_NAME);
 
-	auto config = web::json::value::parse(Configuration::instance()->getSecureConfigContentStr());
+	auto config = Configuration::instance()->getSecureConfigJson();
 
 	if (!isAdmin)
 	{
@@ -690,18 +1033,29 @@ void RestHandler::apiGetBasicConfig(const HttpRequest& message)
 			if (json.second.is_object() || json.second.is_array()) config.erase(json.first);
 		}
 	}
-	message.reply(status_codes::OK, Utility::prettyJson(GET_STD_STRING(config.serialize())));
+	replyJson(message, config, true);
 }
 
 void RestHandler::apiSetBasicConfig(const HttpRequest& message)
 {
 	permissionCheck(message, PERMISSION_KEY_config_set);
 
-	Configuration::instance()->hotUpdate(message.extract_json().get(), true);
+	handleAsync(message, message.extract_json().then([this, message](web::json::value json)
+		{
+			Configuration::instance()->hotUpdate(json, true);
 
-	Configuration::instance()->saveConfigToDisk();
+			Configuration::instance()->saveConfigToDisk();
+
+			apiGetBasicConfig(message);
+		}));
+}
+
+void RestHandler::apiReexec(const HttpRequest& message)
+{
+	permissionCheck(message, PERMISSION_KEY_config_set);
 
-	apiGetBasicConfig(message);
+	HotUpgrade::instance()->request();
+	message.reply(status_codes::OK, std::string("Daemon re-exec scheduled, running applications are kept"));
 }
 
 void RestHandler::apiChangePassword(const HttpRequest& message)
@@ -842,13 +1196,15 @@ void RestHandler::apiLogin(const HttpRequest& message)
 			headers[HTTP_HEADER_JWT_username] = message.headers().find(HTTP_HEADER_JWT_username)->second;
 			headers[HTTP_HEADER_JWT_password] = message.headers().find(HTTP_HEADER_JWT_password)->second;
 			headers[HTTP_HEADER_JWT_expire_seconds] = std::to_string(timeoutSeconds);
-			auto resp = requestHttp(
+			handleAsync(message, requestHttp(
 				web::http::methods::POST,
 				"/login",
 				{}, headers,
 				NULL,
-				getTokenStr(message));
-			message.reply(resp.status_code(), resp.body());
+				getTokenStr(message)).then([message](http_response resp)
+					{
+						message.reply(resp.status_code(), resp.body());
+					}));
 			return;
 		}
 
@@ -905,40 +1261,90 @@ void RestHandler::apiGetApp(const HttpRequest& message)
 	permissionCheck(message, PERMISSION_KEY_view_app);
 	auto path = GET_STD_STRING(http::uri::decode(message.relative_uri().path()));
 	std::string app = path.substr(strlen("/app/"));
-	message.reply(status_codes::OK, Utility::prettyJson(GET_STD_STRING(Configuration::instance()->getApp(app)->AsJson(true).serialize())));
+	auto application = Configuration::instance()->getApp(app);
+	replyJson(message, [&application](JsonWriter& writer) { application->writeJson(writer, true); }, true);
 }
 
-std::shared_ptr<Application> RestHandler::apiRunParseApp(const HttpRequest& message)
+std::string RestHandler::runJob(const HttpRequest& message, const web::json::value& jsonJob, int timeout, int retention, bool sync, std::string& processUuid, size_t& queuePosition)
 {
-	auto jsonApp = const_cast<HttpRequest*>(&message)->extract_json(true).get();
-	// force specify a UUID app name
-	auto appName = Utility::createUUID();
-	jsonApp[JSON_KEY_APP_name] = web::json::value::string(appName);
-	jsonApp[JSON_KEY_APP_status] = web::json::value::number(STATUS::NOTAVIALABLE);
-	jsonApp[JSON_KEY_APP_cache_lines] = web::json::value::number(MAX_APP_CACHED_LINES);
-	return Configuration::instance()->addApp(jsonApp);
+	const static char fname[] = "RestHandler::runJob() ";
+
+	if (GET_JSON_STR_VALUE(jsonJob, JSON_KEY_APP_docker_image).length())
+	{
+		throw std::invalid_argument("Docker application does not support this API");
+	}
+	// read the same as Application::FromJson()
+	auto command = Utility::stdStringTrim(GET_JSON_STR_VALUE(jsonJob, JSON_KEY_APP_command));
+	if (command.empty()) throw std::invalid_argument("command is required");
+	if (command.length() > MAX_COMMAND_LINE_LENGH) throw std::invalid_argument("command line lengh should less than 2048");
+	auto user = Utility::stdStringTrim(GET_JSON_STR_VALUE(jsonJob, JSON_KEY_APP_user));
+	if (user.empty()) user = "root";
+	std::map<std::string, std::string> envMap;
+	if (HAS_JSON_FIELD(jsonJob, JSON_KEY_APP_env))
+	{
+		for (const auto& env : jsonJob.at(JSON_KEY_APP_env).as_object())
+		{
+			envMap[GET_STD_STRING(env.first)] = GET_STD_STRING(env.second.as_string());
+		}
+	}
+
+	std::shared_ptr<ResourceLimitation> limit;
+	if (HAS_JSON_FIELD(jsonJob, JSON_KEY_APP_resource_limit))
+	{
+		limit = ResourceLimitation::FromJson(jsonJob.at(JSON_KEY_APP_resource_limit), "");
+	}
+	auto workDir = Utility::stdStringTrim(GET_JSON_STR_VALUE(jsonJob, JSON_KEY_APP_working_dir));
+
+	auto process = std::make_shared<MonitoredProcess>(MAX_APP_CACHED_LINES);
+	JobTable::JobRequest request;
+	// verified token user, the os user job runs as when JWT is disabled
+	request.user = verifyToken(message);
+	if (request.user.empty()) request.user = user;
+	request.label = GET_JSON_STR_VALUE(jsonJob, JSON_KEY_JOB_label);
+	request.priority = JobTable::parsePriority(GET_JSON_STR_VALUE(jsonJob, JSON_KEY_JOB_priority));
+	request.timeoutSeconds = timeout;
+	request.retentionSeconds = retention;
+	// called when the job leaves queue, from the job table thread or this thread
+	request.launch = [message, process, command, user, workDir, envMap, limit, sync](const std::string& name)
+	{
+		if (limit != nullptr) limit->n_name = name;
+		if (sync)
+		{
+			// reader thread replies output and release job when pipe closed
+			process->setAsyncHttpRequest(new HttpRequestWithCallback(message, name, [](std::string jobName) { JobTable::instance()->release(jobName); }));
+		}
+		if (process->spawnProcess(command, user, workDir, envMap, limit) <= 0)
+		{
+			throw std::invalid_argument("Start process failed");
+		}
+		LOG_INF << fname << "job <" << name << "> started with pid <" << process->getpid() << ">";
+	};
+	if (sync)
+	{
+		request.fail = [message](const std::string& error) { message.reply(status_codes::BadRequest, error); };
+	}
+	auto name = JobTable::instance()->submit(process, request, queuePosition);
+	processUuid = process->getuuid();
+	return name;
 }
 
 void RestHandler::apiRunAsync(const HttpRequest& message)
 {
-	const static char fname[] = "RestHandler::apiAsyncRun() ";
 	permissionCheck(message, PERMISSION_KEY_run_app_async);
 
 	int retention = getHttpQueryValue(message, HTTP_QUERY_KEY_retention, DEFAULT_RUN_APP_RETENTION_DURATION, 1, 60 * 60 * 24);
 	int timeout = getHttpQueryValue(message, HTTP_QUERY_KEY_timeout, DEFAULT_RUN_APP_TIMEOUT_SECONDS, 1, 60 * 60 * 24);
-	auto appObj = apiRunParseApp(message);
-
-	auto processUuid = appObj->runAsyncrize(timeout);
-	auto result = web::json::value::object();
-	result[JSON_KEY_APP_name] = web::json::value::string(appObj->getName());
-	result[HTTP_QUERY_KEY_process_uuid] = web::json::value::string(processUuid);
-	message.reply(status_codes::OK, result);
-
-	// Save cleaup footprint
-	std::lock_guard<std::recursive_mutex> guard(m_mutex);
-	auto timerId = this->registerTimer(timeout + retention, 0,
-		std::bind(&RestHandler::cleanTempApp, this, std::placeholders::_1), fname);
-	m_tempAppsForClean[timerId] = appObj->getName();
+	handleAsync(message, message.extract_json(true).then([this, message, retention, timeout](web::json::value jsonJob)
+		{
+			std::string processUuid;
+			size_t queuePosition = 0;
+			auto name = runJob(message, jsonJob, timeout, retention, false, processUuid, queuePosition);
+			auto result = web::json::value::object();
+			result[JSON_KEY_APP_name] = web::json::value::string(name);
+			result[HTTP_QUERY_KEY_process_uuid] = web::json::value::string(processUuid);
+			result[JSON_KEY_JOB_queue_position] = web::json::value::number((uint32_t)queuePosition);
+			message.reply(status_codes::OK, result);
+		}));
 }
 
 void RestHandler::apiRunSync(const HttpRequest& message)
@@ -946,11 +1352,13 @@ void RestHandler::apiRunSync(const HttpRequest& message)
 	permissionCheck(message, PERMISSION_KEY_run_app_sync);
 
 	int timeout = getHttpQueryValue(message, HTTP_QUERY_KEY_timeout, DEFAULT_RUN_APP_TIMEOUT_SECONDS, 1, 60 * 60 * 24);
-	auto appObj = apiRunParseApp(message);
-
-	// Use async reply here
-	HttpRequest* asyncRequest = new HttpRequestWithCallback(message, appObj->getName(), std::bind(&RestHandler::cleanTempAppByName, this, std::placeholders::_1));
-	appObj->runSyncrize(timeout, asyncRequest);
+	handleAsync(message, message.extract_json(true).then([this, message, timeout](web::json::value jsonJob)
+		{
+			// Use async reply here, output is replied when process exit
+			std::string processUuid;
+			size_t queuePosition = 0;
+			runJob(message, jsonJob, timeout, DEFAULT_RUN_APP_RETENTION_DURATION, true, processUuid, queuePosition);
+		}));
 }
 
 void RestHandler::apiRunAsyncOut(const HttpRequest& message)
@@ -970,16 +1378,20 @@ void RestHandler::apiRunAsyncOut(const HttpRequest& message)
 
 		int exitCode = 0;
 		bool finished = false;
-		auto appObj = Configuration::instance()->getApp(app);
-		std::string body = appObj->getAsyncRunOutput(uuid, exitCode, finished);
+		size_t queuePosition = 0;
+		std::string body;
+		// remote run job is released by job table once finished, configured application is queried at last
+		if (!JobTable::instance()->fetchOutput(app, uuid, body, exitCode, finished, queuePosition))
+		{
+			body = Configuration::instance()->getApp(app)->getAsyncRunOutput(uuid, exitCode, finished);
+		}
 		web::http::http_response resp(status_codes::OK);
 		resp.set_body(body);
+		if (queuePosition) resp.headers().add(HTTP_HEADER_KEY_queue_position, queuePosition);
 		if (finished)
 		{
 			resp.set_status_code(status_codes::Created);
 			resp.headers().add(HTTP_HEADER_KEY_exit_code, exitCode);
-			// remove temp app immediately
-			if (appObj->isUnAvialable()) Configuration::instance()->removeApp(app);
 		}
 
 		LOG_DBG << fname << "Use process uuid :" << uuid << " exit_code:" << exitCode;
@@ -1002,37 +1414,357 @@ void RestHandler::apiGetAppOutput(const HttpRequest& message)
 	// /app/$app-name/output
 	std::string app = path.substr(strlen("/app/"));
 	app = app.substr(0, app.find_first_of('/'));
+
+	// /app/$app-name/output?offset=0&length=1024 or ?from=1580000000&to=1580003600 read history from output store
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	auto queryValue = [&querymap](const std::string& key) { return GET_STD_STRING(querymap.find(U(key))->second); };
+	if (querymap.count(U(HTTP_QUERY_KEY_offset)) || querymap.count(U(HTTP_QUERY_KEY_from)) || querymap.count(U(HTTP_QUERY_KEY_to)))
+	{
+		Configuration::instance()->getApp(app);
+		if (!Configuration::instance()->getOutputStoreEnabled())
+		{
+			throw std::invalid_argument("output history is not available, OutputStoreEnabled is false");
+		}
+		auto log = OutputStore::instance()->getLog(app);
+		uint64_t offset = 0;
+		uint64_t end = std::numeric_limits<uint64_t>::max();
+		size_t length = MAX_OUTPUT_READ_BYTES;
+		if (querymap.count(U(HTTP_QUERY_KEY_offset))) offset = toUnsigned(HTTP_QUERY_KEY_offset, queryValue(HTTP_QUERY_KEY_offset));
+		if (querymap.count(U(HTTP_QUERY_KEY_from))) offset = log->seek(toSigned(HTTP_QUERY_KEY_from, queryValue(HTTP_QUERY_KEY_from)));
+		if (querymap.count(U(HTTP_QUERY_KEY_to)))
+		{
+			// output at <to> second is included
+			auto to = toSigned(HTTP_QUERY_KEY_to, queryValue(HTTP_QUERY_KEY_to));
+			end = log->seek(to < std::numeric_limits<int64_t>::max() ? to + 1 : to);
+		}
+		if (querymap.count(U(HTTP_QUERY_KEY_length))) length = std::min<uint64_t>(length, toUnsigned(HTTP_QUERY_KEY_length, queryValue(HTTP_QUERY_KEY_length)));
+
+		std::string output;
+		auto next = log->read(offset, end, length, output);
+		web::http::http_response resp(status_codes::OK);
+		resp.set_body(output);
+		// continue with offset returned in header
+		resp.headers().add(HTTP_HEADER_KEY_output_offset, next);
+		LOG_DBG << fname << "app <" << app << "> offset <" << offset << "> next <" << next << ">";
+		message.reply(resp);
+		return;
+	}
 	bool keepHis = getHttpQueryValue(message, HTTP_QUERY_KEY_keep_history, false, 0, 0);
 	auto output = Configuration::instance()->getApp(app)->getOutput(keepHis);
 	LOG_DBG << fname;// << output;
 	message.reply(status_codes::OK, output);
 }
 
+void RestHandler::apiSearchAppOutput(const HttpRequest& message)
+{
+	const static char fname[] = "RestHandler::apiSearchAppOutput() ";
+
+	permissionCheck(message, PERMISSION_KEY_view_app_output);
+	auto path = GET_STD_STRING(http::uri::decode(message.relative_uri().path()));
+
+	// /app/$app-name/output/search
+	std::string app = path.substr(strlen("/app/"));
+	app = app.substr(0, app.find_first_of('/'));
+	auto appObj = Configuration::instance()->getApp(app);
+
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	auto queryValue = [&querymap](const std::string& key) { return GET_STD_STRING(querymap.find(U(key))->second); };
+	if (!querymap.count(U(HTTP_QUERY_KEY_pattern)) || queryValue(HTTP_QUERY_KEY_pattern).empty())
+	{
+		throw std::invalid_argument("pattern is required for output search");
+	}
+	auto pattern = queryValue(HTTP_QUERY_KEY_pattern);
+	bool regex = getHttpQueryValue(message, HTTP_QUERY_KEY_regex, false, 0, 0);
+	int limit = getHttpQueryValue(message, HTTP_QUERY_KEY_limit, DEFAULT_OUTPUT_SEARCH_MATCHES, 0, 0);
+	limit = std::min(std::max(limit, 1), MAX_OUTPUT_SEARCH_MATCHES);
+	uint64_t offset = querymap.count(U(HTTP_QUERY_KEY_offset)) ? toUnsigned(HTTP_QUERY_KEY_offset, queryValue(HTTP_QUERY_KEY_offset)) : 0;
+	int64_t since = 0;
+	if (querymap.count(U(HTTP_QUERY_KEY_since)))
+	{
+		since = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		since -= Utility::parseDurationSeconds(queryValue(HTTP_QUERY_KEY_since));
+	}
+
+	// regex is compiled once for all lines, scan stops at match limit or CPU budget
+	OutputSearch search(pattern, regex, offset, limit, MAX_OUTPUT_SEARCH_BYTES, MAX_OUTPUT_SEARCH_MILLISECONDS);
+	bool history = Configuration::instance()->getOutputStoreEnabled();
+	if (history)
+	{
+		// segment history includes the cached lines
+		auto log = OutputStore::instance()->getLog(app);
+		if (since) offset = std::max(offset, log->seek(since));
+		auto end = log->endOffset();
+		auto scanned = log->scan(offset, end, std::numeric_limits<uint64_t>::max(), [&search](uint64_t offset, const char* data, size_t len)
+			{
+				return search.scan(offset, data, len);
+			});
+		if (search.complete() && scanned >= end) search.finish();
+		for (auto& match : search.matches()) match.time = log->timeAt(match.offset);
+	}
+	else
+	{
+		appObj->searchOutput(search, offset, since);
+	}
+
+	web::json::value result = web::json::value::object();
+	auto matches = web::json::value::array(search.matches().size());
+	for (size_t i = 0; i < search.matches().size(); i++)
+	{
+		const auto& match = search.matches()[i];
+		auto item = web::json::value::object();
+		item[JSON_KEY_SEARCH_offset] = web::json::value::number(match.offset);
+		item[JSON_KEY_SEARCH_time] = web::json::value::number(match.time);
+		item[JSON_KEY_SEARCH_line] = web::json::value::string(GET_STRING_T(match.line));
+		matches[i] = item;
+	}
+	result[JSON_KEY_APP_name] = web::json::value::string(app);
+	result[JSON_KEY_SEARCH_matches] = matches;
+	result[JSON_KEY_SEARCH_next_offset] = web::json::value::number(search.nextOffset());
+	result[JSON_KEY_SEARCH_complete] = web::json::value::boolean(search.complete());
+	result[JSON_KEY_SEARCH_scanned_bytes] = web::json::value::number(search.scannedBytes());
+	result[JSON_KEY_SEARCH_history] = web::json::value::boolean(history);
+	LOG_DBG << fname << "app <" << app << "> pattern <" << pattern << "> matches <" << search.matches().size() << "> scanned <" << search.scannedBytes() << ">";
+	replyJson(message, result, false);
+}
+
+void RestHandler::apiGetAppMetrics(const HttpRequest& message)
+{
+	const static char fname[] = "RestHandler::apiGetAppMetrics() ";
+
+	permissionCheck(message, PERMISSION_KEY_view_app);
+	auto path = GET_STD_STRING(http::uri::decode(message.relative_uri().path()));
+
+	// /app/$app-name/metrics
+	std::string app = path.substr(strlen("/app/"));
+	app = app.substr(0, app.find_first_of('/'));
+	Configuration::instance()->getApp(app);
+
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	int range = 60 * 60;
+	int64_t step = 0;
+	if (querymap.find(U(HTTP_QUERY_KEY_range)) != querymap.end())
+	{
+		range = Utility::parseDurationSeconds(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_range))->second));
+		range = std::min(range, DEFAULT_TIMESERIES_RETENTION_SECONDS);
+	}
+	if (querymap.find(U(HTTP_QUERY_KEY_step)) != querymap.end())
+	{
+		step = Utility::parseDurationSeconds(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_step))->second));
+	}
+	if (step <= 0)
+	{
+		// same step for all metrics
+		step = std::max<int64_t>(1, (range + MAX_TIMESERIES_QUERY_POINTS - 1) / MAX_TIMESERIES_QUERY_POINTS);
+	}
+	std::vector<std::string> metrics;
+	if (querymap.find(U(HTTP_QUERY_KEY_metric)) != querymap.end())
+	{
+		metrics = Utility::splitString(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_metric))->second), ",");
+	}
+	else
+	{
+		metrics = TimeSeriesStore::instance()->getMetrics(app);
+	}
+
+	auto to = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	auto from = to - range;
+	web::json::value result = web::json::value::object();
+	result[JSON_KEY_APP_name] = web::json::value::string(app);
+	result[JSON_KEY_TIMESERIES_from] = web::json::value::number(from);
+	result[JSON_KEY_TIMESERIES_to] = web::json::value::number(to);
+	result[JSON_KEY_TIMESERIES_step] = web::json::value::number(step);
+	web::json::value series = web::json::value::object();
+	for (const auto& metric : metrics)
+	{
+		auto name = Utility::stdStringTrim(metric);
+		if (name.length()) series[name] = TimeSeriesStore::instance()->query(app, name, from, to, step);
+	}
+	result[JSON_KEY_TIMESERIES_metrics] = series;
+	LOG_DBG << fname << "app <" << app << "> range <" << range << "> step <" << step << ">";
+	replyJson(message, result, false);
+}
+
 void RestHandler::apiGetApps(const HttpRequest& message)
 {
+	const static char fname[] = "RestHandler::apiGetApps() ";
 	permissionCheck(message, PERMISSION_KEY_view_all_app);
-	message.reply(status_codes::OK, Configuration::instance()->getApplicationJson(true));
+
+	// ?fields=name,status,pid&since=generation
+	std::set<std::string> fields;
+	uint64_t since = 0;
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	if (querymap.find(U(HTTP_QUERY_KEY_fields)) != querymap.end())
+	{
+		auto fieldsStr = GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_fields))->second);
+		for (const auto& field : Utility::splitString(fieldsStr, ","))
+		{
+			auto key = Utility::stdStringTrim(field);
+			if (key.length()) fields.insert(key);
+		}
+	}
+	if (querymap.find(U(HTTP_QUERY_KEY_since)) != querymap.end())
+	{
+		since = std::stoull(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_since))->second));
+	}
+
+	// ETag is generation plus query, memory, cpu and restarts in window change over time without changing
+	// generation, so response with them has no ETag and is never 304
+	auto generation = Configuration::instance()->getGeneration();
+	bool sampledFields = (fields.empty() || fields.count(JSON_KEY_APP_memory) || fields.count(JSON_KEY_APP_cpu_percent) ||
+		fields.count(JSON_KEY_APP_cpu_seconds) || fields.count(JSON_KEY_APP_restarts_in_window));
+	std::string etag;
+	if (!sampledFields)
+	{
+		std::string fieldsStr;
+		for (const auto& field : fields) fieldsStr.append(field).append(",");
+		// json and cbor body have different ETag
+		if (message.headers().has(U(HTTP_HEADER_KEY_Accept))) fieldsStr.append(GET_STD_STRING(message.headers().find(U(HTTP_HEADER_KEY_Accept))->second));
+		etag = std::string("\"") + std::to_string(generation) + "-" + std::to_string(std::hash<std::string>()(fieldsStr + std::to_string(since))) + "\"";
+		if (message.headers().has(web::http::header_names::if_none_match))
+		{
+			// weak comparison, W/ prefix of client tag is ignored
+			auto ifNoneMatch = GET_STD_STRING(message.headers().find(web::http::header_names::if_none_match)->second);
+			if (ifNoneMatch.find(etag) != std::string::npos)
+			{
+				web::http::http_response resp(status_codes::NotModified);
+				resp.headers().add(web::http::header_names::etag, etag);
+				message.reply(resp);
+				return;
+			}
+		}
+	}
+
+	web::http::http_response resp(status_codes::OK);
+	if (etag.length()) resp.headers().add(web::http::header_names::etag, etag);
+	resp.headers().add(HTTP_HEADER_KEY_generation, generation);
+	std::string contentType;
+	if (since == 0)
+	{
+		auto body = serializeJson(message, [&fields](JsonWriter& writer) { Configuration::instance()->writeApplicationJson(writer, true, fields); }, false, contentType);
+		resp.set_body(body, contentType);
+	}
+	else
+	{
+		// delta response, full means client should drop local apps not in this response
+		bool complete = true;
+		auto removed = Configuration::instance()->getRemovedApps(since, complete);
+		auto body = serializeJson(message, [&](JsonWriter& writer)
+		{
+			writer.startObject();
+			writer.key(JSON_KEY_DELTA_generation).value(generation);
+			writer.key(JSON_KEY_DELTA_full).value(!complete);
+			writer.key(JSON_KEY_DELTA_apps);
+			Configuration::instance()->writeApplicationJson(writer, true, fields, complete ? since : 0);
+			writer.key(JSON_KEY_DELTA_removed).startArray();
+			for (const auto& name : removed) writer.value(name);
+			writer.endArray();
+			writer.endObject();
+		}, false, contentType);
+		resp.set_body(body, contentType);
+	}
+	LOG_DBG << fname << "generation <" << generation << "> since <" << since << "> fields <" << fieldsStr << ">";
+	message.reply(resp);
 }
 
 void RestHandler::apiGetResources(const HttpRequest& message)
 {
 	permissionCheck(message, PERMISSION_KEY_view_host_resource);
-	message.reply(status_codes::OK, Utility::prettyJson(GET_STD_STRING(ResourceCollection::instance()->AsJson().serialize())));
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	if (querymap.find(U(HTTP_QUERY_KEY_history)) != querymap.end())
+	{
+		// ?history=5m return samples of the last 5 minutes
+		auto seconds = Utility::parseDurationSeconds(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_history))->second));
+		replyJson(message, ResourceCollection::instance()->getHistoryJson(seconds), false);
+	}
+	else
+	{
+		replyJson(message, [](JsonWriter& writer) { ResourceCollection::instance()->writeJson(writer); }, true);
+	}
 }
 
-void RestHandler::apiRegApp(const HttpRequest& message)
+void RestHandler::apiGetJobs(const HttpRequest& message)
 {
-	permissionCheck(message, PERMISSION_KEY_app_reg);
-	auto jsonApp = message.extract_json(true).get();
-	if (jsonApp.is_null())
+	permissionCheck(message, PERMISSION_KEY_view_all_app);
+	replyJson(message, JobTable::instance()->AsJson(), true);
+}
+
+void RestHandler::apiGetEvents(const HttpRequest& message)
+{
+	const static char fname[] = "RestHandler::apiGetEvents() ";
+	permissionCheck(message, PERMISSION_KEY_view_all_app);
+
+	// default only stream new events
+	uint64_t since = EventStream::instance()->lastSequence();
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.relative_uri().query()));
+	if (querymap.find(U(HTTP_QUERY_KEY_since)) != querymap.end())
 	{
-		throw std::invalid_argument("invalid json format");
+		since = std::stoull(GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_since))->second));
+	}
+	int timeout = getHttpQueryValue(message, HTTP_QUERY_KEY_timeout, DEFAULT_EVENT_STREAM_SECONDS, 0, 0);
+	timeout = std::min(std::max(timeout, 1), MAX_EVENT_STREAM_SECONDS);
+
+	if (!EventStream::instance()->addClient())
+	{
+		message.reply(status_codes::ServiceUnavailable, "Too many event stream clients");
+		return;
 	}
-	auto app = Configuration::instance()->addApp(jsonApp);
-	message.reply(status_codes::OK, Utility::prettyJson(GET_STD_STRING(app->AsJson(false).serialize())));
+
+	// chunked NDJSON response, one event per line, an empty line is heartbeat;
+	// stream ends at timeout, client reconnect with since=<last seq> to resume
+	concurrency::streams::producer_consumer_buffer<uint8_t> buffer;
+	message.reply(status_codes::OK, buffer.create_istream(), U("application/x-ndjson"));
+	LOG_DBG << fname << "stream events since <" << since << "> for <" << timeout << "> seconds";
+
+	std::thread([buffer, since, timeout]() mutable
+		{
+			const static char fname[] = "RestHandler::eventStreamThread() ";
+			auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(timeout);
+			try
+			{
+				while (buffer.can_write() && std::chrono::system_clock::now() < deadline)
+				{
+					bool lost = false;
+					auto from = since;
+					auto heartbeat = std::min(deadline, std::chrono::system_clock::now() + std::chrono::seconds(EVENT_STREAM_HEARTBEAT_SECONDS));
+					auto lines = EventStream::instance()->wait(since, heartbeat, lost);
+					if (lost)
+					{
+						// client should re-sync full state
+						web::json::value event = web::json::value::object();
+						event[JSON_KEY_EVENT_seq] = web::json::value::number(from);
+						event[JSON_KEY_EVENT_type] = web::json::value::string(EVENT_TYPE_lost);
+						lines.insert(0, GET_STD_STRING(event.serialize()).append("\n"));
+					}
+					if (lines.empty()) lines = "\n";
+					buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(lines.data()), lines.length()).wait();
+					buffer.sync().wait();
+				}
+			}
+			catch (const std::exception& e)
+			{
+				LOG_WAR << fname << e.what();
+			}
+			buffer.close(std::ios_base::out).wait();
+			EventStream::instance()->removeClient();
+			LOG_DBG << fname << "stream closed at <" << since << ">";
+		}).detach();
+}
+
+void RestHandler::apiRegApp(const HttpRequest& message)
+{
+	permissionCheck(message, PERMISSION_KEY_app_reg);
+	handleAsync(message, message.extract_json(true).then([this, message](web::json::value jsonApp)
+		{
+			if (jsonApp.is_null())
+			{
+				throw std::invalid_argument("invalid json format");
+			}
+			auto app = Configuration::instance()->addApp(jsonApp);
+			replyJson(message, [&app](JsonWriter& writer) { app->writeJson(writer, false); }, true);
+		}));
 }
 
-http_response RestHandler::requestHttp(const method& mtd, const std::string& path, std::map<std::string, std::string> query, std::map<std::string, std::string> header, web::json::value* body, const std::string& token)
+pplx::task<http_response> RestHandler::requestHttp(const method& mtd, const std::string& path, std::map<std::string, std::string> query, std::map<std::string, std::string> header, web::json::value* body, const std::string& token)
 {
 	const static char fname[] = "RestHandler::requestHttp() ";
 
@@ -1065,6 +1797,6 @@ http_response RestHandler::requestHttp(const method& mtd, const std::string& pat
 	{
 		request.set_body(*body);
 	}
-	http_response response = client.request(request).get();
-	return std::move(response);
+	// client internal context is kept by the pending request
+	return client.request(request);
 }
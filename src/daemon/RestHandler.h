@@ -14,6 +14,7 @@ using namespace utility;
 using namespace http::experimental::listener;
 
 class Application;
+class JsonWriter;
 //////////////////////////////////////////////////////////////////////////
 // REST service
 //////////////////////////////////////////////////////////////////////////
@@ -29,6 +30,13 @@ protected:
 
 private:
 	void handleRest(const http_request& message, std::map<utility::string_t, std::function<void(const HttpRequest&)>>& restFunctions);
+	void dispatchRest(const HttpRequest& request, const std::string& path, const std::function<void(const HttpRequest&)>& stdFunction);
+	// reply exception of handler continuation, handler return without waiting for body or remote reply
+	void handleAsync(const HttpRequest& message, const pplx::task<void>& task);
+	// rate limit route class of a request: view, run, control or file
+	std::string getRouteClass(const web::http::method& mtd, const std::string& path) const;
+	// user of rate limit bucket, empty when token is not valid
+	std::string getRateLimitUser(const HttpRequest& message);
 	void bindRestMethod(web::http::method method, std::string path, std::function< void(const HttpRequest&)> func);
 	void handle_get(const HttpRequest& message);
 	void handle_put(const HttpRequest& message);
@@ -42,38 +50,61 @@ private:
 	bool permissionCheck(const HttpRequest& message, const std::string& permission);
 	std::string getTokenStr(const HttpRequest& message);
 	std::string createToken(const std::string& uname, const std::string& passwd, int timeoutSeconds);
-	void cleanTempApp(int timerId = 0);
-	void cleanTempAppByName(std::string appNameStr);
+	// serialize json with JsonWriter and reply, pretty format can be override by ?pretty=
+	void replyJson(const HttpRequest& message, const web::json::value& json, bool defaultPretty) const;
+	// CBOR when request Accept application/cbor, otherwise JSON, contentType is set accordingly
+	std::string serializeJson(const HttpRequest& message, const web::json::value& json, bool defaultPretty, std::string& contentType) const;
+	// same as above with the body written by <write>, a json tree is only built for CBOR
+	void replyJson(const HttpRequest& message, const std::function<void(JsonWriter&)>& write, bool defaultPretty) const;
+	std::string serializeJson(const HttpRequest& message, const std::function<void(JsonWriter&)>& write, bool defaultPretty, std::string& contentType) const;
+	bool isCborAccepted(const HttpRequest& message) const;
 	int getHttpQueryValue(const HttpRequest& message, const std::string key, int defaultValue, int min, int max) const;
+	// number of query <key>, throw std::invalid_argument for bad format or out of range
+	static uint64_t toUnsigned(const std::string& key, const std::string& value);
+	static int64_t toSigned(const std::string& key, const std::string& value);
 
 	void apiLogin(const HttpRequest& message);
 	void apiAuth(const HttpRequest& message);
 	void apiGetApp(const HttpRequest& message);
-	std::shared_ptr<Application> apiRunParseApp(const HttpRequest& message);
+	// queue remote run job of <jsonJob> in JobTable, sync job replies output to <message> when process exit,
+	// return job name, process uuid and queue position (0 when started)
+	std::string runJob(const HttpRequest& message, const web::json::value& jsonJob, int timeout, int retention, bool sync, std::string& processUuid, size_t& queuePosition);
 	void apiRunAsync(const HttpRequest& message);
 	void apiRunSync(const HttpRequest& message);
 	void apiRunAsyncOut(const HttpRequest& message);
+	void apiGetJobs(const HttpRequest& message);
 	void apiGetAppOutput(const HttpRequest& message);
+	void apiSearchAppOutput(const HttpRequest& message);
+	void apiGetAppMetrics(const HttpRequest& message);
 	void apiGetApps(const HttpRequest& message);
 	void apiGetResources(const HttpRequest& message);
+	void apiGetEvents(const HttpRequest& message);
 	void apiRegApp(const HttpRequest& message);
 	void apiEnableApp(const HttpRequest& message);
 	void apiDisableApp(const HttpRequest& message);
 	void apiDeleteApp(const HttpRequest& message);
+	void apiBatchApps(const HttpRequest& message);
 	void apiFileDownload(const HttpRequest& message);
 	void apiFileUpload(const HttpRequest& message);
+	void apiUploadSessionCreate(const HttpRequest& message);
+	void apiUploadSessionStatus(const HttpRequest& message);
+	void apiUploadSessionChunk(const HttpRequest& message);
+	void apiUploadSessionCommit(const HttpRequest& message);
+	void apiUploadSessionAbort(const HttpRequest& message);
+	std::string getUploadSessionId(const HttpRequest& message) const;
 	void apiGetTags(const HttpRequest& message);
 	void apiTagAdd(const HttpRequest& message);
 	void apiTagDel(const HttpRequest& message);
 	void apiGetPermissions(const HttpRequest& message);
 	void apiGetBasicConfig(const HttpRequest& message);
 	void apiSetBasicConfig(const HttpRequest& message);
+	void apiReexec(const HttpRequest& message);
 	void apiChangePassword(const HttpRequest& message);
 	void apiLockUser(const HttpRequest& message);
 	void apiUnLockUser(const HttpRequest& message);
 	void apiHealth(const HttpRequest& message);
 
-	http_response requestHttp(const method& mtd, const std::string& path, std::map<std::string, std::string> query, std::map<std::string, std::string> header, web::json::value* body, const std::string& token);
+	pplx::task<http_response> requestHttp(const method& mtd, const std::string& path, std::map<std::string, std::string> query, std::map<std::string, std::string> header, web::json::value* body, const std::string& token);
 
 private:
 	std::unique_ptr<http_listener> m_listener;
@@ -84,8 +115,6 @@ private:
 	std::map<utility::string_t, std::function<void(const HttpRequest&)>> m_restDelFunctions;
 
 	std::recursive_mutex m_mutex;
-	// key: timerId, value: appName
-	std::map<int, std::string> m_tempAppsForClean;
 
 	// prometheus
 	prometheus::Counter* m_promScrapeCounter;
@@ -93,6 +122,8 @@ private:
 	prometheus::Counter* m_restPutCounter;
 	prometheus::Counter* m_restDelCounter;
 	prometheus::Counter* m_restPostCounter;
+	// key: <route class>/<user|client>
+	std::map<std::string, prometheus::Counter*> m_throttleCounters;
 };
 
 #endif
@@ -0,0 +1,224 @@
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include "RestartPolicy.h"
+
+RestartPolicy::RestartPolicy()
+	:m_defined(false), m_backoffInitialSeconds(DEFAULT_RESTART_BACKOFF_INITIAL_SECONDS), m_backoffMaxSeconds(DEFAULT_RESTART_BACKOFF_MAX_SECONDS),
+	m_backoffMultiplier(DEFAULT_RESTART_BACKOFF_MULTIPLIER), m_jitterPercent(DEFAULT_RESTART_JITTER_PERCENT), m_maxRestarts(DEFAULT_RESTART_MAX_RESTARTS),
+	m_windowSeconds(DEFAULT_RESTART_WINDOW_SECONDS), m_breakerSeconds(DEFAULT_RESTART_BREAKER_SECONDS), m_stableSeconds(DEFAULT_RESTART_STABLE_SECONDS),
+	m_historyHead(0), m_historyCount(0), m_state(State::NORMAL), m_failures(0), m_spawned(false), m_trial(false)
+{
+}
+
+RestartPolicy::~RestartPolicy()
+{
+}
+
+void RestartPolicy::dump()
+{
+	const static char fname[] = "RestartPolicy::dump() ";
+
+	LOG_DBG << fname << "m_backoffInitialSeconds:" << m_backoffInitialSeconds;
+	LOG_DBG << fname << "m_backoffMaxSeconds:" << m_backoffMaxSeconds;
+	LOG_DBG << fname << "m_backoffMultiplier:" << m_backoffMultiplier;
+	LOG_DBG << fname << "m_jitterPercent:" << m_jitterPercent;
+	LOG_DBG << fname << "m_maxRestarts:" << m_maxRestarts;
+	LOG_DBG << fname << "m_windowSeconds:" << m_windowSeconds;
+	LOG_DBG << fname << "m_breakerSeconds:" << m_breakerSeconds;
+	LOG_DBG << fname << "m_stableSeconds:" << m_stableSeconds;
+	LOG_DBG << fname << "m_state:" << getStateName();
+}
+
+web::json::value RestartPolicy::AsJson() const
+{
+	if (!m_defined) return web::json::value::null();
+
+	web::json::value result = web::json::value::object();
+	result[JSON_KEY_RESTART_backoff_initial_seconds] = web::json::value::number(m_backoffInitialSeconds);
+	result[JSON_KEY_RESTART_backoff_max_seconds] = web::json::value::number(m_backoffMaxSeconds);
+	result[JSON_KEY_RESTART_backoff_multiplier] = web::json::value::number(m_backoffMultiplier);
+	result[JSON_KEY_RESTART_jitter_percent] = web::json::value::number(m_jitterPercent);
+	result[JSON_KEY_RESTART_max_restarts] = web::json::value::number(m_maxRestarts);
+	result[JSON_KEY_RESTART_window_seconds] = web::json::value::number(m_windowSeconds);
+	result[JSON_KEY_RESTART_breaker_seconds] = web::json::value::number(m_breakerSeconds);
+	result[JSON_KEY_RESTART_stable_seconds] = web::json::value::number(m_stableSeconds);
+	return result;
+}
+
+std::shared_ptr<RestartPolicy> RestartPolicy::FromJson(const web::json::value& jobj)
+{
+	auto result = std::make_shared<RestartPolicy>();
+	if (!jobj.is_null())
+	{
+		result->m_defined = true;
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_backoff_initial_seconds, result->m_backoffInitialSeconds);
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_backoff_max_seconds, result->m_backoffMaxSeconds);
+		if (HAS_JSON_FIELD(jobj, JSON_KEY_RESTART_backoff_multiplier)) result->m_backoffMultiplier = GET_JSON_DOUBLE_VALUE(jobj, JSON_KEY_RESTART_backoff_multiplier);
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_jitter_percent, result->m_jitterPercent);
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_max_restarts, result->m_maxRestarts);
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_window_seconds, result->m_windowSeconds);
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_breaker_seconds, result->m_breakerSeconds);
+		SET_JSON_INT_VALUE(jobj, JSON_KEY_RESTART_stable_seconds, result->m_stableSeconds);
+
+		if (result->m_backoffInitialSeconds < 0 || result->m_backoffMaxSeconds < result->m_backoffInitialSeconds)
+		{
+			throw std::invalid_argument("backoff_initial_seconds should not be negative or greater than backoff_max_seconds");
+		}
+		if (result->m_backoffMultiplier < 1)
+		{
+			throw std::invalid_argument("backoff_multiplier should not be less than 1");
+		}
+		if (result->m_jitterPercent < 0 || result->m_jitterPercent > 100)
+		{
+			throw std::invalid_argument("jitter_percent should be between 0 and 100");
+		}
+		if (result->m_maxRestarts < 0 || result->m_maxRestarts > RESTART_HISTORY_SIZE)
+		{
+			throw std::invalid_argument("max_restarts should be between 0 and " + std::to_string(RESTART_HISTORY_SIZE));
+		}
+		if (result->m_windowSeconds <= 0 || result->m_breakerSeconds < 0 || result->m_stableSeconds < 0)
+		{
+			throw std::invalid_argument("window_seconds should be positive, breaker_seconds and stable_seconds should not be negative");
+		}
+	}
+	return result;
+}
+
+void RestartPolicy::onSpawn(const std::chrono::steady_clock::time_point& now)
+{
+	m_history[m_historyHead] = now;
+	m_historyHead = (m_historyHead + 1) % m_history.size();
+	m_historyCount = std::min(m_historyCount + 1, m_history.size());
+	m_spawnTime = now;
+	m_spawned = true;
+	if (m_state == State::CIRCUIT_OPEN)
+	{
+		m_state = State::BACKOFF;
+		m_trial = true;
+	}
+}
+
+void RestartPolicy::onAttach(const std::chrono::steady_clock::time_point& now)
+{
+	m_spawnTime = now;
+	m_spawned = true;
+}
+
+void RestartPolicy::onExit(const std::chrono::steady_clock::time_point& now)
+{
+	m_spawned = false;
+	// application without restart_policy is restarted at once as before
+	if (!m_defined || now - m_spawnTime >= std::chrono::seconds(m_stableSeconds))
+	{
+		m_state = State::NORMAL;
+		m_failures = 0;
+		m_trial = false;
+		m_nextStart = now;
+		return;
+	}
+
+	m_failures++;
+	if (m_trial || (m_maxRestarts > 0 && restartsInWindow(now) >= (size_t)m_maxRestarts))
+	{
+		m_state = State::CIRCUIT_OPEN;
+		m_trial = false;
+		m_nextStart = now + std::chrono::seconds(m_breakerSeconds);
+		return;
+	}
+	// restarts of many applications crashed together are spread
+	static thread_local std::mt19937 random(std::random_device{}());
+	const double jitter = m_jitterPercent / 100.0;
+	std::uniform_real_distribution<double> distribution(1 - jitter, 1 + jitter);
+	m_state = State::BACKOFF;
+	m_nextStart = now + std::chrono::milliseconds((int64_t)(backoffSeconds(m_failures) * distribution(random) * 1000));
+}
+
+void RestartPolicy::reset()
+{
+	m_historyHead = m_historyCount = 0;
+	m_state = State::NORMAL;
+	m_failures = 0;
+	m_spawned = m_trial = false;
+	m_nextStart = std::chrono::steady_clock::time_point();
+}
+
+std::chrono::system_clock::time_point RestartPolicy::getNextStartTime() const
+{
+	return std::chrono::system_clock::now() + std::chrono::duration_cast<std::chrono::system_clock::duration>(m_nextStart - std::chrono::steady_clock::now());
+}
+
+const char* RestartPolicy::getStateName() const
+{
+	switch (m_state)
+	{
+	case State::BACKOFF:
+		return RESTART_STATE_backoff;
+	case State::CIRCUIT_OPEN:
+		return RESTART_STATE_circuit_open;
+	default:
+		return RESTART_STATE_normal;
+	}
+}
+
+size_t RestartPolicy::restartsInWindow(const std::chrono::steady_clock::time_point& now) const
+{
+	const auto from = now - std::chrono::seconds(m_windowSeconds);
+	size_t count = 0;
+	for (size_t i = 0; i < m_historyCount; i++)
+	{
+		// newest first, stop at the first one out of window
+		const auto& time = m_history[(m_historyHead + m_history.size() - 1 - i) % m_history.size()];
+		if (time <= from) break;
+		count++;
+	}
+	return count;
+}
+
+web::json::value RestartPolicy::freezeState() const
+{
+	web::json::value state = web::json::value::object();
+	// oldest first
+	auto history = web::json::value::array(m_historyCount);
+	for (size_t i = 0; i < m_historyCount; i++)
+	{
+		const auto& time = m_history[(m_historyHead + m_history.size() - m_historyCount + i) % m_history.size()];
+		history[i] = web::json::value::number((int64_t)time.time_since_epoch().count());
+	}
+	state[JSON_KEY_REEXEC_history] = history;
+	state[JSON_KEY_REEXEC_failures] = web::json::value::number(m_failures);
+	state[JSON_KEY_REEXEC_state] = web::json::value::number(static_cast<int>(m_state));
+	state[JSON_KEY_REEXEC_spawned] = web::json::value::boolean(m_spawned);
+	state[JSON_KEY_REEXEC_trial] = web::json::value::boolean(m_trial);
+	state[JSON_KEY_REEXEC_spawn_time] = web::json::value::number((int64_t)m_spawnTime.time_since_epoch().count());
+	state[JSON_KEY_REEXEC_next_start] = web::json::value::number((int64_t)m_nextStart.time_since_epoch().count());
+	return state;
+}
+
+void RestartPolicy::restoreState(const web::json::value& state)
+{
+	typedef std::chrono::steady_clock::time_point TimePoint;
+	reset();
+	if (HAS_JSON_FIELD(state, JSON_KEY_REEXEC_history))
+	{
+		for (const auto& time : state.at(JSON_KEY_REEXEC_history).as_array())
+		{
+			m_history[m_historyHead] = TimePoint(TimePoint::duration(time.as_number().to_int64()));
+			m_historyHead = (m_historyHead + 1) % m_history.size();
+			m_historyCount = std::min(m_historyCount + 1, m_history.size());
+		}
+	}
+	m_failures = GET_JSON_INT_VALUE(state, JSON_KEY_REEXEC_failures);
+	auto stateValue = GET_JSON_INT_VALUE(state, JSON_KEY_REEXEC_state);
+	if (stateValue >= static_cast<int>(State::NORMAL) && stateValue <= static_cast<int>(State::CIRCUIT_OPEN)) m_state = static_cast<State>(stateValue);
+	m_spawned = GET_JSON_BOOL_VALUE(state, JSON_KEY_REEXEC_spawned);
+	m_trial = GET_JSON_BOOL_VALUE(state, JSON_KEY_REEXEC_trial);
+	m_spawnTime = TimePoint(TimePoint::duration(GET_JSON_NUMBER_VALUE(state, JSON_KEY_REEXEC_spawn_time)));
+	m_nextStart = TimePoint(TimePoint::duration(GET_JSON_NUMBER_VALUE(state, JSON_KEY_REEXEC_next_start)));
+}
+
+double RestartPolicy::backoffSeconds(int failures) const
+{
+	return std::min((double)m_backoffMaxSeconds, m_backoffInitialSeconds * std::pow(m_backoffMultiplier, std::min(failures - 1, 64)));
+}
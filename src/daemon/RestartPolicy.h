@@ -0,0 +1,88 @@
+#ifndef RESTART_POLICY_H
+#define RESTART_POLICY_H
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cpprest/json.h>
+#include "../common/Utility.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Restart of a long running application process: a process exited before
+// running stable_seconds restarts after an exponential backoff with jitter,
+// more than max_restarts restarts in window_seconds open the circuit breaker
+// and the application is not restarted in breaker_seconds, then one attempt
+// is made and a quick exit opens it again. Backoff and circuit breaker
+// only apply when restart_policy is defined. Restart times are kept in a
+// fixed ring. Deadlines use steady clock and are not moved by wall clock
+// change. Not thread safe, protected by the application lock.
+//////////////////////////////////////////////////////////////////////////
+class RestartPolicy
+{
+public:
+	enum class State
+	{
+		NORMAL = 0,
+		BACKOFF,
+		CIRCUIT_OPEN
+	};
+
+	RestartPolicy();
+	virtual ~RestartPolicy();
+	void dump();
+
+	// configuration only, AsJson is null when restart_policy was not defined
+	virtual web::json::value AsJson() const;
+	// default policy when <obj> is null
+	static std::shared_ptr<RestartPolicy> FromJson(const web::json::value& obj);
+
+	// process is spawned
+	void onSpawn(const std::chrono::steady_clock::time_point& now);
+	// running process attached at daemon start, its exit is handled as spawned without counting a restart
+	void onAttach(const std::chrono::steady_clock::time_point& now);
+	// process spawned by onSpawn() exited, decide when next spawn is allowed
+	void onExit(const std::chrono::steady_clock::time_point& now);
+	bool spawned() const { return m_spawned; }
+	bool ready(const std::chrono::steady_clock::time_point& now) const { return now >= m_nextStart; }
+	// forget history and close circuit breaker, such as application is enabled again
+	void reset();
+
+	State getState() const { return m_state; }
+	const char* getStateName() const;
+	// next allowed spawn as wall clock, for report only
+	std::chrono::system_clock::time_point getNextStartTime() const;
+	size_t restartsInWindow(const std::chrono::steady_clock::time_point& now) const;
+
+	// hot upgrade: runtime state passed to new daemon, steady clock is not reset by exec
+	web::json::value freezeState() const;
+	void restoreState(const web::json::value& state);
+
+private:
+	// delay before restart after <failures> quick exits, jitter not included
+	double backoffSeconds(int failures) const;
+
+	bool m_defined;
+	int m_backoffInitialSeconds;
+	int m_backoffMaxSeconds;
+	double m_backoffMultiplier;
+	int m_jitterPercent;
+	int m_maxRestarts;
+	int m_windowSeconds;
+	int m_breakerSeconds;
+	int m_stableSeconds;
+
+	// runtime
+	std::array<std::chrono::steady_clock::time_point, RESTART_HISTORY_SIZE> m_history;
+	size_t m_historyHead;
+	size_t m_historyCount;
+	State m_state;
+	// consecutive exits before stable_seconds
+	int m_failures;
+	bool m_spawned;
+	// the attempt after circuit breaker opened
+	bool m_trial;
+	std::chrono::steady_clock::time_point m_spawnTime;
+	std::chrono::steady_clock::time_point m_nextStart;
+};
+
+#endif
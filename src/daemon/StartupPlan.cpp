@@ -0,0 +1,230 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "StartupPlan.h"
+#include "Application.h"
+#include "../common/Utility.h"
+#include "Configuration.h"
+
+StartupPlan::StartupPlan(const std::vector<std::shared_ptr<Application>>& apps)
+{
+	const size_t count = apps.size();
+	std::map<std::string, size_t> indexes;
+	for (size_t i = 0; i < count; i++) indexes[apps[i]->getName()] = i;
+
+	// pending: dependencies not placed yet
+	std::vector<size_t> pending(count, 0);
+	std::vector<std::vector<size_t>> dependencies(count);
+	std::vector<std::vector<size_t>> dependents(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (const auto& dependency : apps[i]->getDependsOn())
+		{
+			auto it = indexes.find(dependency.first);
+			if (it == indexes.end())
+			{
+				if (m_error.empty()) m_error = "application <" + apps[i]->getName() + "> depends on unknown application <" + dependency.first + ">";
+				continue;
+			}
+			pending[i]++;
+			dependencies[i].push_back(it->second);
+			dependents[it->second].push_back(i);
+		}
+	}
+
+	std::vector<size_t> current;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (pending[i] == 0) current.push_back(i);
+	}
+	size_t placed = 0;
+	while (current.size())
+	{
+		std::vector<std::shared_ptr<Application>> level;
+		std::vector<size_t> next;
+		for (auto i : current)
+		{
+			level.push_back(apps[i]);
+			m_appLevels[apps[i]->getName()] = m_levels.size();
+			for (auto dependent : dependents[i])
+			{
+				if (--pending[dependent] == 0) next.push_back(dependent);
+			}
+		}
+		placed += level.size();
+		m_levels.push_back(level);
+		// keep registry order inside one level
+		std::sort(next.begin(), next.end());
+		current.swap(next);
+	}
+
+	if (placed < count)
+	{
+		// every application left has a dependency left, follow them until one repeats
+		size_t i = std::find_if(pending.begin(), pending.end(), [](size_t p) { return p > 0; }) - pending.begin();
+		std::vector<int> pathIndex(count, -1);
+		std::vector<size_t> path;
+		while (pathIndex[i] < 0)
+		{
+			pathIndex[i] = path.size();
+			path.push_back(i);
+			i = *std::find_if(dependencies[i].begin(), dependencies[i].end(), [&pending](size_t d) { return pending[d] > 0; });
+		}
+		std::string cycle;
+		for (size_t p = pathIndex[i]; p < path.size(); p++) cycle.append(apps[path[p]]->getName()).append(" -> ");
+		cycle.append(apps[i]->getName());
+		if (m_error.empty()) m_error = "dependency cycle: " + cycle;
+
+		std::vector<std::shared_ptr<Application>> level;
+		for (size_t j = 0; j < count; j++)
+		{
+			if (pending[j] == 0) continue;
+			level.push_back(apps[j]);
+			m_appLevels[apps[j]->getName()] = m_levels.size();
+		}
+		m_levels.push_back(level);
+	}
+}
+
+StartupPlan::~StartupPlan()
+{
+}
+
+void StartupPlan::validate(const std::vector<std::shared_ptr<Application>>& apps)
+{
+	StartupPlan plan(apps);
+	if (plan.error().length()) throw std::invalid_argument(plan.error());
+}
+
+size_t StartupPlan::level(const std::string& appName) const
+{
+	auto it = m_appLevels.find(appName);
+	return (it != m_appLevels.end()) ? it->second : 0;
+}
+
+void StartupPlan::invoke(size_t concurrency) const
+{
+	// next level is invoked after all spawned, so a started dependency is seen in the same round
+	for (const auto& level : m_levels)
+	{
+		StartupWorkers::instance()->invoke(level, concurrency);
+	}
+}
+
+StartupWorkers::StartupWorkers()
+	:m_apps(nullptr), m_round(0), m_helpers(0), m_joined(0), m_next(0), m_threads(0), m_exit(false)
+{
+}
+
+StartupWorkers::~StartupWorkers()
+{
+}
+
+std::unique_ptr<StartupWorkers>& StartupWorkers::instance()
+{
+	static std::unique_ptr<StartupWorkers> singleton = std::make_unique<StartupWorkers>();
+	return singleton;
+}
+
+void StartupWorkers::invoke(const std::vector<std::shared_ptr<Application>>& apps, size_t concurrency)
+{
+	const size_t helpers = std::min(std::max(concurrency, (size_t)1), apps.size()) - 1;
+	if (helpers == 0)
+	{
+		for (const auto& app : apps) invokeApp(app);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		grow(helpers);
+		m_apps = &apps;
+		m_next = 0;
+		m_helpers = std::min(helpers, m_threads);
+		m_joined = 0;
+		m_round++;
+	}
+	m_wakeup.notify_all();
+	work(apps);
+
+	// no more pool thread joins this level, wait for the joined ones
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_helpers = 0;
+	m_finished.wait(lock, [this]() { return m_joined == 0; });
+	m_apps = nullptr;
+}
+
+int StartupWorkers::svc(void)
+{
+	uint64_t round = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wakeup.wait(lock, [this, &round]() { return m_exit || (m_round != round && m_joined < m_helpers); });
+		if (m_exit) break;
+		round = m_round;
+		m_joined++;
+		auto apps = m_apps;
+		lock.unlock();
+		work(*apps);
+		lock.lock();
+		if (--m_joined == 0) m_finished.notify_all();
+	}
+	return 0;
+}
+
+int StartupWorkers::open(void* args)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	grow(Configuration::instance()->getStartupConcurrency() - 1);
+	return 0;
+}
+
+int StartupWorkers::close(u_long flags)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_exit = true;
+	}
+	m_wakeup.notify_all();
+	return ACE_Task_Base::close(flags);
+}
+
+void StartupWorkers::grow(size_t count)
+{
+	const static char fname[] = "StartupWorkers::grow() ";
+
+	if (count <= m_threads) return;
+	// add threads to the running group
+	if (activate(THR_NEW_LWP | THR_JOINABLE, (int)(count - m_threads), 1) == 0)
+	{
+		LOG_INF << fname << "startup worker threads <" << m_threads << "> to <" << count << ">";
+		m_threads = count;
+	}
+	else
+	{
+		LOG_ERR << fname << "failed to start worker threads with error: " << std::strerror(errno);
+	}
+}
+
+void StartupWorkers::work(const std::vector<std::shared_ptr<Application>>& apps)
+{
+	for (size_t i = m_next++; i < apps.size(); i = m_next++) invokeApp(apps[i]);
+}
+
+void StartupWorkers::invokeApp(const std::shared_ptr<Application>& app)
+{
+	const static char fname[] = "StartupWorkers::invokeApp() ";
+
+	try
+	{
+		app->invoke();
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERR << fname << "application <" << app->getName() << "> invoke failed: " << e.what();
+	}
+	catch (...)
+	{
+		LOG_ERR << fname << "application <" << app->getName() << "> invoke failed with unknown exception";
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef STARTUP_PLAN_H
+#define STARTUP_PLAN_H
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+#include <ace/Task.h>
+
+class Application;
+
+//////////////////////////////////////////////////////////////////////////
+// Start order of applications from depends_on: an application is one level
+// after its deepest dependency, applications of the same level do not depend
+// on each other and are invoked in parallel. Stop order is the reverse.
+// Built once when the registry changed, see Configuration::getStartupPlan().
+//////////////////////////////////////////////////////////////////////////
+class StartupPlan
+{
+public:
+	// unknown dependency or dependency cycle is kept in error(), applications in a cycle go to the last level
+	explicit StartupPlan(const std::vector<std::shared_ptr<Application>>& apps);
+	virtual ~StartupPlan();
+	// throw std::invalid_argument for unknown dependency or dependency cycle
+	static void validate(const std::vector<std::shared_ptr<Application>>& apps);
+
+	const std::string& error() const { return m_error; }
+	// 0 for application not in plan
+	size_t level(const std::string& appName) const;
+	// invoke applications level by level by StartupWorkers, at most <concurrency> threads for one level
+	void invoke(size_t concurrency) const;
+
+private:
+	std::vector<std::vector<std::shared_ptr<Application>>> m_levels;
+	std::map<std::string, size_t> m_appLevels;
+	std::string m_error;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Persistent threads invoking applications of one level together with the
+// calling thread, the pool grows to the largest concurrency requested and
+// threads wait for the next level between schedule rounds.
+//////////////////////////////////////////////////////////////////////////
+class StartupWorkers : public ACE_Task_Base
+{
+public:
+	StartupWorkers();
+	virtual ~StartupWorkers();
+	static std::unique_ptr<StartupWorkers>& instance();
+
+	// invoke <apps> with the calling thread and at most <concurrency> - 1 pool threads,
+	// return after all invoked, called by one thread at a time
+	void invoke(const std::vector<std::shared_ptr<Application>>& apps, size_t concurrency);
+
+	virtual int svc(void) override;
+	// start <StartupConcurrency> - 1 threads
+	virtual int open(void* args = 0) override;
+	virtual int close(u_long flags = 0) override;
+
+private:
+	// start threads up to <count>, m_mutex should be locked
+	void grow(size_t count);
+	// take and invoke applications of <apps> until none left
+	void work(const std::vector<std::shared_ptr<Application>>& apps);
+	static void invokeApp(const std::shared_ptr<Application>& app);
+
+private:
+	std::mutex m_mutex;
+	// new level to invoke or exit
+	std::condition_variable m_wakeup;
+	// a pool thread finished its part of current level
+	std::condition_variable m_finished;
+	const std::vector<std::shared_ptr<Application>>* m_apps;
+	uint64_t m_round;
+	// pool threads allowed to join current level, and joined
+	size_t m_helpers;
+	size_t m_joined;
+	std::atomic<size_t> m_next;
+	size_t m_threads;
+	bool m_exit;
+};
+
+#endif
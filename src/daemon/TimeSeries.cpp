@@ -0,0 +1,384 @@
+#include <cstring>
+#include <algorithm>
+#include "TimeSeries.h"
+#include "../common/Utility.h"
+
+// worst case of one point: 4 + 32 bits timestamp, 2 + 5 + 6 + 64 bits value
+#define TIMESERIES_MAX_POINT_BITS (36 + 77)
+
+namespace
+{
+	struct BitReader
+	{
+		explicit BitReader(const uint8_t* data) :m_data(data), m_pos(0) {}
+		uint64_t read(int bits)
+		{
+			uint64_t value = 0;
+			while (bits > 0)
+			{
+				int avail = 8 - (m_pos & 7);
+				int n = std::min(bits, avail);
+				value = (value << n) | ((m_data[m_pos >> 3] >> (avail - n)) & ((1u << n) - 1));
+				m_pos += n;
+				bits -= n;
+			}
+			return value;
+		}
+		const uint8_t* m_data;
+		size_t m_pos;
+	};
+
+	inline int64_t signExtend(uint64_t value, int bits)
+	{
+		return static_cast<int64_t>(value << (64 - bits)) >> (64 - bits);
+	}
+}
+
+TimeSeriesChunk::TimeSeriesChunk()
+	:m_bitPos(0), m_count(0), m_firstTime(0), m_lastTime(0), m_lastDelta(0), m_lastValue(0), m_lastLeading(-1), m_lastTrailing(0)
+{
+	std::memset(m_data, 0, sizeof(m_data));
+}
+
+void TimeSeriesChunk::writeBits(uint64_t value, int bits)
+{
+	while (bits > 0)
+	{
+		int avail = 8 - (m_bitPos & 7);
+		int n = std::min(bits, avail);
+		uint8_t part = (value >> (bits - n)) & ((1u << n) - 1);
+		m_data[m_bitPos >> 3] |= part << (avail - n);
+		m_bitPos += n;
+		bits -= n;
+	}
+}
+
+bool TimeSeriesChunk::append(int64_t timestamp, double value)
+{
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	if (m_count == 0)
+	{
+		// chunk header keep the first point uncompressed
+		writeBits(static_cast<uint64_t>(timestamp), 64);
+		writeBits(bits, 64);
+		m_firstTime = m_lastTime = timestamp;
+		m_lastDelta = 0;
+		m_lastValue = bits;
+		m_count = 1;
+		return true;
+	}
+	if (m_bitPos + TIMESERIES_MAX_POINT_BITS > sizeof(m_data) * 8)
+	{
+		return false;
+	}
+
+	// timestamp
+	int64_t delta = timestamp - m_lastTime;
+	int64_t dod = delta - m_lastDelta;
+	if (dod == 0)
+	{
+		writeBits(0, 1);
+	}
+	else if (dod >= -64 && dod <= 63)
+	{
+		writeBits(0x2, 2);
+		writeBits(static_cast<uint64_t>(dod), 7);
+	}
+	else if (dod >= -256 && dod <= 255)
+	{
+		writeBits(0x6, 3);
+		writeBits(static_cast<uint64_t>(dod), 9);
+	}
+	else if (dod >= -2048 && dod <= 2047)
+	{
+		writeBits(0xE, 4);
+		writeBits(static_cast<uint64_t>(dod), 12);
+	}
+	else if (dod >= INT32_MIN && dod <= INT32_MAX)
+	{
+		writeBits(0xF, 4);
+		writeBits(static_cast<uint64_t>(dod), 32);
+	}
+	else
+	{
+		// gap too large, start a new chunk
+		return false;
+	}
+	m_lastDelta = delta;
+	m_lastTime = timestamp;
+
+	// value
+	uint64_t xorValue = bits ^ m_lastValue;
+	if (xorValue == 0)
+	{
+		writeBits(0, 1);
+	}
+	else
+	{
+		int leading = std::min(__builtin_clzll(xorValue), 31);
+		int trailing = __builtin_ctzll(xorValue);
+		if (m_lastLeading >= 0 && leading >= m_lastLeading && trailing >= m_lastTrailing)
+		{
+			// meaningful bits fit in previous window
+			writeBits(0x2, 2);
+			writeBits(xorValue >> m_lastTrailing, 64 - m_lastLeading - m_lastTrailing);
+		}
+		else
+		{
+			int meaningful = 64 - leading - trailing;
+			writeBits(0x3, 2);
+			writeBits(leading, 5);
+			writeBits(meaningful - 1, 6);
+			writeBits(xorValue >> trailing, meaningful);
+			m_lastLeading = leading;
+			m_lastTrailing = trailing;
+		}
+	}
+	m_lastValue = bits;
+	m_count++;
+	return true;
+}
+
+void TimeSeriesChunk::forEach(const std::function<void(int64_t timestamp, double value)>& visitor) const
+{
+	if (m_count == 0) return;
+
+	BitReader reader(m_data);
+	int64_t timestamp = static_cast<int64_t>(reader.read(64));
+	uint64_t bits = reader.read(64);
+	int64_t delta = 0;
+	int leading = 0;
+	int trailing = 0;
+	double value;
+	std::memcpy(&value, &bits, sizeof(value));
+	visitor(timestamp, value);
+
+	for (size_t i = 1; i < m_count; i++)
+	{
+		int64_t dod = 0;
+		if (reader.read(1))
+		{
+			if (!reader.read(1)) dod = signExtend(reader.read(7), 7);
+			else if (!reader.read(1)) dod = signExtend(reader.read(9), 9);
+			else if (!reader.read(1)) dod = signExtend(reader.read(12), 12);
+			else dod = signExtend(reader.read(32), 32);
+		}
+		delta += dod;
+		timestamp += delta;
+
+		if (reader.read(1))
+		{
+			if (reader.read(1))
+			{
+				leading = static_cast<int>(reader.read(5));
+				int meaningful = static_cast<int>(reader.read(6)) + 1;
+				trailing = 64 - leading - meaningful;
+			}
+			bits ^= reader.read(64 - leading - trailing) << trailing;
+		}
+		std::memcpy(&value, &bits, sizeof(value));
+		visitor(timestamp, value);
+	}
+}
+
+TimeSeries::TimeSeries()
+{
+}
+
+int TimeSeries::append(int64_t timestamp, double value, bool overBudget)
+{
+	// out of order point is dropped
+	if (!m_chunks.empty() && timestamp < m_chunks.back()->lastTime()) return 0;
+
+	int allocated = 0;
+	if (m_chunks.empty() || !m_chunks.back()->append(timestamp, value))
+	{
+		// over memory budget, recycle the oldest chunk of this series
+		if (overBudget && !m_chunks.empty())
+		{
+			m_chunks.pop_front();
+			allocated--;
+		}
+		m_chunks.push_back(std::make_unique<TimeSeriesChunk>());
+		m_chunks.back()->append(timestamp, value);
+		allocated++;
+	}
+	return allocated;
+}
+
+int TimeSeries::expire(int64_t before)
+{
+	int released = 0;
+	while (!m_chunks.empty() && m_chunks.front()->lastTime() < before)
+	{
+		m_chunks.pop_front();
+		released++;
+	}
+	return released;
+}
+
+std::vector<TimeSeriesBucket> TimeSeries::query(int64_t from, int64_t to, int64_t step) const
+{
+	std::vector<TimeSeriesBucket> buckets;
+	if (step <= 0 || to < from) return buckets;
+
+	buckets.resize((to - from) / step + 1);
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		buckets[i].time = from + static_cast<int64_t>(i) * step;
+		buckets[i].count = 0;
+		buckets[i].sum = 0;
+	}
+	for (const auto& chunk : m_chunks)
+	{
+		if (chunk->lastTime() < from || chunk->firstTime() > to) continue;
+		chunk->forEach([&buckets, from, to, step](int64_t timestamp, double value)
+			{
+				if (timestamp < from || timestamp > to) return;
+				auto& bucket = buckets[(timestamp - from) / step];
+				if (bucket.count == 0 || value < bucket.min) bucket.min = value;
+				if (bucket.count == 0 || value > bucket.max) bucket.max = value;
+				bucket.sum += value;
+				bucket.count++;
+			});
+	}
+	buckets.erase(std::remove_if(buckets.begin(), buckets.end(), [](const TimeSeriesBucket& bucket) { return bucket.count == 0; }), buckets.end());
+	return buckets;
+}
+
+size_t TimeSeries::pointCount() const
+{
+	size_t count = 0;
+	for (const auto& chunk : m_chunks) count += chunk->count();
+	return count;
+}
+
+TimeSeriesStore::TimeSeriesStore(int retentionSeconds, size_t maxMemoryBytes)
+	:m_chunks(0), m_seriesCount(0), m_retentionSeconds(retentionSeconds), m_maxMemoryBytes(maxMemoryBytes)
+{
+}
+
+TimeSeriesStore::~TimeSeriesStore()
+{
+}
+
+std::unique_ptr<TimeSeriesStore>& TimeSeriesStore::instance()
+{
+	static auto singleton = std::make_unique<TimeSeriesStore>(DEFAULT_TIMESERIES_RETENTION_SECONDS, MAX_TIMESERIES_MEMORY_BYTES);
+	return singleton;
+}
+
+void TimeSeriesStore::append(const std::string& app, const std::string& metric, int64_t timestamp, double value)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto& metrics = m_series[app];
+	auto it = metrics.find(metric);
+	if (it == metrics.end())
+	{
+		it = metrics.insert(std::make_pair(metric, TimeSeries())).first;
+		m_seriesCount++;
+	}
+	bool overBudget = (m_chunks * sizeof(TimeSeriesChunk) >= m_maxMemoryBytes);
+	m_chunks += it->second.append(timestamp, value, overBudget);
+}
+
+web::json::value TimeSeriesStore::query(const std::string& app, const std::string& metric, int64_t from, int64_t to, int64_t step)
+{
+	if (step <= 0)
+	{
+		step = std::max<int64_t>(1, (to - from + MAX_TIMESERIES_QUERY_POINTS - 1) / MAX_TIMESERIES_QUERY_POINTS);
+	}
+	if ((to - from) / step >= MAX_TIMESERIES_QUERY_POINTS * 10)
+	{
+		throw std::invalid_argument("too many points requested, please use a larger step");
+	}
+
+	std::vector<TimeSeriesBucket> buckets;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		auto appIt = m_series.find(app);
+		if (appIt != m_series.end())
+		{
+			auto it = appIt->second.find(metric);
+			if (it != appIt->second.end()) buckets = it->second.query(from, to, step);
+		}
+	}
+
+	// columnar format to keep response small
+	std::vector<web::json::value> times, mins, maxs, avgs;
+	for (const auto& bucket : buckets)
+	{
+		times.push_back(web::json::value::number(bucket.time));
+		mins.push_back(web::json::value::number(bucket.min));
+		maxs.push_back(web::json::value::number(bucket.max));
+		avgs.push_back(web::json::value::number(bucket.sum / bucket.count));
+	}
+	web::json::value result = web::json::value::object();
+	result[JSON_KEY_TIMESERIES_time] = web::json::value::array(times);
+	result[JSON_KEY_TIMESERIES_min] = web::json::value::array(mins);
+	result[JSON_KEY_TIMESERIES_max] = web::json::value::array(maxs);
+	result[JSON_KEY_TIMESERIES_avg] = web::json::value::array(avgs);
+	return result;
+}
+
+std::vector<std::string> TimeSeriesStore::getMetrics(const std::string& app)
+{
+	std::vector<std::string> metrics;
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto appIt = m_series.find(app);
+	if (appIt != m_series.end())
+	{
+		for (const auto& series : appIt->second) metrics.push_back(series.first);
+	}
+	return metrics;
+}
+
+void TimeSeriesStore::removeApp(const std::string& app)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto appIt = m_series.find(app);
+	if (appIt != m_series.end())
+	{
+		for (const auto& series : appIt->second) m_chunks -= series.second.chunkCount();
+		m_seriesCount -= appIt->second.size();
+		m_series.erase(appIt);
+	}
+}
+
+void TimeSeriesStore::expire(int64_t now)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (auto& app : m_series)
+	{
+		for (auto& series : app.second)
+		{
+			m_chunks -= series.second.expire(now - m_retentionSeconds);
+		}
+	}
+}
+
+size_t TimeSeriesStore::getMemoryBytes()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// chunk memory plus an estimation of container node overhead
+	return m_chunks * (sizeof(TimeSeriesChunk) + 3 * sizeof(void*)) + m_seriesCount * (sizeof(TimeSeries) + 64);
+}
+
+web::json::value TimeSeriesStore::AsJson()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	size_t points = 0;
+	for (const auto& app : m_series)
+	{
+		for (const auto& series : app.second) points += series.second.pointCount();
+	}
+	web::json::value result = web::json::value::object();
+	result[JSON_KEY_TIMESERIES_series] = web::json::value::number((uint64_t)m_seriesCount);
+	result[JSON_KEY_TIMESERIES_chunks] = web::json::value::number((uint64_t)m_chunks);
+	result[JSON_KEY_TIMESERIES_points] = web::json::value::number((uint64_t)points);
+	result[JSON_KEY_TIMESERIES_memory_bytes] = web::json::value::number((uint64_t)getMemoryBytes());
+	result[JSON_KEY_TIMESERIES_memory_limit_bytes] = web::json::value::number((uint64_t)m_maxMemoryBytes);
+	result[JSON_KEY_TIMESERIES_retention_seconds] = web::json::value::number(m_retentionSeconds);
+	return result;
+}
@@ -0,0 +1,113 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <cpprest/json.h>
+
+// bytes of one compressed chunk, about 350 points of a regular series
+#define TIMESERIES_CHUNK_BYTES 512
+
+//////////////////////////////////////////////////////////////////////////
+// Fixed size block of compressed points (Gorilla encoding):
+//  timestamp: delta-of-delta in variable bit length
+//  value: XOR with previous value, only the meaningful bits are stored
+//////////////////////////////////////////////////////////////////////////
+class TimeSeriesChunk
+{
+public:
+	TimeSeriesChunk();
+	// return false when chunk is full, timestamp must not be older than last point
+	bool append(int64_t timestamp, double value);
+	void forEach(const std::function<void(int64_t timestamp, double value)>& visitor) const;
+
+	int64_t firstTime() const { return m_firstTime; }
+	int64_t lastTime() const { return m_lastTime; }
+	size_t count() const { return m_count; }
+	size_t usedBytes() const { return (m_bitPos + 7) / 8; }
+
+private:
+	void writeBits(uint64_t value, int bits);
+
+private:
+	uint8_t m_data[TIMESERIES_CHUNK_BYTES];
+	size_t m_bitPos;
+	size_t m_count;
+	int64_t m_firstTime;
+	int64_t m_lastTime;
+	int64_t m_lastDelta;
+	uint64_t m_lastValue;
+	int m_lastLeading;
+	int m_lastTrailing;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Downsampled result, one bucket per step
+//////////////////////////////////////////////////////////////////////////
+struct TimeSeriesBucket
+{
+	int64_t time;
+	double min;
+	double max;
+	double sum;
+	size_t count;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// One metric of one application, list of chunks ordered by time
+//////////////////////////////////////////////////////////////////////////
+class TimeSeries
+{
+public:
+	TimeSeries();
+	// return number of chunks allocated (1) or released (-N) by this append
+	int append(int64_t timestamp, double value, bool overBudget);
+	// drop chunks older than <before>, return number of chunks released
+	int expire(int64_t before);
+	std::vector<TimeSeriesBucket> query(int64_t from, int64_t to, int64_t step) const;
+	size_t chunkCount() const { return m_chunks.size(); }
+	size_t pointCount() const;
+
+private:
+	std::list<std::unique_ptr<TimeSeriesChunk>> m_chunks;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Embedded in-memory time series store, series key is app name + metric
+// memory is bounded by retention and a global chunk budget
+//////////////////////////////////////////////////////////////////////////
+class TimeSeriesStore
+{
+public:
+	TimeSeriesStore(int retentionSeconds, size_t maxMemoryBytes);
+	virtual ~TimeSeriesStore();
+	// Internal Singleton.
+	static std::unique_ptr<TimeSeriesStore>& instance();
+
+	void append(const std::string& app, const std::string& metric, int64_t timestamp, double value);
+	// downsample to min/max/avg per step, step 0 means choose by MAX_TIMESERIES_QUERY_POINTS
+	web::json::value query(const std::string& app, const std::string& metric, int64_t from, int64_t to, int64_t step);
+	std::vector<std::string> getMetrics(const std::string& app);
+	void removeApp(const std::string& app);
+	// remove points out of retention
+	void expire(int64_t now);
+
+	size_t getMemoryBytes();
+	web::json::value AsJson();
+
+private:
+	// app name -> metric -> series
+	std::map<std::string, std::map<std::string, TimeSeries>> m_series;
+	size_t m_chunks;
+	size_t m_seriesCount;
+	const int m_retentionSeconds;
+	const size_t m_maxMemoryBytes;
+	std::recursive_mutex m_mutex;
+};
+
+#endif
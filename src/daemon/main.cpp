@@ -14,6 +14,13 @@
 #include "ResourceCollection.h"
 #include "TimerHandler.h"
 #include "HealthCheckTask.h"
+#include "JobTable.h"
+#include "ProcessTracker.h"
+#include "ProcessSnapshot.h"
+#include "HotUpgrade.h"
+#include "OutputStore.h"
+#include "StartupPlan.h"
+#include "CronScheduler.h"
 
 int main(int argc, char* argv[])
 {
@@ -23,6 +30,7 @@ int main(int argc, char* argv[])
 	try
 	{
 		ACE::init();
+		HotUpgrade::instance()->setArguments(argc, argv);
 		// set working dir
 		ACE_OS::chdir(Utility::getSelfDir().c_str());
 
@@ -35,14 +43,25 @@ int main(int argc, char* argv[])
 		// get configuration
 		auto config = Configuration::FromJson(Configuration::readConfiguration());
 		Configuration::instance(config);
+		JobTable::instance()->setPolicy(config->getJobQueuePolicy());
 
 		// set log level
 		Utility::setLogLevel(config->getLogLevel());
 		Configuration::instance()->dump();
 
-		// Resource init
+		// started by hot upgrade: take over processes and output pipes from previous binary
+		HotUpgrade::instance()->restore();
+
+		// process tree tracker should be ready before the first sample
+		if (config->getProcessTrackerEnabled())
+		{
+			ProcessTracker::instance()->open();
+		}
+
+		// Resource init, first sample is taken here and refreshed by sampler thread
 		ResourceCollection::instance()->getHostResource();
 		ResourceCollection::instance()->dump();
+		ResourceCollection::instance()->open();
 
 		std::shared_ptr<RestHandler> httpServerIp4;
 		std::shared_ptr<RestHandler> httpServerIp6;
@@ -80,25 +99,38 @@ int main(int argc, char* argv[])
 			LOG_INF << fname << "initialize_with_threads:" << config->getThreadPoolSize();
 		}
 
-		// HA attach process to App
+		// HA attach process to App with one /proc snapshot,
+		// apps attached by pid from configuration go first, so their processes are not matched by command line
 		auto apps = config->getApps();
-		std::map<std::string, int> process;
-		AppProcess::getSysProcessList(process, nullptr);
-		std::for_each(apps.begin(), apps.end(), [&process](std::vector<std::shared_ptr<Application>>::reference p) { p->attach(process); });
+		std::stable_partition(apps.begin(), apps.end(), [](std::vector<std::shared_ptr<Application>>::reference p) { return p->getPid() > 0; });
+		auto snapshot = ProcessSnapshot::capture();
+		std::for_each(apps.begin(), apps.end(), [&snapshot](std::vector<std::shared_ptr<Application>>::reference p) { p->attach(*snapshot); });
 
 		// start one thread for timers
 		auto timerThread = std::make_unique<std::thread>(std::bind(&TimerHandler::runTimerThread));
 		// start one thread for health check
 		HealthCheckTask::instance()->open();
+		// start one thread for cron applications
+		CronScheduler::instance()->open();
+		// start one thread for remote run job timeout and expiry
+		JobTable::instance()->open();
+		// start StartupConcurrency - 1 threads invoking applications together with main thread
+		StartupWorkers::instance()->open();
 
 		// monitor applications
 		while (true)
 		{
 			std::this_thread::sleep_for(std::chrono::seconds(Configuration::instance()->getScheduleInterval()));
-			auto apps = Configuration::instance()->getApps();
-			for (const auto& app : apps)
+			if (HotUpgrade::instance()->requested())
+			{
+				HotUpgrade::instance()->reexec();
+			}
+			// dependencies are invoked before their dependents, independent apps in parallel
+			Configuration::instance()->getStartupPlan()->invoke(Configuration::instance()->getStartupConcurrency());
+			// bound data lost when daemon crash, drop history out of retention
+			if (Configuration::instance()->getOutputStoreEnabled())
 			{
-				app->invoke();
+				OutputStore::instance()->flush(std::time(nullptr));
 			}
 		}
 	}